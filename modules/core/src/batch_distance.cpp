@@ -215,16 +215,32 @@ struct BatchDistInvoker : public ParallelLoopBody
 
     void operator()(const Range& range) const CV_OVERRIDE
     {
-        AutoBuffer<int> buf(src2->rows);
+        // The train set is processed in blocks that stay in cache while
+        // all the query rows of this range are compared against them.
+        // The rows inside a block are still visited in increasing order,
+        // so the K-best lists are the same as with a single pass.
+        const int blockSize = std::max(std::min(src2->rows, (int)(BLOCK_BYTES / std::max(src2->step.p[0], (size_t)1))), 1);
+        AutoBuffer<int> buf(blockSize);
         int* bufptr = buf.data();
 
-        for( int i = range.start; i < range.end; i++ )
+        for( int j0 = 0; j0 < src2->rows; j0 += blockSize )
         {
-            func(src1->ptr(i), src2->ptr(), src2->step, src2->rows, src2->cols,
-                 K > 0 ? (uchar*)bufptr : dist->ptr(i), mask->data ? mask->ptr(i) : 0);
+            int nvecs = std::min(blockSize, src2->rows - j0);
 
-            if( K > 0 )
+            for( int i = range.start; i < range.end; i++ )
             {
+                const uchar* maskptr = mask->data ? mask->ptr(i) + j0 : 0;
+
+                if( K <= 0 )
+                {
+                    func(src1->ptr(i), src2->ptr(j0), src2->step, nvecs, src2->cols,
+                         dist->ptr(i) + j0*dist->elemSize(), maskptr);
+                    continue;
+                }
+
+                func(src1->ptr(i), src2->ptr(j0), src2->step, nvecs, src2->cols,
+                     (uchar*)bufptr, maskptr);
+
                 int* nidxptr = nidx->ptr<int>(i);
                 // since positive float's can be compared just like int's,
                 // we handle both CV_32S and CV_32F cases with a single branch
@@ -232,7 +248,7 @@ struct BatchDistInvoker : public ParallelLoopBody
 
                 int j, k;
 
-                for( j = 0; j < src2->rows; j++ )
+                for( j = 0; j < nvecs; j++ )
                 {
                     int d = bufptr[j];
                     if( d < distptr[K-1] )
@@ -242,7 +258,7 @@ struct BatchDistInvoker : public ParallelLoopBody
                             nidxptr[k+1] = nidxptr[k];
                             distptr[k+1] = distptr[k];
                         }
-                        nidxptr[k+1] = j + update;
+                        nidxptr[k+1] = j0 + j + update;
                         distptr[k+1] = d;
                     }
                 }
@@ -250,6 +266,8 @@ struct BatchDistInvoker : public ParallelLoopBody
         }
     }
 
+    enum { BLOCK_BYTES = 1 << 17 };
+
     const Mat *src1;
     const Mat *src2;
     Mat *dist;
@@ -381,6 +399,8 @@ void cv::batchDistance( InputArray _src1, InputArray _src2,
                   ("The combination of type=%d, dtype=%d and normType=%d is not supported",
                    type, dtype, normType));
 
+    // a few query rows per stripe, so that each train block is reused across them
     parallel_for_(Range(0, src1.rows),
-                  BatchDistInvoker(src1, src2, dist, nidx, K, mask, update, func));
+                  BatchDistInvoker(src1, src2, dist, nidx, K, mask, update, func),
+                  std::max(src1.rows / 16, 1));
 }
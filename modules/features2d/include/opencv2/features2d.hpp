@@ -124,6 +124,24 @@ public:
      * Retain the specified number of the best keypoints (according to the response)
      */
     static void retainBest( std::vector<KeyPoint>& keypoints, int npoints );
+    /*
+     * Retain at most npoints keypoints spread over the image: the image is split into
+     * gridRows x gridCols cells and each cell keeps an equal share of its best keypoints
+     */
+    static void retainBestInGrid( std::vector<KeyPoint>& keypoints, int npoints, Size imageSize,
+                                  int gridRows, int gridCols );
+    /*
+     * Retain about npoints keypoints using Suppression via Square Covering (SSC):
+     * a strong keypoint suppresses the weaker ones in a square around it, and the square
+     * size is searched so that the number of survivors is within tolerance*npoints of npoints
+     */
+    static void retainBestSSC( std::vector<KeyPoint>& keypoints, int npoints, Size imageSize,
+                               float tolerance = 0.1f );
+    /*
+     * Retain at most npoints keypoints by recursively splitting the image into quadrants
+     * until there are npoints non-empty nodes, and keeping the best keypoint of each node
+     */
+    static void retainBestQuadtree( std::vector<KeyPoint>& keypoints, int npoints, Size imageSize );
 };
 
 
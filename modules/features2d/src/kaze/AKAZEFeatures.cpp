@@ -12,6 +12,7 @@
 #include "nldiffusion_functions.h"
 #include "utils.h"
 #include "opencl_kernels_features2d.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include <iostream>
 
@@ -190,7 +191,21 @@ nld_step_scalar_one_lane(const Mat& Lt, const Mat& Lf, Mat& Lstep, float step_si
     dst++;
 
     // The middle columns
-    for (int j = 0; j < cols; j++)
+    int j = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int vlanes = VTraits<v_float32>::vlanes();
+    const v_float32 v_step_size = vx_setall_f32(step_size);
+    for (; j <= cols - vlanes; j += vlanes)
+    {
+      v_float32 vlf_c = vx_load(lf_c + j), vlt_c = vx_load(lt_c + j);
+      v_float32 v_step_r = v_mul(v_add(vlf_c, vx_load(lf_c + j + 1)), v_sub(vx_load(lt_c + j + 1), vlt_c));
+      v_step_r = v_add(v_step_r, v_mul(v_add(vlf_c, vx_load(lf_c + j - 1)), v_sub(vx_load(lt_c + j - 1), vlt_c)));
+      v_step_r = v_add(v_step_r, v_mul(v_add(vlf_c, vx_load(lf_b + j)), v_sub(vx_load(lt_b + j), vlt_c)));
+      v_step_r = v_add(v_step_r, v_mul(v_add(vlf_c, vx_load(lf_a + j)), v_sub(vx_load(lt_a + j), vlt_c)));
+      v_store(dst + j, v_mul(v_step_r, v_step_size));
+    }
+#endif
+    for (; j < cols; j++)
     {
       step_r = (lf_c[j] + lf_c[j + 1])*(lt_c[j + 1] - lt_c[j]) +
                (lf_c[j] + lf_c[j - 1])*(lt_c[j - 1] - lt_c[j]) +
@@ -588,7 +603,15 @@ static inline void compute_determinant(InputArray Lxx_, InputArray Lxy_, InputAr
   float *lyy = Lyy.ptr<float>();
   float *ldet = Ldet.ptr<float>();
   const int total = Lxx.cols * Lxx.rows;
-  for (int j = 0; j < total; j++) {
+  int j = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+  const v_float32 v_sigma = vx_setall_f32(sigma);
+  for (; j <= total - VTraits<v_float32>::vlanes(); j += VTraits<v_float32>::vlanes()) {
+    v_float32 v_lxy = vx_load(lxy + j);
+    v_store(ldet + j, v_mul(v_sub(v_mul(vx_load(lxx + j), vx_load(lyy + j)), v_mul(v_lxy, v_lxy)), v_sigma));
+  }
+#endif
+  for (; j < total; j++) {
     ldet[j] = (lxx[j] * lyy[j] - lxy[j] * lxy[j]) * sigma;
   }
 
@@ -24,6 +24,7 @@
 
 #include "../precomp.hpp"
 #include "nldiffusion_functions.h"
+#include "opencv2/core/hal/intrin.hpp"
 #include <iostream>
 
 // Namespaces
@@ -99,16 +100,26 @@ void pm_g1(InputArray _Lx, InputArray _Ly, OutputArray _dst, float k) {
 
   Size sz = Lx.size();
   float inv_k = 1.0f / (k*k);
-  for (int y = 0; y < sz.height; y++) {
-
-    const float* Lx_row = Lx.ptr<float>(y);
-    const float* Ly_row = Ly.ptr<float>(y);
-    float* dst_row = dst.ptr<float>(y);
-
-    for (int x = 0; x < sz.width; x++) {
-      dst_row[x] = (-inv_k*(Lx_row[x]*Lx_row[x] + Ly_row[x]*Ly_row[x]));
+  parallel_for_(Range(0, sz.height), [&](const Range& range) {
+    for (int y = range.start; y < range.end; y++) {
+
+      const float* Lx_row = Lx.ptr<float>(y);
+      const float* Ly_row = Ly.ptr<float>(y);
+      float* dst_row = dst.ptr<float>(y);
+
+      int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+      const v_float32 v_ninv_k = vx_setall_f32(-inv_k);
+      for (; x <= sz.width - VTraits<v_float32>::vlanes(); x += VTraits<v_float32>::vlanes()) {
+        v_float32 lx = vx_load(Lx_row + x), ly = vx_load(Ly_row + x);
+        v_store(dst_row + x, v_mul(v_ninv_k, v_add(v_mul(lx, lx), v_mul(ly, ly))));
+      }
+#endif
+      for (; x < sz.width; x++) {
+        dst_row[x] = (-inv_k*(Lx_row[x]*Lx_row[x] + Ly_row[x]*Ly_row[x]));
+      }
     }
-  }
+  }, (double)sz.area()/(1 << 16));
 
   exp(dst, dst);
 }
@@ -134,14 +145,25 @@ void pm_g2(InputArray _Lx, InputArray _Ly, OutputArray _dst, float k) {
     dst.create(sz, Lx.type());
     float k2inv = 1.0f / (k * k);
 
-    for(int y = 0; y < sz.height; y++) {
-        const float *Lx_row = Lx.ptr<float>(y);
-        const float *Ly_row = Ly.ptr<float>(y);
-        float* dst_row = dst.ptr<float>(y);
-        for(int x = 0; x < sz.width; x++) {
-            dst_row[x] = 1.0f / (1.0f + ((Lx_row[x] * Lx_row[x] + Ly_row[x] * Ly_row[x]) * k2inv));
+    parallel_for_(Range(0, sz.height), [&](const Range& range) {
+        for(int y = range.start; y < range.end; y++) {
+            const float *Lx_row = Lx.ptr<float>(y);
+            const float *Ly_row = Ly.ptr<float>(y);
+            float* dst_row = dst.ptr<float>(y);
+            int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+            const v_float32 v_one = vx_setall_f32(1.0f), v_k2inv = vx_setall_f32(k2inv);
+            for(; x <= sz.width - VTraits<v_float32>::vlanes(); x += VTraits<v_float32>::vlanes()) {
+                v_float32 lx = vx_load(Lx_row + x), ly = vx_load(Ly_row + x);
+                v_float32 dL = v_mul(v_add(v_mul(lx, lx), v_mul(ly, ly)), v_k2inv);
+                v_store(dst_row + x, v_div(v_one, v_add(v_one, dL)));
+            }
+#endif
+            for(; x < sz.width; x++) {
+                dst_row[x] = 1.0f / (1.0f + ((Lx_row[x] * Lx_row[x] + Ly_row[x] * Ly_row[x]) * k2inv));
+            }
         }
-    }
+    }, (double)sz.area()/(1 << 16));
 }
 /* ************************************************************************* */
 /**
@@ -89,6 +89,223 @@ void KeyPointsFilter::retainBest(std::vector<KeyPoint>& keypoints, int n_points)
     }
 }
 
+void KeyPointsFilter::retainBestInGrid(std::vector<KeyPoint>& keypoints, int n_points, Size imageSize,
+                                       int gridRows, int gridCols)
+{
+    CV_Assert( gridRows > 0 && gridCols > 0 );
+    CV_Assert( imageSize.width > 0 && imageSize.height > 0 );
+
+    if( n_points < 0 || keypoints.size() <= (size_t)n_points )
+        return;
+    if( n_points == 0 )
+    {
+        keypoints.clear();
+        return;
+    }
+
+    const int ncells = gridRows*gridCols;
+    const float sx = (float)gridCols/imageSize.width, sy = (float)gridRows/imageSize.height;
+    std::vector<std::vector<KeyPoint> > cells(ncells);
+    for( size_t i = 0; i < keypoints.size(); i++ )
+    {
+        const KeyPoint& kp = keypoints[i];
+        int cx = std::min(std::max(cvFloor(kp.pt.x*sx), 0), gridCols - 1);
+        int cy = std::min(std::max(cvFloor(kp.pt.y*sy), 0), gridRows - 1);
+        cells[cy*gridCols + cx].push_back(kp);
+    }
+
+    // every cell gets an equal share; the share that sparse cells cannot use
+    // goes to the denser ones, so the total stays at n_points
+    std::vector<int> order(ncells);
+    for( int i = 0; i < ncells; i++ )
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return cells[a].size() < cells[b].size(); });
+
+    keypoints.clear();
+    int remaining = n_points;
+    for( int i = 0; i < ncells; i++ )
+    {
+        std::vector<KeyPoint>& cell = cells[order[i]];
+        int quota = (remaining + ncells - i - 1)/(ncells - i);
+        // retainBest keeps all the keypoints tied with the last one, cut them to the quota
+        retainBest(cell, quota);
+        if( (int)cell.size() > quota )
+            cell.resize(quota);
+        remaining -= (int)cell.size();
+        keypoints.insert(keypoints.end(), cell.begin(), cell.end());
+    }
+}
+
+void KeyPointsFilter::retainBestSSC(std::vector<KeyPoint>& keypoints, int n_points, Size imageSize, float tolerance)
+{
+    CV_Assert( imageSize.width > 0 && imageSize.height > 0 );
+    CV_Assert( tolerance >= 0 );
+
+    if( n_points < 0 || keypoints.size() <= (size_t)n_points )
+        return;
+    if( n_points == 0 )
+    {
+        keypoints.clear();
+        return;
+    }
+
+    std::vector<int> order((int)keypoints.size());
+    for( size_t i = 0; i < order.size(); i++ )
+        order[i] = (int)i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](int a, int b) { return keypoints[a].response > keypoints[b].response; });
+
+    // initial bounds of the square size, see
+    // O. Bailo et al., "Efficient adaptive non-maximal suppression algorithms
+    // for homogeneous spatial keypoint distribution", 2018
+    const double rows = imageSize.height, cols = imageSize.width, k = n_points, n = (double)keypoints.size();
+    double exp1 = rows + cols + 2*k;
+    double exp2 = 4*cols + 4*k + 4*rows*k + rows*rows + cols*cols - 2*rows*cols + 4*rows*cols*k;
+    double exp3 = std::sqrt(exp2);
+    double exp4 = k - 1;
+    int high = (int)std::max(cols, rows);
+    if( exp4 > 0 )
+        high = std::max(-cvRound((exp1 - exp3)/exp4), -cvRound((exp1 + exp3)/exp4));
+    int low = cvFloor(std::sqrt(n/k));
+    high = std::max(high, low + 1);
+
+    const int kmin = cvRound(k - k*tolerance), kmax = cvRound(k + k*tolerance);
+    std::vector<int> result, best;
+    std::vector<uchar> covered;
+    int prevWidth = -1;
+
+    while( low <= high )
+    {
+        int width = low + (high - low)/2;
+        if( width == prevWidth )
+            break;
+        prevWidth = width;
+
+        const double c = std::max(width/2.0, 1.0);
+        const int gridCols = cvFloor(cols/c) + 1, gridRows = cvFloor(rows/c) + 1;
+        const int reach = cvFloor(width/c);
+        covered.assign((size_t)gridCols*gridRows, (uchar)0);
+        result.clear();
+
+        for( size_t i = 0; i < order.size(); i++ )
+        {
+            const Point2f& pt = keypoints[order[i]].pt;
+            int row = std::min(std::max(cvFloor(pt.y/c), 0), gridRows - 1);
+            int col = std::min(std::max(cvFloor(pt.x/c), 0), gridCols - 1);
+            if( covered[row*gridCols + col] )
+                continue;
+
+            result.push_back(order[i]);
+            int r0 = std::max(row - reach, 0), r1 = std::min(row + reach, gridRows - 1);
+            int c0 = std::max(col - reach, 0), c1 = std::min(col + reach, gridCols - 1);
+            for( int y = r0; y <= r1; y++ )
+                memset(&covered[y*gridCols + c0], 1, c1 - c0 + 1);
+        }
+
+        if( (int)result.size() >= kmin && (int)result.size() <= kmax )
+        {
+            best.swap(result);
+            break;
+        }
+        // keep the closest solution in case the search ends without hitting the range
+        if( best.empty() || std::abs((int)result.size() - n_points) < std::abs((int)best.size() - n_points) )
+            best = result;
+        if( (int)result.size() < kmin )
+            high = width - 1;
+        else
+            low = width + 1;
+    }
+
+    if( (int)best.size() > n_points )
+        best.resize(n_points);
+
+    std::vector<KeyPoint> selected(best.size());
+    for( size_t i = 0; i < best.size(); i++ )
+        selected[i] = keypoints[best[i]];
+    keypoints.swap(selected);
+}
+
+void KeyPointsFilter::retainBestQuadtree(std::vector<KeyPoint>& keypoints, int n_points, Size imageSize)
+{
+    CV_Assert( imageSize.width > 0 && imageSize.height > 0 );
+
+    if( n_points < 0 || keypoints.size() <= (size_t)n_points )
+        return;
+    if( n_points == 0 )
+    {
+        keypoints.clear();
+        return;
+    }
+
+    struct Node
+    {
+        Rect2f r;
+        std::vector<int> idx;
+    };
+
+    std::vector<Node> nodes(1);
+    nodes[0].r = Rect2f(0.f, 0.f, (float)imageSize.width, (float)imageSize.height);
+    nodes[0].idx.resize(keypoints.size());
+    for( size_t i = 0; i < keypoints.size(); i++ )
+        nodes[0].idx[i] = (int)i;
+
+    // split the most populated nodes first, until there are enough of them
+    // or none of them can be split anymore
+    std::vector<Node> next;
+    while( (int)nodes.size() < n_points )
+    {
+        std::stable_sort(nodes.begin(), nodes.end(),
+                         [](const Node& a, const Node& b) { return a.idx.size() > b.idx.size(); });
+        if( nodes[0].idx.size() <= 1 || nodes[0].r.width < 1.f )
+            break;
+
+        next.clear();
+        size_t i = 0;
+        for( ; i < nodes.size() && (int)(next.size() + nodes.size() - i) < n_points; i++ )
+        {
+            Node& node = nodes[i];
+            if( node.idx.size() <= 1 || node.r.width < 1.f )
+                break;
+
+            float hw = node.r.width*0.5f, hh = node.r.height*0.5f;
+            float xm = node.r.x + hw, ym = node.r.y + hh;
+            Node children[4];
+            for( int k = 0; k < 4; k++ )
+                children[k].r = Rect2f(k & 1 ? xm : node.r.x, k & 2 ? ym : node.r.y, hw, hh);
+            for( size_t j = 0; j < node.idx.size(); j++ )
+            {
+                const Point2f& pt = keypoints[node.idx[j]].pt;
+                children[(pt.x >= xm ? 1 : 0) + (pt.y >= ym ? 2 : 0)].idx.push_back(node.idx[j]);
+            }
+            for( int k = 0; k < 4; k++ )
+                if( !children[k].idx.empty() )
+                    next.push_back(children[k]);
+        }
+        for( ; i < nodes.size(); i++ )
+            next.push_back(nodes[i]);
+        nodes.swap(next);
+    }
+
+    std::vector<KeyPoint> selected(nodes.size());
+    for( size_t i = 0; i < nodes.size(); i++ )
+    {
+        const std::vector<int>& idx = nodes[i].idx;
+        int bestIdx = idx[0];
+        for( size_t j = 1; j < idx.size(); j++ )
+            if( keypoints[idx[j]].response > keypoints[bestIdx].response )
+                bestIdx = idx[j];
+        selected[i] = keypoints[bestIdx];
+    }
+    // the last split can leave up to 3 nodes too many; retainBest would keep all
+    // the keypoints tied with the cutoff, so cut the sorted list instead
+    if( (int)selected.size() > n_points )
+    {
+        std::stable_sort(selected.begin(), selected.end(), KeypointResponseGreater());
+        selected.resize(n_points);
+    }
+    keypoints.swap(selected);
+}
+
 struct RoiPredicate
 {
     RoiPredicate( const Rect& _r ) : r(_r)
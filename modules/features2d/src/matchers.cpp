@@ -845,8 +845,6 @@ void BFMatcher::knnMatchImpl( InputArray _queryDescriptors, std::vector<std::vec
         utrainDescCollection.clear();
     }
 
-    matches.reserve(queryDescriptors.rows);
-
     Mat dist, nidx;
 
     int iIdx, imgCount = (int)trainDescCollection.size(), update = 0;
@@ -870,25 +868,41 @@ void BFMatcher::knnMatchImpl( InputArray _queryDescriptors, std::vector<std::vec
         dist = temp;
     }
 
-    for( int qIdx = 0; qIdx < queryDescriptors.rows; qIdx++ )
+    size_t matchesOffset = matches.size();
+    matches.resize(matchesOffset + queryDescriptors.rows);
+
+    parallel_for_(Range(0, queryDescriptors.rows), [&](const Range& range)
     {
-        const float* distptr = dist.ptr<float>(qIdx);
-        const int* nidxptr = nidx.ptr<int>(qIdx);
+        for( int qIdx = range.start; qIdx < range.end; qIdx++ )
+        {
+            const float* distptr = dist.ptr<float>(qIdx);
+            const int* nidxptr = nidx.ptr<int>(qIdx);
 
-        matches.push_back( std::vector<DMatch>() );
-        std::vector<DMatch>& mq = matches.back();
-        mq.reserve(knn);
+            std::vector<DMatch>& mq = matches[matchesOffset + qIdx];
+            mq.reserve(knn);
 
-        for( int k = 0; k < nidx.cols; k++ )
-        {
-            if( nidxptr[k] < 0 )
-                break;
-            mq.push_back( DMatch(qIdx, nidxptr[k] & (IMGIDX_ONE - 1),
-                          nidxptr[k] >> IMGIDX_SHIFT, distptr[k]) );
+            for( int k = 0; k < nidx.cols; k++ )
+            {
+                if( nidxptr[k] < 0 )
+                    break;
+                mq.push_back( DMatch(qIdx, nidxptr[k] & (IMGIDX_ONE - 1),
+                              nidxptr[k] >> IMGIDX_SHIFT, distptr[k]) );
+            }
         }
+    });
 
-        if( mq.empty() && compactResult )
-            matches.pop_back();
+    if( compactResult )
+    {
+        size_t qIdx0 = matchesOffset;
+        for( size_t qIdx = matchesOffset; qIdx < matches.size(); qIdx++ )
+        {
+            if( matches[qIdx].empty() )
+                continue;
+            if( qIdx0 < qIdx )
+                std::swap(matches[qIdx], matches[qIdx0]);
+            qIdx0++;
+        }
+        matches.resize(qIdx0);
     }
 }
 
@@ -987,17 +1001,20 @@ void BFMatcher::radiusMatchImpl( InputArray _queryDescriptors, std::vector<std::
         else
             distf = dist;
 
-        for( int qIdx = 0; qIdx < queryDescriptors.rows; qIdx++ )
+        parallel_for_(Range(0, queryDescriptors.rows), [&](const Range& range)
         {
-            const float* distptr = distf.ptr<float>(qIdx);
-
-            std::vector<DMatch>& mq = matches[qIdx];
-            for( int k = 0; k < distf.cols; k++ )
+            for( int qIdx = range.start; qIdx < range.end; qIdx++ )
             {
-                if( distptr[k] <= maxDistance )
-                    mq.push_back( DMatch(qIdx, k, iIdx, distptr[k]) );
+                const float* distptr = distf.ptr<float>(qIdx);
+
+                std::vector<DMatch>& mq = matches[qIdx];
+                for( int k = 0; k < distf.cols; k++ )
+                {
+                    if( distptr[k] <= maxDistance )
+                        mq.push_back( DMatch(qIdx, k, iIdx, distptr[k]) );
+                }
             }
-        }
+        });
     }
 
     int qIdx0 = 0;
@@ -36,6 +36,7 @@
 
 #include "precomp.hpp"
 #include "opencl_kernels_features2d.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <iterator>
 
 #ifndef CV_IMPL_ADD
@@ -135,7 +136,7 @@ HarrisResponses(const Mat& img, const std::vector<Rect>& layerinfo,
     CV_CheckGT(blockSize, 0, "");
     CV_CheckLE(blockSize*blockSize, 2048, "");
 
-    size_t ptidx, ptsize = pts.size();
+    size_t ptsize = pts.size();
 
     const uchar* ptr00 = img.ptr<uchar>();
     size_t size_t_step = img.step;
@@ -153,7 +154,9 @@ HarrisResponses(const Mat& img, const std::vector<Rect>& layerinfo,
         for( int j = 0; j < blockSize; j++ )
             ofs[i*blockSize + j] = (int)(i*step + j);
 
-    for( ptidx = 0; ptidx < ptsize; ptidx++ )
+    parallel_for_(Range(0, (int)ptsize), [&](const Range& range)
+    {
+    for( int ptidx = range.start; ptidx < range.end; ptidx++ )
     {
         int x0 = cvRound(pts[ptidx].pt.x);
         int y0 = cvRound(pts[ptidx].pt.y);
@@ -174,6 +177,7 @@ HarrisResponses(const Mat& img, const std::vector<Rect>& layerinfo,
         pts[ptidx].response = ((float)a * b - (float)c * c -
                                harris_k * ((float)a + b) * ((float)a + b))*scale_sq_sq;
     }
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -182,9 +186,11 @@ static void ICAngles(const Mat& img, const std::vector<Rect>& layerinfo,
                      std::vector<KeyPoint>& pts, const std::vector<int> & u_max, int half_k)
 {
     int step = (int)img.step1();
-    size_t ptidx, ptsize = pts.size();
+    int ptsize = (int)pts.size();
 
-    for( ptidx = 0; ptidx < ptsize; ptidx++ )
+    parallel_for_(Range(0, ptsize), [&](const Range& range)
+    {
+    for( int ptidx = range.start; ptidx < range.end; ptidx++ )
     {
         const Rect& layer = layerinfo[pts[ptidx].octave];
         const uchar* center = &img.at<uchar>(cvRound(pts[ptidx].pt.y) + layer.y, cvRound(pts[ptidx].pt.x) + layer.x);
@@ -212,144 +218,140 @@ static void ICAngles(const Mat& img, const std::vector<Rect>& layerinfo,
 
         pts[ptidx].angle = fastAtan2((float)m_01, (float)m_10);
     }
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Computes the image offsets of the rotated sampling pattern, relative to the keypoint center.
+ * This is the "gather" part of rBRIEF: once the offsets are known, the intensity tests
+ * only need plain table lookups.
+ */
+static void
+computeOrbPatternOffsets( const Point* pattern, int npoints, float a, float b, int step, int* ofs )
+{
+    int k = 0;
+#if CV_SIMD128
+    const v_float32x4 va = v_setall_f32(a), vb = v_setall_f32(b);
+    const v_int32x4 vstep = v_setall_s32(step);
+    for( ; k <= npoints - 4; k += 4 )
+    {
+        v_int32x4 px, py;
+        v_load_deinterleave((const int*)(pattern + k), px, py);
+        v_float32x4 fx = v_cvt_f32(px), fy = v_cvt_f32(py);
+        v_int32x4 ix = v_round(v_sub(v_mul(fx, va), v_mul(fy, vb)));
+        v_int32x4 iy = v_round(v_add(v_mul(fx, vb), v_mul(fy, va)));
+        v_store(ofs + k, v_add(v_mul(iy, vstep), ix));
+    }
+#endif
+    for( ; k < npoints; k++ )
+    {
+        float x = pattern[k].x*a - pattern[k].y*b;
+        float y = pattern[k].x*b + pattern[k].y*a;
+        ofs[k] = cvRound(y)*step + cvRound(x);
+    }
+}
+
 static void
 computeOrbDescriptors( const Mat& imagePyramid, const std::vector<Rect>& layerInfo,
                        const std::vector<float>& layerScale, std::vector<KeyPoint>& keypoints,
                        Mat& descriptors, const std::vector<Point>& _pattern, int dsize, int wta_k )
 {
+    if( wta_k != 2 && wta_k != 3 && wta_k != 4 )
+        CV_Error( Error::StsBadSize, "Wrong wta_k. It can be only 2, 3 or 4." );
+
     int step = (int)imagePyramid.step;
-    int j, i, nkeypoints = (int)keypoints.size();
+    int nkeypoints = (int)keypoints.size();
+    int npoints = (int)_pattern.size();
 
-    for( j = 0; j < nkeypoints; j++ )
+    parallel_for_(Range(0, nkeypoints), [&](const Range& range)
     {
-        const KeyPoint& kpt = keypoints[j];
-        const Rect& layer = layerInfo[kpt.octave];
-        float scale = 1.f/layerScale[kpt.octave];
-        float angle = kpt.angle;
-
-        angle *= (float)(CV_PI/180.f);
-        float a = (float)cos(angle), b = (float)sin(angle);
-
-        const uchar* center = &imagePyramid.at<uchar>(cvRound(kpt.pt.y*scale) + layer.y,
-                                                      cvRound(kpt.pt.x*scale) + layer.x);
-        float x, y;
-        int ix, iy;
-        const Point* pattern = &_pattern[0];
-        uchar* desc = descriptors.ptr<uchar>(j);
-
-    #if 1
-        #define GET_VALUE(idx) \
-               (x = pattern[idx].x*a - pattern[idx].y*b, \
-                y = pattern[idx].x*b + pattern[idx].y*a, \
-                ix = cvRound(x), \
-                iy = cvRound(y), \
-                *(center + iy*step + ix) )
-    #else
-        #define GET_VALUE(idx) \
-            (x = pattern[idx].x*a - pattern[idx].y*b, \
-            y = pattern[idx].x*b + pattern[idx].y*a, \
-            ix = cvFloor(x), iy = cvFloor(y), \
-            x -= ix, y -= iy, \
-            cvRound(center[iy*step + ix]*(1-x)*(1-y) + center[(iy+1)*step + ix]*(1-x)*y + \
-                    center[iy*step + ix+1]*x*(1-y) + center[(iy+1)*step + ix+1]*x*y))
-    #endif
+        AutoBuffer<int> ofsbuf(npoints);
+        AutoBuffer<uchar> valbuf(npoints);
+        int* ofs = ofsbuf.data();
+        uchar* vals = valbuf.data();
 
-        if( wta_k == 2 )
+        for( int j = range.start; j < range.end; j++ )
         {
-            for (i = 0; i < dsize; ++i, pattern += 16)
-            {
-                int t0, t1, val;
-                t0 = GET_VALUE(0); t1 = GET_VALUE(1);
-                val = t0 < t1;
-                t0 = GET_VALUE(2); t1 = GET_VALUE(3);
-                val |= (t0 < t1) << 1;
-                t0 = GET_VALUE(4); t1 = GET_VALUE(5);
-                val |= (t0 < t1) << 2;
-                t0 = GET_VALUE(6); t1 = GET_VALUE(7);
-                val |= (t0 < t1) << 3;
-                t0 = GET_VALUE(8); t1 = GET_VALUE(9);
-                val |= (t0 < t1) << 4;
-                t0 = GET_VALUE(10); t1 = GET_VALUE(11);
-                val |= (t0 < t1) << 5;
-                t0 = GET_VALUE(12); t1 = GET_VALUE(13);
-                val |= (t0 < t1) << 6;
-                t0 = GET_VALUE(14); t1 = GET_VALUE(15);
-                val |= (t0 < t1) << 7;
-
-                desc[i] = (uchar)val;
-            }
-        }
-        else if( wta_k == 3 )
-        {
-            for (i = 0; i < dsize; ++i, pattern += 12)
-            {
-                int t0, t1, t2, val;
-                t0 = GET_VALUE(0); t1 = GET_VALUE(1); t2 = GET_VALUE(2);
-                val = t2 > t1 ? (t2 > t0 ? 2 : 0) : (t1 > t0);
+            const KeyPoint& kpt = keypoints[j];
+            const Rect& layer = layerInfo[kpt.octave];
+            float scale = 1.f/layerScale[kpt.octave];
+            float angle = kpt.angle;
 
-                t0 = GET_VALUE(3); t1 = GET_VALUE(4); t2 = GET_VALUE(5);
-                val |= (t2 > t1 ? (t2 > t0 ? 2 : 0) : (t1 > t0)) << 2;
+            angle *= (float)(CV_PI/180.f);
+            float a = (float)cos(angle), b = (float)sin(angle);
 
-                t0 = GET_VALUE(6); t1 = GET_VALUE(7); t2 = GET_VALUE(8);
-                val |= (t2 > t1 ? (t2 > t0 ? 2 : 0) : (t1 > t0)) << 4;
+            const uchar* center = &imagePyramid.at<uchar>(cvRound(kpt.pt.y*scale) + layer.y,
+                                                          cvRound(kpt.pt.x*scale) + layer.x);
+            uchar* desc = descriptors.ptr<uchar>(j);
 
-                t0 = GET_VALUE(9); t1 = GET_VALUE(10); t2 = GET_VALUE(11);
-                val |= (t2 > t1 ? (t2 > t0 ? 2 : 0) : (t1 > t0)) << 6;
+            computeOrbPatternOffsets(&_pattern[0], npoints, a, b, step, ofs);
+            for( int k = 0; k < npoints; k++ )
+                vals[k] = center[ofs[k]];
 
-                desc[i] = (uchar)val;
+            int i = 0;
+            if( wta_k == 2 )
+            {
+#if CV_SIMD128
+                // 16 point pairs give 2 descriptor bytes: every comparison mask selects
+                // its bit weight, and the weights of each half are summed into a byte
+                const v_uint8x16 vbits(1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128);
+                for( ; i <= dsize - 2; i += 2 )
+                {
+                    v_uint8x16 t0, t1;
+                    v_load_deinterleave(vals + i*16, t0, t1);
+                    v_uint16x8 lo, hi;
+                    v_expand(v_and(v_lt(t0, t1), vbits), lo, hi);
+                    desc[i] = (uchar)v_reduce_sum(lo);
+                    desc[i + 1] = (uchar)v_reduce_sum(hi);
+                }
+#endif
+                for( ; i < dsize; i++ )
+                {
+                    const uchar* t = vals + i*16;
+                    int val = 0;
+                    for( int k = 0; k < 8; k++ )
+                        val |= (t[k*2] < t[k*2 + 1]) << k;
+                    desc[i] = (uchar)val;
+                }
             }
-        }
-        else if( wta_k == 4 )
-        {
-            for (i = 0; i < dsize; ++i, pattern += 16)
+            else if( wta_k == 3 )
             {
-                int t0, t1, t2, t3, u, v, k, val;
-                t0 = GET_VALUE(0); t1 = GET_VALUE(1);
-                t2 = GET_VALUE(2); t3 = GET_VALUE(3);
-                u = 0, v = 2;
-                if( t1 > t0 ) t0 = t1, u = 1;
-                if( t3 > t2 ) t2 = t3, v = 3;
-                k = t0 > t2 ? u : v;
-                val = k;
-
-                t0 = GET_VALUE(4); t1 = GET_VALUE(5);
-                t2 = GET_VALUE(6); t3 = GET_VALUE(7);
-                u = 0, v = 2;
-                if( t1 > t0 ) t0 = t1, u = 1;
-                if( t3 > t2 ) t2 = t3, v = 3;
-                k = t0 > t2 ? u : v;
-                val |= k << 2;
-
-                t0 = GET_VALUE(8); t1 = GET_VALUE(9);
-                t2 = GET_VALUE(10); t3 = GET_VALUE(11);
-                u = 0, v = 2;
-                if( t1 > t0 ) t0 = t1, u = 1;
-                if( t3 > t2 ) t2 = t3, v = 3;
-                k = t0 > t2 ? u : v;
-                val |= k << 4;
-
-                t0 = GET_VALUE(12); t1 = GET_VALUE(13);
-                t2 = GET_VALUE(14); t3 = GET_VALUE(15);
-                u = 0, v = 2;
-                if( t1 > t0 ) t0 = t1, u = 1;
-                if( t3 > t2 ) t2 = t3, v = 3;
-                k = t0 > t2 ? u : v;
-                val |= k << 6;
-
-                desc[i] = (uchar)val;
+                for( ; i < dsize; i++ )
+                {
+                    const uchar* t = vals + i*12;
+                    int val = 0;
+                    for( int k = 0; k < 4; k++, t += 3 )
+                    {
+                        int t0 = t[0], t1 = t[1], t2 = t[2];
+                        val |= (t2 > t1 ? (t2 > t0 ? 2 : 0) : (t1 > t0)) << (k*2);
+                    }
+                    desc[i] = (uchar)val;
+                }
+            }
+            else
+            {
+                for( ; i < dsize; i++ )
+                {
+                    const uchar* t = vals + i*16;
+                    int val = 0;
+                    for( int k = 0; k < 4; k++, t += 4 )
+                    {
+                        int t0 = t[0], t1 = t[1], t2 = t[2], t3 = t[3], u = 0, v = 2;
+                        if( t1 > t0 ) t0 = t1, u = 1;
+                        if( t3 > t2 ) t2 = t3, v = 3;
+                        val |= (t0 > t2 ? u : v) << (k*2);
+                    }
+                    desc[i] = (uchar)val;
+                }
             }
         }
-        else
-            CV_Error( Error::StsBadSize, "Wrong wta_k. It can be only 2, 3 or 4." );
-        #undef GET_VALUE
-    }
+    });
 }
 
 
+
 static void initializeOrbPattern( const Point* pattern0, std::vector<Point>& pattern, int ntuples, int tupleSize, int poolSize )
 {
     RNG rng(0x12345678);
@@ -878,37 +880,48 @@ static void computeKeyPoints(const Mat& imagePyramid,
     allKeypoints.clear();
     std::vector<KeyPoint> keypoints;
     std::vector<int> counters(nlevels);
-    keypoints.reserve(nfeaturesPerLevel[0]*2);
+    std::vector<std::vector<KeyPoint> > levelKeypoints(nlevels);
 
-    for( level = 0; level < nlevels; level++ )
+    // The levels are independent, so FAST runs on all of them concurrently
+    parallel_for_(Range(0, nlevels), [&](const Range& range)
     {
-        int featuresNum = nfeaturesPerLevel[level];
-        Mat img = imagePyramid(layerInfo[level]);
-        Mat mask = maskPyramid.empty() ? Mat() : maskPyramid(layerInfo[level]);
-
-        // Detect FAST features, 20 is a good threshold
+        for( int lvl = range.start; lvl < range.end; lvl++ )
         {
-        Ptr<FastFeatureDetector> fd = FastFeatureDetector::create(fastThreshold, true);
-        fd->detect(img, keypoints, mask);
-        }
+            std::vector<KeyPoint>& kpts = levelKeypoints[lvl];
+            int featuresNum = nfeaturesPerLevel[lvl];
+            Mat img = imagePyramid(layerInfo[lvl]);
+            Mat mask = maskPyramid.empty() ? Mat() : maskPyramid(layerInfo[lvl]);
 
-        // Remove keypoints very close to the border
-        KeyPointsFilter::runByImageBorder(keypoints, img.size(), edgeThreshold);
+            // Detect FAST features, 20 is a good threshold
+            {
+            Ptr<FastFeatureDetector> fd = FastFeatureDetector::create(fastThreshold, true);
+            fd->detect(img, kpts, mask);
+            }
 
-        // Keep more points than necessary as FAST does not give amazing corners
-        KeyPointsFilter::retainBest(keypoints, scoreType == ORB_Impl::HARRIS_SCORE ? 2 * featuresNum : featuresNum);
+            // Remove keypoints very close to the border
+            KeyPointsFilter::runByImageBorder(kpts, img.size(), edgeThreshold);
 
-        nkeypoints = (int)keypoints.size();
-        counters[level] = nkeypoints;
+            // Keep more points than necessary as FAST does not give amazing corners
+            KeyPointsFilter::retainBest(kpts, scoreType == ORB_Impl::HARRIS_SCORE ? 2 * featuresNum : featuresNum);
 
-        float sf = layerScale[level];
-        for( i = 0; i < nkeypoints; i++ )
-        {
-            keypoints[i].octave = level;
-            keypoints[i].size = patchSize*sf;
+            float sf = layerScale[lvl];
+            for( size_t k = 0; k < kpts.size(); k++ )
+            {
+                kpts[k].octave = lvl;
+                kpts[k].size = patchSize*sf;
+            }
         }
+    });
+
+    nkeypoints = 0;
+    for( level = 0; level < nlevels; level++ )
+        nkeypoints += (int)levelKeypoints[level].size();
+    allKeypoints.reserve(nkeypoints);
 
-        std::copy(keypoints.begin(), keypoints.end(), std::back_inserter(allKeypoints));
+    for( level = 0; level < nlevels; level++ )
+    {
+        counters[level] = (int)levelKeypoints[level].size();
+        std::copy(levelKeypoints[level].begin(), levelKeypoints[level].end(), std::back_inserter(allKeypoints));
     }
 
     std::vector<Vec3i> ukeypoints_buf;
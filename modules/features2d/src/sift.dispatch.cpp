@@ -309,16 +309,20 @@ void SIFT_Impl::buildDoGPyramid( const std::vector<Mat>& gpyr, std::vector<Mat>&
     parallel_for_(Range(0, nOctaves * (nOctaveLayers + 2)), buildDoGPyramidComputer(nOctaveLayers, gpyr, dogpyr));
 }
 
+// A band of rows of one DoG layer; all bands of all layers are processed
+// in a single parallel loop instead of one loop per layer.
+struct ScaleSpaceExtremaTile
+{
+    int o, i;
+    Range rows;
+};
+
 class findScaleSpaceExtremaComputer : public ParallelLoopBody
 {
 public:
     findScaleSpaceExtremaComputer(
-        int _o,
-        int _i,
+        const std::vector<ScaleSpaceExtremaTile>& _tiles,
         int _threshold,
-        int _idx,
-        int _step,
-        int _cols,
         int _nOctaveLayers,
         double _contrastThreshold,
         double _edgeThreshold,
@@ -327,12 +331,8 @@ public:
         const std::vector<Mat>& _dog_pyr,
         TLSData<std::vector<KeyPoint> > &_tls_kpts_struct)
 
-        : o(_o),
-          i(_i),
+        : tiles(_tiles),
           threshold(_threshold),
-          idx(_idx),
-          step(_step),
-          cols(_cols),
           nOctaveLayers(_nOctaveLayers),
           contrastThreshold(_contrastThreshold),
           edgeThreshold(_edgeThreshold),
@@ -346,13 +346,22 @@ public:
 
         std::vector<KeyPoint>& kpts = tls_kpts_struct.getRef();
 
-        CV_CPU_DISPATCH(findScaleSpaceExtrema, (o, i, threshold, idx, step, cols, nOctaveLayers, contrastThreshold, edgeThreshold, sigma, gauss_pyr, dog_pyr, kpts, range),
-            CV_CPU_DISPATCH_MODES_ALL);
+        for( int t = range.start; t < range.end; t++ )
+        {
+            const ScaleSpaceExtremaTile& tile = tiles[t];
+            const int o = tile.o, i = tile.i;
+            const int idx = o*(nOctaveLayers+2)+i;
+            const Mat& img = dog_pyr[idx];
+            const int step = (int)img.step1();
+            const int cols = img.cols;
+
+            CV_CPU_DISPATCH(findScaleSpaceExtrema, (o, i, threshold, idx, step, cols, nOctaveLayers, contrastThreshold, edgeThreshold, sigma, gauss_pyr, dog_pyr, kpts, tile.rows),
+                CV_CPU_DISPATCH_MODES_ALL);
+        }
     }
 private:
-    int o, i;
+    const std::vector<ScaleSpaceExtremaTile>& tiles;
     int threshold;
-    int idx, step, cols;
     int nOctaveLayers;
     double contrastThreshold;
     double edgeThreshold;
@@ -372,28 +381,35 @@ void SIFT_Impl::findScaleSpaceExtrema( const std::vector<Mat>& gauss_pyr, const
 
     const int nOctaves = (int)gauss_pyr.size()/(nOctaveLayers + 3);
     const int threshold = cvFloor(0.5 * contrastThreshold / nOctaveLayers * 255 * SIFT_FIXPT_SCALE);
+    const int tileRows = 16;
 
     keypoints.clear();
     TLSDataAccumulator<std::vector<KeyPoint> > tls_kpts_struct;
 
+    std::vector<ScaleSpaceExtremaTile> tiles;
     for( int o = 0; o < nOctaves; o++ )
         for( int i = 1; i <= nOctaveLayers; i++ )
         {
-            const int idx = o*(nOctaveLayers+2)+i;
-            const Mat& img = dog_pyr[idx];
-            const int step = (int)img.step1();
-            const int rows = img.rows, cols = img.cols;
-
-            parallel_for_(Range(SIFT_IMG_BORDER, rows-SIFT_IMG_BORDER),
-                findScaleSpaceExtremaComputer(
-                    o, i, threshold, idx, step, cols,
-                    nOctaveLayers,
-                    contrastThreshold,
-                    edgeThreshold,
-                    sigma,
-                    gauss_pyr, dog_pyr, tls_kpts_struct));
+            const int rows = dog_pyr[o*(nOctaveLayers+2)+i].rows;
+            for( int r = SIFT_IMG_BORDER; r < rows-SIFT_IMG_BORDER; r += tileRows )
+            {
+                ScaleSpaceExtremaTile tile;
+                tile.o = o;
+                tile.i = i;
+                tile.rows = Range(r, std::min(r + tileRows, rows-SIFT_IMG_BORDER));
+                tiles.push_back(tile);
+            }
         }
 
+    parallel_for_(Range(0, (int)tiles.size()),
+        findScaleSpaceExtremaComputer(
+            tiles, threshold,
+            nOctaveLayers,
+            contrastThreshold,
+            edgeThreshold,
+            sigma,
+            gauss_pyr, dog_pyr, tls_kpts_struct));
+
     std::vector<std::vector<KeyPoint>*> kpt_vecs;
     tls_kpts_struct.gather(kpt_vecs);
     for (size_t i = 0; i < kpt_vecs.size(); ++i) {
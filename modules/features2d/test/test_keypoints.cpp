@@ -184,4 +184,104 @@ TEST(Features2d_Detector_Keypoints_SIFT, validation)
 }
 
 
+static std::vector<KeyPoint> generateClusteredKeyPoints(Size imageSize)
+{
+    RNG& rng = theRNG();
+    std::vector<KeyPoint> kps;
+    // a dense cluster in the top-left corner and a sparse layer over the whole image
+    for (int i = 0; i < 2000; i++)
+        kps.push_back(KeyPoint(rng.uniform(0.f, imageSize.width/4.f), rng.uniform(0.f, imageSize.height/4.f),
+                               7.f, -1, rng.uniform(0.5f, 1.f)));
+    for (int i = 0; i < 500; i++)
+        kps.push_back(KeyPoint(rng.uniform(0.f, (float)imageSize.width), rng.uniform(0.f, (float)imageSize.height),
+                               7.f, -1, rng.uniform(0.f, 0.5f)));
+    return kps;
+}
+
+static int countOutsideCluster(const std::vector<KeyPoint>& kps, Size imageSize)
+{
+    int n = 0;
+    for (size_t i = 0; i < kps.size(); i++)
+        if (kps[i].pt.x >= imageSize.width/4.f || kps[i].pt.y >= imageSize.height/4.f)
+            n++;
+    return n;
+}
+
+TEST(Features2d_KeyPointsFilter, retainBestInGrid)
+{
+    const Size sz(640, 480);
+    std::vector<KeyPoint> kps = generateClusteredKeyPoints(sz);
+    std::vector<KeyPoint> best = kps;
+
+    KeyPointsFilter::retainBest(best, 200);
+    KeyPointsFilter::retainBestInGrid(kps, 200, sz, 4, 4);
+
+    EXPECT_EQ(200u, kps.size());
+    // retainBest keeps only the cluster, the grid spreads the points
+    EXPECT_EQ(0, countOutsideCluster(best, sz));
+    EXPECT_GT(countOutsideCluster(kps, sz), 150);
+}
+
+TEST(Features2d_KeyPointsFilter, retainBestInGrid_ties)
+{
+    const Size sz(640, 480);
+    std::vector<KeyPoint> kps;
+    for (int y = 0; y < sz.height; y += 10)
+        for (int x = 0; x < sz.width; x += 10)
+            kps.push_back(KeyPoint((float)x, (float)y, 7.f, -1, 1.f));
+
+    for (int n = 1; n <= 100; n += 11)
+    {
+        std::vector<KeyPoint> res = kps;
+        KeyPointsFilter::retainBestInGrid(res, n, sz, 3, 4);
+        EXPECT_EQ((size_t)n, res.size());
+    }
+}
+
+TEST(Features2d_KeyPointsFilter, retainBestSSC)
+{
+    const Size sz(640, 480);
+    std::vector<KeyPoint> kps = generateClusteredKeyPoints(sz);
+
+    KeyPointsFilter::retainBestSSC(kps, 100, sz, 0.1f);
+
+    EXPECT_LE(kps.size(), 100u);
+    EXPECT_GE(kps.size(), 90u);
+    EXPECT_GT(countOutsideCluster(kps, sz), 50);
+}
+
+TEST(Features2d_KeyPointsFilter, retainBestQuadtree)
+{
+    const Size sz(640, 480);
+    std::vector<KeyPoint> kps = generateClusteredKeyPoints(sz);
+
+    KeyPointsFilter::retainBestQuadtree(kps, 100, sz);
+
+    EXPECT_EQ(100u, kps.size());
+    EXPECT_GT(countOutsideCluster(kps, sz), 30);
+    for (size_t i = 0; i < kps.size(); i++)
+        for (size_t j = i + 1; j < kps.size(); j++)
+            EXPECT_NE(kps[i].pt, kps[j].pt);
+}
+
+TEST(Features2d_KeyPointsFilter, retainBestSSC_and_Quadtree_ties)
+{
+    const Size sz(640, 480);
+    std::vector<KeyPoint> kps;
+    for (int y = 0; y < sz.height; y += 10)
+        for (int x = 0; x < sz.width; x += 10)
+            kps.push_back(KeyPoint((float)x, (float)y, 7.f, -1, 1.f));
+
+    for (int n = 1; n <= 100; n += 11)
+    {
+        std::vector<KeyPoint> res = kps;
+        KeyPointsFilter::retainBestSSC(res, n, sz, 0.1f);
+        EXPECT_LE(res.size(), (size_t)n) << "n=" << n;
+
+        res = kps;
+        KeyPointsFilter::retainBestQuadtree(res, n, sz);
+        EXPECT_EQ((size_t)n, res.size()) << "n=" << n;
+    }
+}
+
 }} // namespace
@@ -632,4 +632,34 @@ TEST(Features2d_DMatch, issue_17771)
     EXPECT_NO_THROW(ubf->knnMatch(usources, utargets, match, 1, mask, true));
 }
 
+TEST(Features2d_BFMatcher, knnMatch_large_train_set)
+{
+    // big enough for the train set to be processed in several cache blocks
+    Mat query(200, 32, CV_8U), train(6000, 32, CV_8U);
+    randu(query, Scalar::all(0), Scalar::all(256));
+    randu(train, Scalar::all(0), Scalar::all(256));
+
+    const int knn = 3;
+    Ptr<BFMatcher> bf = BFMatcher::create(NORM_HAMMING);
+    vector<vector<DMatch> > matches;
+    bf->knnMatch(query, train, matches, knn);
+    ASSERT_EQ((size_t)query.rows, matches.size());
+
+    for (int i = 0; i < query.rows; i++)
+    {
+        vector<std::pair<int, int> > ref(train.rows);
+        for (int j = 0; j < train.rows; j++)
+            ref[j] = std::make_pair((int)cv::norm(query.row(i), train.row(j), NORM_HAMMING), j);
+        std::stable_sort(ref.begin(), ref.end());
+
+        ASSERT_EQ((size_t)knn, matches[i].size());
+        for (int k = 0; k < knn; k++)
+        {
+            EXPECT_EQ(i, matches[i][k].queryIdx);
+            EXPECT_EQ(ref[k].second, matches[i][k].trainIdx) << "query " << i << " k " << k;
+            EXPECT_EQ((float)ref[k].first, matches[i][k].distance);
+        }
+    }
+}
+
 }} // namespace
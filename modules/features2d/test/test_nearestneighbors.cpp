@@ -43,6 +43,11 @@
 
 #include "test_precomp.hpp"
 
+#ifdef HAVE_OPENCV_FLANN
+#include "opencv2/flann.hpp"
+#include "opencv2/flann/ground_truth.h"
+#endif
+
 namespace opencv_test { namespace {
 
 #ifdef HAVE_OPENCV_FLANN
@@ -293,6 +298,16 @@ protected:
     virtual void createModel( const Mat& data ) { createIndex( data, AutotunedIndexParams() ); }
     virtual int findNeighbors( Mat& points, Mat& neighbors ) { return knnSearch( points, neighbors ); }
 };
+//----------------------------------------
+class CV_FlannHnswIndexTest : public CV_FlannTest
+{
+public:
+    CV_FlannHnswIndexTest() {}
+protected:
+    virtual void createModel( const Mat& data ) { createIndex( data, HnswIndexParams() ); }
+    virtual int findNeighbors( Mat& points, Mat& neighbors ) { return knnSearch( points, neighbors ); }
+};
+
 //----------------------------------------
 class CV_FlannSavedIndexTest : public CV_FlannTest
 {
@@ -321,12 +336,319 @@ void CV_FlannSavedIndexTest::createModel(const cv::Mat &data)
     remove( filename.c_str() );
 }
 
+//----------------------------------------
+class CV_FlannSavedHnswIndexTest : public CV_FlannTest
+{
+public:
+    CV_FlannSavedHnswIndexTest() {}
+protected:
+    virtual void createModel( const Mat& data )
+    {
+        createIndex( data, HnswIndexParams() );
+        string filename = tempfile();
+        index->save( filename );
+
+        createIndex( data, SavedIndexParams(filename.c_str()));
+        remove( filename.c_str() );
+    }
+    virtual int findNeighbors( Mat& points, Mat& neighbors ) { return knnSearch( points, neighbors ); }
+};
+
+TEST(Features2d_FLANN_KDTree, save_load_same_results)
+{
+    Mat data(2000, 16, CV_32F), query(100, 16, CV_32F);
+    randu(data, Scalar::all(0), Scalar::all(1));
+    randu(query, Scalar::all(0), Scalar::all(1));
+
+    cv::flann::Index index(data, cv::flann::KDTreeIndexParams(4));
+    string filename = tempfile();
+    index.save(filename);
+
+    cv::flann::Index loaded;
+    ASSERT_TRUE(loaded.load(data, filename));
+    remove(filename.c_str());
+
+    Mat indices, dists, loadedIndices, loadedDists;
+    index.knnSearch(query, indices, dists, 5, cv::flann::SearchParams(64));
+    loaded.knnSearch(query, loadedIndices, loadedDists, 5, cv::flann::SearchParams(64));
+
+    EXPECT_EQ(0, cvtest::norm(indices, loadedIndices, NORM_INF));
+    EXPECT_EQ(0, cvtest::norm(dists, loadedDists, NORM_INF));
+}
+
+TEST(Features2d_FLANN_PooledAllocator, large_and_failed_allocations)
+{
+    // sizes past INT_MAX must not wrap around, and a failed allocation throws
+    cvflann::PooledAllocator pool;
+    EXPECT_ANY_THROW(pool.allocate<char>(std::numeric_limits<size_t>::max() / 2));
+    int* p = pool.allocate<int>(1000);
+    ASSERT_TRUE(p != NULL);
+    p[999] = 1;
+}
+
+TEST(Features2d_FLANN_KDTree, parallel_build_and_search_match_serial)
+{
+    Mat data(20000, 16, CV_32F), query(300, 16, CV_32F);
+    randu(data, Scalar::all(0), Scalar::all(1));
+    randu(query, Scalar::all(0), Scalar::all(1));
+
+    Mat indices[4], dists[4];
+    const int threads = getNumThreads();
+    for (int i = 0; i < 4; i++)
+    {
+        setNumThreads(i % 2 == 0 ? 1 : threads);
+        theRNG() = RNG(12345);
+        cv::flann::Index index;
+        if (i < 2)
+            index.build(data, cv::flann::KDTreeIndexParams(4));
+        else
+            index.build(data, cv::flann::KMeansIndexParams(8));
+        index.knnSearch(query, indices[i], dists[i], 5, cv::flann::SearchParams(64));
+    }
+    setNumThreads(threads);
+
+    EXPECT_EQ(0, cvtest::norm(indices[0], indices[1], NORM_INF));
+    EXPECT_EQ(0, cvtest::norm(dists[0], dists[1], NORM_INF));
+    EXPECT_EQ(0, cvtest::norm(indices[2], indices[3], NORM_INF));
+    EXPECT_EQ(0, cvtest::norm(dists[2], dists[3], NORM_INF));
+
+    // batch search gives the same answers as one query at a time
+    cv::flann::Index index(data, cv::flann::KMeansIndexParams());
+    Mat batchIndices, batchDists;
+    index.knnSearch(query, batchIndices, batchDists, 5, cv::flann::SearchParams(64));
+    for (int i = 0; i < query.rows; i++)
+    {
+        Mat rowIndices, rowDists;
+        index.knnSearch(query.row(i), rowIndices, rowDists, 5, cv::flann::SearchParams(64));
+        ASSERT_EQ(0, cvtest::norm(rowIndices, batchIndices.row(i), NORM_INF)) << "query " << i;
+    }
+}
+
+TEST(Features2d_FLANN_LSH, dense_and_sparse_tables_find_perturbed_descriptors)
+{
+    Mat data(10000, 32, CV_8U);
+    randu(data, Scalar::all(0), Scalar::all(256));
+    Mat query = data.rowRange(0, 500).clone();
+    for (int i = 0; i < query.rows; i++)
+        query.at<uchar>(i, i % query.cols) ^= (uchar)(1 << (i % 8));
+
+    // key sizes giving both the per-key offsets and the sorted keys layouts
+    const int keySizes[] = { 8, 20 };
+    const int threads = getNumThreads();
+    for (size_t k = 0; k < sizeof(keySizes) / sizeof(keySizes[0]); k++)
+    {
+        Mat indices[2], dists[2];
+        for (int i = 0; i < 2; i++)
+        {
+            setNumThreads(i == 0 ? 1 : threads);
+            theRNG() = RNG(12345);
+            cv::flann::Index index(data, cv::flann::LshIndexParams(6, keySizes[k], 1), cvflann::FLANN_DIST_HAMMING);
+            index.knnSearch(query, indices[i], dists[i], 3, cv::flann::SearchParams());
+        }
+        setNumThreads(threads);
+
+        EXPECT_EQ(0, cvtest::norm(indices[0], indices[1], NORM_INF)) << "key_size " << keySizes[k];
+        for (int i = 0; i < query.rows; i++)
+        {
+            // one flipped bit is always recovered by the multi-probe
+            ASSERT_EQ(i, indices[1].at<int>(i, 0)) << "key_size " << keySizes[k];
+            ASSERT_EQ(1, dists[1].at<int>(i, 0)) << "key_size " << keySizes[k];
+        }
+    }
+}
+
+TEST(Features2d_FLANN_HNSW, recall_with_added_points)
+{
+    typedef cvflann::L2<float> Distance;
+    const int K = 10, queryCount = 200;
+    Mat data(4000, 64, CV_32F), query(queryCount, 64, CV_32F);
+    randu(data, Scalar::all(0), Scalar::all(1));
+    randu(query, Scalar::all(0), Scalar::all(1));
+
+    // build on the first half and insert the second half incrementally
+    cvflann::Matrix<float> dataset((float*)data.data, data.rows, data.cols);
+    cvflann::Matrix<float> firstHalf((float*)data.data, data.rows / 2, data.cols);
+    cvflann::Matrix<float> secondHalf(data.ptr<float>(data.rows / 2), data.rows - data.rows / 2, data.cols);
+    cvflann::Matrix<float> queries((float*)query.data, query.rows, query.cols);
+
+    cvflann::HnswIndex<Distance> index(firstHalf, cvflann::HnswIndexParams(16, 100));
+    index.buildIndex();
+    index.addPoints(secondHalf);
+    ASSERT_EQ((size_t)data.rows, index.size());
+
+    std::vector<int> gt(queryCount * K), found(queryCount * K);
+    std::vector<float> dists(queryCount * K);
+    cvflann::Matrix<int> gtMatches(&gt[0], queryCount, K), indices(&found[0], queryCount, K);
+    cvflann::Matrix<float> distances(&dists[0], queryCount, K);
+    cvflann::compute_ground_truth<Distance>(dataset, queries, gtMatches);
+    index.knnSearch(queries, indices, distances, K, cvflann::SearchParams(128));
+
+    int correct = 0;
+    for (int i = 0; i < queryCount; i++)
+        correct += cvflann::countCorrectMatches(indices[i], gtMatches[i], K);
+    EXPECT_GE(correct / (double)(queryCount * K), 0.9);
+
+    // the saved graph includes the inserted points
+    string filename = tempfile();
+    FILE* f = fopen(filename.c_str(), "wb");
+    ASSERT_TRUE(f != NULL);
+    index.saveIndex(f);
+    fclose(f);
+
+    cvflann::HnswIndex<Distance> loaded(firstHalf);
+    f = fopen(filename.c_str(), "rb");
+    ASSERT_TRUE(f != NULL);
+    loaded.loadIndex(f);
+    fclose(f);
+    remove(filename.c_str());
+
+    std::vector<int> loadedFound(queryCount * K);
+    cvflann::Matrix<int> loadedIndices(&loadedFound[0], queryCount, K);
+    loaded.knnSearch(queries, loadedIndices, distances, K, cvflann::SearchParams(128));
+    EXPECT_EQ(found, loadedFound);
+
+    // a candidate list shorter than K still returns K neighbors
+    std::fill(found.begin(), found.end(), -1);
+    index.knnSearch(queries, indices, distances, K, cvflann::SearchParams(4));
+    for (int i = 0; i < queryCount; i++)
+    {
+        std::vector<int> row(indices[i], indices[i] + K);
+        std::sort(row.begin(), row.end());
+        ASSERT_GE(row[0], 0) << "query " << i;
+        ASSERT_TRUE(std::unique(row.begin(), row.end()) == row.end()) << "query " << i;
+    }
+}
+
+TEST(Features2d_FLANN_IVFPQ, recall_and_save_load)
+{
+    typedef cvflann::L2<float> Distance;
+    const int K = 10, queryCount = 100, clusters = 20;
+    Mat data(5000, 32, CV_32F), query(queryCount, 32, CV_32F), centers(clusters, 32, CV_32F);
+    RNG& rng = theRNG();
+    rng.fill(centers, RNG::UNIFORM, 0, 10);
+    rng.fill(data, RNG::NORMAL, 0, 1);
+    rng.fill(query, RNG::NORMAL, 0, 1);
+    for (int i = 0; i < data.rows; i++)
+        data.row(i) += centers.row(i % clusters);
+    for (int i = 0; i < query.rows; i++)
+        query.row(i) += centers.row(i % clusters);
+
+    cvflann::Matrix<float> dataset((float*)data.data, data.rows, data.cols);
+    cvflann::Matrix<float> queries((float*)query.data, query.rows, query.cols);
+    std::vector<int> gt(queryCount * K);
+    cvflann::Matrix<int> gtMatches(&gt[0], queryCount, K);
+    cvflann::compute_ground_truth<Distance>(dataset, queries, gtMatches);
+
+    std::vector<int> found[2];
+    std::vector<float> dists(queryCount * K);
+    cvflann::Matrix<float> distances(&dists[0], queryCount, K);
+    double recall[2];
+    for (int r = 0; r < 2; r++)
+    {
+        cvflann::IvfPqIndex<Distance> index(dataset, cvflann::IvfPqIndexParams(32, 8, r == 0 ? 0 : 100));
+        index.buildIndex();
+        EXPECT_LT(index.usedMemory(), (int)(data.total() * sizeof(float) / 2));
+
+        found[r].resize(queryCount * K);
+        cvflann::Matrix<int> indices(&found[r][0], queryCount, K);
+        index.knnSearch(queries, indices, distances, K, cvflann::SearchParams(1000));
+        int correct = 0;
+        for (int i = 0; i < queryCount; i++)
+            correct += cvflann::countCorrectMatches(indices[i], gtMatches[i], K);
+        recall[r] = correct / (double)(queryCount * K);
+
+        string filename = tempfile();
+        FILE* f = fopen(filename.c_str(), "wb");
+        ASSERT_TRUE(f != NULL);
+        index.saveIndex(f);
+        fclose(f);
+
+        cvflann::IvfPqIndex<Distance> loaded(dataset);
+        f = fopen(filename.c_str(), "rb");
+        ASSERT_TRUE(f != NULL);
+        loaded.loadIndex(f);
+        fclose(f);
+        remove(filename.c_str());
+
+        std::vector<int> loadedFound(queryCount * K);
+        cvflann::Matrix<int> loadedIndices(&loadedFound[0], queryCount, K);
+        loaded.knnSearch(queries, loadedIndices, distances, K, cvflann::SearchParams(1000));
+        EXPECT_EQ(found[r], loadedFound);
+    }
+    EXPECT_GE(recall[0], 0.4);
+    EXPECT_GE(recall[1], 0.9);
+    EXPECT_GE(recall[1], recall[0]);
+
+    // without re-ranking cv::flann::Index does not need the raw vectors after the build,
+    // and the quantizers only depend on the seed
+    Mat indices[2], flannDists[2];
+    for (int i = 0; i < 2; i++)
+    {
+        Mat copy = data.clone();
+        theRNG() = RNG(12345);
+        cv::flann::Index index(copy, cv::flann::IvfPqIndexParams(32, 8));
+        copy.setTo(Scalar::all(0));
+        copy.release();
+        index.knnSearch(query, indices[i], flannDists[i], K, cv::flann::SearchParams(1000));
+    }
+    EXPECT_EQ(0, cvtest::norm(indices[0], indices[1], NORM_INF));
+    EXPECT_EQ(0, cvtest::norm(flannDists[0], flannDists[1], NORM_INF));
+}
+
+TEST(Features2d_FLANN_IVFPQ, rerank_checks)
+{
+    typedef cvflann::L2<float> Distance;
+    const int K = 10, queryCount = 100, clusters = 20;
+    Mat data(2000, 32, CV_32F), query(queryCount, 32, CV_32F), centers(clusters, 32, CV_32F);
+    RNG& rng = theRNG();
+    rng.fill(centers, RNG::UNIFORM, 0, 10);
+    rng.fill(data, RNG::NORMAL, 0, 1);
+    rng.fill(query, RNG::UNIFORM, 0, 10);
+    for (int i = 0; i < data.rows; i++)
+        data.row(i) += centers.row(i % clusters);
+
+    cvflann::Matrix<float> dataset((float*)data.data, data.rows, data.cols);
+    cvflann::Matrix<float> queries((float*)query.data, query.rows, query.cols);
+    std::vector<float> dists(queryCount * K);
+    cvflann::Matrix<float> distances(&dists[0], queryCount, K);
+
+    // the search stops at "checks" once the candidates to re-rank are collected
+    cvflann::IvfPqIndex<Distance> index(dataset, cvflann::IvfPqIndexParams(32, 8, 20));
+    index.buildIndex();
+    std::vector<int> found[2];
+    for (int i = 0; i < 2; i++)
+    {
+        found[i].resize(queryCount * K);
+        cvflann::Matrix<int> indices(&found[i][0], queryCount, K);
+        index.knnSearch(queries, indices, distances, K,
+                        cvflann::SearchParams(i == 0 ? 1 : cvflann::FLANN_CHECKS_UNLIMITED));
+    }
+    EXPECT_NE(found[0], found[1]);
+
+    // fewer candidates to re-rank than neighbors still returns K neighbors
+    cvflann::IvfPqIndex<Distance> small(dataset, cvflann::IvfPqIndexParams(32, 8, 3));
+    small.buildIndex();
+    std::vector<int> smallFound(queryCount * K);
+    cvflann::Matrix<int> indices(&smallFound[0], queryCount, K);
+    small.knnSearch(queries, indices, distances, K, cvflann::SearchParams(1));
+    for (int i = 0; i < queryCount; i++)
+    {
+        std::vector<int> row(indices[i], indices[i] + K);
+        std::sort(row.begin(), row.end());
+        ASSERT_GE(row[0], 0) << "query " << i;
+        ASSERT_LT(row[K - 1], data.rows) << "query " << i;
+        ASSERT_TRUE(std::unique(row.begin(), row.end()) == row.end()) << "query " << i;
+    }
+}
+
 TEST(Features2d_FLANN_Linear, regression) { CV_FlannLinearIndexTest test; test.safe_run(); }
 TEST(Features2d_FLANN_KMeans, regression) { CV_FlannKMeansIndexTest test; test.safe_run(); }
 TEST(Features2d_FLANN_KDTree, regression) { CV_FlannKDTreeIndexTest test; test.safe_run(); }
 TEST(Features2d_FLANN_Composite, regression) { CV_FlannCompositeIndexTest test; test.safe_run(); }
 TEST(Features2d_FLANN_Auto, regression) { CV_FlannAutotunedIndexTest test; test.safe_run(); }
+TEST(Features2d_FLANN_HNSW, regression) { CV_FlannHnswIndexTest test; test.safe_run(); }
 TEST(Features2d_FLANN_Saved, regression) { CV_FlannSavedIndexTest test; test.safe_run(); }
+TEST(Features2d_FLANN_HNSW, saved) { CV_FlannSavedHnswIndexTest test; test.safe_run(); }
 
 #endif
 
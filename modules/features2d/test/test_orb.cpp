@@ -141,6 +141,39 @@ TEST(Features2D_ORB, regression_16197)
     ASSERT_NO_THROW(orbPtr->detectAndCompute(img, noArray(), kps, fv));
 }
 
+typedef testing::TestWithParam<int> Features2D_ORB_WTA;
+
+TEST_P(Features2D_ORB_WTA, parallel_matches_serial)
+{
+    const int wta_k = GetParam();
+    Mat img(Size(640, 480), CV_8UC1);
+    RNG& rng = theRNG();
+    rng.fill(img, RNG::UNIFORM, 0, 256);
+    GaussianBlur(img, img, Size(5, 5), 1.5);
+
+    Ptr<ORB> orb = ORB::create(2000, 1.2f, 8, 31, 0, wta_k);
+
+    std::vector<KeyPoint> kps_ref, kps;
+    Mat desc_ref, desc;
+    int nthreads = getNumThreads();
+    setNumThreads(1);
+    orb->detectAndCompute(img, noArray(), kps_ref, desc_ref);
+    setNumThreads(nthreads);
+    orb->detectAndCompute(img, noArray(), kps, desc);
+
+    ASSERT_FALSE(kps_ref.empty());
+    ASSERT_EQ(kps_ref.size(), kps.size());
+    for (size_t i = 0; i < kps.size(); i++)
+    {
+        EXPECT_EQ(kps_ref[i].pt, kps[i].pt) << i;
+        EXPECT_EQ(kps_ref[i].angle, kps[i].angle) << i;
+        EXPECT_EQ(kps_ref[i].octave, kps[i].octave) << i;
+    }
+    EXPECT_EQ(0, cvtest::norm(desc_ref, desc, NORM_INF));
+}
+
+INSTANTIATE_TEST_CASE_P(/**/, Features2D_ORB_WTA, testing::Values(2, 3, 4));
+
 // https://github.com/opencv/opencv-python/issues/537
 BIGDATA_TEST(Features2D_ORB, regression_opencv_python_537)  // memory usage: ~3 Gb
 {
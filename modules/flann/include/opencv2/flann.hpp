@@ -261,6 +261,37 @@ public:
                 int multi_probe_level );
         };
         @endcode
+        - **HnswIndexParams** When using a parameters object of this type the index created is a
+        Hierarchical Navigable Small World graph (by Efficient and robust approximate nearest neighbor
+        search using Hierarchical Navigable Small World graphs by Yu. A. Malkov, D. A. Yashunin, IEEE
+        Transactions on Pattern Analysis and Machine Intelligence, 2018). It is well suited for
+        high-dimensional vectors. The checks search parameter is the size of the candidate list and
+        should not be smaller than the number of neighbors searched for. :
+        @code
+        struct HnswIndexParams : public IndexParams
+        {
+            HnswIndexParams(
+                int M = 16,
+                int ef_construction = 200 );
+        };
+        @endcode
+        - **IvfPqIndexParams** When using a parameters object of this type the index created is an
+        inverted file with product quantization (by Product quantization for nearest neighbor search
+        by Herve Jegou, Matthijs Douze, Cordelia Schmid, IEEE Transactions on Pattern Analysis and
+        Machine Intelligence, 2011). Each vector is stored as m bytes, the vector length must be a
+        multiple of m. The checks search parameter is the number of encoded vectors examined. Unless
+        rerank is set, the distances are approximations of the squared euclidean distance and
+        cv::flann::Index does not keep a copy of the raw vectors. :
+        @code
+        struct IvfPqIndexParams : public IndexParams
+        {
+            IvfPqIndexParams(
+                int nlist = 1024,
+                int m = 8,
+                int rerank = 0,
+                int iterations = 10 );
+        };
+        @endcode
         - **AutotunedIndexParams** When passing an object of this type the index created is
         automatically tuned to offer the best performance, by choosing the optimal index type
         (randomized kd-trees, hierarchical kmeans, linear) and parameters for the dataset provided. :
@@ -42,6 +42,8 @@
 #include "linear_index.h"
 #include "hierarchical_clustering_index.h"
 #include "lsh_index.h"
+#include "hnsw_index.h"
+#include "ivfpq_index.h"
 #include "autotuned_index.h"
 
 
@@ -81,6 +83,12 @@ struct index_creator
         case FLANN_INDEX_LSH:
             nnIndex = new LshIndex<Distance>(dataset, params, distance);
             break;
+        case FLANN_INDEX_HNSW:
+            nnIndex = new HnswIndex<Distance>(dataset, params, distance);
+            break;
+        case FLANN_INDEX_IVFPQ:
+            nnIndex = new IvfPqIndex<Distance>(dataset, params, distance);
+            break;
         default:
             FLANN_THROW(cv::Error::StsBadArg, "Unknown index type");
         }
@@ -110,6 +118,9 @@ struct index_creator<False,VectorSpace,Distance>
         case FLANN_INDEX_LSH:
             nnIndex = new LshIndex<Distance>(dataset, params, distance);
             break;
+        case FLANN_INDEX_HNSW:
+            nnIndex = new HnswIndex<Distance>(dataset, params, distance);
+            break;
         default:
             FLANN_THROW(cv::Error::StsBadArg, "Unknown index type");
         }
@@ -139,6 +150,9 @@ struct index_creator<False,False,Distance>
         case FLANN_INDEX_LSH:
             nnIndex = new LshIndex<Distance>(dataset, params, distance);
             break;
+        case FLANN_INDEX_HNSW:
+            nnIndex = new HnswIndex<Distance>(dataset, params, distance);
+            break;
         default:
             FLANN_THROW(cv::Error::StsBadArg, "Unknown index type");
         }
@@ -36,6 +36,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "general.h"
+
 
 namespace cvflann
 {
@@ -81,7 +83,7 @@ class PooledAllocator
     /* Minimum number of bytes requested at a time from	the system.  Must be multiple of WORDSIZE. */
 
 
-    int     remaining;  /* Number of bytes left in current block of storage. */
+    size_t  remaining;  /* Number of bytes left in current block of storage. */
     void*   base;     /* Pointer to base of current block of storage. */
     void*   loc;      /* Current location in block to next allocate memory. */
     int     blocksize;
@@ -123,9 +125,14 @@ public:
      * Returns a pointer to a piece of new memory of the given size in bytes
      * allocated from the pool.
      */
-    void* allocateMemory(int size)
+    void* allocateMemory(size_t size)
     {
-        int blockSize;
+        size_t blockSize;
+
+        /* Sizes this large cannot be allocated, and would wrap around below. */
+        if (size > (((size_t)-1) >> 1) - BLOCKSIZE) {
+            FLANN_THROW(cv::Error::StsNoMem, "Failed to allocate memory");
+        }
 
         /* Round size up to a multiple of wordsize.  The following expression
             only works for WORDSIZE that is a power of 2, by masking last bits of
@@ -138,7 +145,7 @@ public:
          */
         if (size > remaining) {
 
-            wastedMemory += remaining;
+            wastedMemory += (int)remaining;
 
             /* Allocate new storage. */
             blockSize = (size + sizeof(void*) + (WORDSIZE-1) > BLOCKSIZE) ?
@@ -147,8 +154,7 @@ public:
             // use the standard C malloc to allocate memory
             void* m = ::malloc(blockSize);
             if (!m) {
-                fprintf(stderr,"Failed to allocate memory.\n");
-                return NULL;
+                FLANN_THROW(cv::Error::StsNoMem, "Failed to allocate memory");
             }
 
             /* Fill first word of new block with pointer to previous block. */
@@ -165,7 +171,7 @@ public:
         loc = (char*)loc + size;
         remaining -= size;
 
-        usedMemory += size;
+        usedMemory += (int)size;
 
         return rloc;
     }
@@ -180,7 +186,7 @@ public:
     template <typename T>
     T* allocate(size_t count = 1)
     {
-        T* mem = (T*) this->allocateMemory((int)(sizeof(T)*count));
+        T* mem = (T*) this->allocateMemory(sizeof(T)*count);
         return mem;
     }
 
@@ -0,0 +1,651 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef OPENCV_FLANN_HNSW_INDEX_H_
+#define OPENCV_FLANN_HNSW_INDEX_H_
+
+//! @cond IGNORED
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/hal.hpp"
+
+#include "nn_index.h"
+#include "matrix.h"
+#include "result_set.h"
+#include "saving.h"
+#include "dist.h"
+
+namespace cvflann
+{
+
+struct HnswIndexParams : public IndexParams
+{
+    HnswIndexParams(int M = 16, int ef_construction = 200)
+    {
+        (*this)["algorithm"] = FLANN_INDEX_HNSW;
+        // The number of links per node on the upper layers (2*M on the bottom layer)
+        (*this)["M"] = M;
+        // The size of the candidate list used while the graph is built
+        (*this)["ef_construction"] = ef_construction;
+    }
+};
+
+namespace hnsw
+{
+
+/**
+ * Distance evaluation used by the graph traversal. The generic version calls the
+ * functor, the specializations below forward the common float metrics to the
+ * vectorized kernels of the core module.
+ */
+template<typename Distance>
+struct DistanceKernel
+{
+    typedef typename Distance::ElementType ElementType;
+    typedef typename Distance::ResultType DistanceType;
+
+    static DistanceType apply(const Distance& distance, const ElementType* a, const ElementType* b, size_t n)
+    {
+        return distance(a, b, n);
+    }
+};
+
+template<>
+struct DistanceKernel< L2<float> >
+{
+    static float apply(const L2<float>&, const float* a, const float* b, size_t n)
+    {
+        return cv::hal::normL2Sqr_(a, b, (int)n);
+    }
+};
+
+template<>
+struct DistanceKernel< L2_Simple<float> >
+{
+    static float apply(const L2_Simple<float>&, const float* a, const float* b, size_t n)
+    {
+        return cv::hal::normL2Sqr_(a, b, (int)n);
+    }
+};
+
+template<>
+struct DistanceKernel< L1<float> >
+{
+    static float apply(const L1<float>&, const float* a, const float* b, size_t n)
+    {
+        return cv::hal::normL1_(a, b, (int)n);
+    }
+};
+
+/**
+ * Visited-node marks of one search. Marks are epoch tagged so that the array does
+ * not have to be cleared between searches.
+ */
+class VisitedList
+{
+public:
+    VisitedList() : tag_(0) {}
+
+    void reset(size_t size)
+    {
+        if (marks_.size() < size)
+            marks_.resize(size, 0);
+        if (++tag_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0u);
+            tag_ = 1;
+        }
+    }
+
+    /** Marks the node and returns true if it had already been visited. */
+    bool visit(int index)
+    {
+        if (marks_[index] == tag_) return true;
+        marks_[index] = tag_;
+        return false;
+    }
+
+private:
+    std::vector<unsigned> marks_;
+    unsigned tag_;
+};
+
+class VisitedListPool
+{
+public:
+    VisitedListPool() {}
+
+    ~VisitedListPool()
+    {
+        for (size_t i = 0; i < lists_.size(); ++i) delete lists_[i];
+    }
+
+    VisitedList* get(size_t size)
+    {
+        VisitedList* list = NULL;
+        {
+            cv::AutoLock lock(mutex_);
+            if (!lists_.empty()) {
+                list = lists_.back();
+                lists_.pop_back();
+            }
+        }
+        if (list == NULL) list = new VisitedList();
+        list->reset(size);
+        return list;
+    }
+
+    void release(VisitedList* list)
+    {
+        cv::AutoLock lock(mutex_);
+        lists_.push_back(list);
+    }
+
+private:
+    VisitedListPool(const VisitedListPool&);
+    VisitedListPool& operator=(const VisitedListPool&);
+
+    cv::Mutex mutex_;
+    std::vector<VisitedList*> lists_;
+};
+
+}
+
+/**
+ * Hierarchical Navigable Small World graph index.
+ *
+ * Y. A. Malkov, D. A. Yashunin, "Efficient and robust approximate nearest neighbor
+ * search using Hierarchical Navigable Small World graphs", TPAMI 2018.
+ *
+ * Every point is a node of a proximity graph on layer 0 and, with exponentially
+ * decaying probability, on the layers above it. A query descends greedily from the
+ * single entry point on the top layer and runs a best-first search with a candidate
+ * list of "checks" elements on layer 0. The graph is built with a parallel loop;
+ * points can be appended later with addPoints().
+ */
+template <typename Distance>
+class HnswIndex : public NNIndex<Distance>
+{
+public:
+    typedef typename Distance::ElementType ElementType;
+    typedef typename Distance::ResultType DistanceType;
+
+    /** Constructor
+     * @param inputData dataset with the input features
+     * @param params parameters passed to the HNSW algorithm
+     * @param d the distance used
+     */
+    HnswIndex(const Matrix<ElementType>& inputData, const IndexParams& params = HnswIndexParams(),
+              Distance d = Distance()) :
+        dataset_(inputData), index_params_(params), distance_(d),
+        size_(0), entry_point_(-1), max_level_(-1), rng_(0x48534e57), link_locks_(LOCK_COUNT)
+    {
+        veclen_ = dataset_.cols;
+        setParams(get_param(index_params_, "M", 16), get_param(index_params_, "ef_construction", 200));
+    }
+
+    HnswIndex(const HnswIndex&);
+    HnswIndex& operator=(const HnswIndex&);
+
+    flann_algorithm_t getType() const CV_OVERRIDE
+    {
+        return FLANN_INDEX_HNSW;
+    }
+
+    size_t size() const CV_OVERRIDE
+    {
+        return size_;
+    }
+
+    size_t veclen() const CV_OVERRIDE
+    {
+        return veclen_;
+    }
+
+    int usedMemory() const CV_OVERRIDE
+    {
+        size_t mem = levels_.size() * sizeof(int) + links0_.size() * sizeof(int) +
+                     upper_links_.size() * sizeof(std::vector<int>) + extra_points_.size() * sizeof(ElementType);
+        for (size_t i = 0; i < upper_links_.size(); ++i)
+            mem += upper_links_[i].size() * sizeof(int);
+        return (int)mem;
+    }
+
+    IndexParams getParameters() const CV_OVERRIDE
+    {
+        return index_params_;
+    }
+
+    /**
+     * Builds the graph over the whole dataset.
+     */
+    void buildIndex() CV_OVERRIDE
+    {
+        size_ = 0;
+        entry_point_ = -1;
+        max_level_ = -1;
+        levels_.clear();
+        links0_.clear();
+        upper_links_.clear();
+        extra_points_.clear();
+        insertPoints(dataset_.rows);
+    }
+
+    /**
+     * Inserts new points into an already built graph. The points are copied, they
+     * get the indices following the existing ones.
+     */
+    void addPoints(const Matrix<ElementType>& points)
+    {
+        if (points.rows == 0) return;
+        CV_Assert(points.cols == veclen_);
+        for (size_t i = 0; i < points.rows; ++i)
+            extra_points_.insert(extra_points_.end(), points[i], points[i] + veclen_);
+        insertPoints(size_ + points.rows);
+    }
+
+    void saveIndex(FILE* stream) CV_OVERRIDE
+    {
+        save_value(stream, M_);
+        save_value(stream, ef_construction_);
+        save_value(stream, size_);
+        save_value(stream, entry_point_);
+        save_value(stream, max_level_);
+        saveVector(stream, levels_);
+        saveVector(stream, links0_);
+        for (size_t i = 0; i < size_; ++i) {
+            if (levels_[i] > 0) saveVector(stream, upper_links_[i]);
+        }
+        saveVector(stream, extra_points_);
+    }
+
+    void loadIndex(FILE* stream) CV_OVERRIDE
+    {
+        int M, ef_construction;
+        load_value(stream, M);
+        load_value(stream, ef_construction);
+        setParams(M, ef_construction);
+        load_value(stream, size_);
+        load_value(stream, entry_point_);
+        load_value(stream, max_level_);
+        loadVector(stream, levels_);
+        loadVector(stream, links0_);
+        if (levels_.size() != size_ || links0_.size() != size_ * (M0_ + 1)) {
+            FLANN_THROW(cv::Error::StsError, "Invalid index file, graph size mismatch");
+        }
+        upper_links_.assign(size_, std::vector<int>());
+        for (size_t i = 0; i < size_; ++i) {
+            if (levels_[i] > 0) loadVector(stream, upper_links_[i]);
+        }
+        loadVector(stream, extra_points_);
+        if (dataset_.rows + extra_points_.size() / veclen_ != size_) {
+            FLANN_THROW(cv::Error::StsError, "Invalid index file, dataset size mismatch");
+        }
+
+        index_params_["algorithm"] = getType();
+        index_params_["M"] = M_;
+        index_params_["ef_construction"] = ef_construction_;
+    }
+
+    /**
+     * Find set of nearest neighbors to vec. Their indices are stored inside
+     * the result object.
+     *
+     * Params:
+     *     result = the result object in which the indices of the nearest-neighbors are stored
+     *     vec = the vector for which to search the nearest neighbors
+     *     searchParams = "checks" is the size of the candidate list used on the bottom layer,
+     *                    it is raised when it is smaller than the number of requested neighbors
+     */
+    void findNeighbors(ResultSet<DistanceType>& result, const ElementType* vec, const SearchParams& searchParams) CV_OVERRIDE
+    {
+        if (size_ == 0) return;
+
+        int ef = get_param(searchParams, "checks", 32);
+        if (ef <= 0 || (size_t)ef > size_) ef = (int)size_;
+
+        int ep = entry_point_;
+        DistanceType epDist = dist(vec, ep);
+        for (int level = max_level_; level > 0; --level) {
+            greedySearch(vec, ep, epDist, level, false);
+        }
+
+        // the result set does not expose its capacity, so when fewer candidates than
+        // requested neighbors were kept, search again with a larger list; the knn
+        // result sets skip the indices they already hold
+        for (;;) {
+            CandidateQueue top;
+            searchLayer(vec, ep, epDist, ef, 0, false, top);
+            while (!top.empty()) {
+                result.addPoint(top.top().first, top.top().second);
+                top.pop();
+            }
+            if (result.full() || (size_t)ef >= size_) break;
+            ef = (int)std::min((size_t)ef*2, size_);
+        }
+    }
+
+private:
+    typedef std::pair<DistanceType, int> Candidate;
+    // max-heap, the furthest candidate is on top
+    typedef std::priority_queue<Candidate> CandidateQueue;
+    // min-heap, the closest candidate is on top
+    typedef std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate> > ExpansionQueue;
+
+    enum { LOCK_COUNT = 1 << 12 };
+
+    void setParams(int M, int ef_construction)
+    {
+        M_ = std::max(M, 2);
+        M0_ = 2 * M_;
+        ef_construction_ = std::max(ef_construction, M_);
+        level_mult_ = 1.0 / std::log((double)M_);
+    }
+
+    const ElementType* point(int index) const
+    {
+        return (size_t)index < dataset_.rows ? dataset_[index] :
+               &extra_points_[((size_t)index - dataset_.rows) * veclen_];
+    }
+
+    DistanceType dist(const ElementType* vec, int index) const
+    {
+        return hnsw::DistanceKernel<Distance>::apply(distance_, vec, point(index), veclen_);
+    }
+
+    /** Link list of a node on a layer, element 0 holds the number of links. */
+    int* links(int index, int level)
+    {
+        return level == 0 ? &links0_[(size_t)index * (M0_ + 1)] : &upper_links_[index][(size_t)(level - 1) * (M_ + 1)];
+    }
+
+    cv::Mutex& nodeLock(int index)
+    {
+        return link_locks_[index & (LOCK_COUNT - 1)];
+    }
+
+    int randomLevel()
+    {
+        double r = 1.0 - rng_.uniform(0., 1.);
+        return (int)(-std::log(r) * level_mult_);
+    }
+
+    /**
+     * Grows the graph to hold the first newSize points. The levels are drawn
+     * serially so that the layer structure does not depend on the thread count.
+     */
+    void insertPoints(size_t newSize)
+    {
+        size_t first = size_;
+        if (newSize <= first) return;
+
+        levels_.resize(newSize);
+        links0_.resize(newSize * (M0_ + 1), 0);
+        upper_links_.resize(newSize);
+        for (size_t i = first; i < newSize; ++i) {
+            levels_[i] = randomLevel();
+            if (levels_[i] > 0) upper_links_[i].assign((size_t)levels_[i] * (M_ + 1), 0);
+        }
+        size_ = newSize;
+
+        if (entry_point_ < 0) {
+            entry_point_ = (int)first;
+            max_level_ = levels_[first];
+            ++first;
+        }
+
+        cv::parallel_for_(cv::Range((int)first, (int)newSize), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; ++i) insertPoint(i);
+        });
+    }
+
+    void insertPoint(int index)
+    {
+        int level = levels_[index];
+        int ep, maxLevel;
+        {
+            // the global lock is kept only by an insertion that raises the top layer
+            cv::AutoLock global(global_lock_);
+            ep = entry_point_;
+            maxLevel = max_level_;
+            if (level > maxLevel) {
+                linkPoint(index, level, ep, maxLevel);
+                entry_point_ = index;
+                max_level_ = level;
+                return;
+            }
+        }
+        linkPoint(index, level, ep, maxLevel);
+    }
+
+    void linkPoint(int index, int level, int ep, int maxLevel)
+    {
+        const ElementType* vec = point(index);
+        DistanceType epDist = dist(vec, ep);
+        for (int lc = maxLevel; lc > level; --lc) {
+            greedySearch(vec, ep, epDist, lc, true);
+        }
+
+        for (int lc = std::min(level, maxLevel); lc >= 0; --lc) {
+            CandidateQueue top;
+            searchLayer(vec, ep, epDist, ef_construction_, lc, true, top);
+            connect(index, top, lc, ep, epDist);
+        }
+    }
+
+    void greedySearch(const ElementType* vec, int& ep, DistanceType& epDist, int level, bool lock)
+    {
+        std::vector<int> neighbors;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            copyLinks(ep, level, lock, neighbors);
+            for (size_t j = 0; j < neighbors.size(); ++j) {
+                DistanceType d = dist(vec, neighbors[j]);
+                if (d < epDist) {
+                    epDist = d;
+                    ep = neighbors[j];
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    void copyLinks(int index, int level, bool lock, std::vector<int>& neighbors)
+    {
+        if (lock) {
+            cv::AutoLock guard(nodeLock(index));
+            const int* l = links(index, level);
+            neighbors.assign(l + 1, l + 1 + l[0]);
+        }
+        else {
+            const int* l = links(index, level);
+            neighbors.assign(l + 1, l + 1 + l[0]);
+        }
+    }
+
+    /**
+     * Best-first search on one layer, leaves the ef closest nodes found in top.
+     */
+    void searchLayer(const ElementType* vec, int ep, DistanceType epDist, int ef, int level, bool lock, CandidateQueue& top)
+    {
+        hnsw::VisitedList* visited = visited_pool_.get(size_);
+        ExpansionQueue candidates;
+        std::vector<int> neighbors;
+
+        visited->visit(ep);
+        top.push(Candidate(epDist, ep));
+        candidates.push(Candidate(epDist, ep));
+
+        while (!candidates.empty()) {
+            Candidate current = candidates.top();
+            if (current.first > top.top().first && (int)top.size() >= ef) break;
+            candidates.pop();
+
+            copyLinks(current.second, level, lock, neighbors);
+            for (size_t j = 0; j < neighbors.size(); ++j) {
+                int n = neighbors[j];
+                if (visited->visit(n)) continue;
+                DistanceType d = dist(vec, n);
+                if ((int)top.size() < ef || d < top.top().first) {
+                    candidates.push(Candidate(d, n));
+                    top.push(Candidate(d, n));
+                    if ((int)top.size() > ef) top.pop();
+                }
+            }
+        }
+        visited_pool_.release(visited);
+    }
+
+    /**
+     * Neighbor selection heuristic: a candidate is kept only if it is closer to the
+     * base node than to every neighbor already kept. The candidates are sorted by
+     * increasing distance.
+     */
+    void selectNeighbors(const std::vector<Candidate>& candidates, int count, std::vector<Candidate>& selected) const
+    {
+        selected.clear();
+        for (size_t i = 0; i < candidates.size() && (int)selected.size() < count; ++i) {
+            const ElementType* c = point(candidates[i].second);
+            bool good = true;
+            for (size_t j = 0; j < selected.size(); ++j) {
+                if (dist(c, selected[j].second) < candidates[i].first) {
+                    good = false;
+                    break;
+                }
+            }
+            if (good) selected.push_back(candidates[i]);
+        }
+    }
+
+    void connect(int index, CandidateQueue& top, int level, int& ep, DistanceType& epDist)
+    {
+        int maxLinks = level == 0 ? M0_ : M_;
+
+        std::vector<Candidate> candidates;
+        candidates.reserve(top.size());
+        while (!top.empty()) {
+            if (top.top().second != index) candidates.push_back(top.top());
+            top.pop();
+        }
+        if (candidates.empty()) return;
+        std::reverse(candidates.begin(), candidates.end());
+
+        std::vector<Candidate> selected;
+        selectNeighbors(candidates, M_, selected);
+        ep = candidates[0].second;
+        epDist = candidates[0].first;
+
+        {
+            cv::AutoLock guard(nodeLock(index));
+            int* l = links(index, level);
+            l[0] = (int)selected.size();
+            for (size_t j = 0; j < selected.size(); ++j) l[j + 1] = selected[j].second;
+        }
+
+        std::vector<Candidate> pruned, kept;
+        for (size_t j = 0; j < selected.size(); ++j) {
+            int n = selected[j].second;
+            cv::AutoLock guard(nodeLock(n));
+            int* l = links(n, level);
+            int count = l[0];
+            if (std::find(l + 1, l + 1 + count, index) != l + 1 + count) continue;
+            if (count < maxLinks) {
+                l[count + 1] = index;
+                l[0] = count + 1;
+                continue;
+            }
+
+            // the neighbor is full, keep the best maxLinks of its links and the new node
+            const ElementType* nvec = point(n);
+            pruned.clear();
+            pruned.push_back(Candidate(selected[j].first, index));
+            for (int k = 1; k <= count; ++k) pruned.push_back(Candidate(dist(nvec, l[k]), l[k]));
+            std::sort(pruned.begin(), pruned.end());
+            selectNeighbors(pruned, maxLinks, kept);
+            l[0] = (int)kept.size();
+            for (size_t k = 0; k < kept.size(); ++k) l[k + 1] = kept[k].second;
+        }
+    }
+
+    template<typename T>
+    static void saveVector(FILE* stream, const std::vector<T>& v)
+    {
+        size_t size = v.size();
+        save_value(stream, size);
+        if (size > 0) save_value(stream, v[0], (int)size);
+    }
+
+    template<typename T>
+    static void loadVector(FILE* stream, std::vector<T>& v)
+    {
+        size_t size;
+        load_value(stream, size);
+        v.resize(size);
+        if (size > 0) load_value(stream, v[0], (int)size);
+    }
+
+private:
+    /**
+     * The dataset used by this index
+     */
+    const Matrix<ElementType> dataset_;
+
+    /**
+     * Points added after the index was built
+     */
+    std::vector<ElementType> extra_points_;
+
+    IndexParams index_params_;
+
+    Distance distance_;
+
+    size_t veclen_;
+
+    /**
+     * Number of points in the graph
+     */
+    size_t size_;
+
+    int M_;
+    int M0_;
+    int ef_construction_;
+    double level_mult_;
+
+    int entry_point_;
+    int max_level_;
+
+    /**
+     * Top layer of each node
+     */
+    std::vector<int> levels_;
+
+    /**
+     * Layer 0 links, M0_+1 ints per node
+     */
+    std::vector<int> links0_;
+
+    /**
+     * Links of the upper layers, M_+1 ints per node and layer
+     */
+    std::vector< std::vector<int> > upper_links_;
+
+    cv::RNG rng_;
+
+    cv::Mutex global_lock_;
+    std::vector<cv::Mutex> link_locks_;
+    hnsw::VisitedListPool visited_pool_;
+};
+
+}
+
+//! @endcond
+
+#endif //OPENCV_FLANN_HNSW_INDEX_H_
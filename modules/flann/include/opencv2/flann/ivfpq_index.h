@@ -0,0 +1,504 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef OPENCV_FLANN_IVFPQ_INDEX_H_
+#define OPENCV_FLANN_IVFPQ_INDEX_H_
+
+//! @cond IGNORED
+
+#include <algorithm>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/utility.hpp"
+#include "opencv2/core/hal/hal.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+#include "nn_index.h"
+#include "matrix.h"
+#include "result_set.h"
+#include "saving.h"
+
+namespace cvflann
+{
+
+struct IvfPqIndexParams : public IndexParams
+{
+    IvfPqIndexParams(int nlist = 1024, int m = 8, int rerank = 0, int iterations = 10)
+    {
+        (*this)["algorithm"] = FLANN_INDEX_IVFPQ;
+        // The number of inverted lists (coarse quantizer centroids)
+        (*this)["nlist"] = nlist;
+        // The number of sub-quantizers, the vector length must be a multiple of it
+        (*this)["m"] = m;
+        // The number of approximate candidates re-ranked with the exact distance (0 to disable)
+        (*this)["rerank"] = rerank;
+        // The maximum number of k-means iterations used for training the quantizers
+        (*this)["iterations"] = iterations;
+    }
+};
+
+namespace pq
+{
+
+/** Number of codes stored together, subspace after subspace, in the inverted lists */
+const int BLOCK_SIZE = 16;
+/** Number of centroids of each sub-quantizer, the codes are stored as bytes */
+const int KSUB = 256;
+
+/**
+ * Asymmetric distance computation: dists[j] = sum_s table[s*KSUB + code_j[s]] for
+ * nblocks blocks of BLOCK_SIZE codes.
+ */
+inline void adcScan(const float* table, int m, const uchar* codes, int nblocks, float* dists)
+{
+    for (int b = 0; b < nblocks; b++, codes += m*BLOCK_SIZE, dists += BLOCK_SIZE) {
+#if CV_SIMD128
+        cv::v_float32x4 s0 = cv::v_setzero_f32(), s1 = s0, s2 = s0, s3 = s0;
+        for (int s = 0; s < m; s++) {
+            const float* t = table + s*KSUB;
+            cv::v_uint16x8 c0, c1;
+            cv::v_uint32x4 c00, c01, c10, c11;
+            cv::v_expand(cv::v_load(codes + s*BLOCK_SIZE), c0, c1);
+            cv::v_expand(c0, c00, c01);
+            cv::v_expand(c1, c10, c11);
+            s0 = cv::v_add(s0, cv::v_lut(t, cv::v_reinterpret_as_s32(c00)));
+            s1 = cv::v_add(s1, cv::v_lut(t, cv::v_reinterpret_as_s32(c01)));
+            s2 = cv::v_add(s2, cv::v_lut(t, cv::v_reinterpret_as_s32(c10)));
+            s3 = cv::v_add(s3, cv::v_lut(t, cv::v_reinterpret_as_s32(c11)));
+        }
+        cv::v_store(dists, s0);
+        cv::v_store(dists + 4, s1);
+        cv::v_store(dists + 8, s2);
+        cv::v_store(dists + 12, s3);
+#else
+        for (int j = 0; j < BLOCK_SIZE; j++) {
+            float d = 0;
+            for (int s = 0; s < m; s++) {
+                d += table[s*KSUB + codes[s*BLOCK_SIZE + j]];
+            }
+            dists[j] = d;
+        }
+#endif
+    }
+}
+
+}
+
+/**
+ * Inverted file index with product quantization (IVF-PQ).
+ *
+ * H. Jegou, M. Douze, C. Schmid, "Product quantization for nearest neighbor
+ * search", TPAMI 2011.
+ *
+ * A coarse k-means quantizer splits the points into inverted lists. The residual
+ * of each point to its list centroid is split into m sub-vectors, each one encoded
+ * with the byte index of the closest centroid of a per-subspace k-means codebook,
+ * so that a point takes m bytes instead of its raw vector. A query visits the
+ * closest lists until "checks" points have been examined and computes distances
+ * from per-list lookup tables. Optionally the best "rerank" candidates, and at
+ * least as many as the requested neighbors, are re-ranked with the exact distance,
+ * which needs the raw vectors.
+ *
+ * The quantizers are trained for the squared euclidean distance, without re-ranking
+ * the reported distances are squared L2 approximations.
+ */
+template <typename Distance>
+class IvfPqIndex : public NNIndex<Distance>
+{
+public:
+    typedef typename Distance::ElementType ElementType;
+    typedef typename Distance::ResultType DistanceType;
+
+    /** Constructor
+     * @param inputData dataset with the input features
+     * @param params parameters passed to the IVF-PQ algorithm
+     * @param d the distance used
+     */
+    IvfPqIndex(const Matrix<ElementType>& inputData, const IndexParams& params = IvfPqIndexParams(),
+               Distance d = Distance()) :
+        dataset_(inputData), index_params_(params), distance_(d), ksub_(0)
+    {
+        size_ = dataset_.rows;
+        veclen_ = dataset_.cols;
+        nlist_ = get_param(index_params_, "nlist", 1024);
+        m_ = get_param(index_params_, "m", 8);
+        rerank_ = get_param(index_params_, "rerank", 0);
+        iterations_ = get_param(index_params_, "iterations", 10);
+        dsub_ = m_ > 0 ? (int)veclen_ / m_ : 0;
+    }
+
+    IvfPqIndex(const IvfPqIndex&);
+    IvfPqIndex& operator=(const IvfPqIndex&);
+
+    flann_algorithm_t getType() const CV_OVERRIDE
+    {
+        return FLANN_INDEX_IVFPQ;
+    }
+
+    size_t size() const CV_OVERRIDE
+    {
+        return size_;
+    }
+
+    size_t veclen() const CV_OVERRIDE
+    {
+        return veclen_;
+    }
+
+    int usedMemory() const CV_OVERRIDE
+    {
+        size_t mem = (coarse_.size() + codebooks_.size()) * sizeof(float);
+        for (size_t i = 0; i < lists_.size(); ++i)
+            mem += lists_[i].ids.size() * sizeof(int) + lists_[i].codes.size();
+        return (int)mem;
+    }
+
+    IndexParams getParameters() const CV_OVERRIDE
+    {
+        return index_params_;
+    }
+
+    /**
+     * Trains the coarse quantizer and the sub-quantizers on a sample of the
+     * dataset with cv::kmeans, then encodes all the points.
+     */
+    void buildIndex() CV_OVERRIDE
+    {
+        if (m_ <= 0 || veclen_ % m_ != 0) {
+            FLANN_THROW(cv::Error::StsBadArg, "The vector length must be a multiple of the number of sub-quantizers");
+        }
+        if (nlist_ < 1) {
+            FLANN_THROW(cv::Error::StsBadArg, "The number of inverted lists must be positive");
+        }
+        dsub_ = (int)veclen_ / m_;
+        lists_.clear();
+        if (size_ == 0) return;
+
+        // training sample, drawn with replacement
+        int sampleCount = (int)std::min(size_, (size_t)std::max(nlist_ * 64, 65536));
+        cv::Mat sample(sampleCount, (int)veclen_, CV_32F);
+        if ((size_t)sampleCount == size_) {
+            for (int i = 0; i < sampleCount; ++i) toFloat(dataset_[i], sample.ptr<float>(i));
+        }
+        else {
+            cv::RNG& rng = cv::theRNG();
+            for (int i = 0; i < sampleCount; ++i) toFloat(dataset_[rng.uniform(0, (int)size_)], sample.ptr<float>(i));
+        }
+
+        cv::TermCriteria criteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, std::max(iterations_, 1), 1e-4);
+        nlist_ = std::min(nlist_, sampleCount);
+        cv::Mat labels, centers;
+        cv::kmeans(sample, nlist_, labels, criteria, 1, cv::KMEANS_PP_CENTERS, centers);
+        coarse_.assign(centers.ptr<float>(), centers.ptr<float>() + nlist_ * veclen_);
+
+        // the sub-quantizers are trained on the residuals, one subspace per task
+        for (int i = 0; i < sampleCount; ++i) {
+            float* x = sample.ptr<float>(i);
+            const float* c = &coarse_[labels.at<int>(i) * veclen_];
+            for (size_t k = 0; k < veclen_; ++k) x[k] -= c[k];
+        }
+        ksub_ = std::min(pq::KSUB, sampleCount);
+        codebooks_.assign((size_t)m_ * pq::KSUB * dsub_, 0.f);
+        // cv::kmeans seeds its centers from the per thread cv::theRNG(), every
+        // subspace gets its own generator so that the result does not depend on
+        // the scheduling
+        std::vector<uint64> seeds(m_);
+        for (int s = 0; s < m_; ++s) seeds[s] = cv::theRNG().next();
+        cv::parallel_for_(cv::Range(0, m_), [&](const cv::Range& range) {
+            cv::RNG& rng = cv::theRNG();
+            cv::RNG saved = rng;
+            for (int s = range.start; s < range.end; ++s) {
+                rng = cv::RNG(seeds[s]);
+                cv::Mat sub = sample.colRange(s * dsub_, (s + 1) * dsub_).clone();
+                cv::Mat subLabels, subCenters;
+                cv::kmeans(sub, ksub_, subLabels, criteria, 1, cv::KMEANS_PP_CENTERS, subCenters);
+                std::copy(subCenters.ptr<float>(), subCenters.ptr<float>() + ksub_ * dsub_,
+                          &codebooks_[(size_t)s * pq::KSUB * dsub_]);
+            }
+            rng = saved;
+        });
+
+        // encode all the points
+        std::vector<int> assignment(size_);
+        std::vector<uchar> codes(size_ * m_);
+        cv::parallel_for_(cv::Range(0, (int)size_), [&](const cv::Range& range) {
+            cv::AutoBuffer<float> buf(veclen_);
+            float* x = buf.data();
+            for (int i = range.start; i < range.end; ++i) {
+                toFloat(dataset_[i], x);
+                int list = nearestCentroid(x);
+                assignment[i] = list;
+                const float* c = &coarse_[list * veclen_];
+                for (size_t k = 0; k < veclen_; ++k) x[k] -= c[k];
+                encode(x, &codes[(size_t)i * m_]);
+            }
+        }, size_ / 1024.);
+
+        lists_.resize(nlist_);
+        for (size_t i = 0; i < size_; ++i) lists_[assignment[i]].ids.push_back((int)i);
+        cv::parallel_for_(cv::Range(0, nlist_), [&](const cv::Range& range) {
+            for (int l = range.start; l < range.end; ++l) {
+                InvertedList& list = lists_[l];
+                int n = (int)list.ids.size();
+                list.codes.assign((size_t)(n + pq::BLOCK_SIZE - 1) / pq::BLOCK_SIZE * pq::BLOCK_SIZE * m_, 0);
+                for (int j = 0; j < n; ++j) {
+                    uchar* block = &list.codes[(size_t)(j / pq::BLOCK_SIZE) * pq::BLOCK_SIZE * m_];
+                    const uchar* code = &codes[(size_t)list.ids[j] * m_];
+                    for (int s = 0; s < m_; ++s) block[s * pq::BLOCK_SIZE + j % pq::BLOCK_SIZE] = code[s];
+                }
+            }
+        });
+    }
+
+    void saveIndex(FILE* stream) CV_OVERRIDE
+    {
+        save_value(stream, nlist_);
+        save_value(stream, m_);
+        save_value(stream, ksub_);
+        save_value(stream, rerank_);
+        save_value(stream, coarse_);
+        save_value(stream, codebooks_);
+        for (size_t i = 0; i < lists_.size(); ++i) {
+            save_value(stream, lists_[i].ids);
+            save_value(stream, lists_[i].codes);
+        }
+    }
+
+    void loadIndex(FILE* stream) CV_OVERRIDE
+    {
+        load_value(stream, nlist_);
+        load_value(stream, m_);
+        load_value(stream, ksub_);
+        load_value(stream, rerank_);
+        if (m_ <= 0 || veclen_ % m_ != 0) {
+            FLANN_THROW(cv::Error::StsError, "Invalid index file, wrong number of sub-quantizers");
+        }
+        dsub_ = (int)veclen_ / m_;
+        load_value(stream, coarse_);
+        load_value(stream, codebooks_);
+        if (coarse_.size() != (size_t)nlist_ * veclen_ || codebooks_.size() != (size_t)m_ * pq::KSUB * dsub_) {
+            FLANN_THROW(cv::Error::StsError, "Invalid index file, quantizer size mismatch");
+        }
+        lists_.resize(nlist_);
+        for (int i = 0; i < nlist_; ++i) {
+            load_value(stream, lists_[i].ids);
+            load_value(stream, lists_[i].codes);
+        }
+
+        index_params_["algorithm"] = getType();
+        index_params_["nlist"] = nlist_;
+        index_params_["m"] = m_;
+        index_params_["rerank"] = rerank_;
+        index_params_["iterations"] = iterations_;
+    }
+
+    /**
+     * \brief Perform k-nearest neighbor search
+     *
+     * Same as NNIndex::knnSearch(), except that at least knn candidates are re-ranked when
+     * "rerank" is set, so that a query always gets knn neighbors back.
+     */
+    void knnSearch(const Matrix<ElementType>& queries, Matrix<int>& indices, Matrix<DistanceType>& dists, int knn, const SearchParams& params) CV_OVERRIDE
+    {
+        CV_Assert(queries.cols == veclen());
+        CV_Assert(indices.rows >= queries.rows);
+        CV_Assert(dists.rows >= queries.rows);
+        CV_Assert(int(indices.cols) >= knn);
+        CV_Assert(int(dists.cols) >= knn);
+
+        const bool sorted = get_param(params,"sorted",true);
+        const int maxChecks = get_param(params, "checks", 32);
+        const int nrerank = rerank_ > 0 ? std::max(rerank_, knn) : 0;
+        cv::parallel_for_(cv::Range(0, (int)queries.rows), [&](const cv::Range& range) {
+            KNNUniqueResultSet<DistanceType> resultSet(knn);
+            for (int i = range.start; i < range.end; i++) {
+                resultSet.clear();
+                searchLists(resultSet, queries[i], maxChecks, nrerank);
+                if (sorted) resultSet.sortAndCopy(indices[i], dists[i], knn);
+                else resultSet.copy(indices[i], dists[i], knn);
+            }
+        });
+    }
+
+    /**
+     * Find set of nearest neighbors to vec. Their indices are stored inside
+     * the result object.
+     *
+     * Params:
+     *     result = the result object in which the indices of the nearest-neighbors are stored
+     *     vec = the vector for which to search the nearest neighbors
+     *     searchParams = "checks" is the number of encoded points to examine,
+     *                    the closest inverted lists are visited until it is reached
+     */
+    void findNeighbors(ResultSet<DistanceType>& result, const ElementType* vec, const SearchParams& searchParams) CV_OVERRIDE
+    {
+        searchLists(result, vec, get_param(searchParams, "checks", 32), rerank_);
+    }
+
+private:
+    struct InvertedList
+    {
+        /** Indices of the points of the list */
+        std::vector<int> ids;
+        /** Codes of the points, in blocks of pq::BLOCK_SIZE points stored subspace after subspace */
+        std::vector<uchar> codes;
+    };
+
+    /**
+     * Visits the inverted lists closest to vec until maxChecks points have been examined and
+     * the result (or, with re-ranking, the nrerank candidates) is full.
+     */
+    void searchLists(ResultSet<DistanceType>& result, const ElementType* vec, int maxChecks, int nrerank) const
+    {
+        if (lists_.empty()) return;
+
+        cv::AutoBuffer<float> buf(veclen_ * 2 + (size_t)m_ * pq::KSUB);
+        float* x = buf.data();
+        float* residual = x + veclen_;
+        float* table = residual + veclen_;
+        toFloat(vec, x);
+
+        std::vector<std::pair<float, int> > order(nlist_);
+        for (int l = 0; l < nlist_; ++l) {
+            order[l] = std::make_pair(cv::hal::normL2Sqr_(x, &coarse_[l * veclen_], (int)veclen_), l);
+        }
+        std::sort(order.begin(), order.end());
+
+        // max-heap of the approximate candidates kept for re-ranking
+        std::priority_queue<std::pair<float, int> > candidates;
+        std::vector<float> dists;
+        int checks = 0;
+        for (int i = 0; i < nlist_; ++i) {
+            if (maxChecks != FLANN_CHECKS_UNLIMITED && checks >= maxChecks &&
+                (nrerank > 0 ? (int)candidates.size() >= nrerank : result.full())) break;
+
+            const InvertedList& list = lists_[order[i].second];
+            int n = (int)list.ids.size();
+            if (n == 0) continue;
+
+            const float* c = &coarse_[order[i].second * veclen_];
+            for (size_t k = 0; k < veclen_; ++k) residual[k] = x[k] - c[k];
+            computeTable(residual, table);
+
+            int nblocks = (n + pq::BLOCK_SIZE - 1) / pq::BLOCK_SIZE;
+            dists.resize((size_t)nblocks * pq::BLOCK_SIZE);
+            pq::adcScan(table, m_, &list.codes[0], nblocks, &dists[0]);
+
+            if (nrerank > 0) {
+                for (int j = 0; j < n; ++j) {
+                    if ((int)candidates.size() < nrerank) {
+                        candidates.push(std::make_pair(dists[j], list.ids[j]));
+                    }
+                    else if (dists[j] < candidates.top().first) {
+                        candidates.pop();
+                        candidates.push(std::make_pair(dists[j], list.ids[j]));
+                    }
+                }
+            }
+            else {
+                for (int j = 0; j < n; ++j) result.addPoint((DistanceType)dists[j], list.ids[j]);
+            }
+            checks += n;
+        }
+
+        while (!candidates.empty()) {
+            int index = candidates.top().second;
+            candidates.pop();
+            result.addPoint(distance_(vec, dataset_[index], veclen_), index);
+        }
+    }
+
+    void toFloat(const ElementType* v, float* x) const
+    {
+        for (size_t k = 0; k < veclen_; ++k) x[k] = (float)v[k];
+    }
+
+    int nearestCentroid(const float* x) const
+    {
+        int best = 0;
+        float bestDist = cv::hal::normL2Sqr_(x, &coarse_[0], (int)veclen_);
+        for (int l = 1; l < nlist_; ++l) {
+            float d = cv::hal::normL2Sqr_(x, &coarse_[l * veclen_], (int)veclen_);
+            if (d < bestDist) {
+                bestDist = d;
+                best = l;
+            }
+        }
+        return best;
+    }
+
+    void encode(const float* residual, uchar* code) const
+    {
+        for (int s = 0; s < m_; ++s) {
+            const float* r = residual + s * dsub_;
+            const float* codebook = &codebooks_[(size_t)s * pq::KSUB * dsub_];
+            int best = 0;
+            float bestDist = cv::hal::normL2Sqr_(r, codebook, dsub_);
+            for (int k = 1; k < ksub_; ++k) {
+                float d = cv::hal::normL2Sqr_(r, codebook + k * dsub_, dsub_);
+                if (d < bestDist) {
+                    bestDist = d;
+                    best = k;
+                }
+            }
+            code[s] = (uchar)best;
+        }
+    }
+
+    /**
+     * Squared distances between the sub-vectors of the residual and every
+     * centroid of the corresponding sub-quantizer.
+     */
+    void computeTable(const float* residual, float* table) const
+    {
+        for (int s = 0; s < m_; ++s) {
+            const float* r = residual + s * dsub_;
+            const float* codebook = &codebooks_[(size_t)s * pq::KSUB * dsub_];
+            for (int k = 0; k < ksub_; ++k) {
+                table[s * pq::KSUB + k] = cv::hal::normL2Sqr_(r, codebook + k * dsub_, dsub_);
+            }
+        }
+    }
+
+private:
+    /**
+     * The dataset used by this index, only accessed when re-ranking
+     */
+    const Matrix<ElementType> dataset_;
+
+    IndexParams index_params_;
+
+    Distance distance_;
+
+    size_t size_;
+    size_t veclen_;
+
+    int nlist_;
+    int m_;
+    int dsub_;
+    int ksub_;
+    int rerank_;
+    int iterations_;
+
+    /**
+     * Coarse centroids, nlist_ x veclen_
+     */
+    std::vector<float> coarse_;
+
+    /**
+     * Sub-quantizer centroids, m_ x pq::KSUB x dsub_
+     */
+    std::vector<float> codebooks_;
+
+    std::vector<InvertedList> lists_;
+};
+
+}
+
+//! @endcond
+
+#endif //OPENCV_FLANN_IVFPQ_INDEX_H_
@@ -96,9 +96,6 @@ public:
         for (size_t i = 0; i < size_; ++i) {
             vind_[i] = int(i);
         }
-
-        mean_ = new DistanceType[veclen_];
-        var_ = new DistanceType[veclen_];
     }
 
 
@@ -113,8 +110,6 @@ public:
         if (tree_roots_!=NULL) {
             delete[] tree_roots_;
         }
-        delete[] mean_;
-        delete[] var_;
     }
 
     /**
@@ -131,7 +126,7 @@ public:
             std::random_shuffle(vind_.begin(), vind_.end());
 #endif
 
-            tree_roots_[i] = divideTree(&vind_[0], int(size_) );
+            tree_roots_[i] = buildTree(&vind_[0], int(size_) );
         }
     }
 
@@ -159,9 +154,7 @@ public:
             delete[] tree_roots_;
         }
         tree_roots_ = new NodePtr[trees_];
-        for (int i=0; i<trees_; ++i) {
-            load_tree(stream,tree_roots_[i]);
-        }
+        load_trees(stream);
 
         index_params_["algorithm"] = getType();
         index_params_["trees"] = tree_roots_;
@@ -243,6 +236,31 @@ private:
     typedef BranchStruct<NodePtr, DistanceType> BranchSt;
     typedef BranchSt* Branch;
 
+    /**
+     * Scratch buffers and random generator used while splitting the nodes
+     * of one subtree.
+     */
+    struct SplitContext
+    {
+        SplitContext(size_t veclen, uint64 seed) : mean(veclen), var(veclen), rng(seed) {}
+
+        std::vector<DistanceType> mean;
+        std::vector<DistanceType> var;
+        cv::RNG rng;
+    };
+
+    /**
+     * A subtree waiting to be built: its first node and its points.
+     */
+    struct BuildTask
+    {
+        BuildTask(NodePtr node_, int* ind_, int count_) : node(node_), ind(ind_), count(count_) {}
+
+        NodePtr node;
+        int* ind;
+        int count;
+    };
+
 
 
     void save_tree(FILE* stream, NodePtr tree)
@@ -257,50 +275,139 @@ private:
     }
 
 
-    void load_tree(FILE* stream, NodePtr& tree)
+    /**
+     * Loads all the trees saved by save_tree(). The nodes are stored in pre-order and
+     * have a fixed size, so instead of one read and one allocation per node they are
+     * read in large chunks straight into the pool and linked using an explicit stack.
+     * Whatever was read past the last node is given back to the stream.
+     */
+    void load_trees(FILE* stream)
     {
-        tree = pool_.allocate<Node>();
-        load_value(stream, *tree);
-        if (tree->child1!=NULL) {
-            load_tree(stream, tree->child1);
+        const size_t chunk_size = 1 << 14;
+        std::vector<NodePtr*> pending;
+        NodePtr chunk = NULL;
+        size_t avail = 0;
+
+        for (int i = 0; i < trees_; ++i) {
+            pending.push_back(&tree_roots_[i]);
+            while (!pending.empty()) {
+                if (avail == 0) {
+                    chunk = pool_.allocate<Node>(chunk_size);
+                    avail = fread(chunk, sizeof(Node), chunk_size, stream);
+                    if (avail == 0) {
+                        FLANN_THROW(cv::Error::StsParseError, "Cannot read from file");
+                    }
+                }
+                NodePtr node = chunk++;
+                --avail;
+
+                *pending.back() = node;
+                pending.pop_back();
+                // child1 is stored first, so it goes on top of the stack
+                if (node->child2!=NULL) {
+                    pending.push_back(&node->child2);
+                }
+                if (node->child1!=NULL) {
+                    pending.push_back(&node->child1);
+                }
+            }
         }
-        if (tree->child2!=NULL) {
-            load_tree(stream, tree->child2);
+
+        if (avail > 0 && fseek(stream, -(long)(avail*sizeof(Node)), SEEK_CUR) != 0) {
+            FLANN_THROW(cv::Error::StsError, "Cannot seek in file");
         }
     }
 
 
     /**
-     * Create a tree node that subdivides the list of vecs from vind[first]
-     * to vind[last].  The routine is called recursively on each sublist.
-     * Place a pointer to this new tree node in the location pTree.
+     * Builds one tree over the points ind[0..count-1].
      *
-     * Params: pTree = the new node to create
-     *                  first = index of the first vector
-     *                  last = index of the last vector
+     * A tree with count leaves has 2*count-1 nodes. They are allocated at once and
+     * laid out in pre-order, so the subtree of a node holding n points spans 2*n-1
+     * consecutive nodes and its position is known before its parent is built. The
+     * top levels are split serially until there are enough independent subtrees,
+     * which are then built in parallel, each one with its own random generator
+     * seeded upfront so that the result does not depend on the number of threads.
      */
-    NodePtr divideTree(int* ind, int count)
+    NodePtr buildTree(int* ind, int count)
     {
-        NodePtr node = pool_.allocate<Node>(); // allocate memory
+        NodePtr root = pool_.allocate<Node>(2*count-1);
+        SplitContext ctx(veclen_, cv::theRNG().next());
+
+        std::vector<BuildTask> tasks(1, BuildTask(root, ind, count)), next;
+        while ((int)tasks.size() < PARALLEL_TASKS) {
+            next.clear();
+            for (size_t t = 0; t < tasks.size(); ++t) {
+                const BuildTask& task = tasks[t];
+                if (task.count < PARALLEL_MIN_COUNT) {
+                    next.push_back(task);
+                    continue;
+                }
+                int idx = splitNode(task.node, task.ind, task.count, ctx);
+                next.push_back(BuildTask(task.node->child1, task.ind, idx));
+                next.push_back(BuildTask(task.node->child2, task.ind+idx, task.count-idx));
+            }
+            if (next.size() == tasks.size()) break;
+            tasks.swap(next);
+        }
+
+        std::vector<uint64> seeds(tasks.size());
+        for (size_t t = 0; t < tasks.size(); ++t) {
+            seeds[t] = ctx.rng.next();
+        }
+
+        cv::parallel_for_(cv::Range(0, (int)tasks.size()), [&](const cv::Range& range) {
+            SplitContext taskCtx(veclen_, 0);
+            for (int t = range.start; t < range.end; ++t) {
+                taskCtx.rng = cv::RNG(seeds[t]);
+                divideTree(tasks[t].node, tasks[t].ind, tasks[t].count, taskCtx);
+            }
+        });
+
+        return root;
+    }
 
+
+    /**
+     * Create a tree node that subdivides the list of vecs from ind[0]
+     * to ind[count-1]. The routine is called recursively on each sublist,
+     * the children are written to the nodes following this one.
+     *
+     * Params: node = the node to fill, followed by room for its subtree
+     *         ind = indices of the vectors
+     *         count = number of vectors
+     */
+    void divideTree(NodePtr node, int* ind, int count, SplitContext& ctx)
+    {
         /* If too few exemplars remain, then make this a leaf node. */
         if ( count == 1) {
             node->child1 = node->child2 = NULL;    /* Mark as leaf node. */
             node->divfeat = *ind;    /* Store index of this vec. */
         }
         else {
-            int idx;
-            int cutfeat;
-            DistanceType cutval;
-            meanSplit(ind, count, idx, cutfeat, cutval);
-
-            node->divfeat = cutfeat;
-            node->divval = cutval;
-            node->child1 = divideTree(ind, idx);
-            node->child2 = divideTree(ind+idx, count-idx);
+            int idx = splitNode(node, ind, count, ctx);
+            divideTree(node->child1, ind, idx, ctx);
+            divideTree(node->child2, ind+idx, count-idx, ctx);
         }
+    }
 
-        return node;
+
+    /**
+     * Makes node an inner node splitting ind[0..count-1], count > 1, and returns
+     * the number of points going to its first child.
+     */
+    int splitNode(NodePtr node, int* ind, int count, SplitContext& ctx)
+    {
+        int idx;
+        int cutfeat;
+        DistanceType cutval;
+        meanSplit(ind, count, idx, cutfeat, cutval, ctx);
+
+        node->divfeat = cutfeat;
+        node->divval = cutval;
+        node->child1 = node+1;
+        node->child2 = node+2*idx;
+        return idx;
     }
 
 
@@ -309,10 +416,12 @@ private:
      * Make a random choice among those with the highest variance, and use
      * its variance as the threshold value.
      */
-    void meanSplit(int* ind, int count, int& index, int& cutfeat, DistanceType& cutval)
+    void meanSplit(int* ind, int count, int& index, int& cutfeat, DistanceType& cutval, SplitContext& ctx)
     {
-        memset(mean_,0,veclen_*sizeof(DistanceType));
-        memset(var_,0,veclen_*sizeof(DistanceType));
+        DistanceType* mean = &ctx.mean[0];
+        DistanceType* var = &ctx.var[0];
+        memset(mean,0,veclen_*sizeof(DistanceType));
+        memset(var,0,veclen_*sizeof(DistanceType));
 
         /* Compute mean values.  Only the first SAMPLE_MEAN values need to be
             sampled to get a good estimate.
@@ -321,24 +430,24 @@ private:
         for (int j = 0; j < cnt; ++j) {
             ElementType* v = dataset_[ind[j]];
             for (size_t k=0; k<veclen_; ++k) {
-                mean_[k] += v[k];
+                mean[k] += v[k];
             }
         }
         for (size_t k=0; k<veclen_; ++k) {
-            mean_[k] /= cnt;
+            mean[k] /= cnt;
         }
 
         /* Compute variances (no need to divide by count). */
         for (int j = 0; j < cnt; ++j) {
             ElementType* v = dataset_[ind[j]];
             for (size_t k=0; k<veclen_; ++k) {
-                DistanceType dist = v[k] - mean_[k];
-                var_[k] += dist * dist;
+                DistanceType dist = v[k] - mean[k];
+                var[k] += dist * dist;
             }
         }
         /* Select one of the highest variance indices at random. */
-        cutfeat = selectDivision(var_);
-        cutval = mean_[cutfeat];
+        cutfeat = selectDivision(var, ctx.rng);
+        cutval = mean[cutfeat];
 
         int lim1, lim2;
         planeSplit(ind, count, cutfeat, cutval, lim1, lim2);
@@ -358,7 +467,7 @@ private:
      * Select the top RAND_DIM largest values from v and return the index of
      * one of these selected at random.
      */
-    int selectDivision(DistanceType* v)
+    int selectDivision(DistanceType* v, cv::RNG& rng)
     {
         int num = 0;
         size_t topind[RAND_DIM];
@@ -382,7 +491,7 @@ private:
             }
         }
         /* Select a random integer in range [0,num-1], and return that index. */
-        int rnd = rand_int(num);
+        int rnd = rng.uniform(0, num);
         return (int)topind[rnd];
     }
 
@@ -581,7 +690,15 @@ private:
          * selected at random from among the top RAND_DIM dimensions with the
          * highest variance.  A value of 5 works well.
          */
-        RAND_DIM=5
+        RAND_DIM=5,
+        /**
+         * Number of subtrees a tree is split into before they are built in parallel
+         */
+        PARALLEL_TASKS = 64,
+        /**
+         * Subtrees with fewer points are not split further before the parallel build
+         */
+        PARALLEL_MIN_COUNT = 1024
     };
 
 
@@ -606,9 +723,6 @@ private:
     size_t veclen_;
 
 
-    DistanceType* mean_;
-    DistanceType* var_;
-
 
     /**
      * Array of k-d trees used to find neighbours.
@@ -1012,7 +1012,7 @@ private:
 
        for (int i=0; i<branching; ++i) {
            centers[i] = new CentersType[veclen_];
-           memoryCounter_ += (int)(veclen_*sizeof(CentersType));
+           CV_XADD(&memoryCounter_, (int)(veclen_*sizeof(CentersType)));
            for (size_t k=0; k<veclen_; ++k) {
                centers[i][k] = (CentersType)dcenters[i][k];
            }
@@ -1025,7 +1025,7 @@ private:
     {
         for (int i=0; i<branching; ++i) {
             centers[i] = new CentersType[veclen_];
-            memoryCounter_ += (int)(veclen_*sizeof(CentersType));
+            CV_XADD(&memoryCounter_, (int)(veclen_*sizeof(CentersType)));
         }
 
         const unsigned int accumulator_veclen = static_cast<unsigned int>(
@@ -1129,7 +1129,7 @@ private:
     {
         for (int i=0; i<branching; ++i) {
             centers[i] = new CentersType[veclen_];
-            memoryCounter_ += (int)(veclen_*sizeof(CentersType));
+            CV_XADD(&memoryCounter_, (int)(veclen_*sizeof(CentersType)));
         }
 
         const unsigned int histos_veclen = static_cast<unsigned int>(
@@ -1235,7 +1235,8 @@ private:
                               std::vector<DistanceType>& radiuses, int* belongs_to, int* count)
     {
         // compute kmeans clustering for each of the resulting clusters
-        node->childs = pool_.allocate<KMeansNodePtr>(branching);
+        allocateChildren(node, branching);
+        cv::AutoBuffer<int> child_start(branching+1);
         int start = 0;
         int end = start;
         for (int c=0; c<branching; ++c) {
@@ -1257,15 +1258,16 @@ private:
             mean_radius /= s;
             variance -= distance_(centers[c], ZeroIterator<ElementType>(), veclen_);
 
-            node->childs[c] = pool_.allocate<KMeansNode>();
-            std::memset(node->childs[c], 0, sizeof(KMeansNode));
             node->childs[c]->radius = radiuses[c];
             node->childs[c]->pivot = centers[c];
             node->childs[c]->variance = variance;
             node->childs[c]->mean_radius = mean_radius;
-            computeClustering(node->childs[c],indices+start, end-start, branching, level+1);
+            child_start[c] = start;
             start=end;
         }
+        child_start[branching] = end;
+
+        computeChildClustering(node, indices, child_start.data(), branching, level);
     }
 
 
@@ -1274,7 +1276,8 @@ private:
                               std::vector<DistanceType>& radiuses, int* belongs_to, int* count)
     {
         // compute kmeans clustering for each of the resulting clusters
-        node->childs = pool_.allocate<KMeansNodePtr>(branching);
+        allocateChildren(node, branching);
+        cv::AutoBuffer<int> child_start(branching+1);
         int start = 0;
         int end = start;
         for (int c=0; c<branching; ++c) {
@@ -1300,15 +1303,71 @@ private:
                         ensureSquareDistance<Distance>(
                             distance_(centers[c], ZeroIterator<ElementType>(), veclen_)));
 
-            node->childs[c] = pool_.allocate<KMeansNode>();
-            std::memset(node->childs[c], 0, sizeof(KMeansNode));
             node->childs[c]->radius = radiuses[c];
             node->childs[c]->pivot = centers[c];
             node->childs[c]->variance = static_cast<DistanceType>(variance);
             node->childs[c]->mean_radius = mean_radius;
-            computeClustering(node->childs[c],indices+start, end-start, branching, level+1);
+            child_start[c] = start;
             start=end;
         }
+        child_start[branching] = end;
+
+        computeChildClustering(node, indices, child_start.data(), branching, level);
+    }
+
+
+    /**
+     * Clusters the children of a node, the points of child c being
+     * indices[start[c]..start[c+1]-1]. The children of large nodes are
+     * processed in parallel, the nested calls then run serially.
+     *
+     * The centers are chosen with cv::theRNG(), which is per thread. Every
+     * child gets a generator seeded from the caller's one before the parallel
+     * section, so the tree does not depend on the scheduling. std::rand() is
+     * shared by all threads, the build stays serial when it is used.
+     */
+    void computeChildClustering(KMeansNodePtr node, int* indices, const int* start, int branching, int level)
+    {
+#ifndef OPENCV_FLANN_USE_STD_RAND
+        if (start[branching] >= PARALLEL_MIN_SIZE) {
+            std::vector<uint64> seeds(branching);
+            for (int c=0; c<branching; ++c) {
+                seeds[c] = cv::theRNG().next();
+            }
+            cv::parallel_for_(cv::Range(0, branching), [&](const cv::Range& range) {
+                cv::RNG& rng = cv::theRNG();
+                cv::RNG saved = rng;
+                for (int c = range.start; c < range.end; ++c) {
+                    rng = cv::RNG(seeds[c]);
+                    computeClustering(node->childs[c], indices+start[c], start[c+1]-start[c], branching, level+1);
+                }
+                rng = saved;
+            });
+            return;
+        }
+#endif
+        for (int c=0; c<branching; ++c) {
+            computeClustering(node->childs[c], indices+start[c], start[c+1]-start[c], branching, level+1);
+        }
+    }
+
+
+    /**
+     * Allocates the zeroed children of a node with a single pool access,
+     * the nodes may be created concurrently.
+     */
+    void allocateChildren(KMeansNodePtr node, int branching)
+    {
+        KMeansNodePtr childs;
+        {
+            cv::AutoLock lock(pool_mutex_);
+            node->childs = pool_.allocate<KMeansNodePtr>(branching);
+            childs = pool_.allocate<KMeansNode>(branching);
+        }
+        std::memset(childs, 0, branching*sizeof(KMeansNode));
+        for (int c=0; c<branching; ++c) {
+            node->childs[c] = childs + c;
+        }
     }
 
 
@@ -1806,10 +1865,20 @@ private:
      */
     PooledAllocator pool_;
 
+    /**
+     * Guards the pool while the tree is built in parallel.
+     */
+    cv::Mutex pool_mutex_;
+
     /**
      * Memory occupied by the index.
      */
     int memoryCounter_;
+
+    /**
+     * Nodes with fewer points cluster their children serially.
+     */
+    enum { PARALLEL_MIN_SIZE = 4096 };
 };
 
 }
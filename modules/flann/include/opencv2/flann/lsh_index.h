@@ -114,14 +114,16 @@ public:
      */
     void buildIndex() CV_OVERRIDE
     {
+        // The masks are drawn serially so that the tables do not depend on the number of threads
         tables_.resize(table_number_);
-        for (int i = 0; i < table_number_; ++i) {
-            lsh::LshTable<ElementType>& table = tables_[i];
-            table = lsh::LshTable<ElementType>(feature_size_, key_size_);
-
-            // Add the features to the table
-            table.add(dataset_);
-        }
+        for (int i = 0; i < table_number_; ++i)
+            tables_[i] = lsh::LshTable<ElementType>(feature_size_, key_size_);
+
+        // Add the features to the tables, each table is filled independently
+        cv::parallel_for_(cv::Range(0, table_number_), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; ++i)
+                tables_[i].add(dataset_);
+        });
     }
 
     flann_algorithm_t getType() const CV_OVERRIDE
@@ -201,15 +203,18 @@ public:
         CV_Assert(int(dists.cols) >= knn);
 
 
-        KNNUniqueResultSet<DistanceType> resultSet(knn);
-        for (size_t i = 0; i < queries.rows; i++) {
-            resultSet.clear();
-            std::fill_n(indices[i], knn, -1);
-            std::fill_n(dists[i], knn, std::numeric_limits<DistanceType>::max());
-            findNeighbors(resultSet, queries[i], params);
-            if (get_param(params,"sorted",true)) resultSet.sortAndCopy(indices[i], dists[i], knn);
-            else resultSet.copy(indices[i], dists[i], knn);
-        }
+        const bool sorted = get_param(params,"sorted",true);
+        cv::parallel_for_(cv::Range(0, (int)queries.rows), [&](const cv::Range& range) {
+            KNNUniqueResultSet<DistanceType> resultSet(knn);
+            for (int i = range.start; i < range.end; i++) {
+                resultSet.clear();
+                std::fill_n(indices[i], knn, -1);
+                std::fill_n(dists[i], knn, std::numeric_limits<DistanceType>::max());
+                findNeighbors(resultSet, queries[i], params);
+                if (sorted) resultSet.sortAndCopy(indices[i], dists[i], knn);
+                else resultSet.copy(indices[i], dists[i], knn);
+            }
+        });
     }
 
 
@@ -280,12 +285,11 @@ private:
                 std::vector<lsh::BucketKey>::const_iterator xor_mask_end = xor_masks_.end();
                 for (; xor_mask != xor_mask_end; ++xor_mask) {
                     size_t sub_key = key ^ (*xor_mask);
-                    const lsh::Bucket* bucket = table->getBucketFromKey(sub_key);
-                    if (bucket == 0) continue;
+                    lsh::BucketRange bucket = table->getBucketRange((lsh::BucketKey)sub_key);
 
                     // Go over each descriptor index
-                    std::vector<lsh::FeatureIndex>::const_iterator training_index = bucket->begin();
-                    std::vector<lsh::FeatureIndex>::const_iterator last_training_index = bucket->end();
+                    const lsh::FeatureIndex* training_index = bucket.begin;
+                    const lsh::FeatureIndex* last_training_index = bucket.end;
                     DistanceType hamming_distance;
 
                     // Process the rest of the candidates
@@ -294,7 +298,7 @@ private:
 
                         if (hamming_distance < worst_score) {
                             // Insert the new element
-                            score_index_heap.push_back(ScoreIndexPair(hamming_distance, training_index));
+                            score_index_heap.push_back(ScoreIndexPair(hamming_distance, *training_index));
                             std::push_heap(score_index_heap.begin(), score_index_heap.end());
 
                             if (score_index_heap.size() > (unsigned int)k_nn) {
@@ -318,19 +322,18 @@ private:
                 std::vector<lsh::BucketKey>::const_iterator xor_mask_end = xor_masks_.end();
                 for (; xor_mask != xor_mask_end; ++xor_mask) {
                     size_t sub_key = key ^ (*xor_mask);
-                    const lsh::Bucket* bucket = table->getBucketFromKey(sub_key);
-                    if (bucket == 0) continue;
+                    lsh::BucketRange bucket = table->getBucketRange((lsh::BucketKey)sub_key);
 
                     // Go over each descriptor index
-                    std::vector<lsh::FeatureIndex>::const_iterator training_index = bucket->begin();
-                    std::vector<lsh::FeatureIndex>::const_iterator last_training_index = bucket->end();
+                    const lsh::FeatureIndex* training_index = bucket.begin;
+                    const lsh::FeatureIndex* last_training_index = bucket.end;
                     DistanceType hamming_distance;
 
                     // Process the rest of the candidates
                     for (; training_index < last_training_index; ++training_index) {
                         // Compute the Hamming distance
                         hamming_distance = distance_(vec, dataset_[*training_index], dataset_.cols);
-                        if (hamming_distance < radius) score_index_heap.push_back(ScoreIndexPair(hamming_distance, training_index));
+                        if (hamming_distance < radius) score_index_heap.push_back(ScoreIndexPair(hamming_distance, *training_index));
                     }
                 }
             }
@@ -351,12 +354,11 @@ private:
             std::vector<lsh::BucketKey>::const_iterator xor_mask_end = xor_masks_.end();
             for (; xor_mask != xor_mask_end; ++xor_mask) {
                 size_t sub_key = key ^ (*xor_mask);
-                const lsh::Bucket* bucket = table->getBucketFromKey((lsh::BucketKey)sub_key);
-                if (bucket == 0) continue;
+                lsh::BucketRange bucket = table->getBucketRange((lsh::BucketKey)sub_key);
 
                 // Go over each descriptor index
-                std::vector<lsh::FeatureIndex>::const_iterator training_index = bucket->begin();
-                std::vector<lsh::FeatureIndex>::const_iterator last_training_index = bucket->end();
+                const lsh::FeatureIndex* training_index = bucket.begin;
+                const lsh::FeatureIndex* last_training_index = bucket.end;
                 DistanceType hamming_distance;
 
                 // Process the rest of the candidates
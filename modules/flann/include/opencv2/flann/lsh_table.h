@@ -41,6 +41,7 @@
 #include <iostream>
 #include <iomanip>
 #include <limits.h>
+#include <limits>
 // TODO as soon as we use C++0x, use the code in USE_UNORDERED_MAP
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 #  define USE_UNORDERED_MAP 1
@@ -83,6 +84,17 @@ typedef unsigned int BucketKey;
  */
 typedef std::vector<FeatureIndex> Bucket;
 
+/** A contiguous range of feature indices, as returned by a bucket lookup
+ */
+struct BucketRange
+{
+    BucketRange() : begin(0), end(0) {}
+    BucketRange(const FeatureIndex* b, const FeatureIndex* e) : begin(b), end(e) {}
+
+    const FeatureIndex* begin;
+    const FeatureIndex* end;
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /** POD for stats about an LSH table
@@ -196,14 +208,24 @@ public:
             buckets_space_[key].push_back(value);
             break;
         }
+        case kDenseSorted:
+        case kSparseSorted:
+            CV_Error(cv::Error::StsNotImplemented, "LSH table built in bulk can not be extended feature by feature");
+            break;
         }
     }
 
     /** Add a set of features to the table
+     * When the table is empty, the features are stored in the compact sorted layout,
+     * otherwise they are appended to the existing buckets one by one
      * @param dataset the values to store
      */
     void add(Matrix<ElementType> dataset)
     {
+        if (buckets_space_.empty() && buckets_speed_.empty() && bucket_ids_.empty()) {
+            buildSorted(dataset);
+            return;
+        }
 #if USE_UNORDERED_MAP
         buckets_space_.rehash((buckets_space_.size() + dataset.rows) * 1.2);
 #endif
@@ -238,10 +260,43 @@ public:
             else return &bucket_it->second;
             break;
         }
+        case kDenseSorted:
+        case kSparseSorted:
+            // The buckets are not stored as vectors, use getBucketRange()
+            return 0;
         }
         return 0;
     }
 
+    /** Get the feature indices of a bucket given the key, works with any storage
+     */
+    inline BucketRange getBucketRange(BucketKey key) const
+    {
+        switch (speed_level_) {
+        case kDenseSorted:
+        {
+            // The offsets are indexed by the key itself
+            const FeatureIndex* ids = bucket_ids_.data();
+            return BucketRange(ids + bucket_offsets_[key], ids + bucket_offsets_[key + 1]);
+        }
+        case kSparseSorted:
+        {
+            if (!key_bitset_.empty() && !key_bitset_.test(key)) return BucketRange();
+            std::vector<BucketKey>::const_iterator it = std::lower_bound(sorted_keys_.begin(), sorted_keys_.end(), key);
+            if (it == sorted_keys_.end() || *it != key) return BucketRange();
+            size_t bucket = it - sorted_keys_.begin();
+            const FeatureIndex* ids = bucket_ids_.data();
+            return BucketRange(ids + bucket_offsets_[bucket], ids + bucket_offsets_[bucket + 1]);
+        }
+        default:
+        {
+            const Bucket* bucket = getBucketFromKey(key);
+            if (bucket == 0 || bucket->empty()) return BucketRange();
+            return BucketRange(bucket->data(), bucket->data() + bucket->size());
+        }
+        }
+    }
+
     /** Compute the sub-signature of a feature
      */
     size_t getKey(const ElementType* /*feature*/) const
@@ -259,10 +314,12 @@ private:
      * kArray uses a vector for storing data
      * kBitsetHash uses a hash map but checks for the validity of a key with a bitset
      * kHash uses a hash map only
+     * kDenseSorted keeps all the indices in one array sorted by key, with an offset per possible key
+     * kSparseSorted keeps all the indices in one array sorted by key, with a sorted array of the used keys
      */
     enum SpeedLevel
     {
-        kArray, kBitsetHash, kHash
+        kArray, kBitsetHash, kHash, kDenseSorted, kSparseSorted
     };
 
     /** Initialize some variables
@@ -281,6 +338,57 @@ private:
         key_size_ = (unsigned)key_size;
     }
 
+    /** Store a whole dataset in one array of feature indices sorted by key
+     * Features that fall in the same bucket stay in increasing index order
+     */
+    void buildSorted(const Matrix<ElementType>& dataset)
+    {
+        const size_t n = dataset.rows;
+        CV_Assert(n <= (size_t)std::numeric_limits<FeatureIndex>::max());
+
+        std::vector<BucketKey> keys(n);
+        for (size_t i = 0; i < n; ++i) keys[i] = (BucketKey)getKey(dataset[i]);
+
+        bucket_ids_.resize(n);
+        const size_t key_space = size_t(1) << key_size_;
+        if (key_space <= 2 * n) {
+            // Counting sort, the offsets can be indexed by the key directly
+            speed_level_ = kDenseSorted;
+            bucket_offsets_.assign(key_space + 1, 0);
+            for (size_t i = 0; i < n; ++i) ++bucket_offsets_[keys[i] + 1];
+            for (size_t k = 0; k < key_space; ++k) bucket_offsets_[k + 1] += bucket_offsets_[k];
+            std::vector<FeatureIndex> next(bucket_offsets_.begin(), bucket_offsets_.end() - 1);
+            for (size_t i = 0; i < n; ++i) bucket_ids_[next[keys[i]]++] = (FeatureIndex)i;
+            return;
+        }
+
+        speed_level_ = kSparseSorted;
+        std::vector<uint64_t> entries(n);
+        for (size_t i = 0; i < n; ++i) entries[i] = ((uint64_t)keys[i] << 32) | (uint64_t)i;
+        std::sort(entries.begin(), entries.end());
+
+        sorted_keys_.clear();
+        bucket_offsets_.clear();
+        for (size_t i = 0; i < n; ++i) {
+            BucketKey key = (BucketKey)(entries[i] >> 32);
+            if (sorted_keys_.empty() || sorted_keys_.back() != key) {
+                sorted_keys_.push_back(key);
+                bucket_offsets_.push_back((FeatureIndex)i);
+            }
+            bucket_ids_[i] = (FeatureIndex)(entries[i] & 0xffffffffu);
+        }
+        bucket_offsets_.push_back((FeatureIndex)n);
+
+        // Reject most of the empty multi-probe buckets without a binary search,
+        // as long as the bitset stays small compared to the indices themselves
+        if (key_space / CHAR_BIT <= 4 * n * sizeof(FeatureIndex)) {
+            key_bitset_.resize(key_space);
+            key_bitset_.reset();
+            for (size_t k = 0; k < sorted_keys_.size(); ++k) key_bitset_.set(sorted_keys_[k]);
+        }
+        else key_bitset_.clear();
+    }
+
     /** Optimize the table for speed/space
      */
     void optimize()
@@ -324,6 +432,19 @@ private:
      */
     BucketsSpace buckets_space_;
 
+    /** The indices of all the features, sorted by key, when the table was built in bulk
+     */
+    std::vector<FeatureIndex> bucket_ids_;
+
+    /** Where each bucket starts in bucket_ids_, indexed by the key (kDenseSorted)
+     * or by the position of the key in sorted_keys_ (kSparseSorted)
+     */
+    std::vector<FeatureIndex> bucket_offsets_;
+
+    /** The keys of the non-empty buckets in increasing order (kSparseSorted only)
+     */
+    std::vector<BucketKey> sorted_keys_;
+
     /** What is used to store the data */
     SpeedLevel speed_level_;
 
@@ -343,6 +464,11 @@ private:
      * Only used in the unsigned char case
      */
     std::vector<size_t> mask_;
+
+    /** The positions of the bits set in mask_, in the order they appear in the key
+     * Only used in the unsigned char case
+     */
+    std::vector<unsigned int> mask_bits_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -375,6 +501,16 @@ inline LshTable<unsigned char>::LshTable(unsigned int feature_size, unsigned int
         mask_[idx] |= size_t(1) << (index % divisor); //use modulo to find the bit offset
     }
 
+    // Remember the positions of the mask bits from the lowest to the highest, so that
+    // a key can be gathered without walking the mask
+    for (size_t idx = 0; idx < mask_.size(); ++idx) {
+        for (size_t mask_block = mask_[idx]; mask_block; mask_block &= mask_block - 1) {
+            unsigned int bit = 0;
+            while (!((mask_block >> bit) & 1)) ++bit;
+            mask_bits_.push_back((unsigned int)(idx * CHAR_BIT * sizeof(size_t)) + bit);
+        }
+    }
+
     // Set to 1 if you want to display the mask for debug
 #if 0
     {
@@ -397,44 +533,24 @@ inline LshTable<unsigned char>::LshTable(unsigned int feature_size, unsigned int
 template<>
 inline size_t LshTable<unsigned char>::getKey(const unsigned char* feature) const
 {
-    // no need to check if T is dividable by sizeof(size_t) like in the Hamming
-    // distance computation as we have a mask
-    // FIXIT: This is bad assumption, because we reading tail bytes after of the allocated features buffer
-    const size_t* feature_block_ptr = reinterpret_cast<const size_t*> ((const void*)feature);
-
     // Figure out the subsignature of the feature
     // Given the feature ABCDEF, and the mask 001011, the output will be
     // 000CEF
+    // The bits are gathered byte by byte from their precomputed positions, which avoids
+    // walking the mask and reading past the end of the feature
+    const unsigned int* bits = mask_bits_.data();
+    const size_t nbits = mask_bits_.size();
     size_t subsignature = 0;
-    size_t bit_index = 1;
-
-    for (unsigned i = 0; i < feature_size_; i += sizeof(size_t)) {
-        // get the mask and signature blocks
-        size_t feature_block;
-        if (i <= feature_size_ - sizeof(size_t))
-        {
-            feature_block = *feature_block_ptr;
-        }
-        else
-        {
-            size_t tmp = 0;
-            memcpy(&tmp, feature_block_ptr, feature_size_ - i); // preserve bytes order
-            feature_block = tmp;
-        }
-        size_t mask_block = mask_[i / sizeof(size_t)];
-        while (mask_block) {
-            // Get the lowest set bit in the mask block
-            size_t lowest_bit = mask_block & (-(ptrdiff_t)mask_block);
-            // Add it to the current subsignature if necessary
-            subsignature += (feature_block & lowest_bit) ? bit_index : 0;
-            // Reset the bit in the mask block
-            mask_block ^= lowest_bit;
-            // increment the bit index for the subsignature
-            bit_index <<= 1;
-        }
-        // Check the next feature block
-        ++feature_block_ptr;
+    size_t i = 0;
+    for (; i + 4 <= nbits; i += 4) {
+        size_t b0 = (feature[bits[i] / CHAR_BIT] >> (bits[i] % CHAR_BIT)) & 1;
+        size_t b1 = (feature[bits[i + 1] / CHAR_BIT] >> (bits[i + 1] % CHAR_BIT)) & 1;
+        size_t b2 = (feature[bits[i + 2] / CHAR_BIT] >> (bits[i + 2] % CHAR_BIT)) & 1;
+        size_t b3 = (feature[bits[i + 3] / CHAR_BIT] >> (bits[i + 3] % CHAR_BIT)) & 1;
+        subsignature |= (b0 | (b1 << 1) | (b2 << 2) | (b3 << 3)) << i;
     }
+    for (; i < nbits; ++i)
+        subsignature |= size_t((feature[bits[i] / CHAR_BIT] >> (bits[i] % CHAR_BIT)) & 1) << i;
     return subsignature;
 }
 
@@ -443,7 +559,7 @@ inline LshStats LshTable<unsigned char>::getStats() const
 {
     LshStats stats;
     stats.bucket_size_mean_ = 0;
-    if ((buckets_speed_.empty()) && (buckets_space_.empty())) {
+    if ((buckets_speed_.empty()) && (buckets_space_.empty()) && (bucket_ids_.empty())) {
         stats.n_buckets_ = 0;
         stats.bucket_size_median_ = 0;
         stats.bucket_size_min_ = 0;
@@ -451,7 +567,17 @@ inline LshStats LshTable<unsigned char>::getStats() const
         return stats;
     }
 
-    if (!buckets_speed_.empty()) {
+    if (!bucket_offsets_.empty()) {
+        size_t n_buckets = bucket_offsets_.size() - 1;
+        for (size_t k = 0; k < n_buckets; ++k) {
+            lsh::FeatureIndex bucket_size = bucket_offsets_[k + 1] - bucket_offsets_[k];
+            stats.bucket_sizes_.push_back(bucket_size);
+            stats.bucket_size_mean_ += bucket_size;
+        }
+        stats.bucket_size_mean_ /= n_buckets;
+        stats.n_buckets_ = n_buckets;
+    }
+    else if (!buckets_speed_.empty()) {
         for (BucketsSpeed::const_iterator pbucket = buckets_speed_.begin(); pbucket != buckets_speed_.end(); ++pbucket) {
             stats.bucket_sizes_.push_back((lsh::FeatureIndex)pbucket->size());
             stats.bucket_size_mean_ += pbucket->size();
@@ -136,6 +136,16 @@ struct CV_EXPORTS LshIndexParams : public IndexParams
     LshIndexParams(int table_number, int key_size, int multi_probe_level);
 };
 
+struct CV_EXPORTS HnswIndexParams : public IndexParams
+{
+    HnswIndexParams(int M = 16, int ef_construction = 200);
+};
+
+struct CV_EXPORTS IvfPqIndexParams : public IndexParams
+{
+    IvfPqIndexParams(int nlist = 1024, int m = 8, int rerank = 0, int iterations = 10);
+};
+
 struct CV_EXPORTS SavedIndexParams : public IndexParams
 {
     SavedIndexParams(const String& filename);
@@ -31,6 +31,8 @@
 #ifndef OPENCV_FLANN_NNINDEX_H
 #define OPENCV_FLANN_NNINDEX_H
 
+#include "opencv2/core/utility.hpp"
+
 #include "matrix.h"
 #include "result_set.h"
 #include "params.h"
@@ -60,6 +62,9 @@ public:
 
     /**
      * \brief Perform k-nearest neighbor search
+     *
+     * The queries are processed in parallel, findNeighbors() must not modify the index.
+     *
      * \param[in] queries The query points for which to find the nearest neighbors
      * \param[out] indices The indices of the nearest neighbors found
      * \param[out] dists Distances to the nearest neighbors found
@@ -81,13 +86,16 @@ public:
             findNeighbors(resultSet, queries[i], params);
         }
 #else
-        KNNUniqueResultSet<DistanceType> resultSet(knn);
-        for (size_t i = 0; i < queries.rows; i++) {
-            resultSet.clear();
-            findNeighbors(resultSet, queries[i], params);
-            if (get_param(params,"sorted",true)) resultSet.sortAndCopy(indices[i], dists[i], knn);
-            else resultSet.copy(indices[i], dists[i], knn);
-        }
+        const bool sorted = get_param(params,"sorted",true);
+        cv::parallel_for_(cv::Range(0, (int)queries.rows), [&](const cv::Range& range) {
+            KNNUniqueResultSet<DistanceType> resultSet(knn);
+            for (int i = range.start; i < range.end; i++) {
+                resultSet.clear();
+                findNeighbors(resultSet, queries[i], params);
+                if (sorted) resultSet.sortAndCopy(indices[i], dists[i], knn);
+                else resultSet.copy(indices[i], dists[i], knn);
+            }
+        });
 #endif
     }
 
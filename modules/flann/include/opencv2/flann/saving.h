@@ -142,7 +142,7 @@ void save_value(FILE* stream, const std::vector<T>& value)
 {
     size_t size = value.size();
     fwrite(&size, sizeof(size_t), 1, stream);
-    fwrite(&value[0], sizeof(T), size, stream);
+    fwrite(value.data(), sizeof(T), size, stream);
 }
 
 template<typename T>
@@ -178,7 +178,7 @@ void load_value(FILE* stream, std::vector<T>& value)
         FLANN_THROW(cv::Error::StsError, "Cannot read from file");
     }
     value.resize(size);
-    read_cnt = fread(&value[0], sizeof(T), size, stream);
+    read_cnt = fread(value.data(), sizeof(T), size, stream);
     if (read_cnt != size) {
         FLANN_THROW(cv::Error::StsError, "Cannot read from file");
     }
@@ -285,6 +285,30 @@ LshIndexParams::LshIndexParams(int table_number, int key_size, int multi_probe_l
     p["multi_probe_level"] = multi_probe_level;
 }
 
+HnswIndexParams::HnswIndexParams(int M, int ef_construction)
+{
+    ::cvflann::IndexParams& p = get_params(*this);
+    p["algorithm"] = FLANN_INDEX_HNSW;
+    // The number of links per node on the upper layers (2*M on the bottom layer)
+    p["M"] = M;
+    // The size of the candidate list used while the graph is built
+    p["ef_construction"] = ef_construction;
+}
+
+IvfPqIndexParams::IvfPqIndexParams(int nlist, int m, int rerank, int iterations)
+{
+    ::cvflann::IndexParams& p = get_params(*this);
+    p["algorithm"] = FLANN_INDEX_IVFPQ;
+    // The number of inverted lists (coarse quantizer centroids)
+    p["nlist"] = nlist;
+    // The number of sub-quantizers, the vector length must be a multiple of it
+    p["m"] = m;
+    // The number of approximate candidates re-ranked with the exact distance (0 to disable)
+    p["rerank"] = rerank;
+    // The maximum number of k-means iterations used for training the quantizers
+    p["iterations"] = iterations;
+}
+
 SavedIndexParams::SavedIndexParams(const String& _filename)
 {
     String filename = _filename;
@@ -391,11 +415,20 @@ void Index::build(InputArray _data, const IndexParams& params, flann_distance_t
 
     release();
 
-    // Index may reuse 'data' during search, need to keep it alive
-    features_clone = _data.getMat().clone();
-    Mat data = features_clone;
-
     algo = getParam<flann_algorithm_t>(params, "algorithm", FLANN_INDEX_LINEAR);
+
+    // Index may reuse 'data' during search, need to keep it alive.
+    // IVF-PQ only reads the raw vectors to re-rank, without it they are
+    // needed while the index is built only.
+    Mat data = _data.getMat();
+    if( algo != FLANN_INDEX_IVFPQ || getParam<int>(params, "rerank", 0) > 0 )
+    {
+        features_clone = data.clone();
+        data = features_clone;
+    }
+    else if( !data.isContinuous() )
+        data = data.clone();
+
     if( algo == FLANN_INDEX_SAVED )
     {
         load_(getParam<String>(params, "filename", String()));
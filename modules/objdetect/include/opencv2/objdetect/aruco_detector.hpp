@@ -57,6 +57,8 @@ struct CV_EXPORTS_W_SIMPLE DetectorParameters {
         useAruco3Detection = false;
         minSideLengthCanonicalImg = 32;
         minMarkerLengthRatioOriginalImg = 0.0;
+        trackingRedetectionPeriod = 30;
+        trackingWindowMarginRate = 0.5f;
     }
 
     /** @brief Read a new set of DetectorParameters from FileNode (use FileStorage.root()).
@@ -231,6 +233,14 @@ struct CV_EXPORTS_W_SIMPLE DetectorParameters {
 
     /// range [0,1], eq (2) from paper. The parameter tau_i has a direct influence on the processing speed.
     CV_PROP_RW float minMarkerLengthRatioOriginalImg;
+
+    /** @brief number of frames ArucoDetector::trackMarkers() searches the markers only around their predicted
+     * positions before it runs a full detection again (default 30).
+     */
+    CV_PROP_RW int trackingRedetectionPeriod;
+
+    /// margin added around each predicted marker in ArucoDetector::trackMarkers(), relative to the marker side (default 0.5)
+    CV_PROP_RW float trackingWindowMarginRate;
 };
 
 /** @brief struct RefineParameters is used by ArucoDetector
@@ -308,6 +318,30 @@ public:
     CV_WRAP void detectMarkers(InputArray image, OutputArrayOfArrays corners, OutputArray ids,
                                OutputArrayOfArrays rejectedImgPoints = noArray()) const;
 
+    /** @brief Marker detection in consecutive video frames
+     *
+     * @param image input frame
+     * @param corners vector of detected marker corners, see detectMarkers()
+     * @param ids vector of identifiers of the detected markers, see detectMarkers()
+     * @param rejectedImgPoints contains the imgPoints of the rejected candidates of the processed regions
+     *
+     * The first call runs detectMarkers() on the whole frame. The next calls predict the corners of each marker
+     * from its last two positions and run the detection only inside a window around the prediction, see
+     * DetectorParameters::trackingWindowMarginRate. The whole frame is processed again when a tracked marker is
+     * lost, when the frame size changes and every DetectorParameters::trackingRedetectionPeriod frames, so new
+     * markers are found with that delay at most.
+     * @note The tracked markers are stored in the detector implementation, which copies of an ArucoDetector
+     * share like they share the parameters. Use a separately created detector for every video stream and do not
+     * call this method concurrently on the same detector or its copies.
+     * @sa resetTracking
+     */
+    CV_WRAP void trackMarkers(InputArray image, OutputArrayOfArrays corners, OutputArray ids,
+                              OutputArrayOfArrays rejectedImgPoints = noArray());
+
+    /** @brief Forget the markers tracked by trackMarkers(), its next call runs a full detection
+     */
+    CV_WRAP void resetTracking();
+
     /** @brief Refine not detected markers based on the already detected and the board layout
      *
      * @param image input image
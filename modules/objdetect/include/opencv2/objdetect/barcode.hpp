@@ -57,6 +57,31 @@ public:
                                       CV_OUT std::vector<std::string> &decoded_info,
                                       CV_OUT std::vector<std::string> &decoded_type,
                                       OutputArray points = noArray()) const;
+
+    /** @brief Detects and decodes barcodes in consecutive video frames
+
+     * @param frame grayscale or color (BGR) frame containing barcodes.
+     * @param decoded_info UTF8-encoded output vector of string(s) or empty vector of string if the codes cannot be decoded.
+     * @param decoded_type vector of strings, specifies the type of these barcodes
+     * @param points optional output vector of vertices of the found barcode rectangles. Will be empty if not found.
+     * @return true if at least one valid barcode have been found
+     *
+     * Same as detectAndDecodeWithType(), but the detector keeps its buffers and the results of the previous frame.
+     * The barcodes found in a region whose content hasn't changed since they were decoded keep their
+     * previous result, the others are decoded again; the whole detection is skipped when the frame hasn't changed.
+     * The detector should not be used by several threads at once in this mode. The kept state belongs to the
+     * detector implementation, which copies of a BarcodeDetector share, so use a separately created detector
+     * for every video stream. The state is dropped when the frame size changes.
+     * @sa resetFrames
+     */
+    CV_WRAP bool detectAndDecodeFrame(InputArray frame,
+                                      CV_OUT std::vector<std::string> &decoded_info,
+                                      CV_OUT std::vector<std::string> &decoded_type,
+                                      OutputArray points = noArray());
+
+    /** @brief Forget the frames seen by detectAndDecodeFrame(), its next call processes the frame from scratch
+     */
+    CV_WRAP void resetFrames();
 };
 //! @}
 
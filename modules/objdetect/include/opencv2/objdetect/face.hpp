@@ -71,6 +71,17 @@ public:
      */
     CV_WRAP virtual int detect(InputArray image, OutputArray faces) = 0;
 
+    /** @brief Detects faces in several images with a single forward pass of the network.
+     *
+     *  The detector created by create() letterboxes each image into the size set with setInputSize(): it is
+     *  resized to fit while keeping its aspect ratio and padded at the right and bottom. The network must accept
+     *  batched inputs. The base class implementation, for derived classes that do not override it, calls
+     *  detect() on each image in turn.
+     *  @param images images to detect, they may have different sizes
+     *  @param faces one detection result per image, in the format of detect() and in the coordinates of that image
+     */
+    CV_WRAP virtual int detectBatch(InputArrayOfArrays images, OutputArrayOfArrays faces);
+
     /** @brief Creates an instance of face detector class with given parameters
      *
      *  @param model the path to the requested model
@@ -56,6 +56,8 @@ static inline bool readWrite(DetectorParameters &params, const FileNode* readNod
     check |= readWriteParameter("minSideLengthCanonicalImg", params.minSideLengthCanonicalImg, readNode, writeStorage);
     check |= readWriteParameter("minMarkerLengthRatioOriginalImg", params.minMarkerLengthRatioOriginalImg,
                                 readNode, writeStorage);
+    check |= readWriteParameter("trackingRedetectionPeriod", params.trackingRedetectionPeriod, readNode, writeStorage);
+    check |= readWriteParameter("trackingWindowMarginRate", params.trackingWindowMarginRate, readNode, writeStorage);
     return check;
 }
 
@@ -413,12 +415,13 @@ static int _getBorderErrors(const Mat &bits, int markerSize, int borderSize) {
 
 
 /**
- * @brief Tries to identify one candidate given the dictionary
+ * @brief Tries to identify one candidate given the dictionary and, if not null, its lookup index
  * @return candidate typ. zero if the candidate is not valid,
  *                           1 if the candidate is a black candidate (default candidate)
  *                           2 if the candidate is a white candidate
  */
-static uint8_t _identifyOneCandidate(const Dictionary& dictionary, const Mat& _image,
+static uint8_t _identifyOneCandidate(const Dictionary& dictionary, const DictionaryIndex* dictionaryIndex,
+                                     const Mat& _image,
                                      const vector<Point2f>& _corners, int& idx,
                                      const DetectorParameters& params, int& rotation,
                                      const float scale = 1.f) {
@@ -464,7 +467,10 @@ static uint8_t _identifyOneCandidate(const Dictionary& dictionary, const Mat& _i
             .colRange(params.markerBorderBits, candidateBits.cols - params.markerBorderBits);
 
     // try to indentify the marker
-    if(!dictionary.identify(onlyBits, idx, rotation, params.errorCorrectionRate))
+    bool identified = dictionaryIndex ?
+        dictionaryIndex->identify(dictionary, onlyBits, idx, rotation, params.errorCorrectionRate) :
+        dictionary.identify(onlyBits, idx, rotation, params.errorCorrectionRate);
+    if(!identified)
         return 0;
 
     return typ;
@@ -649,11 +655,20 @@ struct ArucoDetector::ArucoDetectorImpl {
 
     /// marker refine parameters
     RefineParameters refineParams;
+
+    /// lookup structure built from the dictionary to identify the candidates
+    DictionaryIndex dictionaryIndex;
+
+    /// markers found by the last trackMarkers() call, with the motion of their corners since the call before
+    vector<vector<Point2f> > trackedCorners, trackedMotion;
+    vector<int> trackedIds;
+    Size trackedImageSize;
+    int framesSinceDetection = 0;
     ArucoDetectorImpl() {}
 
     ArucoDetectorImpl(const Dictionary &_dictionary, const DetectorParameters &_detectorParams,
                       const RefineParameters& _refineParams): dictionary(_dictionary),
-                      detectorParams(_detectorParams), refineParams(_refineParams) {}
+                      detectorParams(_detectorParams), refineParams(_refineParams), dictionaryIndex(_dictionary) {}
     /**
      * @brief Detect square candidates in the input image
      */
@@ -779,6 +794,8 @@ struct ArucoDetector::ArucoDetectorImpl {
         vector<uint8_t> validCandidates(ncandidates, 0);
         vector<uint8_t> was(ncandidates, false);
         bool checkCloseContours = true;
+        // the dictionary is public and can be modified after the index was built
+        const DictionaryIndex* index = dictionaryIndex.matches(dictionary) ? &dictionaryIndex : nullptr;
 
         int maxDepth = 0;
         for (size_t i = 0ull; i < selectedContours.size(); i++)
@@ -807,11 +824,11 @@ struct ArucoDetector::ArucoDetectorImpl {
                     }
                     const float scale = detectorParams.useAruco3Detection ? img.cols / static_cast<float>(grey.cols) : 1.f;
 
-                    validCandidates[v] = _identifyOneCandidate(dictionary, img, selectedContours[v].corners, idsTmp[v], detectorParams, rotated[v], scale);
+                    validCandidates[v] = _identifyOneCandidate(dictionary, index, img, selectedContours[v].corners, idsTmp[v], detectorParams, rotated[v], scale);
 
                     if (validCandidates[v] == 0 && checkCloseContours) {
                         for (const MarkerCandidate& closeMarkerCandidate: selectedContours[v].closeContours) {
-                            validCandidates[v] = _identifyOneCandidate(dictionary, img, closeMarkerCandidate.corners, idsTmp[v], detectorParams, rotated[v], scale);
+                            validCandidates[v] = _identifyOneCandidate(dictionary, index, img, closeMarkerCandidate.corners, idsTmp[v], detectorParams, rotated[v], scale);
                             if (validCandidates[v] > 0) {
                                 selectedContours[v].corners = closeMarkerCandidate.corners;
                                 selectedContours[v].contour = closeMarkerCandidate.contour;
@@ -1003,6 +1020,105 @@ void ArucoDetector::detectMarkers(InputArray _image, OutputArrayOfArrays _corner
     Mat(ids).copyTo(_ids);
 }
 
+static inline Point2f _getMarkerCenter(const vector<Point2f>& corners) {
+    return (corners[0] + corners[1] + corners[2] + corners[3]) * 0.25f;
+}
+
+void ArucoDetector::trackMarkers(InputArray _image, OutputArrayOfArrays _corners, OutputArray _ids,
+                                 OutputArrayOfArrays _rejectedImgPoints) {
+    CV_Assert(!_image.empty());
+    ArucoDetectorImpl& impl = *arucoDetectorImpl;
+    const DetectorParameters& detectorParams = impl.detectorParams;
+    CV_Assert(detectorParams.trackingWindowMarginRate >= 0.f);
+
+    Mat grey;
+    _convertToGrey(_image, grey);
+
+    vector<vector<Point2f> > corners, rejected;
+    vector<int> ids;
+    bool tracked = !impl.trackedIds.empty() && impl.trackedImageSize == grey.size() &&
+                   impl.framesSinceDetection < detectorParams.trackingRedetectionPeriod;
+
+    // search every tracked marker in a window around its predicted position
+    const Rect imageRect(Point(0, 0), grey.size());
+    vector<vector<Point2f> > windowCorners, windowRejected;
+    vector<int> windowIds;
+    for (size_t i = 0; tracked && i < impl.trackedIds.size(); i++) {
+        vector<Point2f> predicted(4);
+        for (int c = 0; c < 4; c++)
+            predicted[c] = impl.trackedCorners[i][c] + impl.trackedMotion[i][c];
+        const Rect2f box = boundingRect(predicted);
+        const float margin = detectorParams.trackingWindowMarginRate * max(box.width, box.height);
+        const Rect window = Rect(Point(cvFloor(box.x - margin), cvFloor(box.y - margin)),
+                                 Point(cvCeil(box.br().x + margin) + 1, cvCeil(box.br().y + margin) + 1)) & imageRect;
+        if (window.empty()) {
+            tracked = false;
+            break;
+        }
+
+        detectMarkers(grey(window), windowCorners, windowIds,
+                      _rejectedImgPoints.needed() ? _OutputArray(windowRejected) : _OutputArray(noArray()));
+        const Point2f offset((float)window.x, (float)window.y);
+        const Point2f predictedCenter = _getMarkerCenter(predicted);
+        int best = -1;
+        float bestDistance = std::numeric_limits<float>::max();
+        for (size_t j = 0; j < windowIds.size(); j++) {
+            if (windowIds[j] != impl.trackedIds[i])
+                continue;
+            const float distance = (float)norm(_getMarkerCenter(windowCorners[j]) + offset - predictedCenter);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = (int)j;
+            }
+        }
+        // a lost marker may have been occluded or may have moved too fast, look at the whole frame
+        if (best < 0) {
+            tracked = false;
+            break;
+        }
+
+        for (Point2f& corner : windowCorners[best])
+            corner += offset;
+        corners.push_back(windowCorners[best]);
+        ids.push_back(windowIds[best]);
+        for (vector<Point2f>& candidate : windowRejected) {
+            for (Point2f& corner : candidate)
+                corner += offset;
+            rejected.push_back(candidate);
+        }
+    }
+
+    if (tracked) {
+        for (size_t i = 0; i < corners.size(); i++)
+            for (int c = 0; c < 4; c++)
+                impl.trackedMotion[i][c] = corners[i][c] - impl.trackedCorners[i][c];
+        impl.framesSinceDetection++;
+    }
+    else {
+        corners.clear();
+        ids.clear();
+        rejected.clear();
+        detectMarkers(grey, corners, ids, _rejectedImgPoints.needed() ? _OutputArray(rejected) : _OutputArray(noArray()));
+        impl.trackedMotion.assign(corners.size(), vector<Point2f>(4, Point2f(0.f, 0.f)));
+        impl.framesSinceDetection = 0;
+    }
+    impl.trackedCorners = corners;
+    impl.trackedIds = ids;
+    impl.trackedImageSize = grey.size();
+
+    _copyVector2Output(corners, _corners);
+    Mat(ids).copyTo(_ids);
+    if (_rejectedImgPoints.needed())
+        _copyVector2Output(rejected, _rejectedImgPoints);
+}
+
+void ArucoDetector::resetTracking() {
+    arucoDetectorImpl->trackedCorners.clear();
+    arucoDetectorImpl->trackedMotion.clear();
+    arucoDetectorImpl->trackedIds.clear();
+    arucoDetectorImpl->framesSinceDetection = 0;
+}
+
 /**
   * Project board markers that are not included in the list of detected markers
   */
@@ -1289,6 +1405,8 @@ void ArucoDetector::write(FileStorage &fs) const
 
 void ArucoDetector::read(const FileNode &fn) {
     arucoDetectorImpl->dictionary.readDictionary(fn);
+    arucoDetectorImpl->dictionaryIndex = DictionaryIndex(arucoDetectorImpl->dictionary);
+    resetTracking();
     arucoDetectorImpl->detectorParams.readDetectorParameters(fn);
     arucoDetectorImpl->refineParams.readRefineParameters(fn);
 }
@@ -1299,6 +1417,8 @@ const Dictionary& ArucoDetector::getDictionary() const {
 
 void ArucoDetector::setDictionary(const Dictionary& dictionary) {
     arucoDetectorImpl->dictionary = dictionary;
+    arucoDetectorImpl->dictionaryIndex = DictionaryIndex(dictionary);
+    resetTracking();
 }
 
 const DetectorParameters& ArucoDetector::getDetectorParameters() const {
@@ -134,6 +134,149 @@ int Dictionary::getDistanceToId(InputArray bits, int id, bool allRotations) cons
 }
 
 
+static inline int _popCount64(uint64_t value) {
+    return cv::hal::normHamming((const uchar*)&value, (int)sizeof(value));
+}
+
+
+/**
+ * @brief Pack the bytes of one marker rotation into a word, byte i goes to bits [8i, 8i+8)
+ */
+static inline uint64_t _packBytes(const uchar* bytes, int nbytes) {
+    uint64_t code = 0;
+    for(int i = 0; i < nbytes; i++)
+        code |= (uint64_t)bytes[i] << (8 * i);
+    return code;
+}
+
+
+/**
+ * @brief Pack marker bits like the first rotation of getByteListFromBits()
+ */
+static uint64_t _packBits(const Mat &bits) {
+    uchar bytes[sizeof(uint64_t)] = {0};
+    int currentBit = 0, currentByte = 0;
+    for(int row = 0; row < bits.rows; row++) {
+        for(int col = 0; col < bits.cols; col++) {
+            bytes[currentByte] = (uchar)((bytes[currentByte] << 1) | bits.at<uchar>(row, col));
+            if(++currentBit == 8) {
+                currentBit = 0;
+                currentByte++;
+            }
+        }
+    }
+    return _packBytes(bytes, (bits.rows * bits.cols + 7) / 8);
+}
+
+
+DictionaryIndex::DictionaryIndex(): markerSize(0), maxCorrectionBits(0), chunkBits(0), nchunks(0) {}
+
+
+DictionaryIndex::DictionaryIndex(const Dictionary &dictionary): markerSize(dictionary.markerSize),
+    maxCorrectionBits(dictionary.maxCorrectionBits), chunkBits(0), nchunks(0) {
+    const int nbytes = (markerSize * markerSize + 7) / 8;
+    if(dictionary.bytesList.empty() || dictionary.bytesList.type() != CV_8UC4 ||
+       dictionary.bytesList.cols != nbytes || nbytes > (int)sizeof(uint64_t))
+        return; // not indexed, identify() falls back to Dictionary::identify()
+
+    bytesList = dictionary.bytesList.clone();
+    const int nmarkers = bytesList.rows;
+    codes.resize(4 * nmarkers);
+    sortedCodes.resize(4 * nmarkers);
+    for(int m = 0; m < nmarkers; m++) {
+        for(int r = 0; r < 4; r++) {
+            codes[4 * m + r] = _packBytes(bytesList.ptr(m) + r * nbytes, nbytes);
+            sortedCodes[4 * m + r] = Entry(codes[4 * m + r], 4 * m + r);
+        }
+    }
+    std::sort(sortedCodes.begin(), sortedCodes.end());
+
+    // cut the code words into maxCorrectionBits + 1 chunks, the valid bits of a packed code are contiguous
+    const int totalBits = markerSize * markerSize;
+    nchunks = std::min(std::max(maxCorrectionBits, 0) + 1, totalBits);
+    chunkBits = (totalBits + nchunks - 1) / nchunks;
+    nchunks = (totalBits + chunkBits - 1) / chunkBits;
+    if(nchunks < 2)
+        return;
+
+    const uint64_t chunkMask = (uint64_t(1) << chunkBits) - 1;
+    chunks.resize(nchunks);
+    for(int c = 0; c < nchunks; c++) {
+        chunks[c].resize(codes.size());
+        for(size_t e = 0; e < codes.size(); e++)
+            chunks[c][e] = Entry((codes[e] >> (c * chunkBits)) & chunkMask, (int)e);
+        std::sort(chunks[c].begin(), chunks[c].end());
+    }
+}
+
+
+bool DictionaryIndex::matches(const Dictionary &dictionary) const {
+    if(bytesList.empty() || dictionary.markerSize != markerSize ||
+       dictionary.maxCorrectionBits != maxCorrectionBits || dictionary.bytesList.type() != bytesList.type() ||
+       dictionary.bytesList.size() != bytesList.size())
+        return false;
+    // the dictionary bytes may have been modified in place since the index was built
+    const size_t rowBytes = bytesList.cols * bytesList.elemSize();
+    for(int m = 0; m < bytesList.rows; m++) {
+        if(memcmp(dictionary.bytesList.ptr(m), bytesList.ptr(m), rowBytes) != 0)
+            return false;
+    }
+    return true;
+}
+
+
+bool DictionaryIndex::identify(const Dictionary &dictionary, const Mat &onlyBits, int &idx, int &rotation,
+                               double maxCorrectionRate) const {
+    CV_Assert(onlyBits.rows == markerSize && onlyBits.cols == markerSize);
+
+    int maxCorrectionRecalculed = int(double(maxCorrectionBits) * maxCorrectionRate);
+    // the chunks only guarantee a common exact chunk for codes within nchunks - 1 bits
+    if(bytesList.empty() || maxCorrectionRecalculed < 0 || maxCorrectionRecalculed >= std::max(nchunks, 1))
+        return dictionary.identify(onlyBits, idx, rotation, maxCorrectionRate);
+
+    const uint64_t candidateCode = _packBits(onlyBits);
+    idx = -1; // by default, not found
+
+    if(maxCorrectionRecalculed == 0) {
+        // the lowest marker and rotation with the same code
+        std::vector<Entry>::const_iterator it = std::lower_bound(sortedCodes.begin(), sortedCodes.end(),
+                                                                 Entry(candidateCode, INT_MIN));
+        if(it != sortedCodes.end() && it->first == candidateCode) {
+            idx = it->second / 4;
+            rotation = it->second % 4;
+        }
+        return idx != -1;
+    }
+
+    // lowest marker having a rotation within maxCorrectionRecalculed bits, as in Dictionary::identify()
+    const uint64_t chunkMask = (uint64_t(1) << chunkBits) - 1;
+    int bestMarker = INT_MAX;
+    for(int c = 0; c < nchunks; c++) {
+        const uint64_t chunk = (candidateCode >> (c * chunkBits)) & chunkMask;
+        const std::vector<Entry>& entries = chunks[c];
+        for(std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), Entry(chunk, INT_MIN));
+            it != entries.end() && it->first == chunk; ++it) {
+            const int m = it->second / 4;
+            if(m < bestMarker && _popCount64(codes[it->second] ^ candidateCode) <= maxCorrectionRecalculed)
+                bestMarker = m;
+        }
+    }
+    if(bestMarker == INT_MAX)
+        return false;
+
+    int currentMinDistance = markerSize * markerSize + 1;
+    for(int r = 0; r < 4; r++) {
+        int currentHamming = _popCount64(codes[4 * bestMarker + r] ^ candidateCode);
+        if(currentHamming < currentMinDistance) {
+            currentMinDistance = currentHamming;
+            rotation = r;
+        }
+    }
+    idx = bestMarker;
+    return true;
+}
+
+
 void Dictionary::generateImageMarker(int id, int sidePixels, OutputArray _img, int borderBits) const {
     CV_Assert(sidePixels >= (markerSize + 2*borderBits));
     CV_Assert(id < bytesList.rows);
@@ -5,6 +5,7 @@
 #define __OPENCV_OBJDETECT_ARUCO_UTILS_HPP__
 
 #include <opencv2/core.hpp>
+#include <opencv2/objdetect/aruco_dictionary.hpp>
 #include <vector>
 
 namespace cv {
@@ -20,6 +21,43 @@ void _copyVector2Output(std::vector<std::vector<Point2f> > &vec, OutputArrayOfAr
   */
 void _convertToGrey(InputArray _in, Mat& _out);
 
+/**
+ * @brief Lookup structure to identify marker bits in a dictionary in time independent of its size
+ *
+ * The codes of all markers and rotations are packed into 64-bit words. Exact matches are found by binary
+ * search in the sorted codes. Codes within maxCorrectionBits are found by multi-index hashing: the words are
+ * cut into maxCorrectionBits + 1 chunks and at least one of them matches exactly, so only the codes sharing
+ * a chunk with the candidate are compared. Markers larger than 8x8 bits are not indexed.
+ */
+class DictionaryIndex {
+public:
+    DictionaryIndex();
+    explicit DictionaryIndex(const Dictionary& dictionary);
+
+    /**
+     * @brief Whether the index was built from a dictionary with the same contents
+     */
+    bool matches(const Dictionary& dictionary) const;
+
+    /**
+     * @brief Same as Dictionary::identify(), using the index when possible
+     */
+    bool identify(const Dictionary& dictionary, const Mat& onlyBits, int& idx, int& rotation,
+                  double maxCorrectionRate) const;
+
+private:
+    typedef std::pair<uint64_t, int> Entry; // code or chunk of the code, marker * 4 + rotation
+
+    Mat bytesList;
+    int markerSize;
+    int maxCorrectionBits;
+    int chunkBits;
+    int nchunks;
+    std::vector<uint64_t> codes;
+    std::vector<Entry> sortedCodes;
+    std::vector<std::vector<Entry> > chunks;
+};
+
 template<typename T>
 inline bool readParameter(const std::string& name, T& parameter, const FileNode& node)
 {
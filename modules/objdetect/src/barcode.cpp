@@ -143,11 +143,31 @@ public:
     shared_ptr<SuperScale> sr;
     bool use_nn_sr = false;
 
+    // state of detectAndDecodeFrame() between the frames
+    struct FrameState
+    {
+        Mat gray;
+        Detect bardet;
+        Mat reference, next_reference, changed;
+        Size frame_size;  // size of the frame the reference was taken from
+        vector<vector<Point2f>> points;
+        vector<Result> results;
+
+        void reset()
+        {
+            reference.release();
+            frame_size = Size();
+            points.clear();
+            results.clear();
+        }
+    } frame_state;
+
 public:
     //=================
     // own methods
     BarcodeImpl() = default;
     vector<Mat> initDecode(const Mat &src, const vector<vector<Point2f>> &points) const;
+    vector<Result> decodeCandidates(const Mat &src, const vector<vector<Point2f>> &points) const;
     bool decodeWithType(InputArray img,
                      InputArray points,
                      vector<string> &decoded_info,
@@ -156,6 +176,10 @@ public:
                               vector<string> &decoded_info,
                               vector<string> &decoded_type,
                               OutputArray points_) const;
+    bool detectAndDecodeFrame(InputArray img,
+                              vector<string> &decoded_info,
+                              vector<string> &decoded_type,
+                              OutputArray points_);
 
     //=================
     // implement interface
@@ -171,23 +195,40 @@ public:
 // return cropped and scaled bar img
 vector<Mat> BarcodeImpl::initDecode(const Mat &src, const vector<vector<Point2f>> &points) const
 {
-    vector<Mat> bar_imgs;
-    for (auto &corners : points)
-    {
-        Mat bar_img;
-        cropROI(src, bar_img, corners);
-//        sharpen(bar_img, bar_img);
-        // empirical settings
-        if (bar_img.cols < 320 || bar_img.cols > 640)
+    vector<Mat> bar_imgs(points.size());
+    auto initBarImages = [&](const Range &range) {
+        for (int i = range.start; i < range.end; i++)
         {
-            float scale = 560.0f / static_cast<float>(bar_img.cols);
-            sr->processImageScale(bar_img, bar_img, scale, use_nn_sr);
+            Mat &bar_img = bar_imgs[i];
+            cropROI(src, bar_img, points[i]);
+//            sharpen(bar_img, bar_img);
+            // empirical settings
+            if (bar_img.cols < 320 || bar_img.cols > 640)
+            {
+                float scale = 560.0f / static_cast<float>(bar_img.cols);
+                sr->processImageScale(bar_img, bar_img, scale, use_nn_sr);
+            }
         }
-        bar_imgs.emplace_back(bar_img);
-    }
+    };
+    // the super resolution network can't run concurrently
+    if (use_nn_sr)
+        initBarImages(Range(0, int(points.size())));
+    else
+        parallel_for_(Range(0, int(points.size())), initBarImages);
     return bar_imgs;
 }
 
+vector<Result> BarcodeImpl::decodeCandidates(const Mat &src, const vector<vector<Point2f>> &points) const
+{
+    if (points.empty())
+        return vector<Result>();
+    vector<Mat> bar_imgs = initDecode(src, points);
+    BarDecode bardec;
+    bardec.init(bar_imgs);
+    bardec.decodeMultiplyProcess();
+    return bardec.getDecodeInformation();
+}
+
 bool BarcodeImpl::decodeWithType(InputArray img,
                               InputArray points,
                               vector<string> &decoded_info,
@@ -212,11 +253,7 @@ bool BarcodeImpl::decodeWithType(InputArray img,
         }
     }
     CV_Assert(!src_points.empty());
-    vector<Mat> bar_imgs = initDecode(inarr, src_points);
-    BarDecode bardec;
-    bardec.init(bar_imgs);
-    bardec.decodeMultiplyProcess();
-    const vector<Result> info = bardec.getDecodeInformation();
+    const vector<Result> info = decodeCandidates(inarr, src_points);
     decoded_info.clear();
     decoded_type.clear();
     bool ok = false;
@@ -258,6 +295,119 @@ bool BarcodeImpl::detectAndDecodeWithType(InputArray img,
     return ok;
 }
 
+bool BarcodeImpl::detectAndDecodeFrame(InputArray img,
+                                       vector<string> &decoded_info,
+                                       vector<string> &decoded_type,
+                                       OutputArray points_)
+{
+    // a pixel of the localization image differing by more than this from the reference marks a change
+    static constexpr double THRESHOLD_CHANGE = 24.;
+    // maximal distance between the corners of a candidate and of the previous one it inherits the result from,
+    // in pixels of the localization image
+    static constexpr double THRESHOLD_CORNERS_SHIFT = 2.;
+
+    FrameState &state = frame_state;
+    decoded_info.clear();
+    decoded_type.clear();
+    Mat inarr = state.gray;
+    if (!checkBarInputImage(img, inarr))
+    {
+        state.reset();
+        points_.release();
+        return false;
+    }
+    if (img.channels() != 1)
+        state.gray = inarr;  // conversion buffer of the next frame
+
+    Detect &bardet = state.bardet;
+    bardet.init(inarr);
+    const Mat &resized = bardet.getResizedImage();
+    const double coeff_expansion = bardet.getCoeffExpansion();
+    const Rect resized_rect(Point(), resized.size());
+
+    // frames of different sizes may share the localization image size, but not the corner coordinates
+    if (inarr.size() != state.frame_size)
+        state.reset();
+    const bool has_reference = !state.reference.empty();
+    if (has_reference)
+    {
+        absdiff(resized, state.reference, state.changed);
+        threshold(state.changed, state.changed, THRESHOLD_CHANGE, 255, THRESH_BINARY);
+    }
+    if (!has_reference || countNonZero(state.changed) > 0)
+    {
+        bardet.localization();
+        vector<vector<Point2f>> points;
+        if (bardet.computeTransformationPoints())
+            points = bardet.getTransformationPoints();
+
+        // the candidates lying in unchanged regions take the result of the matching previous candidate,
+        // the other ones are decoded in the full resolution frame
+        vector<Result> results(points.size());
+        vector<vector<Point2f>> decode_points;
+        vector<size_t> decode_indexes;
+        vector<Rect> kept_regions;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            int prev_idx = -1;
+            Rect region;
+            if (has_reference)
+            {
+                vector<Point2f> resized_corners(points[i].size());
+                for (size_t k = 0; k < points[i].size(); k++)
+                    resized_corners[k] = points[i][k] * (1. / coeff_expansion);
+                region = boundingRect(resized_corners) & resized_rect;
+                if (!region.empty() && countNonZero(state.changed(region)) == 0)
+                {
+                    for (size_t j = 0; j < state.points.size() && prev_idx < 0; j++)
+                    {
+                        bool same = true;
+                        for (size_t k = 0; k < 4 && same; k++)
+                            same = norm(points[i][k] - state.points[j][k]) <= THRESHOLD_CORNERS_SHIFT * coeff_expansion;
+                        if (same)
+                            prev_idx = int(j);
+                    }
+                }
+            }
+            if (prev_idx >= 0)
+            {
+                results[i] = state.results[prev_idx];
+                kept_regions.push_back(region);
+            }
+            else
+            {
+                decode_points.push_back(points[i]);
+                decode_indexes.push_back(i);
+            }
+        }
+        const vector<Result> decoded = decodeCandidates(inarr, decode_points);
+        for (size_t i = 0; i < decode_indexes.size(); i++)
+            results[decode_indexes[i]] = decoded[i];
+
+        // the kept regions are compared with the content they were decoded from at the next frame as well,
+        // so slow changes are not missed
+        resized.copyTo(state.next_reference);
+        for (const auto &region : kept_regions)
+            state.reference(region).copyTo(state.next_reference(region));
+        std::swap(state.reference, state.next_reference);
+        state.frame_size = inarr.size();
+        state.points = points;
+        state.results = results;
+    }
+
+    vector<Point2f> trans_points;
+    bool ok = false;
+    for (size_t i = 0; i < state.points.size(); i++)
+    {
+        trans_points.insert(trans_points.end(), state.points[i].begin(), state.points[i].end());
+        ok = ok || state.results[i].isValid();
+        decoded_info.emplace_back(state.results[i].result);
+        decoded_type.emplace_back(state.results[i].typeString());
+    }
+    updatePointsResult(points_, trans_points);
+    return ok;
+}
+
 bool BarcodeImpl::detect(InputArray img, OutputArray points) const
 {
     Mat inarr;
@@ -370,5 +520,19 @@ bool BarcodeDetector::detectAndDecodeWithType(InputArray img, vector<string> &de
     return p_->detectAndDecodeWithType(img, decoded_info, decoded_type, points_);
 }
 
+bool BarcodeDetector::detectAndDecodeFrame(InputArray frame, vector<string> &decoded_info, vector<string> &decoded_type, OutputArray points)
+{
+    Ptr<BarcodeImpl> p_ = dynamic_pointer_cast<BarcodeImpl>(p);
+    CV_Assert(p_);
+    return p_->detectAndDecodeFrame(frame, decoded_info, decoded_type, points);
+}
+
+void BarcodeDetector::resetFrames()
+{
+    Ptr<BarcodeImpl> p_ = dynamic_pointer_cast<BarcodeImpl>(p);
+    CV_Assert(p_);
+    p_->frame_state.reset();
+}
+
 }// namespace barcode
 } // namespace cv
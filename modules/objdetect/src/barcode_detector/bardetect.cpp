@@ -163,7 +163,7 @@ void Detect::init(const Mat &src)
         coeff_expansion = 1.0;
         width = src.size().width;
         height = src.size().height;
-        resized_barcode = src.clone();
+        src.copyTo(resized_barcode);
     }
     // median blur: sometimes it reduces the noise, but also reduces the recall
     // medianBlur(resized_barcode, resized_barcode, 3);
@@ -233,14 +233,13 @@ bool Detect::computeTransformationPoints()
 
 void Detect::preprocess()
 {
-    Mat scharr_x, scharr_y, temp;
     static constexpr double THRESHOLD_MAGNITUDE = 64.;
     Scharr(resized_barcode, scharr_x, CV_32F, 1, 0);
     Scharr(resized_barcode, scharr_y, CV_32F, 0, 1);
     // calculate magnitude of gradient and truncate
-    magnitude(scharr_x, scharr_y, temp);
-    threshold(temp, temp, THRESHOLD_MAGNITUDE, 1, THRESH_BINARY);
-    temp.convertTo(gradient_magnitude, CV_8U);
+    magnitude(scharr_x, scharr_y, scharr_temp);
+    threshold(scharr_temp, scharr_temp, THRESHOLD_MAGNITUDE, 1, THRESH_BINARY);
+    scharr_temp.convertTo(gradient_magnitude, CV_8U);
     integral(gradient_magnitude, integral_edges, CV_32F);
 
 
@@ -264,9 +263,10 @@ void Detect::preprocess()
             }
         }
     }
-    integral(scharr_x, temp, integral_x_sq, CV_32F, CV_32F);
-    integral(scharr_y, temp, integral_y_sq, CV_32F, CV_32F);
-    integral(scharr_x.mul(scharr_y), integral_xy, temp, CV_32F, CV_32F);
+    integral(scharr_x, scharr_temp, integral_x_sq, CV_32F, CV_32F);
+    integral(scharr_y, scharr_temp, integral_y_sq, CV_32F, CV_32F);
+    multiply(scharr_x, scharr_y, scharr_xy);
+    integral(scharr_xy, integral_xy, scharr_temp, CV_32F, CV_32F);
 }
 
 
@@ -33,6 +33,13 @@ public:
 
     bool computeTransformationPoints();
 
+    //! image of the localization, @p src of init() downscaled when its smaller side exceeds 512 pixels
+    const Mat &getResizedImage() const
+    { return resized_barcode; }
+
+    double getCoeffExpansion() const
+    { return coeff_expansion; }
+
 protected:
     enum resize_direction
     {
@@ -43,6 +50,8 @@ protected:
     double coeff_expansion = 1.0;
     int height, width;
     Mat resized_barcode, gradient_magnitude, coherence, orientation, edge_nums, integral_x_sq, integral_y_sq, integral_xy, integral_edges;
+    // preprocess() buffers, kept to be reused when the object processes several frames of the same size
+    Mat scharr_x, scharr_y, scharr_xy, scharr_temp;
 
     void preprocess();
 
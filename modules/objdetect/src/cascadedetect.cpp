@@ -496,9 +496,6 @@ bool FeatureEvaluator::setImage( InputArray _image, const std::vector<float>& _s
     {
         return false;
     }
-    Size sz0 = scaleData->at(0).szi;
-    sz0 = Size(std::max(rbuf.cols, (int)alignSize(sz0.width, 16)), std::max(rbuf.rows, sz0.height));
-
     if (recalcOptFeatures)
     {
         computeOptFeatures();
@@ -507,6 +504,8 @@ bool FeatureEvaluator::setImage( InputArray _image, const std::vector<float>& _s
 
     if (_image.isUMat() && !localSize.empty())
     {
+        Size sz0 = scaleData->at(0).szi;
+        sz0 = Size(std::max(urbuf.cols, (int)alignSize(sz0.width, 16)), std::max(urbuf.rows, sz0.height));
         usbuf.create(sbufSize.height*nchannels, sbufSize.width, CV_32S);
         urbuf.create(sz0, CV_8U);
 
@@ -523,15 +522,20 @@ bool FeatureEvaluator::setImage( InputArray _image, const std::vector<float>& _s
     {
         Mat image = _image.getMat();
         sbuf.create(sbufSize.height*nchannels, sbufSize.width, CV_32S);
-        rbuf.create(sz0, CV_8U);
+        // each scale is resized into its own layer of rbuf, placed like the layers of sbuf,
+        // so all the levels are computed in one parallel pass and the buffers are kept between frames
+        rbuf.create(sbufSize, CV_8U);
 
-        for (i = 0; i < nscales; i++)
+        parallel_for_(Range(0, (int)nscales), [&](const Range& range)
         {
-            const ScaleData& s = scaleData->at(i);
-            Mat dst(s.szi.height - 1, s.szi.width - 1, CV_8U, rbuf.ptr());
-            resize(image, dst, dst.size(), 1. / s.scale, 1. / s.scale, INTER_LINEAR_EXACT);
-            computeChannels((int)i, dst);
-        }
+            for (int scaleIdx = range.start; scaleIdx < range.end; scaleIdx++)
+            {
+                const ScaleData& s = scaleData->at(scaleIdx);
+                Mat dst(s.szi.height - 1, s.szi.width - 1, CV_8U, rbuf.ptr() + s.layer_ofs, rbuf.step);
+                resize(image, dst, dst.size(), 1. / s.scale, 1. / s.scale, INTER_LINEAR_EXACT);
+                computeChannels(scaleIdx, dst);
+            }
+        });
         sbufFlag = SBUF_VALID;
     }
 
@@ -650,7 +654,6 @@ void HaarEvaluator::computeChannels(int scaleIdx, InputArray img)
     CV_INSTRUMENT_REGION();
 
     const ScaleData& s = scaleData->at(scaleIdx);
-    sqofs = hasTiltedFeatures ? sbufSize.area() * 2 : sbufSize.area();
 
     if (img.isUMat())
     {
@@ -695,6 +698,8 @@ void HaarEvaluator::computeOptFeatures()
 
     if (hasTiltedFeatures)
         tofs = sbufSize.area();
+    // set here rather than in computeChannels(), which runs for several scales at once
+    sqofs = hasTiltedFeatures ? sbufSize.area() * 2 : sbufSize.area();
 
     int sstep = sbufSize.width;
     CV_SUM_OFS( nofs[0], nofs[1], nofs[2], nofs[3], 0, normrect, sstep );
@@ -1013,22 +1018,19 @@ Ptr<BaseCascadeClassifier::MaskGenerator> createFaceDetectionMaskGenerator()
 class CascadeClassifierInvoker : public ParallelLoopBody
 {
 public:
-    CascadeClassifierInvoker( CascadeClassifierImpl& _cc, int _nscales, int _nstripes,
-                              const FeatureEvaluator::ScaleData* _scaleData,
-                              const int* _stripeSizes, std::vector<Rect>& _vec,
-                              std::vector<int>& _levels, std::vector<double>& _weights,
-                              bool outputLevels, const Mat& _mask, Mutex* _mtx)
+    CascadeClassifierInvoker( CascadeClassifierImpl& _cc, const FeatureEvaluator::ScaleData* _scaleData,
+                              const std::vector<CascadeScaleStripe>& _stripes,
+                              std::vector<std::vector<Rect> >& _vec,
+                              std::vector<std::vector<int> >& _levels, std::vector<std::vector<double> >& _weights,
+                              bool outputLevels, const Mat& _mask )
     {
         classifier = &_cc;
-        nscales = _nscales;
-        nstripes = _nstripes;
         scaleData = _scaleData;
-        stripeSizes = _stripeSizes;
+        stripes = &_stripes;
         rectangles = &_vec;
         rejectLevels = outputLevels ? &_levels : 0;
         levelWeights = outputLevels ? &_weights : 0;
         mask = _mask;
-        mtx = _mtx;
     }
 
     void operator()(const Range& range) const CV_OVERRIDE
@@ -1039,19 +1041,21 @@ public:
         double gypWeight = 0.;
         Size origWinSize = classifier->data.origWinSize;
 
-        for( int scaleIdx = 0; scaleIdx < nscales; scaleIdx++ )
+        for( int stripeIdx = range.start; stripeIdx < range.end; stripeIdx++ )
         {
+            const CascadeScaleStripe& stripe = (*stripes)[stripeIdx];
+            const int scaleIdx = stripe.scaleIdx;
             const FeatureEvaluator::ScaleData& s = scaleData[scaleIdx];
             float scalingFactor = s.scale;
             int yStep = s.ystep;
-            int stripeSize = stripeSizes[scaleIdx];
-            int y0 = range.start*stripeSize;
             Size szw = s.getWorkingSize(origWinSize);
-            int y1 = std::min(range.end*stripeSize, szw.height);
             Size winSize(cvRound(origWinSize.width * scalingFactor),
                          cvRound(origWinSize.height * scalingFactor));
+            // every stripe has its own output, so no locking is needed and the results
+            // come out in the same order whatever the number of threads
+            std::vector<Rect>& stripeRectangles = (*rectangles)[stripeIdx];
 
-            for( int y = y0; y < y1; y += yStep )
+            for( int y = stripe.y0; y < stripe.y1; y += yStep )
             {
                 for( int x = 0; x < szw.width; x += yStep )
                 {
@@ -1062,22 +1066,18 @@ public:
                             result = -(int)classifier->data.stages.size();
                         if( classifier->data.stages.size() + result == 0 )
                         {
-                            mtx->lock();
-                            rectangles->push_back(Rect(cvRound(x*scalingFactor),
-                                                       cvRound(y*scalingFactor),
-                                                       winSize.width, winSize.height));
-                            rejectLevels->push_back(-result);
-                            levelWeights->push_back(gypWeight);
-                            mtx->unlock();
+                            stripeRectangles.push_back(Rect(cvRound(x*scalingFactor),
+                                                            cvRound(y*scalingFactor),
+                                                            winSize.width, winSize.height));
+                            (*rejectLevels)[stripeIdx].push_back(-result);
+                            (*levelWeights)[stripeIdx].push_back(gypWeight);
                         }
                     }
                     else if( result > 0 )
                     {
-                        mtx->lock();
-                        rectangles->push_back(Rect(cvRound(x*scalingFactor),
-                                                   cvRound(y*scalingFactor),
-                                                   winSize.width, winSize.height));
-                        mtx->unlock();
+                        stripeRectangles.push_back(Rect(cvRound(x*scalingFactor),
+                                                        cvRound(y*scalingFactor),
+                                                        winSize.width, winSize.height));
                     }
                     if( result == 0 )
                         x += yStep;
@@ -1087,15 +1087,12 @@ public:
     }
 
     CascadeClassifierImpl* classifier;
-    std::vector<Rect>* rectangles;
-    int nscales, nstripes;
     const FeatureEvaluator::ScaleData* scaleData;
-    const int* stripeSizes;
-    std::vector<int> *rejectLevels;
-    std::vector<double> *levelWeights;
-    std::vector<float> scales;
+    const std::vector<CascadeScaleStripe>* stripes;
+    std::vector<std::vector<Rect> >* rectangles;
+    std::vector<std::vector<int> > *rejectLevels;
+    std::vector<std::vector<double> > *levelWeights;
     Mat mask;
-    Mutex* mtx;
 };
 
 
@@ -1357,22 +1354,61 @@ void CascadeClassifierImpl::detectMultiScaleNoGrouping( InputArray _image, std::
         if (maskGenerator)
             currentMask = maskGenerator->generateMask(gray.getMat());
 
+        // Cut every scale into stripes of about the same number of windows, so that the small
+        // scales do not end up as a long tail and idle threads can pick up the remaining stripes
         size_t i, nscales = scales.size();
-        cv::AutoBuffer<int> stripeSizeBuf(nscales);
-        int* stripeSizes = stripeSizeBuf.data();
         const FeatureEvaluator::ScaleData* s = &featureEvaluator->getScaleData(0);
-        Size szw = s->getWorkingSize(data.origWinSize);
-        int nstripes = cvCeil(szw.width/32.);
+        int64 totalWindows = 0;
         for( i = 0; i < nscales; i++ )
         {
-            szw = s[i].getWorkingSize(data.origWinSize);
-            stripeSizes[i] = std::max((szw.height/s[i].ystep + nstripes-1)/nstripes, 1)*s[i].ystep;
+            Size szw = s[i].getWorkingSize(data.origWinSize);
+            totalWindows += (int64)((szw.width + s[i].ystep - 1)/s[i].ystep) * ((szw.height + s[i].ystep - 1)/s[i].ystep);
         }
+        const int64 stripeWindows = std::max(totalWindows / (std::max(getNumThreads(), 1) * 16), (int64)1024);
 
-        CascadeClassifierInvoker invoker(*this, (int)nscales, nstripes, s, stripeSizes,
-                                         candidates, rejectLevels, levelWeights,
-                                         outputRejectLevels, currentMask, &mtx);
-        parallel_for_(Range(0, nstripes), invoker);
+        std::vector<CascadeScaleStripe>& stripes = stripeBuf;
+        stripes.clear();
+        for( i = 0; i < nscales; i++ )
+        {
+            Size szw = s[i].getWorkingSize(data.origWinSize);
+            int rowWindows = std::max((szw.width + s[i].ystep - 1)/s[i].ystep, 1);
+            int stripeSize = (int)std::max(stripeWindows / rowWindows, (int64)1)*s[i].ystep;
+            for( int y = 0; y < szw.height; y += stripeSize )
+            {
+                CascadeScaleStripe stripe = { (int)i, y, std::min(y + stripeSize, szw.height) };
+                stripes.push_back(stripe);
+            }
+        }
+
+        std::vector<std::vector<Rect> >& stripeCandidates = stripeCandidatesBuf;
+        std::vector<std::vector<int> >& stripeLevels = stripeLevelsBuf;
+        std::vector<std::vector<double> >& stripeWeights = stripeWeightsBuf;
+        stripeCandidates.resize(stripes.size());
+        stripeLevels.resize(outputRejectLevels ? stripes.size() : 0);
+        stripeWeights.resize(outputRejectLevels ? stripes.size() : 0);
+        for( i = 0; i < stripes.size(); i++ )
+        {
+            stripeCandidates[i].clear();
+            if( outputRejectLevels )
+            {
+                stripeLevels[i].clear();
+                stripeWeights[i].clear();
+            }
+        }
+
+        CascadeClassifierInvoker invoker(*this, s, stripes, stripeCandidates, stripeLevels, stripeWeights,
+                                         outputRejectLevels, currentMask);
+        parallel_for_(Range(0, (int)stripes.size()), invoker);
+
+        for( i = 0; i < stripes.size(); i++ )
+        {
+            candidates.insert(candidates.end(), stripeCandidates[i].begin(), stripeCandidates[i].end());
+            if( outputRejectLevels )
+            {
+                rejectLevels.insert(rejectLevels.end(), stripeLevels[i].begin(), stripeLevels[i].end());
+                levelWeights.insert(levelWeights.end(), stripeWeights[i].begin(), stripeWeights[i].end());
+            }
+        }
     }
 }
 
@@ -73,6 +73,13 @@ protected:
     Ptr<std::vector<ScaleData> > scaleData;
 };
 
+/** Rows [y0, y1) of the working area of one scale, the unit of work of the CPU detection
+ */
+struct CascadeScaleStripe
+{
+    int scaleIdx;
+    int y0, y1;
+};
 
 class CascadeClassifierImpl CV_FINAL : public BaseCascadeClassifier
 {
@@ -224,7 +231,11 @@ protected:
     bool tryOpenCL;
 #endif
 
-    Mutex mtx;
+    // work items and their outputs, kept between calls
+    std::vector<CascadeScaleStripe> stripeBuf;
+    std::vector<std::vector<Rect> > stripeCandidatesBuf;
+    std::vector<std::vector<int> > stripeLevelsBuf;
+    std::vector<std::vector<double> > stripeWeightsBuf;
 };
 
 #define CC_CASCADE_PARAMS "cascadeParams"
@@ -16,7 +16,66 @@
 namespace cv
 {
 
+static void copyFacesToOutput(const std::vector<Mat>& results, OutputArrayOfArrays faces)
+{
+    faces.create((int)results.size(), 1, CV_32FC1, -1, true);
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        faces.create(results[i].rows, results[i].cols, CV_32FC1, (int)i, true);
+        if (!results[i].empty())
+            results[i].copyTo(faces.getMat((int)i));
+    }
+}
+
+int FaceDetectorYN::detectBatch(InputArrayOfArrays images, OutputArrayOfArrays faces)
+{
+    // Generic version running detect() on each image, FaceDetectorYNImpl batches the forward pass
+    std::vector<Mat> input_images;
+    images.getMatVector(input_images);
+
+    std::vector<Mat> results(input_images.size());
+    for (size_t i = 0; i < input_images.size(); i++)
+        detect(input_images[i], results[i]);
+    copyFacesToOutput(results, faces);
+    return 1;
+}
+
 #ifdef HAVE_OPENCV_DNN
+/** Resizes the image to fit into input_size keeping its aspect ratio, and pads it to pad_size
+ * at the right and bottom. Returns the scale factors applied in x and y.
+ */
+static Point2f letterboxImage(const Mat& image, const Size& input_size, const Size& pad_size, Mat& canvas)
+{
+    float scale = std::min((float)input_size.width / image.cols, (float)input_size.height / image.rows);
+    Size scaled_size(std::min(input_size.width, std::max(cvRound(image.cols * scale), 1)),
+                     std::min(input_size.height, std::max(cvRound(image.rows * scale), 1)));
+
+    canvas.create(pad_size, image.type());
+    canvas.setTo(Scalar::all(0));
+    Mat roi = canvas(Rect(Point(0, 0), scaled_size));
+    if (scaled_size == image.size())
+        image.copyTo(roi);
+    else
+        resize(image, roi, scaled_size, 0, 0, INTER_LINEAR);
+    return Point2f((float)scaled_size.width / image.cols, (float)scaled_size.height / image.rows);
+}
+
+/** Maps the bounding boxes and landmarks of a letterboxed image back to the original image
+ */
+static void unletterboxFaces(Mat& faces, const Point2f& scale)
+{
+    for (int i = 0; i < faces.rows; i++)
+    {
+        float* face = faces.ptr<float>(i);
+        // columns 0-13 alternate x and y, the score in column 14 is kept
+        for (int j = 0; j < 14; j += 2)
+        {
+            face[j] /= scale.x;
+            face[j + 1] /= scale.y;
+        }
+    }
+}
+
 class FaceDetectorYNImpl : public FaceDetectorYN
 {
 public:
@@ -153,12 +212,55 @@ public:
         net.forward(output_blobs, output_names);
 
         // Post process
-        Mat results = postProcess(output_blobs);
+        Mat results = postProcess(output_blobs, 0);
         results.convertTo(faces, CV_32FC1);
         return 1;
     }
+
+    int detectBatch(InputArrayOfArrays input_images, OutputArrayOfArrays faces) override
+    {
+        std::vector<Mat> images;
+        input_images.getMatVector(images);
+        if (images.empty())
+        {
+            faces.release();
+            return 0;
+        }
+
+        // Letterbox all the images into one blob, the canvases are kept between calls
+        const int batch_size = (int)images.size();
+        batch_canvases.resize(images.size());
+        std::vector<Point2f> scales(images.size());
+        for (int b = 0; b < batch_size; b++)
+        {
+            CV_CheckFalse(images[b].empty(), "Empty image in the batch");
+            scales[b] = letterboxImage(images[b], Size(inputW, inputH), Size(padW, padH), batch_canvases[b]);
+        }
+        Mat input_blob = dnn::blobFromImages(batch_canvases);
+
+        // Forward
+        std::vector<String> output_names = { "cls_8", "cls_16", "cls_32", "obj_8", "obj_16", "obj_32", "bbox_8", "bbox_16", "bbox_32", "kps_8", "kps_16", "kps_32" };
+        std::vector<Mat> output_blobs;
+        net.setInput(input_blob);
+        net.forward(output_blobs, output_names);
+        for (const Mat& output_blob : output_blobs)
+            CV_CheckEQ(output_blob.size[0], batch_size, "The network does not support batched inputs, use detect() on each image");
+
+        // Decode and suppress the faces of each image in parallel
+        std::vector<Mat> results(images.size());
+        parallel_for_(Range(0, batch_size), [&](const Range& range)
+        {
+            for (int b = range.start; b < range.end; b++)
+            {
+                postProcess(output_blobs, b).convertTo(results[b], CV_32FC1);
+                unletterboxFaces(results[b], scales[b]);
+            }
+        });
+        copyFacesToOutput(results, faces);
+        return 1;
+    }
 private:
-    Mat postProcess(const std::vector<Mat>& output_blobs)
+    Mat postProcess(const std::vector<Mat>& output_blobs, int batch_index)
     {
         Mat faces;
         for (size_t i = 0; i < strides.size(); ++i) {
@@ -171,11 +273,11 @@ private:
             Mat bbox = output_blobs[i + strides.size() * 2];
             Mat kps = output_blobs[i + strides.size() * 3];
 
-            // Decode from predictions
-            float* cls_v = (float*)(cls.data);
-            float* obj_v = (float*)(obj.data);
-            float* bbox_v = (float*)(bbox.data);
-            float* kps_v = (float*)(kps.data);
+            // Decode from predictions of the image batch_index
+            const float* cls_v = cls.ptr<float>() + batch_index * (cls.total() / cls.size[0]);
+            const float* obj_v = obj.ptr<float>() + batch_index * (obj.total() / obj.size[0]);
+            const float* bbox_v = bbox.ptr<float>() + batch_index * (bbox.total() / bbox.size[0]);
+            const float* kps_v = kps.ptr<float>() + batch_index * (kps.total() / kps.size[0]);
 
             // (tl_x, tl_y, w, h, re_x, re_y, le_x, le_y, nt_x, nt_y, rcm_x, rcm_y, lcm_x, lcm_y, score)
             // 'tl': top left point of the bounding box
@@ -276,6 +378,7 @@ private:
     float scoreThreshold;
     float nmsThreshold;
     const std::vector<int> strides;
+    std::vector<Mat> batch_canvases;
 };
 #endif
 
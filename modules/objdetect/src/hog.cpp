@@ -331,7 +331,24 @@ void HOGDescriptor::computeGradient(InputArray _img, InputOutputArray _grad, Inp
 
 #if CV_SIMD128
     typedef const uchar* const T;
-    float *lutPrev, *lutCurr, *lutNext;
+    float *lutPrev = 0, *lutCurr = 0, *lutNext = 0;
+    if (cn == 1)
+    {
+        // Single channel rows are passed through the lut once and kept in a circular buffer
+        // of 3 rows, so the derivatives are plain vector differences of the buffered rows
+        lutPrev = lutBuf+widthP2*0;
+        lutCurr = lutBuf+widthP2*1;
+        lutNext = lutBuf+widthP2*2;
+
+        const uchar* imgPtr  = img.ptr(ymap[0]);
+        const uchar* prevPtr = img.data + img.step*ymap[-1];
+        for( x = -1; x < width + 1; x++ )
+        {
+            lutPrev[x+1] = lut[prevPtr[xmap[x]]];
+            lutCurr[x+1] = lut[imgPtr[xmap[x]]];
+        }
+    }
+    else
     {
         y = 0;
         const uchar* imgPtr  = img.ptr(ymap[y]);
@@ -400,7 +417,28 @@ void HOGDescriptor::computeGradient(InputArray _img, InputOutputArray _grad, Inp
 
         if( cn == 1 )
         {
-            for( x = 0; x < width; x++ )
+            x = 0;
+#if CV_SIMD128
+            for( int k = -1; k < width + 1; k++ )
+                lutNext[k+1] = lut[nextPtr[xmap[k]]];
+
+            for( ; x <= width - 4; x += 4 )
+            {
+                v_store(dbuf + x, v_sub(v_load(lutCurr + x + 2), v_load(lutCurr + x)));
+                v_store(dbuf + x + width, v_sub(v_load(lutNext + x + 1), v_load(lutPrev + x + 1)));
+            }
+            for( ; x < width; x++ )
+            {
+                dbuf[x] = lutCurr[x+2] - lutCurr[x];
+                dbuf[width + x] = lutNext[x+1] - lutPrev[x+1];
+            }
+
+            float* lutTmp = lutPrev;
+            lutPrev = lutCurr;
+            lutCurr = lutNext;
+            lutNext = lutTmp;
+#endif
+            for( ; x < width; x++ )
             {
                 int x1 = xmap[x];
                 dbuf[x] = (float)(lut[imgPtr[xmap[x+1]]] - lut[imgPtr[xmap[x-1]]]);
@@ -602,8 +640,7 @@ struct HOGCache
     {
         size_t gradOfs, qangleOfs;
         int histOfs[4];
-        float histWeights[4];
-        float gradWeight;
+        float histWeights[4]; // cell interpolation weights multiplied by the gaussian window weight
     };
 
     HOGCache();
@@ -619,6 +656,9 @@ struct HOGCache
     Rect getWindow(const Size& imageSize, const Size& winStride, int idx) const;
 
     const float* getBlock(Point pt, float* buf);
+    // block at cachePt (in cacheStride units, padding included) stored in the cacheRow row of the cache
+    const float* getCachedBlock(Point cachePt, int cacheRow);
+    void computeBlock(Point pt, float* blockHist);
     virtual void normalizeBlockHistogram(float* histogram) const;
 
     std::vector<PixData> pixData;
@@ -850,7 +890,8 @@ void HOGCache::init(const HOGDescriptor* _descriptor,
             }
             data->gradOfs = (grad.cols*i + j)*2;
             data->qangleOfs = (qangle.cols*i + j)*2;
-            data->gradWeight = weights(i,j);
+            for( int w = 0; w < 4; w++ )
+                data->histWeights[w] *= weights(i,j);
         }
 
     CV_Assert( count1 + count2 + count4 == rawBlockSize );
@@ -903,6 +944,32 @@ const float* HOGCache::getBlock(Point pt, float* buf)
         computedFlag = (uchar)1; // set it at once, before actual computing
     }
 
+    computeBlock(pt, blockHist);
+    return blockHist;
+}
+
+const float* HOGCache::getCachedBlock(Point cachePt, int cacheRow)
+{
+    int y = cachePt.y*cacheStride.height;
+    if( y != ymaxCached[cacheRow] )
+    {
+        Mat_<uchar> cacheRowFlags = blockCacheFlags.row(cacheRow);
+        cacheRowFlags = (uchar)0;
+        ymaxCached[cacheRow] = y;
+    }
+
+    float* blockHist = &blockCache[cacheRow][cachePt.x*blockHistogramSize];
+    uchar& computedFlag = blockCacheFlags(cacheRow, cachePt.x);
+    if( computedFlag == 0 )
+    {
+        computedFlag = (uchar)1;
+        computeBlock(Point(cachePt.x*cacheStride.width, y), blockHist);
+    }
+    return blockHist;
+}
+
+void HOGCache::computeBlock(Point pt, float* blockHist)
+{
     int k, C1 = count1, C2 = count2, C4 = count4;
     const float* gradPtr = grad.ptr<float>(pt.y) + pt.x*2;
     const uchar* qanglePtr = qangle.ptr(pt.y) + pt.x*2;
@@ -916,7 +983,7 @@ const float* HOGCache::getBlock(Point pt, float* buf)
     {
         const PixData& pk = _pixData[k];
         const float* const a = gradPtr + pk.gradOfs;
-        float w = pk.gradWeight*pk.histWeights[0];
+        float w = pk.histWeights[0];
         const uchar* h = qanglePtr + pk.qangleOfs;
         int h0 = h[0], h1 = h[1];
 
@@ -936,7 +1003,7 @@ const float* HOGCache::getBlock(Point pt, float* buf)
         int h0 = h[0], h1 = h[1];
 
         v_float32x4 _a0 = v_setall_f32(a[0]), _a1 = v_setall_f32(a[1]);
-        v_float32x4 w = v_mul(v_setall_f32(pk.gradWeight), v_load(pk.histWeights));
+        v_float32x4 w = v_load(pk.histWeights);
         v_float32x4 _t0 = v_mul(_a0, w), _t1 = v_mul(_a1, w);
 
         v_store(hist0, _t0);
@@ -962,13 +1029,13 @@ const float* HOGCache::getBlock(Point pt, float* buf)
         int h0 = h[0], h1 = h[1];
 
         float* hist = blockHist + pk.histOfs[0];
-        w = pk.gradWeight*pk.histWeights[0];
+        w = pk.histWeights[0];
         t0 = hist[h0] + a0*w;
         t1 = hist[h1] + a1*w;
         hist[h0] = t0; hist[h1] = t1;
 
         hist = blockHist + pk.histOfs[1];
-        w = pk.gradWeight*pk.histWeights[1];
+        w = pk.histWeights[1];
         t0 = hist[h0] + a0*w;
         t1 = hist[h1] + a1*w;
         hist[h0] = t0; hist[h1] = t1;
@@ -984,7 +1051,7 @@ const float* HOGCache::getBlock(Point pt, float* buf)
         int h0 = h[0], h1 = h[1];
 
         v_float32x4 _a0 = v_setall_f32(a[0]), _a1 = v_setall_f32(a[1]);
-        v_float32x4 w = v_mul(v_setall_f32(pk.gradWeight), v_load(pk.histWeights));
+        v_float32x4 w = v_load(pk.histWeights);
         v_float32x4 _t0 = v_mul(_a0, w), _t1 = v_mul(_a1, w);
 
         v_store(hist0, _t0);
@@ -1020,25 +1087,25 @@ const float* HOGCache::getBlock(Point pt, float* buf)
         int h0 = h[0], h1 = h[1];
 
         float* hist = blockHist + pk.histOfs[0];
-        w = pk.gradWeight*pk.histWeights[0];
+        w = pk.histWeights[0];
         t0 = hist[h0] + a0*w;
         t1 = hist[h1] + a1*w;
         hist[h0] = t0; hist[h1] = t1;
 
         hist = blockHist + pk.histOfs[1];
-        w = pk.gradWeight*pk.histWeights[1];
+        w = pk.histWeights[1];
         t0 = hist[h0] + a0*w;
         t1 = hist[h1] + a1*w;
         hist[h0] = t0; hist[h1] = t1;
 
         hist = blockHist + pk.histOfs[2];
-        w = pk.gradWeight*pk.histWeights[2];
+        w = pk.histWeights[2];
         t0 = hist[h0] + a0*w;
         t1 = hist[h1] + a1*w;
         hist[h0] = t0; hist[h1] = t1;
 
         hist = blockHist + pk.histOfs[3];
-        w = pk.gradWeight*pk.histWeights[3];
+        w = pk.histWeights[3];
         t0 = hist[h0] + a0*w;
         t1 = hist[h1] + a1*w;
         hist[h0] = t0; hist[h1] = t1;
@@ -1046,8 +1113,6 @@ const float* HOGCache::getBlock(Point pt, float* buf)
 #endif
 
     normalizeBlockHistogram(blockHist);
-
-    return blockHist;
 }
 
 void HOGCache::normalizeBlockHistogram(float* _hist) const
@@ -1561,6 +1626,18 @@ void HOGDescriptor::detect(InputArray _img,
     double rho = svmDetector.size() > dsize ? svmDetector[dsize] : 0;
     std::vector<float> blockHist(blockHistogramSize);
 
+    // When scanning the image grid the windows and their blocks are aligned to the cache grid,
+    // so the cached blocks are addressed through offsets precomputed in cacheStride units
+    std::vector<Point> blockCacheOfs;
+    if( cache.useCache )
+    {
+        blockCacheOfs.resize(nblocks);
+        for( int j = 0; j < nblocks; j++ )
+            blockCacheOfs[j] = Point(blockData[j].imgOffset.x/cacheStride.width,
+                                     blockData[j].imgOffset.y/cacheStride.height);
+    }
+    const int cacheRows = cache.blockCache.rows;
+
 #if CV_SIMD128
     float partSum[4];
 #endif
@@ -1583,13 +1660,27 @@ void HOGDescriptor::detect(InputArray _img,
         double s = rho;
         const float* svmVec = &svmDetector[0];
 
+        Point cachePt0;
+        int cacheRow0 = 0;
+        if( cache.useCache )
+        {
+            cachePt0 = Point((pt0.x + padding.width)/cacheStride.width, (pt0.y + padding.height)/cacheStride.height);
+            cacheRow0 = cachePt0.y % cacheRows;
+        }
+
         int j, k;
         for( j = 0; j < nblocks; j++, svmVec += blockHistogramSize )
         {
-            const HOGCache::BlockData& bj = blockData[j];
-            Point pt = pt0 + bj.imgOffset;
-
-            const float* vec = cache.getBlock(pt, &blockHist[0]);
+            const float* vec;
+            if( cache.useCache )
+            {
+                int cacheRow = cacheRow0 + blockCacheOfs[j].y;
+                if( cacheRow >= cacheRows )
+                    cacheRow -= cacheRows;
+                vec = cache.getCachedBlock(cachePt0 + blockCacheOfs[j], cacheRow);
+            }
+            else
+                vec = cache.getBlock(pt0 + blockData[j].imgOffset, &blockHist[0]);
 #if CV_SIMD128
             v_float32x4 _vec = v_load(vec);
             v_float32x4 _svmVec = v_load(svmVec);
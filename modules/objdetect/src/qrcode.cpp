@@ -165,17 +165,15 @@ void QRDetect::init(const Mat& src, double eps_vertical_, double eps_horizontal_
         resized_bin_barcode.release();
 }
 
-vector<Vec3d> QRDetect::searchHorizontalLines()
+static void searchHorizontalLinesInRows(const Mat& bin_barcode, double eps_vertical,
+                                        int y_begin, int y_end, vector<Vec3d>& result)
 {
-    CV_TRACE_FUNCTION();
-    vector<Vec3d> result;
-    const int height_bin_barcode = bin_barcode.rows;
     const int width_bin_barcode  = bin_barcode.cols;
     const size_t test_lines_size = 5;
     double test_lines[test_lines_size];
     vector<size_t> pixels_position;
 
-    for (int y = 0; y < height_bin_barcode; y++)
+    for (int y = y_begin; y < y_end; y++)
     {
         pixels_position.clear();
         const uint8_t *bin_barcode_row = bin_barcode.ptr<uint8_t>(y);
@@ -227,6 +225,29 @@ vector<Vec3d> QRDetect::searchHorizontalLines()
             }
         }
     }
+}
+
+vector<Vec3d> QRDetect::searchHorizontalLines()
+{
+    CV_TRACE_FUNCTION();
+    // The rows are scanned by horizontal stripes in parallel,
+    // the lines of the stripes are then gathered in the row order
+    const int height_bin_barcode = bin_barcode.rows;
+    const int stripe_height = 64;
+    const int nstripes = divUp(height_bin_barcode, stripe_height);
+    vector< vector<Vec3d> > stripe_lines(nstripes);
+    parallel_for_(Range(0, nstripes), [&](const Range& range)
+    {
+        for (int s = range.start; s < range.end; s++)
+        {
+            searchHorizontalLinesInRows(bin_barcode, eps_vertical, s * stripe_height,
+                                        std::min((s + 1) * stripe_height, height_bin_barcode), stripe_lines[s]);
+        }
+    });
+
+    vector<Vec3d> result;
+    for (int s = 0; s < nstripes; s++)
+        result.insert(result.end(), stripe_lines[s].begin(), stripe_lines[s].end());
     return result;
 }
 
@@ -275,79 +296,90 @@ vector<Point2f> QRDetect::separateVerticalLines(const vector<Vec3d> &list_lines)
 vector<Point2f> QRDetect::extractVerticalLines(const vector<Vec3d> &list_lines, double eps)
 {
     CV_TRACE_FUNCTION();
-    vector<Vec3d> result;
-    vector<double> test_lines; test_lines.reserve(6);
-
-    for (size_t pnt = 0; pnt < list_lines.size(); pnt++)
+    // every line is checked independently, in parallel, and the accepted ones are gathered in order
+    vector<uchar> accepted(list_lines.size(), 0);
+    parallel_for_(Range(0, (int)list_lines.size()), [&](const Range& range)
     {
-        const int x = cvRound(list_lines[pnt][0] + list_lines[pnt][2] * 0.5);
-        const int y = cvRound(list_lines[pnt][1]);
+        vector<double> test_lines; test_lines.reserve(6);
 
-        // --------------- Search vertical up-lines --------------- //
+        for (int pnt = range.start; pnt < range.end; pnt++)
+        {
+            const int x = cvRound(list_lines[pnt][0] + list_lines[pnt][2] * 0.5);
+            const int y = cvRound(list_lines[pnt][1]);
 
-        test_lines.clear();
-        uint8_t future_pixel_up = 255;
+            // --------------- Search vertical up-lines --------------- //
 
-        int temp_length_up = 0;
-        for (int j = y; j < bin_barcode.rows - 1; j++)
-        {
-            uint8_t next_pixel = bin_barcode.ptr<uint8_t>(j + 1)[x];
-            temp_length_up++;
-            if (next_pixel == future_pixel_up)
+            test_lines.clear();
+            uint8_t future_pixel_up = 255;
+
+            int temp_length_up = 0;
+            for (int j = y; j < bin_barcode.rows - 1; j++)
             {
-                future_pixel_up = static_cast<uint8_t>(~future_pixel_up);
-                test_lines.push_back(temp_length_up);
-                temp_length_up = 0;
-                if (test_lines.size() == 3)
-                    break;
+                uint8_t next_pixel = bin_barcode.ptr<uint8_t>(j + 1)[x];
+                temp_length_up++;
+                if (next_pixel == future_pixel_up)
+                {
+                    future_pixel_up = static_cast<uint8_t>(~future_pixel_up);
+                    test_lines.push_back(temp_length_up);
+                    temp_length_up = 0;
+                    if (test_lines.size() == 3)
+                        break;
+                }
             }
-        }
 
-        // --------------- Search vertical down-lines --------------- //
+            // --------------- Search vertical down-lines --------------- //
 
-        int temp_length_down = 0;
-        uint8_t future_pixel_down = 255;
-        for (int j = y; j >= 1; j--)
-        {
-            uint8_t next_pixel = bin_barcode.ptr<uint8_t>(j - 1)[x];
-            temp_length_down++;
-            if (next_pixel == future_pixel_down)
+            int temp_length_down = 0;
+            uint8_t future_pixel_down = 255;
+            for (int j = y; j >= 1; j--)
             {
-                future_pixel_down = static_cast<uint8_t>(~future_pixel_down);
-                test_lines.push_back(temp_length_down);
-                temp_length_down = 0;
-                if (test_lines.size() == 6)
-                    break;
+                uint8_t next_pixel = bin_barcode.ptr<uint8_t>(j - 1)[x];
+                temp_length_down++;
+                if (next_pixel == future_pixel_down)
+                {
+                    future_pixel_down = static_cast<uint8_t>(~future_pixel_down);
+                    test_lines.push_back(temp_length_down);
+                    temp_length_down = 0;
+                    if (test_lines.size() == 6)
+                        break;
+                }
             }
-        }
 
-        // --------------- Compute vertical lines --------------- //
+            // --------------- Compute vertical lines --------------- //
 
-        if (test_lines.size() == 6)
-        {
-            double length = 0.0, weight = 0.0;  // TODO avoid 'double' calculations
+            if (test_lines.size() == 6)
+            {
+                double length = 0.0, weight = 0.0;  // TODO avoid 'double' calculations
 
-            for (size_t i = 0; i < test_lines.size(); i++)
-                length += test_lines[i];
+                for (size_t i = 0; i < test_lines.size(); i++)
+                    length += test_lines[i];
 
-            CV_Assert(length > 0);
-            for (size_t i = 0; i < test_lines.size(); i++)
-            {
-                if (i % 3 != 0)
+                CV_Assert(length > 0);
+                for (size_t i = 0; i < test_lines.size(); i++)
                 {
-                    weight += fabs((test_lines[i] / length) - 1.0/ 7.0);
+                    if (i % 3 != 0)
+                    {
+                        weight += fabs((test_lines[i] / length) - 1.0/ 7.0);
+                    }
+                    else
+                    {
+                        weight += fabs((test_lines[i] / length) - 3.0/14.0);
+                    }
                 }
-                else
+
+                if (weight < eps)
                 {
-                    weight += fabs((test_lines[i] / length) - 3.0/14.0);
+                    accepted[pnt] = 1;
                 }
             }
-
-            if (weight < eps)
-            {
-                result.push_back(list_lines[pnt]);
-            }
         }
+    });
+
+    vector<Vec3d> result;
+    for (size_t pnt = 0; pnt < list_lines.size(); pnt++)
+    {
+        if (accepted[pnt])
+            result.push_back(list_lines[pnt]);
     }
 
     vector<Point2f> point2f_result;
@@ -1015,6 +1047,10 @@ class QRDecode
 public:
     QRDecode(bool useAlignmentMarkers);
     void init(const Mat &src, const vector<Point2f> &points);
+    // same as init() for an image already binarized by binarize(), the binary image is only read,
+    // so one binarization may be shared by the decoders of all the codes found in an image
+    void initBinarized(const Mat &bin_src, const vector<Point2f> &points);
+    static void binarize(const Mat &src, Mat &bin_src);
     Mat getIntermediateBarcode() { return intermediate; }
     Mat getStraightBarcode() { return straight; }
     size_t getVersion() { return version; }
@@ -1075,7 +1111,7 @@ protected:
     bool preparingCurvedQRCodes();
 
     const static int NUM_SIDES = 2;
-    Mat original, bin_barcode, no_border_intermediate, intermediate, straight, curved_to_straight, test_image;
+    Mat bin_barcode, no_border_intermediate, intermediate, straight, curved_to_straight;
     vector<Point2f> original_points;
     Mat homography;
     vector<Point2f> original_curved_points;
@@ -1132,15 +1168,26 @@ float static getMinSideLen(const vector<Point2f> &points) {
 }
 
 
+void QRDecode::binarize(const Mat &src, Mat &bin_src)
+{
+    CV_TRACE_FUNCTION();
+    adaptiveThreshold(src, bin_src, 255, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY, 83, 2);
+}
+
 void QRDecode::init(const Mat &src, const vector<Point2f> &points)
 {
     CV_TRACE_FUNCTION();
-    vector<Point2f> bbox = points;
-    original = src.clone();
-    test_image = src.clone();
-    adaptiveThreshold(original, bin_barcode, 255, ADAPTIVE_THRESH_GAUSSIAN_C, THRESH_BINARY, 83, 2);
-    intermediate = Mat::zeros(original.size(), CV_8UC1);
-    original_points = bbox;
+    Mat bin_src;
+    binarize(src, bin_src);
+    initBinarized(bin_src, points);
+}
+
+void QRDecode::initBinarized(const Mat &bin_src, const vector<Point2f> &points)
+{
+    CV_TRACE_FUNCTION();
+    bin_barcode = bin_src;
+    intermediate.release();
+    original_points = points;
     version = 0;
     version_size = 0;
     test_perspective_size = max(getMinSideLen(points)+1.f, 251.f);
@@ -3433,6 +3480,85 @@ bool QRDetectMulti::compareSquare::operator()(const Vec3i& a, const Vec3i& b) co
            fabs((b1.x - b0.x) * (b2.y - b0.y) - (b2.x - b0.x) * (b1.y - b0.y));
 }
 
+// Labels the points which are closer than 10 pixels to each other, visiting the pairs (i, j >= i)
+// in the same order as a full double loop would, but only among the points of the neighbouring
+// cells of a 10 pixels grid. Returns the number of labels.
+static int groupNearPoints(const vector<Point2f>& points, vector<int>& labels)
+{
+    const double max_distance = 10.;
+    const size_t npoints = points.size();
+    labels.assign(npoints, -1);
+    if (npoints == 0)
+        return 0;
+
+    std::map<std::pair<int, int>, vector<int> > cells;
+    vector<std::pair<int, int> > point_cells(npoints);
+    for (size_t i = 0; i < npoints; i++)
+    {
+        point_cells[i] = std::make_pair(cvFloor(points[i].x / max_distance), cvFloor(points[i].y / max_distance));
+        cells[point_cells[i]].push_back((int)i);
+    }
+
+    int num_labels = 0;
+    vector<int> neighbours;
+    for (size_t i = 0; i + 1 < npoints; i++)
+    {
+        neighbours.clear();
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                std::map<std::pair<int, int>, vector<int> >::const_iterator it =
+                        cells.find(std::make_pair(point_cells[i].first + dx, point_cells[i].second + dy));
+                if (it == cells.end())
+                    continue;
+                for (size_t k = 0; k < it->second.size(); k++)
+                {
+                    if (it->second[k] >= (int)i)
+                        neighbours.push_back(it->second[k]);
+                }
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+
+        for (size_t k = 0; k < neighbours.size(); k++)
+        {
+            const size_t j = neighbours[k];
+            double points_distance = norm(points[i] - points[j]);
+            if (points_distance <= max_distance)
+            {
+                if ((labels[i] == -1) && (labels[j] == -1))
+                {
+                    labels[i] = num_labels;
+                    labels[j] = num_labels;
+                    num_labels++;
+                }
+                else if (labels[i] != -1)
+                    labels[j] = labels[i];
+                else if (labels[j] != -1)
+                    labels[i] = labels[j];
+            }
+        }
+    }
+    for (size_t i = 0; i < npoints; i++)
+    {
+        if (labels[i] == -1)
+        {
+            labels[i] = num_labels;
+            num_labels++;
+        }
+    }
+    return num_labels;
+}
+
+static int groupNearPoints(const vector<Point2f>& points, Mat& labels)
+{
+    vector<int> point_labels;
+    const int num_labels = groupNearPoints(points, point_labels);
+    Mat(point_labels, true).copyTo(labels);
+    return num_labels;
+}
+
 int QRDetectMulti::findNumberLocalizationPoints(vector<Point2f>& tmp_localization_points)
 {
     size_t number_possible_purpose = 1;
@@ -3485,38 +3611,7 @@ int QRDetectMulti::findNumberLocalizationPoints(vector<Point2f>& tmp_localizatio
                     break;
             }
             vector<int> index_list_lines_y;
-            for (size_t i = 0; i < list_lines_y.size(); i++)
-                index_list_lines_y.push_back(-1);
-            num_points = 0;
-            for (size_t i = 0; i < list_lines_y.size() - 1; i++)
-            {
-                for (size_t j = i; j < list_lines_y.size(); j++ )
-                {
-
-                    double points_distance = norm(list_lines_y[i] - list_lines_y[j]);
-                    if (points_distance <= 10)
-                    {
-                        if ((index_list_lines_y[i] == -1) && (index_list_lines_y[j] == -1))
-                        {
-                            index_list_lines_y[i] = num_points;
-                            index_list_lines_y[j] = num_points;
-                            num_points++;
-                        }
-                        else if (index_list_lines_y[i] != -1)
-                            index_list_lines_y[j] = index_list_lines_y[i];
-                        else if (index_list_lines_y[j] != -1)
-                            index_list_lines_y[i] = index_list_lines_y[j];
-                    }
-                }
-            }
-            for (size_t i = 0; i < index_list_lines_y.size(); i++)
-            {
-                if (index_list_lines_y[i] == -1)
-                {
-                    index_list_lines_y[i] = num_points;
-                    num_points++;
-                }
-            }
+            num_points = groupNearPoints(list_lines_y, index_list_lines_y);
             if ((tmp_num_points < num_points) && (k == 1))
             {
                 purpose = UNCHANGED;
@@ -3561,10 +3656,21 @@ int QRDetectMulti::findNumberLocalizationPoints(vector<Point2f>& tmp_localizatio
     if (num_points < 3)
         return num_points;
 
+    // The groups of near points are a good partition already, when there are as many as expected
+    // they seed a single k-means run instead of as many k-means++ attempts as points to find
     Mat labels;
-    kmeans(list_lines_y, num_points, labels,
-            TermCriteria( TermCriteria::EPS + TermCriteria::COUNT, 10, 0.1),
-            num_points, KMEANS_PP_CENTERS, tmp_localization_points);
+    if (groupNearPoints(list_lines_y, labels) == num_points)
+    {
+        kmeans(list_lines_y, num_points, labels,
+                TermCriteria( TermCriteria::EPS + TermCriteria::COUNT, 10, 0.1),
+                1, KMEANS_USE_INITIAL_LABELS, tmp_localization_points);
+    }
+    else
+    {
+        kmeans(list_lines_y, num_points, labels,
+                TermCriteria( TermCriteria::EPS + TermCriteria::COUNT, 10, 0.1),
+                num_points, KMEANS_PP_CENTERS, tmp_localization_points);
+    }
     bin_barcode_temp = bin_barcode.clone();
     if (purpose == SHRINKING)
     {
@@ -3619,9 +3725,12 @@ void QRDetectMulti::findQRCodeContours(vector<Point2f>& tmp_localization_points,
     int count_contours = num_qrcodes;
     if (all_contours_points.size() < size_t(num_qrcodes))
         count_contours = (int)all_contours_points.size();
+    // a few attempts are enough, their number does not grow with the number of codes,
+    // as every attempt goes through all the contour points for every code
+    const int contours_attempts = std::min(count_contours, 3);
     kmeans(all_contours_points, count_contours, qrcode_labels,
           TermCriteria( TermCriteria::EPS + TermCriteria::COUNT, 10, 0.1),
-          count_contours, KMEANS_PP_CENTERS, clustered_localization_points);
+          contours_attempts, KMEANS_PP_CENTERS, clustered_localization_points);
 
     vector< vector< Point2f > > qrcode_clusters(count_contours);
     for (int i = 0; i < count_contours; i++)
@@ -3849,9 +3958,13 @@ bool QRDetectMulti::computeTransformationPoints(const size_t cur_ind)
 
     vector<Point> locations, non_zero_elem[3], newHull;
     vector<Point2f> new_non_zero_elem[3];
+    // The mask is shared by the 3 patterns: only the bounding box of every filled region
+    // is scanned for the pattern points, and cleared afterwards
+    Mat mask = Mat::zeros(bin_barcode.rows + 2, bin_barcode.cols + 2, CV_8UC1);
+    const Rect mask_roi_rect(0, 0, bin_barcode.cols - 2, bin_barcode.rows - 2);
     for (size_t i = 0; i < 3 ; i++)
     {
-        Mat mask = Mat::zeros(bin_barcode.rows + 2, bin_barcode.cols + 2, CV_8UC1);
+        Rect filled_rect;
         uint8_t next_pixel, future_pixel = 255;
         int localization_point_x = cvRound(localization_points[cur_ind][i].x);
         int localization_point_y = cvRound(localization_points[cur_ind][i].y);
@@ -3869,14 +3982,21 @@ bool QRDetectMulti::computeTransformationPoints(const size_t cur_ind)
                     // TODO avoid drawing functions
                     floodFill(bin_barcode, mask,
                             Point(index + 1, localization_point_y), 255,
-                            0, Scalar(), Scalar(), FLOODFILL_MASK_ONLY);
+                            &filled_rect, Scalar(), Scalar(), FLOODFILL_MASK_ONLY);
                     break;
                 }
             }
 
         }
-        Mat mask_roi = mask(Range(1, bin_barcode.rows - 1), Range(1, bin_barcode.cols - 1));
-        findNonZero(mask_roi, non_zero_elem[i]);
+        const Rect roi = filled_rect & mask_roi_rect;
+        if (!roi.empty())
+        {
+            findNonZero(mask(roi + Point(1, 1)), non_zero_elem[i]);
+            for (size_t k = 0; k < non_zero_elem[i].size(); k++)
+                non_zero_elem[i][k] += roi.tl();
+        }
+        if (!filled_rect.empty())
+            mask(filled_rect + Point(1, 1)).setTo(Scalar::all(0));
         newHull.insert(newHull.end(), non_zero_elem[i].begin(), non_zero_elem[i].end());
     }
     convexHull(newHull, locations);
@@ -4001,59 +4121,38 @@ bool ImplContour::detectMulti(InputArray in, OutputArray points) const {
 class ParallelDecodeProcess : public ParallelLoopBody
 {
 public:
-    ParallelDecodeProcess(Mat& inarr_, vector<QRDecode>& qrdec_, vector<std::string>& decoded_info_,
-            vector<Mat>& straight_barcode_, vector< vector< Point2f > >& src_points_)
-        : inarr(inarr_), qrdec(qrdec_), decoded_info(decoded_info_)
+    ParallelDecodeProcess(const Mat& bin_inarr_, vector<QRDecode>& qrdec_, vector<std::string>& decoded_info_,
+            vector<Mat>& straight_barcode_, vector< vector< Point2f > >& src_points_,
+            vector<uchar>& decoded_, const vector<int>& indexes_)
+        : bin_inarr(bin_inarr_), qrdec(qrdec_), decoded_info(decoded_info_)
         , straight_barcode(straight_barcode_), src_points(src_points_)
+        , decoded(decoded_), indexes(indexes_)
     {
         // nothing
     }
     void operator()(const Range& range) const CV_OVERRIDE
     {
-        for (int i = range.start; i < range.end; i++)
+        for (int k = range.start; k < range.end; k++)
         {
-            qrdec[i].init(inarr, src_points[i]);
-            bool ok = qrdec[i].straightDecodingProcess();
-            if (ok)
+            const int i = indexes[k];
+            qrdec[i].initBinarized(bin_inarr, src_points[i]);
+            decoded[i] = qrdec[i].straightDecodingProcess();
+            if (decoded[i])
             {
                 decoded_info[i] = qrdec[i].getDecodeInformation();
                 straight_barcode[i] = qrdec[i].getStraightBarcode();
             }
-            else if (std::min(inarr.size().width, inarr.size().height) > 512)
-            {
-                const int min_side = std::min(inarr.size().width, inarr.size().height);
-                qrdec[i].coeff_expansion = min_side / 512.f;
-                const int width  = cvRound(inarr.size().width  / qrdec[i].coeff_expansion);
-                const int height = cvRound(inarr.size().height / qrdec[i].coeff_expansion);
-                Size new_size(width, height);
-                Mat inarr2;
-                resize(inarr, inarr2, new_size, 0, 0, INTER_AREA);
-                for (size_t j = 0ull; j < 4ull; j++)
-                {
-                    src_points[i][j] /= qrdec[i].coeff_expansion;
-                }
-                qrdec[i].init(inarr2, src_points[i]);
-                ok = qrdec[i].straightDecodingProcess();
-                if (ok)
-                {
-                    decoded_info[i] = qrdec[i].getDecodeInformation();
-                    straight_barcode[i] = qrdec[i].getStraightBarcode();
-                    for (size_t j = 0ull; j < qrdec[i].alignment_coords.size(); j++)
-                        qrdec[i].alignment_coords[j] *= qrdec[i].coeff_expansion;
-                }
-            }
-            if (decoded_info[i].empty())
-                decoded_info[i] = "";
         }
     }
 
 private:
-    Mat& inarr;
+    const Mat& bin_inarr;
     vector<QRDecode>& qrdec;
     vector<std::string>& decoded_info;
     vector<Mat>& straight_barcode;
     vector< vector< Point2f > >& src_points;
-
+    vector<uchar>& decoded;
+    const vector<int>& indexes;
 };
 
 bool ImplContour::decodeMulti(
@@ -4083,8 +4182,53 @@ bool ImplContour::decodeMulti(
     vector<QRDecode> qrdec(src_points.size(), useAlignmentMarkers);
     vector<Mat> straight_barcode(src_points.size());
     vector<std::string> info(src_points.size());
-    ParallelDecodeProcess parallelDecodeProcess(inarr, qrdec, info, straight_barcode, src_points);
-    parallel_for_(Range(0, int(src_points.size())), parallelDecodeProcess);
+    vector<uchar> decoded_ok(src_points.size(), 0);
+
+    // The binarization of the whole image is the most expensive part of the decoding,
+    // so it is done once and shared by the decoders running in parallel on every code
+    Mat bin_inarr;
+    QRDecode::binarize(inarr, bin_inarr);
+    vector<int> indexes(src_points.size());
+    for (size_t i = 0; i < indexes.size(); i++)
+        indexes[i] = (int)i;
+    ParallelDecodeProcess parallelDecodeProcess(bin_inarr, qrdec, info, straight_barcode, src_points, decoded_ok, indexes);
+    parallel_for_(Range(0, int(indexes.size())), parallelDecodeProcess);
+
+    // the codes which could not be decoded are retried on a downscaled image, binarized once as well
+    const int min_side = std::min(inarr.size().width, inarr.size().height);
+    vector<int> failed;
+    for (size_t i = 0; i < decoded_ok.size(); i++)
+    {
+        if (!decoded_ok[i])
+            failed.push_back((int)i);
+    }
+    if (min_side > 512 && !failed.empty())
+    {
+        const float coeff_expansion = min_side / 512.f;
+        const int width  = cvRound(inarr.size().width  / coeff_expansion);
+        const int height = cvRound(inarr.size().height / coeff_expansion);
+        Mat inarr2, bin_inarr2;
+        resize(inarr, inarr2, Size(width, height), 0, 0, INTER_AREA);
+        QRDecode::binarize(inarr2, bin_inarr2);
+        for (size_t k = 0; k < failed.size(); k++)
+        {
+            const int i = failed[k];
+            qrdec[i].coeff_expansion = coeff_expansion;
+            for (size_t j = 0ull; j < 4ull; j++)
+                src_points[i][j] /= coeff_expansion;
+        }
+        ParallelDecodeProcess parallelRetryProcess(bin_inarr2, qrdec, info, straight_barcode, src_points, decoded_ok, failed);
+        parallel_for_(Range(0, int(failed.size())), parallelRetryProcess);
+        for (size_t k = 0; k < failed.size(); k++)
+        {
+            QRDecode& dec = qrdec[failed[k]];
+            if (decoded_ok[failed[k]])
+            {
+                for (size_t j = 0ull; j < dec.alignment_coords.size(); j++)
+                    dec.alignment_coords[j] *= dec.coeff_expansion;
+            }
+        }
+    }
     vector<Mat> for_copy;
     for (size_t i = 0; i < straight_barcode.size(); i++)
     {
@@ -638,6 +638,87 @@ TEST(CV_ArucoDetectMarkers, regression_contour_24220)
     }
 }
 
+TEST(CV_ArucoDetectMarkers, identify_matches_dictionary_with_bit_errors)
+{
+    const aruco::PredefinedDictionaryType dictionaries[] = {
+        aruco::DICT_4X4_1000, aruco::DICT_5X5_100, aruco::DICT_6X6_1000, aruco::DICT_7X7_250,
+        aruco::DICT_APRILTAG_36h11, aruco::DICT_ARUCO_MIP_36h12 };
+    RNG rng(0x4152);
+    const int markerSide = 100;
+    for (size_t d = 0; d < sizeof(dictionaries) / sizeof(dictionaries[0]); d++)
+    {
+        const aruco::Dictionary dictionary = aruco::getPredefinedDictionary(dictionaries[d]);
+        aruco::ArucoDetector detector(dictionary);
+        const double errorCorrectionRate = detector.getDetectorParameters().errorCorrectionRate;
+        for (int k = 0; k < 20; k++)
+        {
+            const int id = rng.uniform(0, dictionary.bytesList.rows);
+            Mat bits = aruco::Dictionary::getBitsFromByteList(dictionary.bytesList.row(id), dictionary.markerSize);
+            // from no error to a bit more than what can be corrected
+            const int errors = rng.uniform(0, dictionary.maxCorrectionBits + 3);
+            for (int e = 0; e < errors; e++)
+            {
+                uchar& bit = bits.ptr<uchar>()[rng.uniform(0, (int)bits.total())];
+                bit = !bit;
+            }
+            int expectedId = -1, expectedRotation = -1;
+            dictionary.identify(bits, expectedId, expectedRotation, errorCorrectionRate);
+
+            Mat marker, img(2 * markerSide, 2 * markerSide, CV_8UC1, Scalar::all(255));
+            aruco::Dictionary(aruco::Dictionary::getByteListFromBits(bits), dictionary.markerSize)
+                .generateImageMarker(0, markerSide, marker);
+            marker.copyTo(img(Rect(markerSide / 2, markerSide / 2, markerSide, markerSide)));
+
+            vector<vector<Point2f> > corners;
+            vector<int> ids;
+            detector.detectMarkers(img, corners, ids);
+            if (expectedId < 0)
+                EXPECT_TRUE(ids.empty()) << "dictionary " << (int)dictionaries[d] << " id " << id << " errors " << errors;
+            else
+            {
+                ASSERT_EQ(1u, ids.size()) << "dictionary " << (int)dictionaries[d] << " id " << id << " errors " << errors;
+                EXPECT_EQ(expectedId, ids[0]) << "dictionary " << (int)dictionaries[d] << " id " << id << " errors " << errors;
+            }
+        }
+    }
+}
+
+TEST(CV_ArucoDetectMarkers, track_markers_in_moving_frames)
+{
+    aruco::ArucoDetector detector(aruco::getPredefinedDictionary(aruco::DICT_6X6_250));
+    aruco::DetectorParameters params = detector.getDetectorParameters();
+    params.trackingRedetectionPeriod = 5;
+    detector.setDetectorParameters(params);
+
+    const int markerSide = 60;
+    Mat marker1, marker2;
+    aruco::generateImageMarker(detector.getDictionary(), 17, markerSide, marker1);
+    aruco::generateImageMarker(detector.getDictionary(), 42, markerSide, marker2);
+    for (int frame = 0; frame < 16; frame++)
+    {
+        Mat img(480, 640, CV_8UC1, Scalar::all(255));
+        marker1.copyTo(img(Rect(40 + 6 * frame, 50 + 4 * frame, markerSide, markerSide)));
+        // the second marker is lost at frame 7, which triggers a full detection, and comes back
+        // at frame 13, when the full detection is due after 5 tracked frames
+        if (frame < 7 || frame >= 13)
+            marker2.copyTo(img(Rect(400 - 5 * frame, 300 - 3 * frame, markerSide, markerSide)));
+
+        vector<vector<Point2f> > corners, trackedCorners;
+        vector<int> ids, trackedIds;
+        detector.detectMarkers(img, corners, ids);
+        detector.trackMarkers(img, trackedCorners, trackedIds);
+
+        ASSERT_EQ(ids.size(), trackedIds.size()) << "frame " << frame;
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            size_t j = std::find(trackedIds.begin(), trackedIds.end(), ids[i]) - trackedIds.begin();
+            ASSERT_LT(j, trackedIds.size()) << "frame " << frame << " id " << ids[i];
+            for (int c = 0; c < 4; c++)
+                EXPECT_LE(cv::norm(corners[i][c] - trackedCorners[j][c]), 0.5) << "frame " << frame << " id " << ids[i];
+        }
+    }
+}
+
 
 struct ArucoThreading: public testing::TestWithParam<aruco::CornerRefineMethod>
 {
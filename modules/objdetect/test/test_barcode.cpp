@@ -144,4 +144,87 @@ TEST(BarcodeDetector_base, invalid)
     EXPECT_ANY_THROW(bardet.decodeMulti(zero_image, corners, decoded_info));
 }
 
+// Draw EAN-13 bars of the 13 digits code, module is the width of the thinnest bar
+static void drawEAN13(Mat &img, Point tl, const string &code, int module, int height)
+{
+    static const char *L_CODES[] = {"0001101", "0011001", "0010011", "0111101", "0100011",
+                                    "0110001", "0101111", "0111011", "0110111", "0001011"};
+    static const char *PARITIES[] = {"LLLLLL", "LLGLGG", "LLGGLG", "LLGGGL", "LGLLGG",
+                                     "LGGLLG", "LGGGLL", "LGLGLG", "LGLGGL", "LGGLGL"};
+    ASSERT_EQ(13u, code.size());
+    string bars = "101";
+    for (int i = 1; i < 13; i++)
+    {
+        const string l_code = L_CODES[code[i] - '0'];
+        string r_code;
+        for (char c : l_code)
+            r_code += (c == '0') ? '1' : '0';
+        if (i == 7)
+            bars += "01010";
+        if (i >= 7)
+            bars += r_code;
+        else if (PARITIES[code[0] - '0'][i - 1] == 'G')
+            bars += string(r_code.rbegin(), r_code.rend());
+        else
+            bars += l_code;
+    }
+    bars += "101";
+    for (size_t i = 0; i < bars.size(); i++)
+    {
+        if (bars[i] == '1')
+            rectangle(img, Rect(tl.x + int(i) * module, tl.y, module, height), Scalar::all(0), FILLED);
+    }
+}
+
+TEST(BarcodeDetector_frames, regression)
+{
+    const string codes[] = {"9787115279460", "6922255451427", "6921168509256"};
+    barcode::BarcodeDetector det;
+    RNG rng(12345);
+    for (int frame = 0; frame < 6; frame++)
+    {
+        // the first code moves during the first frames and then stops, the other ones stay
+        const int shift = std::min(frame, 3) * 20;
+        Mat img(720, 1280, CV_8UC3, Scalar::all(230));
+        drawEAN13(img, Point(80 + shift, 60), codes[0], 3, 200);
+        drawEAN13(img, Point(700, 60), codes[1], 3, 200);
+        drawEAN13(img, Point(380, 400), codes[2], 3, 200);
+        Mat noise(img.size(), CV_8UC3);
+        rng.fill(noise, RNG::UNIFORM, 0, 4);
+        img -= noise;
+
+        vector<string> lines, types, frame_lines, frame_types;
+        vector<Point2f> points, frame_points;
+        ASSERT_TRUE(det.detectAndDecodeWithType(img, lines, types, points));
+        ASSERT_TRUE(det.detectAndDecodeFrame(img, frame_lines, frame_types, frame_points)) << "frame " << frame;
+        EXPECT_EQ(toSet(vector<string>(codes, codes + 3)), toSet(frame_lines)) << "frame " << frame;
+        EXPECT_EQ(toSet(lines), toSet(frame_lines)) << "frame " << frame;
+        EXPECT_EQ(toSet(types), toSet(frame_types)) << "frame " << frame;
+        EXPECT_EQ(points.size(), frame_points.size()) << "frame " << frame;
+    }
+
+    det.resetFrames();
+    vector<string> lines, types;
+    EXPECT_FALSE(det.detectAndDecodeFrame(Mat(720, 1280, CV_8UC1, Scalar::all(230)), lines, types));
+    EXPECT_TRUE(lines.empty());
+}
+
+TEST(BarcodeDetector_frames, size_change)
+{
+    // both frames have the same localization image, but not the same corner coordinates
+    Mat img(720, 1280, CV_8UC1, Scalar::all(230)), big;
+    drawEAN13(img, Point(380, 260), "9787115279460", 3, 200);
+    resize(img, big, Size(), 2, 2, INTER_NEAREST);
+
+    barcode::BarcodeDetector det;
+    vector<string> lines, types;
+    vector<Point2f> points, big_points, frame_points;
+    ASSERT_TRUE(det.detectAndDecodeFrame(img, lines, types, points));
+    ASSERT_TRUE(det.detectAndDecodeWithType(big, lines, types, big_points));
+    ASSERT_TRUE(det.detectAndDecodeFrame(big, lines, types, frame_points));
+    ASSERT_EQ(big_points.size(), frame_points.size());
+    for (size_t i = 0; i < big_points.size(); i++)
+        EXPECT_LE(cv::norm(big_points[i] - frame_points[i]), 1.) << i;
+}
+
 }} // opencv_test::<anonymous>::
@@ -1335,6 +1335,41 @@ TEST(Objdetect_HOGDetector_Strict, accuracy)
     }
 }
 
+TEST(Objdetect_HOGDetector, grid_scan_matches_explicit_locations)
+{
+    HOGDescriptor hog;
+    hog.setSVMDetector(HOGDescriptor::getDefaultPeopleDetector());
+
+    RNG& rng = cvtest::TS::ptr()->get_rng();
+    for (int cn = 1; cn <= 3; cn += 2)
+    {
+        Mat image(150, 101, CV_8UC(cn)), smoothed;
+        rng.fill(image, RNG::UNIFORM, 0, 256);
+        GaussianBlur(image, smoothed, Size(5, 5), 1.5);
+
+        const Size winStride(8, 8), padding(16, 16);
+        std::vector<Point> hits;
+        std::vector<double> weights;
+        hog.detect(smoothed, hits, weights, -100., winStride, padding);
+
+        std::vector<Point> locations;
+        for (int y = -padding.height; y <= smoothed.rows + padding.height - hog.winSize.height; y += winStride.height)
+            for (int x = -padding.width; x <= smoothed.cols + padding.width - hog.winSize.width; x += winStride.width)
+                locations.push_back(Point(x, y));
+        std::vector<Point> refHits;
+        std::vector<double> refWeights;
+        hog.detect(smoothed, refHits, refWeights, -100., winStride, padding, locations);
+
+        ASSERT_EQ(locations.size(), hits.size()) << "cn=" << cn;
+        ASSERT_EQ(refHits.size(), hits.size()) << "cn=" << cn;
+        for (size_t i = 0; i < hits.size(); i++)
+        {
+            EXPECT_EQ(refHits[i], hits[i]) << "cn=" << cn << " i=" << i;
+            EXPECT_DOUBLE_EQ(refWeights[i], weights[i]) << "cn=" << cn << " i=" << i;
+        }
+    }
+}
+
 TEST(Objdetect_CascadeDetector, small_img)
 {
     String root = cvtest::TS::ptr()->get_data_path() + "cascadeandhog/cascades/";
@@ -144,6 +144,97 @@ TEST(Objdetect_face_detection, regression)
     }
 }
 
+// reports one "face" covering the image, so that the generic batch detection can be checked without a model
+class ImageSizeFaceDetector : public FaceDetectorYN
+{
+public:
+    void setInputSize(const Size& input_size) CV_OVERRIDE { inputSize = input_size; }
+    Size getInputSize() CV_OVERRIDE { return inputSize; }
+    void setScoreThreshold(float) CV_OVERRIDE {}
+    float getScoreThreshold() CV_OVERRIDE { return 0.f; }
+    void setNMSThreshold(float) CV_OVERRIDE {}
+    float getNMSThreshold() CV_OVERRIDE { return 0.f; }
+    void setTopK(int) CV_OVERRIDE {}
+    int getTopK() CV_OVERRIDE { return 0; }
+    int detect(InputArray image, OutputArray faces) CV_OVERRIDE
+    {
+        Mat img = image.getMat();
+        if (img.empty())
+        {
+            faces.release();
+            return 1;
+        }
+        Mat result(1, 15, CV_32FC1, Scalar::all(0));
+        result.at<float>(0, 2) = (float)img.cols;
+        result.at<float>(0, 3) = (float)img.rows;
+        result.at<float>(0, 14) = (float)mean(img)[0];
+        result.copyTo(faces);
+        return 1;
+    }
+
+    Size inputSize;
+};
+
+TEST(Objdetect_face_detection, batch_default_implementation)
+{
+    std::vector<Mat> images(3);
+    images[0].create(120, 160, CV_8UC3);
+    images[1].create(50, 40, CV_8UC3);
+    randu(images[0], Scalar::all(0), Scalar::all(255));
+    randu(images[1], Scalar::all(0), Scalar::all(255));
+
+    ImageSizeFaceDetector detector;
+    std::vector<Mat> batchFaces;
+    detector.detectBatch(images, batchFaces);
+    ASSERT_EQ(images.size(), batchFaces.size());
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        Mat faces;
+        detector.detect(images[i], faces);
+        ASSERT_EQ(faces.size(), batchFaces[i].size()) << "image " << i;
+        if (!faces.empty())
+        {
+            EXPECT_EQ(0, cvtest::norm(faces, batchFaces[i], NORM_INF)) << "image " << i;
+        }
+    }
+}
+
+TEST(Objdetect_face_detection, batch_matches_single_detection)
+{
+    std::string model = findDataFile("dnn/onnx/models/yunet-202303.onnx", false);
+    Mat image = imread(findDataFile("cascadeandhog/images/lena.png"));
+    ASSERT_FALSE(image.empty());
+    Mat flipped, half;
+    flip(image, flipped, 1);
+    resize(image, half, Size(), 0.5, 0.5, INTER_AREA);
+
+    Ptr<FaceDetectorYN> faceDetector = FaceDetectorYN::create(model, "", image.size());
+    std::vector<Mat> images = { image, flipped, half };
+    std::vector<Mat> batchFaces;
+    faceDetector->detectBatch(images, batchFaces);
+    ASSERT_EQ(images.size(), batchFaces.size());
+
+    // images of the input size are not resized, the results are the same as with detect()
+    for (size_t i = 0; i < 2; i++)
+    {
+        Mat faces;
+        faceDetector->detect(images[i], faces);
+        ASSERT_EQ(faces.rows, batchFaces[i].rows) << "image " << i;
+        EXPECT_LE(cvtest::norm(faces, batchFaces[i], NORM_INF), 1e-2) << "image " << i;
+    }
+
+    // the smaller image is upscaled into the input, the faces are reported in its own coordinates
+    ASSERT_EQ(batchFaces[0].rows, batchFaces[2].rows);
+    for (int i = 0; i < batchFaces[0].rows; i++)
+    {
+        Rect2f box(batchFaces[0].at<float>(i, 0) * 0.5f, batchFaces[0].at<float>(i, 1) * 0.5f,
+                   batchFaces[0].at<float>(i, 2) * 0.5f, batchFaces[0].at<float>(i, 3) * 0.5f);
+        Rect2f halfBox(batchFaces[2].at<float>(i, 0), batchFaces[2].at<float>(i, 1),
+                       batchFaces[2].at<float>(i, 2), batchFaces[2].at<float>(i, 3));
+        EXPECT_GE((box & halfBox).area() / (box | halfBox).area(), 0.7) << "face " << i;
+    }
+}
+
 TEST(Objdetect_face_recognition, regression)
 {
     // Pre-set params
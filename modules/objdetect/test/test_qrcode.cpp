@@ -679,4 +679,37 @@ TEST(Objdetect_QRCode_detect, detect_regression_22892)
     EXPECT_EQ(corners.size(), 4U);
 }
 
+
+TEST(Objdetect_QRCode_detectAndDecodeMulti, synthetic_grid)
+{
+    // codes generated on a white canvas, several of them per row and column
+    Ptr<QRCodeEncoder> encoder = QRCodeEncoder::create();
+    const Size grids[] = {Size(2, 1), Size(3, 2), Size(4, 3), Size(5, 4)};
+    for (const Size& grid : grids)
+    {
+        const int cell = 200, module = 5;
+        Mat src(grid.height * cell, grid.width * cell, CV_8UC1, Scalar::all(255));
+        std::set<std::string> expected;
+        for (int i = 0; i < grid.area(); i++)
+        {
+            const std::string text = format("grid %dx%d, code %d", grid.width, grid.height, i);
+            Mat qr;
+            encoder->encode(text, qr);
+            ASSERT_FALSE(qr.empty());
+            resize(qr, qr, Size(), module, module, INTER_NEAREST);
+            ASSERT_LT(qr.cols, cell);
+            const Point tl((i % grid.width) * cell + (cell - qr.cols) / 2, (i / grid.width) * cell + (cell - qr.rows) / 2);
+            qr.copyTo(src(Rect(tl, qr.size())));
+            expected.insert(text);
+        }
+
+        QRCodeDetector qrcode;
+        std::vector<cv::String> decoded_info;
+        std::vector<Point2f> corners;
+        EXPECT_TRUE(qrcode.detectAndDecodeMulti(src, decoded_info, corners));
+        EXPECT_EQ(expected, std::set<std::string>(decoded_info.begin(), decoded_info.end())) << "grid " << grid;
+        EXPECT_EQ(4u * grid.area(), corners.size()) << "grid " << grid;
+    }
+}
+
 }} // namespace
@@ -93,23 +93,29 @@ namespace cv
 enum
 {
     INPAINT_NS    = 0, //!< Use Navier-Stokes based method
-    INPAINT_TELEA = 1 //!< Use the algorithm proposed by Alexandru Telea @cite Telea04
+    INPAINT_TELEA = 1, //!< Use the algorithm proposed by Alexandru Telea @cite Telea04
+    INPAINT_PATCHMATCH = 2 //!< Fill the region with patches of the image found by PatchMatch @cite Barnes09, coarse to fine
 };
 
 /** @brief Restores the selected region in an image using the region neighborhood.
 
 @param src Input 8-bit, 16-bit unsigned or 32-bit float 1-channel or 8-bit 3-channel image.
+cv::INPAINT_PATCHMATCH also accepts these depths with up to 4 channels.
 @param inpaintMask Inpainting mask, 8-bit 1-channel image. Non-zero pixels indicate the area that
 needs to be inpainted.
 @param dst Output image with the same size and type as src .
 @param inpaintRadius Radius of a circular neighborhood of each point inpainted that is considered
-by the algorithm.
-@param flags Inpainting method that could be cv::INPAINT_NS or cv::INPAINT_TELEA
+by the algorithm. For cv::INPAINT_PATCHMATCH it is the radius of the square patches.
+@param flags Inpainting method that could be cv::INPAINT_NS, cv::INPAINT_TELEA or cv::INPAINT_PATCHMATCH
 
 The function reconstructs the selected image area from the pixel near the area boundary. The
 function may be used to remove dust and scratches from a scanned photo, or to remove undesirable
 objects from still images or video. See <http://en.wikipedia.org/wiki/Inpainting> for more details.
 
+cv::INPAINT_NS and cv::INPAINT_TELEA propagate the boundary inwards, which is suited to thin
+regions; separate regions are processed in parallel. cv::INPAINT_PATCHMATCH copies texture from
+the rest of the image and is better suited to large regions.
+
 @note
    -   An example using the inpainting technique can be found at
         opencv_source_code/samples/cpp/inpaint.cpp
@@ -284,6 +290,74 @@ CV_EXPORTS_W void fastNlMeansDenoisingColoredMulti( InputArrayOfArrays srcImgs,
         float h = 3, float hColor = 3,
         int templateWindowSize = 7, int searchWindowSize = 21);
 
+/** @brief Temporal denoiser for video streams based on fastNlMeansDenoisingMulti.
+
+Every frame passed to apply() is denoised using itself and up to temporalWindowSize - 1 preceding
+frames, so the output is produced without latency. The preceding frames are kept in a ring buffer
+together with their border-extended copies, so each call only has to prepare the newly pushed
+frame instead of the whole temporal window.
+
+If the optical flow to the previous frame is passed to apply(), it is accumulated along the buffer
+and the preceding frames are warped onto the current one before denoising. This keeps moving
+objects from being blurred and allows a smaller search window on panning cameras. The flow can be
+computed with any dense method, e.g. DISOpticalFlow of the video module. The alignment of every
+preceding frame changes with each new flow, so such a call resamples and border-extends all the
+buffered frames again; calls without flow reuse the buffered copies.
+ */
+class CV_EXPORTS_W FastNlMeansVideoDenoiser : public Algorithm
+{
+public:
+    /** @brief Adds a frame to the temporal window and denoises it.
+
+    @param frame Input 8-bit or 16-bit (only with NORM_L1) 1-channel, 2-channel, 3-channel or
+    4-channel frame. If its size or type differs from the previous frame, the denoiser is reset.
+    @param dst Denoised frame with the same size and type as frame.
+
+    The frame is assumed to be aligned with the previous one.
+     */
+    CV_WRAP virtual void apply(InputArray frame, OutputArray dst) = 0;
+
+    /** @overload
+
+    @param frame Input frame, see above.
+    @param flow CV_32FC2 flow from frame to the previous frame: the pixel (x, y) of frame is at
+    (x, y) + flow(y, x) in the previous frame, as computed by DenseOpticalFlow::calc(frame,
+    previousFrame, flow). Empty if the frames are aligned.
+    @param dst Denoised frame with the same size and type as frame.
+     */
+    CV_WRAP virtual void apply(InputArray frame, InputArray flow, OutputArray dst) = 0;
+
+    /** @brief Drops the buffered frames, e.g. on a scene cut. */
+    CV_WRAP virtual void reset() = 0;
+
+    CV_WRAP virtual float getH() const = 0;
+    CV_WRAP virtual void setH(float h) = 0;
+
+    CV_WRAP virtual int getTemporalWindowSize() const = 0;
+    CV_WRAP virtual void setTemporalWindowSize(int temporalWindowSize) = 0;
+
+    CV_WRAP virtual int getTemplateWindowSize() const = 0;
+    CV_WRAP virtual void setTemplateWindowSize(int templateWindowSize) = 0;
+
+    CV_WRAP virtual int getSearchWindowSize() const = 0;
+    CV_WRAP virtual void setSearchWindowSize(int searchWindowSize) = 0;
+};
+
+/** @brief Creates FastNlMeansVideoDenoiser object
+
+@param h Parameter regulating filter strength, see fastNlMeansDenoisingMulti.
+@param temporalWindowSize Number of frames, including the current one, used to denoise each frame.
+@param templateWindowSize Size in pixels of the template patch that is used to compute weights.
+Should be odd.
+@param searchWindowSize Size in pixels of the window that is used to compute weighted average for
+given pixel. Should be odd.
+@param normType Type of norm used for weight calculation. Can be either NORM_L2 or NORM_L1
+ */
+CV_EXPORTS_W Ptr<FastNlMeansVideoDenoiser>
+createFastNlMeansVideoDenoiser(float h = 3, int temporalWindowSize = 5,
+                               int templateWindowSize = 7, int searchWindowSize = 21,
+                               int normType = NORM_L2);
+
 /** @brief Primal-dual algorithm is an algorithm for solving special types of variational problems (that is,
 finding a function to minimize some functional). As the image denoising, in particular, may be seen
 as the variational problem, primal-dual algorithm then can be used to perform denoising and this is
@@ -45,6 +45,8 @@
 #include "fast_nlmeans_multi_denoising_invoker.hpp"
 #include "fast_nlmeans_denoising_opencl.hpp"
 
+#include <deque>
+
 template<typename ST, typename IT, typename UIT, typename D>
 static void fastNlMeansDenoising_( const Mat& src, Mat& dst, const std::vector<float>& h,
                                    int templateWindowSize, int searchWindowSize)
@@ -241,62 +243,61 @@ static void fastNlMeansDenoisingMultiCheckPreconditions(
 }
 
 template<typename ST, typename IT, typename UIT, typename D>
-static void fastNlMeansDenoisingMulti_( const std::vector<Mat>& srcImgs, Mat& dst,
-                                        int imgToDenoiseIndex, int temporalWindowSize,
-                                        const std::vector<float>& h,
+static void fastNlMeansDenoisingMulti_( const std::vector<Mat>& extendedSrcs, Mat& dst,
+                                        int imgToDenoiseIndex, const std::vector<float>& h,
                                         int templateWindowSize, int searchWindowSize)
 {
     int hn = (int)h.size();
     double granularity = (double)std::max(1., (double)dst.total()/(1 << 16));
 
-    switch (srcImgs[0].type())
+    switch (extendedSrcs[0].type())
     {
         case CV_8U:
-            parallel_for_(cv::Range(0, srcImgs[0].rows),
+            parallel_for_(cv::Range(0, dst.rows),
                           FastNlMeansMultiDenoisingInvoker<uchar, IT, UIT, D, int>(
-                              srcImgs, imgToDenoiseIndex, temporalWindowSize,
+                              extendedSrcs, imgToDenoiseIndex,
                               dst, templateWindowSize, searchWindowSize, &h[0]),
                           granularity);
             break;
         case CV_8UC2:
             if (hn == 1)
-                parallel_for_(cv::Range(0, srcImgs[0].rows),
+                parallel_for_(cv::Range(0, dst.rows),
                               FastNlMeansMultiDenoisingInvoker<Vec<ST, 2>, IT, UIT, D, int>(
-                                  srcImgs, imgToDenoiseIndex, temporalWindowSize,
+                                  extendedSrcs, imgToDenoiseIndex,
                                   dst, templateWindowSize, searchWindowSize, &h[0]),
                               granularity);
             else
-                parallel_for_(cv::Range(0, srcImgs[0].rows),
+                parallel_for_(cv::Range(0, dst.rows),
                               FastNlMeansMultiDenoisingInvoker<Vec<ST, 2>, IT, UIT, D, Vec2i>(
-                                  srcImgs, imgToDenoiseIndex, temporalWindowSize,
+                                  extendedSrcs, imgToDenoiseIndex,
                                   dst, templateWindowSize, searchWindowSize, &h[0]),
                               granularity);
             break;
         case CV_8UC3:
             if (hn == 1)
-                parallel_for_(cv::Range(0, srcImgs[0].rows),
+                parallel_for_(cv::Range(0, dst.rows),
                               FastNlMeansMultiDenoisingInvoker<Vec<ST, 3>, IT, UIT, D, int>(
-                                  srcImgs, imgToDenoiseIndex, temporalWindowSize,
+                                  extendedSrcs, imgToDenoiseIndex,
                                   dst, templateWindowSize, searchWindowSize, &h[0]),
                               granularity);
             else
-                parallel_for_(cv::Range(0, srcImgs[0].rows),
+                parallel_for_(cv::Range(0, dst.rows),
                               FastNlMeansMultiDenoisingInvoker<Vec<ST, 3>, IT, UIT, D, Vec3i>(
-                                  srcImgs, imgToDenoiseIndex, temporalWindowSize,
+                                  extendedSrcs, imgToDenoiseIndex,
                                   dst, templateWindowSize, searchWindowSize, &h[0]),
                               granularity);
             break;
         case CV_8UC4:
             if (hn == 1)
-                parallel_for_(cv::Range(0, srcImgs[0].rows),
+                parallel_for_(cv::Range(0, dst.rows),
                               FastNlMeansMultiDenoisingInvoker<Vec<ST, 4>, IT, UIT, D, int>(
-                                  srcImgs, imgToDenoiseIndex, temporalWindowSize,
+                                  extendedSrcs, imgToDenoiseIndex,
                                   dst, templateWindowSize, searchWindowSize, &h[0]),
                               granularity);
             else
-                parallel_for_(cv::Range(0, srcImgs[0].rows),
+                parallel_for_(cv::Range(0, dst.rows),
                               FastNlMeansMultiDenoisingInvoker<Vec<ST, 4>, IT, UIT, D, Vec4i>(
-                                  srcImgs, imgToDenoiseIndex, temporalWindowSize,
+                                  extendedSrcs, imgToDenoiseIndex,
                                   dst, templateWindowSize, searchWindowSize, &h[0]),
                               granularity);
             break;
@@ -316,35 +317,22 @@ void cv::fastNlMeansDenoisingMulti( InputArrayOfArrays _srcImgs, OutputArray _ds
                               std::vector<float>(1, h), templateWindowSize, searchWindowSize);
 }
 
-void cv::fastNlMeansDenoisingMulti( InputArrayOfArrays _srcImgs, OutputArray _dst,
-                                    int imgToDenoiseIndex, int temporalWindowSize,
-                                    const std::vector<float>& h,
-                                    int templateWindowSize, int searchWindowSize, int normType)
+static void fastNlMeansDenoisingMultiExtended( const std::vector<Mat>& extendedSrcs, Mat& dst,
+                                               int imgToDenoiseIndex, const std::vector<float>& h,
+                                               int templateWindowSize, int searchWindowSize,
+                                               int normType )
 {
-    CV_INSTRUMENT_REGION();
-
-    std::vector<Mat> srcImgs;
-    _srcImgs.getMatVector(srcImgs);
-
-    fastNlMeansDenoisingMultiCheckPreconditions(
-        srcImgs, imgToDenoiseIndex,
-        temporalWindowSize, templateWindowSize, searchWindowSize);
-
     int hn = (int)h.size();
-    int type = srcImgs[0].type(), depth = CV_MAT_DEPTH(type), cn = CV_MAT_CN(type);
+    int type = extendedSrcs[0].type(), depth = CV_MAT_DEPTH(type), cn = CV_MAT_CN(type);
     CV_Assert(hn == 1 || hn == cn);
 
-    _dst.create(srcImgs[0].size(), srcImgs[0].type());
-    Mat dst = _dst.getMat();
-
     switch (normType) {
         case NORM_L2:
             switch (depth) {
                 case CV_8U:
                     fastNlMeansDenoisingMulti_<uchar, int, unsigned,
-                                               DistSquared>(srcImgs, dst,
-                                                            imgToDenoiseIndex, temporalWindowSize,
-                                                            h,
+                                               DistSquared>(extendedSrcs, dst,
+                                                            imgToDenoiseIndex, h,
                                                             templateWindowSize, searchWindowSize);
                     break;
                 default:
@@ -356,16 +344,14 @@ void cv::fastNlMeansDenoisingMulti( InputArrayOfArrays _srcImgs, OutputArray _ds
             switch (depth) {
                 case CV_8U:
                     fastNlMeansDenoisingMulti_<uchar, int, unsigned,
-                                               DistAbs>(srcImgs, dst,
-                                                        imgToDenoiseIndex, temporalWindowSize,
-                                                        h,
+                                               DistAbs>(extendedSrcs, dst,
+                                                        imgToDenoiseIndex, h,
                                                         templateWindowSize, searchWindowSize);
                     break;
                 case CV_16U:
                     fastNlMeansDenoisingMulti_<ushort, int64, uint64,
-                                               DistAbs>(srcImgs, dst,
-                                                        imgToDenoiseIndex, temporalWindowSize,
-                                                        h,
+                                               DistAbs>(extendedSrcs, dst,
+                                                        imgToDenoiseIndex, h,
                                                         templateWindowSize, searchWindowSize);
                     break;
                 default:
@@ -379,6 +365,33 @@ void cv::fastNlMeansDenoisingMulti( InputArrayOfArrays _srcImgs, OutputArray _ds
     }
 }
 
+void cv::fastNlMeansDenoisingMulti( InputArrayOfArrays _srcImgs, OutputArray _dst,
+                                    int imgToDenoiseIndex, int temporalWindowSize,
+                                    const std::vector<float>& h,
+                                    int templateWindowSize, int searchWindowSize, int normType)
+{
+    CV_INSTRUMENT_REGION();
+
+    std::vector<Mat> srcImgs;
+    _srcImgs.getMatVector(srcImgs);
+
+    fastNlMeansDenoisingMultiCheckPreconditions(
+        srcImgs, imgToDenoiseIndex,
+        temporalWindowSize, templateWindowSize, searchWindowSize);
+
+    int temporalWindowHalfSize = temporalWindowSize / 2;
+    std::vector<Mat> extendedSrcs(temporalWindowSize);
+    for (int i = 0; i < temporalWindowSize; i++)
+        extendMultiDenoisingFrame(srcImgs[imgToDenoiseIndex - temporalWindowHalfSize + i], extendedSrcs[i],
+                                  templateWindowSize, searchWindowSize);
+
+    _dst.create(srcImgs[0].size(), srcImgs[0].type());
+    Mat dst = _dst.getMat();
+
+    fastNlMeansDenoisingMultiExtended(extendedSrcs, dst, temporalWindowHalfSize, h,
+                                      templateWindowSize, searchWindowSize, normType);
+}
+
 void cv::fastNlMeansDenoisingColoredMulti( InputArrayOfArrays _srcImgs, OutputArray _dst,
                                            int imgToDenoiseIndex, int temporalWindowSize,
                                            float h, float hForColorComponents,
@@ -439,3 +452,181 @@ void cv::fastNlMeansDenoisingColoredMulti( InputArrayOfArrays _srcImgs, OutputAr
 
     cvtColor(dst_lab, dst, COLOR_Lab2LBGR);
 }
+
+namespace cv
+{
+
+class FastNlMeansVideoDenoiserImpl CV_FINAL : public FastNlMeansVideoDenoiser
+{
+public:
+    FastNlMeansVideoDenoiserImpl(float _h, int _temporalWindowSize, int _templateWindowSize,
+                                 int _searchWindowSize, int _normType) :
+        name("FastNlMeansVideoDenoiser"),
+        h(_h),
+        temporalWindowSize(0),
+        templateWindowSize(0),
+        searchWindowSize(0),
+        normType(_normType)
+    {
+        CV_Assert(normType == NORM_L2 || normType == NORM_L1);
+        setTemporalWindowSize(_temporalWindowSize);
+        setTemplateWindowSize(_templateWindowSize);
+        setSearchWindowSize(_searchWindowSize);
+    }
+
+    void apply(InputArray _frame, OutputArray _dst) CV_OVERRIDE
+    {
+        apply(_frame, noArray(), _dst);
+    }
+
+    void apply(InputArray _frame, InputArray _flow, OutputArray _dst) CV_OVERRIDE
+    {
+        CV_INSTRUMENT_REGION();
+
+        Mat frame = _frame.getMat(), flow = _flow.getMat();
+        CV_Assert(!frame.empty() && frame.dims == 2);
+        CV_Assert(flow.empty() || (flow.type() == CV_32FC2 && flow.size() == frame.size()));
+        if (!frames.empty() &&
+            (frames.back().src.size() != frame.size() || frames.back().src.type() != frame.type()))
+            reset();
+
+        // the buffers of the frame leaving the window are reused for the new one
+        BufferedFrame cur;
+        while ((int)frames.size() >= temporalWindowSize)
+        {
+            cur = frames.front();
+            frames.pop_front();
+        }
+        frame.copyTo(cur.src);
+        extendMultiDenoisingFrame(cur.src, cur.extended, templateWindowSize, searchWindowSize);
+        cur.map.release();
+
+        if (!flow.empty() && !frames.empty())
+            alignFrames(flow);
+        frames.push_back(cur);
+
+        std::vector<Mat> window(frames.size());
+        for (size_t i = 0; i < frames.size(); i++)
+            window[i] = frames[i].map.empty() ? frames[i].extended : frames[i].warped;
+
+        _dst.create(frame.size(), frame.type());
+        Mat dst = _dst.getMat();
+        fastNlMeansDenoisingMultiExtended(window, dst, (int)window.size() - 1, std::vector<float>(1, h),
+                                          templateWindowSize, searchWindowSize, normType);
+    }
+
+    void reset() CV_OVERRIDE
+    {
+        frames.clear();
+    }
+
+    float getH() const CV_OVERRIDE { return h; }
+    void setH(float val) CV_OVERRIDE { h = val; }
+
+    int getTemporalWindowSize() const CV_OVERRIDE { return temporalWindowSize; }
+    void setTemporalWindowSize(int val) CV_OVERRIDE
+    {
+        CV_Assert(val >= 1);
+        temporalWindowSize = val;
+    }
+
+    int getTemplateWindowSize() const CV_OVERRIDE { return templateWindowSize; }
+    void setTemplateWindowSize(int val) CV_OVERRIDE
+    {
+        CV_Assert(val > 0 && val % 2 == 1);
+        if (val != templateWindowSize)
+            reset();
+        templateWindowSize = val;
+    }
+
+    int getSearchWindowSize() const CV_OVERRIDE { return searchWindowSize; }
+    void setSearchWindowSize(int val) CV_OVERRIDE
+    {
+        CV_Assert(val > 0 && val % 2 == 1);
+        if (val != searchWindowSize)
+            reset();
+        searchWindowSize = val;
+    }
+
+    void write(FileStorage& fs) const CV_OVERRIDE
+    {
+        writeFormat(fs);
+        fs << "name" << name
+           << "h" << h
+           << "temporalWindowSize" << temporalWindowSize
+           << "templateWindowSize" << templateWindowSize
+           << "searchWindowSize" << searchWindowSize
+           << "normType" << normType;
+    }
+
+    void read(const FileNode& fn) CV_OVERRIDE
+    {
+        FileNode n = fn["name"];
+        CV_Assert(n.isString() && String(n) == name);
+        h = fn["h"];
+        setTemporalWindowSize(fn["temporalWindowSize"]);
+        setTemplateWindowSize(fn["templateWindowSize"]);
+        setSearchWindowSize(fn["searchWindowSize"]);
+        normType = fn["normType"];
+        CV_Assert(normType == NORM_L2 || normType == NORM_L1);
+    }
+
+protected:
+    struct BufferedFrame
+    {
+        Mat src;
+        Mat extended;
+        // position of every pixel of the newest frame in this one, empty if the frames are aligned,
+        // and this frame warped by it and extended
+        Mat map;
+        Mat warped;
+    };
+
+    // flow goes from the new frame to the newest buffered one
+    void alignFrames(const Mat& flow)
+    {
+        Mat map(flow.size(), CV_32FC2);
+        for (int y = 0; y < map.rows; y++)
+        {
+            const Point2f* f = flow.ptr<Point2f>(y);
+            Point2f* m = map.ptr<Point2f>(y);
+            for (int x = 0; x < map.cols; x++)
+                m[x] = Point2f(x + f[x].x, y + f[x].y);
+        }
+
+        // the older frames get the composition of their map with the new one, so every frame is
+        // resampled only once; all the maps change, so all the warped copies are made again
+        Mat composed, warped;
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            if (frames[i].map.empty())
+                map.copyTo(frames[i].map);
+            else
+            {
+                remap(frames[i].map, composed, map, noArray(), INTER_LINEAR, BORDER_REPLICATE);
+                std::swap(frames[i].map, composed);
+            }
+            remap(frames[i].src, warped, frames[i].map, noArray(), INTER_LINEAR, BORDER_REPLICATE);
+            extendMultiDenoisingFrame(warped, frames[i].warped, templateWindowSize, searchWindowSize);
+        }
+    }
+
+    String name;
+    float h;
+    int temporalWindowSize;
+    int templateWindowSize;
+    int searchWindowSize;
+    int normType;
+
+    std::deque<BufferedFrame> frames;
+};
+
+Ptr<FastNlMeansVideoDenoiser> createFastNlMeansVideoDenoiser(float h, int temporalWindowSize,
+                                                            int templateWindowSize, int searchWindowSize,
+                                                            int normType)
+{
+    return makePtr<FastNlMeansVideoDenoiserImpl>(h, temporalWindowSize, templateWindowSize,
+                                                 searchWindowSize, normType);
+}
+
+}
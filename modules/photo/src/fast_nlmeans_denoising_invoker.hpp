@@ -44,12 +44,17 @@
 
 #include "precomp.hpp"
 #include <limits>
+#include "opencv2/core/hal/intrin.hpp"
 
 #include "fast_nlmeans_denoising_invoker_commons.hpp"
-#include "arrays.hpp"
 
 using namespace cv;
 
+// The patch distances are computed by search window offset: for a given offset the distances of
+// all the pixels of a block of rows are box sums over the template window of the per pixel
+// distances between the image and the image shifted by the offset. They are obtained from running
+// column sums and sums along the rows (an integral image of the distances restricted to the block),
+// so every step works on contiguous rows and is vectorized along them.
 template <typename T, typename IT, typename UIT, typename D, typename WT>
 struct FastNlMeansDenoisingInvoker :
         public ParallelLoopBody
@@ -63,10 +68,15 @@ public:
 private:
     void operator= (const FastNlMeansDenoisingInvoker&);
 
+    typedef typename pixelInfo<T>::sampleType ET;
+    static const int cn = pixelInfo<T>::channels;
+    static const int wn = pixelInfo<WT>::channels;
+
     const Mat& src_;
     Mat& dst_;
 
-    Mat extended_src_;
+    // channels of the source image extended by border_size_
+    Mat extended_planes_[cn];
     int border_size_;
 
     int template_window_size_;
@@ -77,18 +87,12 @@ private:
 
     typename pixelInfo<WT>::sampleType fixed_point_mult_;
     int almost_template_window_size_sq_bin_shift_;
-    std::vector<WT> almost_dist2weight_;
-
-    void calcDistSumsForFirstElementInRow(
-        int i, Array2d<int>& dist_sums,
-        Array3d<int>& col_dist_sums,
-        Array3d<int>& up_col_dist_sums) const;
-
-    void calcDistSumsForElementInFirstRow(
-        int i, int j, int first_col_num,
-        Array2d<int>& dist_sums,
-        Array3d<int>& col_dist_sums,
-        Array3d<int>& up_col_dist_sums) const;
+    // weights of every weight channel, one table after another
+    std::vector<int> almost_dist2weight_;
+    int almost_max_dist_;
+
+    void processRows(int row_from, int row_to, std::vector<IT>& estimation,
+                     std::vector<IT>& weights_sum) const;
 };
 
 inline int getNearestPowerOf2(int value)
@@ -99,6 +103,238 @@ inline int getNearestPowerOf2(int value)
     return p;
 }
 
+// ring_row = distances between the rows a and b summed over the channels,
+// col_sums += (new ring_row - old ring_row)
+template <typename ET, typename D, int cn>
+static inline void nlmDistRowScalar(const ET* const* a, const ET* const* b, int* ring_row, int* col_sums, int n)
+{
+    for (int x = 0; x < n; x++)
+    {
+        int dist = 0;
+        for (int c = 0; c < cn; c++)
+            dist += D::template calcDist<ET>(a[c][x], b[c][x]);
+        col_sums[x] += dist - ring_row[x];
+        ring_row[x] = dist;
+    }
+}
+
+template <typename ET, typename D> struct nlmDistRow_
+{
+    template <int cn>
+    static inline void f(const ET* const* a, const ET* const* b, int* ring_row, int* col_sums, int n)
+    {
+        nlmDistRowScalar<ET, D, cn>(a, b, ring_row, col_sums, n);
+    }
+};
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+// the distances are computed in 16-bit lanes, where the operations are native, and widened to be summed
+static inline void nlmVecDist16(DistAbs*, const uchar* a, const uchar* b, v_uint16& d0, v_uint16& d1)
+{
+    v_expand(v_absdiff(vx_load(a), vx_load(b)), d0, d1);
+}
+
+static inline void nlmVecDist16(DistSquared*, const uchar* a, const uchar* b, v_uint16& d0, v_uint16& d1)
+{
+    v_expand(v_absdiff(vx_load(a), vx_load(b)), d0, d1);
+    d0 = v_mul_wrap(d0, d0);
+    d1 = v_mul_wrap(d1, d1);
+}
+
+static inline void nlmUpdateColSums(const v_uint32& dist, int* ring_row, int* col_sums)
+{
+    v_int32 new_dist = v_reinterpret_as_s32(dist);
+    v_store(col_sums, v_add(vx_load(col_sums), v_sub(new_dist, vx_load(ring_row))));
+    v_store(ring_row, new_dist);
+}
+
+template <typename D> struct nlmDistRow_<uchar, D>
+{
+    template <int cn>
+    static inline void f(const uchar* const* a, const uchar* const* b, int* ring_row, int* col_sums, int n)
+    {
+        const int step = VTraits<v_uint8>::vlanes(), step32 = VTraits<v_uint32>::vlanes();
+        int x = 0;
+        for (; x <= n - step; x += step)
+        {
+            v_uint32 dist0 = vx_setzero_u32(), dist1 = vx_setzero_u32(), dist2 = vx_setzero_u32(), dist3 = vx_setzero_u32();
+            for (int c = 0; c < cn; c++)
+            {
+                v_uint16 d0, d1;
+                v_uint32 e0, e1, e2, e3;
+                nlmVecDist16((D*)0, a[c] + x, b[c] + x, d0, d1);
+                v_expand(d0, e0, e1);
+                v_expand(d1, e2, e3);
+                dist0 = v_add(dist0, e0);
+                dist1 = v_add(dist1, e1);
+                dist2 = v_add(dist2, e2);
+                dist3 = v_add(dist3, e3);
+            }
+            nlmUpdateColSums(dist0, ring_row + x, col_sums + x);
+            nlmUpdateColSums(dist1, ring_row + x + step32, col_sums + x + step32);
+            nlmUpdateColSums(dist2, ring_row + x + step32 * 2, col_sums + x + step32 * 2);
+            nlmUpdateColSums(dist3, ring_row + x + step32 * 3, col_sums + x + step32 * 3);
+        }
+        const uchar* a_tail[cn];
+        const uchar* b_tail[cn];
+        for (int c = 0; c < cn; c++)
+        {
+            a_tail[c] = a[c] + x;
+            b_tail[c] = b[c] + x;
+        }
+        nlmDistRowScalar<uchar, D, cn>(a_tail, b_tail, ring_row + x, col_sums + x, n - x);
+    }
+};
+
+// squared 16-bit differences may not fit the 32-bit lanes once summed over the channels
+template <> struct nlmDistRow_<ushort, DistAbs>
+{
+    template <int cn>
+    static inline void f(const ushort* const* a, const ushort* const* b, int* ring_row, int* col_sums, int n)
+    {
+        const int step = VTraits<v_uint16>::vlanes(), step32 = VTraits<v_uint32>::vlanes();
+        int x = 0;
+        for (; x <= n - step; x += step)
+        {
+            v_uint32 dist0 = vx_setzero_u32(), dist1 = vx_setzero_u32();
+            for (int c = 0; c < cn; c++)
+            {
+                v_uint32 e0, e1;
+                v_expand(v_absdiff(vx_load(a[c] + x), vx_load(b[c] + x)), e0, e1);
+                dist0 = v_add(dist0, e0);
+                dist1 = v_add(dist1, e1);
+            }
+            nlmUpdateColSums(dist0, ring_row + x, col_sums + x);
+            nlmUpdateColSums(dist1, ring_row + x + step32, col_sums + x + step32);
+        }
+        const ushort* a_tail[cn];
+        const ushort* b_tail[cn];
+        for (int c = 0; c < cn; c++)
+        {
+            a_tail[c] = a[c] + x;
+            b_tail[c] = b[c] + x;
+        }
+        nlmDistRowScalar<ushort, DistAbs, cn>(a_tail, b_tail, ring_row + x, col_sums + x, n - x);
+    }
+};
+
+static inline v_uint32 nlmVecLoad(const uchar* ptr) { return vx_load_expand_q(ptr); }
+static inline v_uint32 nlmVecLoad(const ushort* ptr) { return vx_load_expand(ptr); }
+#endif
+
+template <typename ET, typename IT> struct nlmAccumulateRow_
+{
+    // estimation += weights * b, weights_sum += weights
+    static inline void f(const int* weights, const ET* b, IT* estimation, IT* weights_sum, bool update_weights_sum, int n)
+    {
+        for (int x = 0; x < n; x++)
+            estimation[x] += (IT)weights[x] * b[x];
+        if (update_weights_sum)
+        {
+            for (int x = 0; x < n; x++)
+                weights_sum[x] += (IT)weights[x];
+        }
+    }
+};
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+template <typename ET> struct nlmAccumulateRowSimd_
+{
+    static inline void f(const int* weights, const ET* b, int* estimation, int* weights_sum, bool update_weights_sum, int n)
+    {
+        const int step = VTraits<v_int32>::vlanes();
+        int x = 0;
+        for (; x <= n - step; x += step)
+        {
+            v_int32 w = vx_load(weights + x);
+            v_store(estimation + x, v_add(vx_load(estimation + x), v_mul(w, v_reinterpret_as_s32(nlmVecLoad(b + x)))));
+            if (update_weights_sum)
+                v_store(weights_sum + x, v_add(vx_load(weights_sum + x), w));
+        }
+        for (; x < n; x++)
+        {
+            estimation[x] += weights[x] * b[x];
+            if (update_weights_sum)
+                weights_sum[x] += weights[x];
+        }
+    }
+};
+
+template <> struct nlmAccumulateRow_<uchar, int> : public nlmAccumulateRowSimd_<uchar> {};
+template <> struct nlmAccumulateRow_<ushort, int> : public nlmAccumulateRowSimd_<ushort> {};
+
+// 16-bit samples weighted by 31-bit weights need 64-bit sums, the weights are never negative
+template <> struct nlmAccumulateRow_<ushort, int64>
+{
+    static inline void f(const int* weights, const ushort* b, int64* estimation, int64* weights_sum, bool update_weights_sum, int n)
+    {
+        const int step = VTraits<v_uint32>::vlanes(), step64 = VTraits<v_uint64>::vlanes();
+        int x = 0;
+        for (; x <= n - step; x += step)
+        {
+            v_uint32 w = v_reinterpret_as_u32(vx_load(weights + x));
+            v_uint64 p0, p1;
+            v_mul_expand(w, vx_load_expand(b + x), p0, p1);
+            v_store(estimation + x, v_add(vx_load(estimation + x), v_reinterpret_as_s64(p0)));
+            v_store(estimation + x + step64, v_add(vx_load(estimation + x + step64), v_reinterpret_as_s64(p1)));
+            if (update_weights_sum)
+            {
+                v_uint64 w0, w1;
+                v_expand(w, w0, w1);
+                v_store(weights_sum + x, v_add(vx_load(weights_sum + x), v_reinterpret_as_s64(w0)));
+                v_store(weights_sum + x + step64, v_add(vx_load(weights_sum + x + step64), v_reinterpret_as_s64(w1)));
+            }
+        }
+        for (; x < n; x++)
+        {
+            estimation[x] += (int64)weights[x] * b[x];
+            if (update_weights_sum)
+                weights_sum[x] += weights[x];
+        }
+    }
+};
+#endif
+
+// weights of the pixels of a row from the column sums of their distances, tables holds table_size weights
+// for every weight channel
+static inline void nlmCalcWeightsRow(const int* col_sums, int tsize, int bin_shift, int table_size,
+                                     const int* tables, int wn, int* dist_indexes, int* weights, int cols)
+{
+    const int max_index = table_size - 1;
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int step = VTraits<v_int32>::vlanes();
+    const v_int32 v_max_index = vx_setall_s32(max_index);
+    for (; x <= cols - step; x += step)
+    {
+        v_int32 dist = vx_load(col_sums + x);
+        for (int k = 1; k < tsize; k++)
+            dist = v_add(dist, vx_load(col_sums + x + k));
+        v_store(dist_indexes + x, v_min(v_shr(dist, bin_shift), v_max_index));
+    }
+#endif
+    for (; x < cols; x++)
+    {
+        int dist = 0;
+        for (int k = 0; k < tsize; k++)
+            dist += col_sums[x + k];
+        dist_indexes[x] = std::min(dist >> bin_shift, max_index);
+    }
+
+    for (int wc = 0; wc < wn; wc++)
+    {
+        const int* table = tables + (size_t)wc * table_size;
+        int* weights_row = weights + (size_t)wc * cols;
+        x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        for (; x <= cols - step; x += step)
+            v_store(weights_row + x, v_lut(table, dist_indexes + x));
+#endif
+        for (; x < cols; x++)
+            weights_row[x] = table[dist_indexes[x]];
+    }
+}
+
 template <typename T, typename IT, typename UIT, typename D, typename WT>
 FastNlMeansDenoisingInvoker<T, IT, UIT, D, WT>::FastNlMeansDenoisingInvoker(
     const Mat& src, Mat& dst,
@@ -115,7 +351,9 @@ FastNlMeansDenoisingInvoker<T, IT, UIT, D, WT>::FastNlMeansDenoisingInvoker(
     search_window_size_        = search_window_half_size_   * 2 + 1;
 
     border_size_ = search_window_half_size_ + template_window_half_size_;
-    copyMakeBorder(src_, extended_src_, border_size_, border_size_, border_size_, border_size_, BORDER_DEFAULT);
+    Mat extended_src;
+    copyMakeBorder(src_, extended_src, border_size_, border_size_, border_size_, border_size_, BORDER_DEFAULT);
+    split(extended_src, extended_planes_);
 
     const IT max_estimate_sum_value =
         (IT)search_window_size_ * (IT)search_window_size_ * (IT)pixelInfo<T>::sampleMax();
@@ -131,13 +369,26 @@ FastNlMeansDenoisingInvoker<T, IT, UIT, D, WT>::FastNlMeansDenoisingInvoker(
 
     int max_dist = D::template maxDist<T>();
     int almost_max_dist = (int)(max_dist / almost_dist2actual_dist_multiplier + 1);
-    almost_dist2weight_.resize(almost_max_dist);
+    std::vector<WT> almost_dist2weight(almost_max_dist);
 
+    // weights decrease with the distance, the tables stop at the first distance where all of them are 0
+    // and the larger distances are clamped to it, so the tables stay small enough for the cache
+    almost_max_dist_ = almost_max_dist;
     for (int almost_dist = 0; almost_dist < almost_max_dist; almost_dist++)
     {
         double dist = almost_dist * almost_dist2actual_dist_multiplier;
-        almost_dist2weight_[almost_dist] =
-            D::template calcWeight<T, WT>(dist, h, fixed_point_mult_);
+        almost_dist2weight[almost_dist] = D::template calcWeight<T, WT>(dist, h, fixed_point_mult_);
+        if (almost_dist2weight[almost_dist] == WT())
+        {
+            almost_max_dist_ = almost_dist + 1;
+            break;
+        }
+    }
+    almost_dist2weight_.resize((size_t)almost_max_dist_ * wn);
+    for (int almost_dist = 0; almost_dist < almost_max_dist_; almost_dist++)
+    {
+        for (int wc = 0; wc < wn; wc++)
+            almost_dist2weight_[(size_t)wc * almost_max_dist_ + almost_dist] = ((const int*)&almost_dist2weight[almost_dist])[wc];
     }
 
     // additional optimization init end
@@ -148,174 +399,115 @@ FastNlMeansDenoisingInvoker<T, IT, UIT, D, WT>::FastNlMeansDenoisingInvoker(
 template <typename T, typename IT, typename UIT, typename D, typename WT>
 void FastNlMeansDenoisingInvoker<T, IT, UIT, D, WT>::operator() (const Range& range) const
 {
-    int row_from = range.start;
-    int row_to = range.end - 1;
-
-    // sums of cols anf rows for current pixel p
-    Array2d<int> dist_sums(search_window_size_, search_window_size_);
-
-    // for lazy calc optimization (sum of cols for current pixel)
-    Array3d<int> col_dist_sums(template_window_size_, search_window_size_, search_window_size_);
-
-    int first_col_num = -1;
-    // last elements of column sum (for each element in row)
-    Array3d<int> up_col_dist_sums(src_.cols, search_window_size_, search_window_size_);
+    // the estimations of a block of rows are kept in cache while all the offsets go through it,
+    // and the block is high enough to amortize the first template window rows of every offset
+    const size_t block_bytes_budget = 1 << 19;
+    const size_t row_bytes = (size_t)src_.cols * (cn + wn) * sizeof(IT);
+    const int block_rows = std::max(template_window_size_, (int)(block_bytes_budget / row_bytes));
+
+    std::vector<IT> estimation, weights_sum;
+    for (int row_from = range.start; row_from < range.end; row_from += block_rows)
+        processRows(row_from, std::min(row_from + block_rows, range.end), estimation, weights_sum);
+}
 
-    for (int i = row_from; i <= row_to; i++)
+template <typename T, typename IT, typename UIT, typename D, typename WT>
+void FastNlMeansDenoisingInvoker<T, IT, UIT, D, WT>::processRows(
+    int row_from, int row_to, std::vector<IT>& estimation, std::vector<IT>& weights_sum) const
+{
+    const int rows = row_to - row_from;
+    const int cols = src_.cols;
+    const int t = template_window_half_size_;
+    const int tsize = template_window_size_;
+    const int s = search_window_half_size_;
+    const size_t plane_size = (size_t)rows * cols;
+
+    estimation.assign(plane_size * cn, (IT)0);
+    weights_sum.assign(plane_size * wn, (IT)0);
+
+    // distances are needed for search_window_half_size_ more pixels on one side
+    // and template_window_half_size_ more on both sides
+    const int max_ext_cols = cols + s + 2 * t;
+    std::vector<int> ring((size_t)tsize * max_ext_cols), col_sums(max_ext_cols);
+    std::vector<int> weights((size_t)wn * (cols + s)), dist_indexes(cols + s);
+
+    const ET* a[cn];
+    const ET* b[cn];
+    // the distance between the patches of p and p + (dx, dy) is also the one between the patches of
+    // p + (dx, dy) and p for the opposite offset, so only half of the offsets are computed, for the
+    // pixels p of the block and the pixels p of the rows above whose p + (dx, dy) is in the block
+    for (int dy = 0; dy <= s; dy++)
     {
-        for (int j = 0; j < src_.cols; j++)
+        for (int dx = dy == 0 ? 0 : -s; dx <= s; dx++)
         {
-            int search_window_y = i - search_window_half_size_;
-            int search_window_x = j - search_window_half_size_;
+            const int x_from = std::min(0, -dx), x_to = cols + std::max(0, -dx);
+            const int n = x_to - x_from, ext_cols = n + 2 * t;
+            const int r_from = row_from - dy;
 
-            // calc dist_sums
-            if (j == 0)
+            std::fill(col_sums.begin(), col_sums.begin() + ext_cols, 0);
+            for (int r = r_from - t; r < row_to + t; r++)
             {
-                calcDistSumsForFirstElementInRow(i, dist_sums, col_dist_sums, up_col_dist_sums);
-                first_col_num = 0;
-            }
-            else
-            {
-                // calc cur dist_sums using previous dist_sums
-                if (i == row_from)
+                // ring row of the image row r, it holds the distances of the row r - tsize before
+                int* ring_row = &ring[(size_t)((r - r_from + t) % tsize) * ext_cols];
+                for (int c = 0; c < cn; c++)
                 {
-                    calcDistSumsForElementInFirstRow(i, j, first_col_num,
-                        dist_sums, col_dist_sums, up_col_dist_sums);
+                    a[c] = extended_planes_[c].template ptr<ET>(border_size_ + r) + border_size_ + x_from - t;
+                    b[c] = extended_planes_[c].template ptr<ET>(border_size_ + r + dy) + border_size_ + x_from - t + dx;
                 }
-                else
+                if (r <= r_from + t)
+                    std::fill(ring_row, ring_row + ext_cols, 0);
+                nlmDistRow_<ET, D>::template f<cn>(a, b, ring_row, &col_sums[0], ext_cols);
+                // rows above the first pixel row only fill the column sums
+                if (r < r_from + t)
+                    continue;
+
+                const int y = r - t;
+                nlmCalcWeightsRow(&col_sums[0], tsize, almost_template_window_size_sq_bin_shift_, almost_max_dist_,
+                                  &almost_dist2weight_[0], wn, &dist_indexes[0], &weights[0], n);
+
+                for (int c = 0; c < cn; c++)
                 {
-                    int ay = border_size_ + i;
-                    int ax = border_size_ + j + template_window_half_size_;
-
-                    int start_by = border_size_ + i - search_window_half_size_;
-                    int start_bx = border_size_ + j - search_window_half_size_ + template_window_half_size_;
-
-                    T a_up = extended_src_.at<T>(ay - template_window_half_size_ - 1, ax);
-                    T a_down = extended_src_.at<T>(ay + template_window_half_size_, ax);
-
-                    // copy class member to local variable for optimization
-                    int search_window_size = search_window_size_;
-
-                    for (int y = 0; y < search_window_size; y++)
+                    const int wc = wn == 1 ? 0 : c;
+                    const bool update_weights_sum = wn != 1 || c == 0;
+                    if (y >= row_from)
                     {
-                        int * dist_sums_row = dist_sums.row_ptr(y);
-                        int * col_dist_sums_row = col_dist_sums.row_ptr(first_col_num, y);
-                        int * up_col_dist_sums_row = up_col_dist_sums.row_ptr(j, y);
-
-                        const T * b_up_ptr = extended_src_.ptr<T>(start_by - template_window_half_size_ - 1 + y);
-                        const T * b_down_ptr = extended_src_.ptr<T>(start_by + template_window_half_size_ + y);
-
-// MSVC 2015 generates unaligned destination for "movaps" instruction for 32-bit builds
-#if defined _MSC_VER && _MSC_VER == 1900 && !defined _WIN64
-#pragma loop(no_vector)
-#endif
-                        for (int x = 0; x < search_window_size; x++)
-                        {
-                            // remove from current pixel sum column sum with index "first_col_num"
-                            dist_sums_row[x] -= col_dist_sums_row[x];
-
-                            int bx = start_bx + x;
-                            col_dist_sums_row[x] = up_col_dist_sums_row[x] + D::template calcUpDownDist<T>(a_up, a_down, b_up_ptr[bx], b_down_ptr[bx]);
-
-                            dist_sums_row[x] += col_dist_sums_row[x];
-                            up_col_dist_sums_row[x] = col_dist_sums_row[x];
-                        }
+                        // pixels (x, y) with the offset (dx, dy)
+                        const size_t row_ofs = (size_t)(y - row_from) * cols;
+                        nlmAccumulateRow_<ET, IT>::f(&weights[(size_t)wc * n - x_from],
+                                                     extended_planes_[c].template ptr<ET>(border_size_ + y + dy) + border_size_ + dx,
+                                                     &estimation[c * plane_size + row_ofs],
+                                                     &weights_sum[wc * plane_size + row_ofs],
+                                                     update_weights_sum, cols);
+                    }
+                    if ((dx != 0 || dy != 0) && y + dy < row_to)
+                    {
+                        // pixels (x + dx, y + dy) with the offset (-dx, -dy)
+                        const size_t row_ofs = (size_t)(y + dy - row_from) * cols;
+                        nlmAccumulateRow_<ET, IT>::f(&weights[(size_t)wc * n - dx - x_from],
+                                                     extended_planes_[c].template ptr<ET>(border_size_ + y) + border_size_ - dx,
+                                                     &estimation[c * plane_size + row_ofs],
+                                                     &weights_sum[wc * plane_size + row_ofs],
+                                                     update_weights_sum, cols);
                     }
-                }
-
-                first_col_num = (first_col_num + 1) % template_window_size_;
-            }
-
-            // calc weights
-            IT estimation[pixelInfo<T>::channels], weights_sum[pixelInfo<WT>::channels];
-            for (int channel_num = 0; channel_num < pixelInfo<T>::channels; channel_num++)
-                estimation[channel_num] = 0;
-            for (int channel_num = 0; channel_num < pixelInfo<WT>::channels; channel_num++)
-                weights_sum[channel_num] = 0;
-
-            for (int y = 0; y < search_window_size_; y++)
-            {
-                const T* cur_row_ptr = extended_src_.ptr<T>(border_size_ + search_window_y + y);
-                int* dist_sums_row = dist_sums.row_ptr(y);
-                for (int x = 0; x < search_window_size_; x++)
-                {
-                    int almostAvgDist = dist_sums_row[x] >> almost_template_window_size_sq_bin_shift_;
-                    WT weight = almost_dist2weight_[almostAvgDist];
-                    T p = cur_row_ptr[border_size_ + search_window_x + x];
-                    incWithWeight<T, IT, WT>(estimation, weights_sum, weight, p);
                 }
             }
-
-            divByWeightsSum<IT, UIT, pixelInfo<T>::channels, pixelInfo<WT>::channels>(estimation,
-                                                                                      weights_sum);
-            dst_.at<T>(i,j) = saturateCastFromArray<T, IT>(estimation);
         }
     }
-}
-
-template <typename T, typename IT, typename UIT, typename D, typename WT>
-inline void FastNlMeansDenoisingInvoker<T, IT, UIT, D, WT>::calcDistSumsForFirstElementInRow(
-    int i,
-    Array2d<int>& dist_sums,
-    Array3d<int>& col_dist_sums,
-    Array3d<int>& up_col_dist_sums) const
-{
-    int j = 0;
-
-    for (int y = 0; y < search_window_size_; y++)
-        for (int x = 0; x < search_window_size_; x++)
-        {
-            dist_sums[y][x] = 0;
-            for (int tx = 0; tx < template_window_size_; tx++)
-                col_dist_sums[tx][y][x] = 0;
 
-            int start_y = i + y - search_window_half_size_;
-            int start_x = j + x - search_window_half_size_;
-
-            for (int ty = -template_window_half_size_; ty <= template_window_half_size_; ty++)
-                for (int tx = -template_window_half_size_; tx <= template_window_half_size_; tx++)
-                {
-                    int dist = D::template calcDist<T>(extended_src_,
-                        border_size_ + i + ty, border_size_ + j + tx,
-                        border_size_ + start_y + ty, border_size_ + start_x + tx);
-
-                    dist_sums[y][x] += dist;
-                    col_dist_sums[tx + template_window_half_size_][y][x] += dist;
-                }
-
-            up_col_dist_sums[j][y][x] = col_dist_sums[template_window_size_ - 1][y][x];
-        }
-}
-
-template <typename T, typename IT, typename UIT, typename D, typename WT>
-inline void FastNlMeansDenoisingInvoker<T, IT, UIT, D, WT>::calcDistSumsForElementInFirstRow(
-    int i, int j, int first_col_num,
-    Array2d<int>& dist_sums,
-    Array3d<int>& col_dist_sums,
-    Array3d<int>& up_col_dist_sums) const
-{
-    int ay = border_size_ + i;
-    int ax = border_size_ + j + template_window_half_size_;
-
-    int start_by = border_size_ + i - search_window_half_size_;
-    int start_bx = border_size_ + j - search_window_half_size_ + template_window_half_size_;
-
-    int new_last_col_num = first_col_num;
-
-    for (int y = 0; y < search_window_size_; y++)
-        for (int x = 0; x < search_window_size_; x++)
+    for (int y = 0; y < rows; y++)
+    {
+        T* dst_row = dst_.template ptr<T>(row_from + y);
+        const size_t row_ofs = (size_t)y * cols;
+        for (int x = 0; x < cols; x++)
         {
-            dist_sums[y][x] -= col_dist_sums[first_col_num][y][x];
-
-            col_dist_sums[new_last_col_num][y][x] = 0;
-            int by = start_by + y;
-            int bx = start_bx + x;
-            for (int ty = -template_window_half_size_; ty <= template_window_half_size_; ty++)
-                col_dist_sums[new_last_col_num][y][x] += D::template calcDist<T>(extended_src_, ay + ty, ax, by + ty, bx);
-
-            dist_sums[y][x] += col_dist_sums[new_last_col_num][y][x];
-            up_col_dist_sums[j][y][x] = col_dist_sums[new_last_col_num][y][x];
+            IT pixel_estimation[cn], pixel_weights_sum[wn];
+            for (int c = 0; c < cn; c++)
+                pixel_estimation[c] = estimation[c * plane_size + row_ofs + x];
+            for (int wc = 0; wc < wn; wc++)
+                pixel_weights_sum[wc] = weights_sum[wc * plane_size + row_ofs + x];
+            divByWeightsSum<IT, UIT, cn, wn>(pixel_estimation, pixel_weights_sum);
+            dst_row[x] = saturateCastFromArray<T, IT>(pixel_estimation);
         }
+    }
 }
 
 #endif
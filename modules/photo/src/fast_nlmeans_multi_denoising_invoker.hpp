@@ -50,13 +50,23 @@
 
 using namespace cv;
 
+static inline void extendMultiDenoisingFrame(const Mat& src, Mat& extended_src,
+                                             int template_window_size, int search_window_size)
+{
+    int border_size = search_window_size / 2 + template_window_size / 2;
+    copyMakeBorder(src, extended_src, border_size, border_size, border_size, border_size,
+                   cv::BORDER_DEFAULT);
+}
+
 template <typename T, typename IT, typename UIT, typename D, typename WT>
 struct FastNlMeansMultiDenoisingInvoker :
         ParallelLoopBody
 {
 public:
-    FastNlMeansMultiDenoisingInvoker(const std::vector<Mat>& srcImgs, int imgToDenoiseIndex,
-                                     int temporalWindowSize, Mat& dst, int template_window_size,
+    // extendedSrcs are the frames of the temporal window, each one extended by a BORDER_DEFAULT
+    // border of search_window_size / 2 + template_window_size / 2 pixels (see extendMultiDenoisingFrame)
+    FastNlMeansMultiDenoisingInvoker(const std::vector<Mat>& extendedSrcs, int imgToDenoiseIndex,
+                                     Mat& dst, int template_window_size,
                                      int search_window_size, const float *h);
 
     void operator() (const Range& range) const CV_OVERRIDE;
@@ -79,7 +89,6 @@ private:
 
     int template_window_half_size_;
     int search_window_half_size_;
-    int temporal_window_half_size_;
 
     typename pixelInfo<WT>::sampleType fixed_point_mult_;
     int almost_template_window_size_sq_bin_shift;
@@ -96,35 +105,31 @@ private:
 
 template <typename T, typename IT, typename UIT, typename D, typename WT>
 FastNlMeansMultiDenoisingInvoker<T, IT, UIT, D, WT>::FastNlMeansMultiDenoisingInvoker(
-    const std::vector<Mat>& srcImgs,
+    const std::vector<Mat>& extendedSrcs,
     int imgToDenoiseIndex,
-    int temporalWindowSize,
     cv::Mat& dst,
     int template_window_size,
     int search_window_size,
     const float *h) :
-        dst_(dst), extended_srcs_(srcImgs.size())
+        dst_(dst), extended_srcs_(extendedSrcs)
 {
-    CV_Assert(srcImgs.size() > 0);
-    CV_Assert(srcImgs[0].channels() == pixelInfo<T>::channels);
-
-    rows_ = srcImgs[0].rows;
-    cols_ = srcImgs[0].cols;
+    CV_Assert(extendedSrcs.size() > 0);
+    CV_Assert(0 <= imgToDenoiseIndex && imgToDenoiseIndex < (int)extendedSrcs.size());
+    CV_Assert(extendedSrcs[0].channels() == pixelInfo<T>::channels);
 
     template_window_half_size_ = template_window_size / 2;
     search_window_half_size_ = search_window_size / 2;
-    temporal_window_half_size_ = temporalWindowSize / 2;
 
     template_window_size_ = template_window_half_size_ * 2 + 1;
     search_window_size_ = search_window_half_size_ * 2 + 1;
-    temporal_window_size_ = temporal_window_half_size_ * 2 + 1;
+    temporal_window_size_ = (int)extendedSrcs.size();
 
     border_size_ = search_window_half_size_ + template_window_half_size_;
-    for (int i = 0; i < temporal_window_size_; i++)
-        copyMakeBorder(srcImgs[imgToDenoiseIndex - temporal_window_half_size_ + i], extended_srcs_[i],
-            border_size_, border_size_, border_size_, border_size_, cv::BORDER_DEFAULT);
+    rows_ = extendedSrcs[0].rows - 2 * border_size_;
+    cols_ = extendedSrcs[0].cols - 2 * border_size_;
+    CV_Assert(rows_ > 0 && cols_ > 0);
 
-    main_extended_src_ = extended_srcs_[temporal_window_half_size_];
+    main_extended_src_ = extended_srcs_[imgToDenoiseIndex];
     const IT max_estimate_sum_value =
         (IT)temporal_window_size_ * (IT)search_window_size_ * (IT)search_window_size_ * (IT)pixelInfo<T>::sampleMax();
     fixed_point_mult_ = (int)std::min<IT>(std::numeric_limits<IT>::max() / max_estimate_sum_value,
@@ -153,7 +158,7 @@ FastNlMeansMultiDenoisingInvoker<T, IT, UIT, D, WT>::FastNlMeansMultiDenoisingIn
 
     // additional optimization init end
     if (dst_.empty())
-        dst_ = Mat::zeros(srcImgs[0].size(), srcImgs[0].type());
+        dst_ = Mat::zeros(rows_, cols_, main_extended_src_.type());
 }
 
 template <typename T, typename IT, typename UIT, typename D, typename WT>
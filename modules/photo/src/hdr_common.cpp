@@ -86,18 +86,6 @@ Mat RobertsonWeights()
     return weight;
 }
 
-void mapLuminance(Mat src, Mat dst, Mat lum, Mat new_lum, float saturation)
-{
-    std::vector<Mat> channels(3);
-    split(src, channels);
-    for(int i = 0; i < 3; i++) {
-        channels[i] = channels[i].mul(1.0f / lum);
-        pow(channels[i], saturation, channels[i]);
-        channels[i] = channels[i].mul(new_lum);
-    }
-    merge(channels, dst);
-}
-
 Mat linearResponse(int channels)
 {
     Mat response = Mat(LDR_SIZE, 1, CV_MAKETYPE(CV_32F, channels));
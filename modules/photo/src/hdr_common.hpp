@@ -52,8 +52,6 @@ void checkImageDimensions(const std::vector<Mat>& images);
 
 Mat triangleWeights();
 
-void mapLuminance(Mat src, Mat dst, Mat lum, Mat new_lum, float saturation);
-
 Mat RobertsonWeights();
 
 Mat linearResponse(int channels);
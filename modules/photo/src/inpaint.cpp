@@ -48,6 +48,7 @@
 #include <queue>
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "opencv2/imgproc/imgproc_c.h"
 #include "opencv2/photo/legacy/constants_c.h"
 
@@ -781,6 +782,384 @@ icvInpaint( const CvArr* _input_img, const CvArr* _inpaint_mask, CvArr* _output_
     }
 }
 
+namespace cv
+{
+
+// Exemplar based inpainting. The hole is filled coarse to fine with patches of the known region:
+// at every level the nearest neighbor field of the patches overlapping the hole is searched with
+// PatchMatch @cite Barnes09, then every hole pixel is set to the mean of the pixels of the source
+// patches covering it @cite Wexler07, and the two steps are iterated.
+class PatchMatchInpainter
+{
+public:
+    explicit PatchMatchInpainter(int patch_radius) : pr(patch_radius) {}
+
+    // returns false when the image has no known patch to copy from
+    bool run(const Mat& src, const Mat& mask, Mat& dst);
+
+private:
+    struct Level
+    {
+        Mat img;        // CV_32FC(cn), hole pixels hold the current estimate
+        Mat hole;       // CV_8UC1, non-zero in the hole
+        Mat confidence; // CV_32FC(cn), weights of the pixels, decreasing with the distance to the known region
+        Mat source;     // CV_8UC1, non-zero at the centers of the patches without hole pixels
+        Mat target;     // CV_8UC1, non-zero at the centers of the patches overlapping the hole
+        Rect target_rect;
+        std::vector<Point> sources;
+        Mat nnf;        // CV_32SC2, source patch center of the target patches
+        Mat cost;       // CV_32FC1, distance between the target patch and its source patch
+    };
+
+    bool initLevel(Level& level) const;
+    float distance(const Level& level, Point p, Point q, float max_dist) const;
+    void nearestNNF(Level& level) const;
+    void upsampleNNF(const Level& coarse, Level& fine) const;
+    void computeCosts(Level& level) const;
+    void searchNNF(Level& level, int iteration) const;
+    void vote(Level& level) const;
+
+    int pr;
+};
+
+bool PatchMatchInpainter::initLevel(Level& level) const
+{
+    const Size size = level.img.size();
+    const int psize = 2 * pr + 1;
+    if (size.width < psize || size.height < psize)
+        return false;
+
+    Mat kernel = getStructuringElement(MORPH_RECT, Size(psize, psize));
+    Mat known = level.hole == 0;
+    erode(known, level.source, kernel, Point(-1, -1), 1, BORDER_CONSTANT, Scalar::all(0));
+    findNonZero(level.source, level.sources);
+    if (level.sources.empty())
+        return false;
+
+    dilate(level.hole, level.target, kernel);
+    Rect inner(pr, pr, size.width - 2 * pr, size.height - 2 * pr);
+    Mat border_mask = Mat::zeros(size, CV_8U);
+    border_mask(inner).setTo(Scalar::all(255));
+    bitwise_and(level.target, border_mask, level.target);
+    level.target_rect = boundingRect(level.target);
+
+    // the estimate of the hole is less reliable far from its boundary @cite Wexler07
+    Mat dist;
+    distanceTransform(level.hole, dist, DIST_L2, DIST_MASK_3);
+    multiply(dist, Scalar::all(-std::log(1.3)), dist);
+    exp(dist, dist);
+    std::vector<Mat> planes(level.img.channels(), dist);
+    merge(planes, level.confidence);
+
+    level.nnf.create(size, CV_32SC2);
+    level.cost.create(size, CV_32F);
+    return true;
+}
+
+float PatchMatchInpainter::distance(const Level& level, Point p, Point q, float max_dist) const
+{
+    const int n = (2 * pr + 1) * level.img.channels();
+    float dist = 0;
+    for (int dy = -pr; dy <= pr && dist < max_dist; dy++)
+    {
+        const float* a = level.img.ptr<float>(p.y + dy, p.x - pr);
+        const float* b = level.img.ptr<float>(q.y + dy, q.x - pr);
+        const float* w = level.confidence.ptr<float>(p.y + dy, p.x - pr);
+        int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int vlanes = VTraits<v_float32>::vlanes();
+        v_float32 acc = vx_setzero_f32();
+        for (; i <= n - vlanes; i += vlanes)
+        {
+            v_float32 t = v_sub(vx_load(a + i), vx_load(b + i));
+            acc = v_muladd(v_mul(t, t), vx_load(w + i), acc);
+        }
+        dist += v_reduce_sum(acc);
+#endif
+        for (; i < n; i++)
+            dist += (a[i] - b[i]) * (a[i] - b[i]) * w[i];
+    }
+    return dist;
+}
+
+void PatchMatchInpainter::nearestNNF(Level& level) const
+{
+    // the target patches start from the closest source patch, the labels of distanceTransform()
+    // number the source pixels in the same raster order as findNonZero()
+    Mat dist, labels;
+    distanceTransform(level.source == 0, dist, labels, DIST_L2, DIST_MASK_5, DIST_LABEL_PIXEL);
+    const Rect& r = level.target_rect;
+    for (int y = r.y; y < r.y + r.height; y++)
+    {
+        const uchar* target = level.target.ptr<uchar>(y);
+        const int* label = labels.ptr<int>(y);
+        Point* nnf = level.nnf.ptr<Point>(y);
+        for (int x = r.x; x < r.x + r.width; x++)
+        {
+            if (target[x])
+                nnf[x] = level.sources[label[x] - 1];
+        }
+    }
+}
+
+void PatchMatchInpainter::upsampleNNF(const Level& coarse, Level& fine) const
+{
+    RNG rng(fine.img.total());
+    const Rect& r = fine.target_rect;
+    for (int y = r.y; y < r.y + r.height; y++)
+    {
+        const uchar* target = fine.target.ptr<uchar>(y);
+        const int cy = std::min(y / 2, coarse.img.rows - 1);
+        const uchar* coarse_target = coarse.target.ptr<uchar>(cy);
+        const Point* coarse_nnf = coarse.nnf.ptr<Point>(cy);
+        Point* nnf = fine.nnf.ptr<Point>(y);
+        for (int x = r.x; x < r.x + r.width; x++)
+        {
+            if (!target[x])
+                continue;
+            const int cx = std::min(x / 2, coarse.img.cols - 1);
+            if (coarse_target[cx])
+            {
+                Point q(coarse_nnf[cx].x * 2 + x - cx * 2, coarse_nnf[cx].y * 2 + y - cy * 2);
+                if (q.x < fine.img.cols && q.y < fine.img.rows && fine.source.at<uchar>(q))
+                {
+                    nnf[x] = q;
+                    continue;
+                }
+            }
+            nnf[x] = fine.sources[rng.uniform(0, (int)fine.sources.size())];
+        }
+    }
+}
+
+void PatchMatchInpainter::computeCosts(Level& level) const
+{
+    const Rect& r = level.target_rect;
+    parallel_for_(Range(r.y, r.y + r.height), [&](const Range& range)
+    {
+        for (int y = range.start; y < range.end; y++)
+        {
+            const uchar* target = level.target.ptr<uchar>(y);
+            const Point* nnf = level.nnf.ptr<Point>(y);
+            float* cost = level.cost.ptr<float>(y);
+            for (int x = r.x; x < r.x + r.width; x++)
+            {
+                if (target[x])
+                    cost[x] = distance(level, Point(x, y), nnf[x], FLT_MAX);
+            }
+        }
+    });
+}
+
+void PatchMatchInpainter::searchNNF(Level& level, int iteration) const
+{
+    // the rows are processed by stripes in parallel, so the propagation only goes through the
+    // rows of the same stripe; the stripes are shifted at every iteration to let it cross them
+    const int stripe_rows = 16;
+    const Rect& r = level.target_rect;
+    const int shift = (iteration % 2) * (stripe_rows / 2);
+    const int nstripes = (r.height + shift + stripe_rows - 1) / stripe_rows;
+    const bool forward = iteration % 2 == 0;
+    const int dir = forward ? 1 : -1;
+    const int max_radius = std::max(level.img.cols, level.img.rows);
+
+    parallel_for_(Range(0, nstripes), [&](const Range& range)
+    {
+        for (int stripe = range.start; stripe < range.end; stripe++)
+        {
+            RNG rng(((uint64)iteration << 32) + (uint64)stripe * 7919 + level.img.total());
+            const int y_from = std::max(r.y + stripe * stripe_rows - shift, r.y);
+            const int y_to = std::min(r.y + (stripe + 1) * stripe_rows - shift, r.y + r.height);
+            for (int i = 0; i < y_to - y_from; i++)
+            {
+                const int y = forward ? y_from + i : y_to - 1 - i;
+                const uchar* target = level.target.ptr<uchar>(y);
+                Point* nnf = level.nnf.ptr<Point>(y);
+                float* cost = level.cost.ptr<float>(y);
+                const int ny = y - dir;
+                const bool has_row_neighbor = ny >= y_from && ny < y_to;
+                const uchar* target_n = has_row_neighbor ? level.target.ptr<uchar>(ny) : NULL;
+                const Point* nnf_n = has_row_neighbor ? level.nnf.ptr<Point>(ny) : NULL;
+
+                for (int j = 0; j < r.width; j++)
+                {
+                    const int x = forward ? r.x + j : r.x + r.width - 1 - j;
+                    if (!target[x])
+                        continue;
+                    Point best = nnf[x];
+                    float best_cost = cost[x];
+
+                    // propagation from the previous pixels of the row and of the column
+                    const int nx = x - dir;
+                    if (nx >= r.x && nx < r.x + r.width && target[nx])
+                    {
+                        Point q(nnf[nx].x + dir, nnf[nx].y);
+                        if (q.x >= 0 && q.x < level.img.cols && level.source.at<uchar>(q) && q != best)
+                        {
+                            float d = distance(level, Point(x, y), q, best_cost);
+                            if (d < best_cost)
+                            {
+                                best = q;
+                                best_cost = d;
+                            }
+                        }
+                    }
+                    if (target_n && target_n[x])
+                    {
+                        Point q(nnf_n[x].x, nnf_n[x].y + dir);
+                        if (q.y >= 0 && q.y < level.img.rows && level.source.at<uchar>(q) && q != best)
+                        {
+                            float d = distance(level, Point(x, y), q, best_cost);
+                            if (d < best_cost)
+                            {
+                                best = q;
+                                best_cost = d;
+                            }
+                        }
+                    }
+
+                    // random search around the best match with an exponentially decreasing radius
+                    for (int radius = max_radius; radius >= 1; radius /= 2)
+                    {
+                        Point q(best.x + rng.uniform(-radius, radius + 1), best.y + rng.uniform(-radius, radius + 1));
+                        if (q.x < 0 || q.y < 0 || q.x >= level.img.cols || q.y >= level.img.rows ||
+                            !level.source.at<uchar>(q) || q == best)
+                            continue;
+                        float d = distance(level, Point(x, y), q, best_cost);
+                        if (d < best_cost)
+                        {
+                            best = q;
+                            best_cost = d;
+                        }
+                    }
+                    nnf[x] = best;
+                    cost[x] = best_cost;
+                }
+            }
+        }
+    });
+}
+
+void PatchMatchInpainter::vote(Level& level) const
+{
+    // the source patches contain only known pixels, so the hole can be updated in place
+    const int cn = level.img.channels();
+    const Size size = level.img.size();
+    parallel_for_(Range(0, size.height), [&](const Range& range)
+    {
+        AutoBuffer<float> acc(cn);
+        for (int y = range.start; y < range.end; y++)
+        {
+            const uchar* hole = level.hole.ptr<uchar>(y);
+            float* img = level.img.ptr<float>(y);
+            for (int x = 0; x < size.width; x++)
+            {
+                if (!hole[x])
+                    continue;
+                for (int c = 0; c < cn; c++)
+                    acc[c] = 0;
+                float weight_sum = 0;
+                for (int dy = -pr; dy <= pr; dy++)
+                {
+                    const int ty = y - dy;
+                    if (ty < 0 || ty >= size.height)
+                        continue;
+                    const uchar* target = level.target.ptr<uchar>(ty);
+                    const Point* nnf = level.nnf.ptr<Point>(ty);
+                    const float* confidence = level.confidence.ptr<float>(ty);
+                    for (int dx = -pr; dx <= pr; dx++)
+                    {
+                        // the patches centered closer to the known region weigh more
+                        const int tx = x - dx;
+                        if (tx < 0 || tx >= size.width || !target[tx])
+                            continue;
+                        const float w = confidence[tx * cn];
+                        const float* s = level.img.ptr<float>(nnf[tx].y + dy, nnf[tx].x + dx);
+                        for (int c = 0; c < cn; c++)
+                            acc[c] += s[c] * w;
+                        weight_sum += w;
+                    }
+                }
+                if (weight_sum > 0)
+                {
+                    for (int c = 0; c < cn; c++)
+                        img[x * cn + c] = acc[c] / weight_sum;
+                }
+            }
+        }
+    });
+}
+
+bool PatchMatchInpainter::run(const Mat& src, const Mat& mask, Mat& dst)
+{
+    std::vector<Level> levels(1);
+    src.convertTo(levels[0].img, CV_32F);
+    levels[0].hole = mask != 0;
+    if (!initLevel(levels[0]))
+        return false;
+
+    // the coarsest level is the one where the hole is a few patches thick; going
+    // further down makes small structures around the hole vanish from the source
+    Mat dist;
+    distanceTransform(levels[0].hole, dist, DIST_L2, 3);
+    double thickness = 0;
+    minMaxLoc(dist, NULL, &thickness);
+    while (thickness > 4 * pr)
+    {
+        const Level& prev = levels.back();
+        Level next;
+        pyrDown(prev.img, next.img);
+        Mat hole;
+        pyrDown(prev.hole, hole);
+        next.hole = hole != 0;
+        if (!initLevel(next))
+            break;
+        levels.push_back(next);
+        thickness /= 2;
+    }
+
+    const int coarsest = (int)levels.size() - 1;
+    for (int l = coarsest; l >= 0; l--)
+    {
+        Level& level = levels[l];
+        if (l == coarsest)
+        {
+            // the hole of the coarsest level is initialized from its boundary
+            std::vector<Mat> planes;
+            split(level.img, planes);
+            for (size_t c = 0; c < planes.size(); c++)
+                inpaint(planes[c], level.hole, planes[c], pr, INPAINT_TELEA);
+            merge(planes, level.img);
+            nearestNNF(level);
+        }
+        else
+        {
+            Mat up;
+            resize(levels[l + 1].img, up, level.img.size(), 0, 0, INTER_LINEAR);
+            up.copyTo(level.img, level.hole);
+            upsampleNNF(levels[l + 1], level);
+        }
+
+        const int em_iterations = l == coarsest ? 8 : 4;
+        const int search_iterations = 2;
+        for (int em = 0; em < em_iterations; em++)
+        {
+            computeCosts(level);
+            for (int i = 0; i < search_iterations; i++)
+                searchNNF(level, em * search_iterations + i);
+            vote(level);
+        }
+    }
+
+    src.copyTo(dst);
+    Mat result;
+    levels[0].img.convertTo(result, src.type());
+    result.copyTo(dst, levels[0].hole);
+    return true;
+}
+
+}
+
 void cv::inpaint( InputArray _src, InputArray _mask, OutputArray _dst,
                   double inpaintRange, int flags )
 {
@@ -789,6 +1168,55 @@ void cv::inpaint( InputArray _src, InputArray _mask, OutputArray _dst,
     Mat src = _src.getMat(), mask = _mask.getMat();
     _dst.create( src.size(), src.type() );
     Mat dst = _dst.getMat();
-    CvMat c_src = cvMat(src), c_mask = cvMat(mask), c_dst = cvMat(dst);
-    icvInpaint( &c_src, &c_mask, &c_dst, inpaintRange, flags );
+
+    if( flags == INPAINT_PATCHMATCH )
+    {
+        CV_Assert( src.size() == mask.size() && mask.type() == CV_8UC1 );
+        CV_Assert( src.depth() == CV_8U || src.depth() == CV_16U || src.depth() == CV_32F );
+        CV_Assert( src.channels() <= 4 );
+        PatchMatchInpainter inpainter(std::min(std::max(cvRound(inpaintRange), 1), 16));
+        if( !inpainter.run(src, mask, dst) )
+        {
+            // no room for patches, Telea only takes 1-channel images besides 8UC3, so the
+            // channels are inpainted one by one
+            std::vector<Mat> planes;
+            split(src, planes);
+            for( size_t c = 0; c < planes.size(); c++ )
+                inpaint(planes[c], mask, planes[c], inpaintRange, INPAINT_TELEA);
+            merge(planes, dst);
+        }
+        return;
+    }
+
+    if( src.size() != mask.size() || mask.type() != CV_8UC1 || (flags != INPAINT_NS && flags != INPAINT_TELEA) )
+    {
+        // let icvInpaint() report the error
+        CvMat c_src = cvMat(src), c_mask = cvMat(mask), c_dst = cvMat(dst);
+        icvInpaint( &c_src, &c_mask, &c_dst, inpaintRange, flags );
+        return;
+    }
+
+    // The pixels of a hole only depend on the pixels within range + 1 of it, so the holes farther
+    // apart are inpainted independently and in parallel, each on the bounding box of its area.
+    const int range = std::min(std::max(cvRound(inpaintRange), 1), 100);
+    Mat areas, labels, stats, centroids;
+    dilate(mask, areas, getStructuringElement(MORPH_RECT, Size(2 * range + 3, 2 * range + 3)));
+    const int count = connectedComponentsWithStats(areas, labels, stats, centroids, 8, CV_32S);
+
+    Mat input = src.data == dst.data ? src.clone() : src;
+    input.copyTo(dst);
+    parallel_for_(Range(1, count), [&](const Range& r)
+    {
+        for( int i = r.start; i < r.end; i++ )
+        {
+            Rect roi(stats.at<int>(i, CC_STAT_LEFT) - 1, stats.at<int>(i, CC_STAT_TOP) - 1,
+                     stats.at<int>(i, CC_STAT_WIDTH) + 2, stats.at<int>(i, CC_STAT_HEIGHT) + 2);
+            roi &= Rect(0, 0, src.cols, src.rows);
+            Mat area_mask = (labels(roi) == i) & mask(roi);
+            Mat area_src = input(roi), area_dst(roi.size(), src.type());
+            CvMat c_src = cvMat(area_src), c_mask = cvMat(area_mask), c_dst = cvMat(area_dst);
+            icvInpaint( &c_src, &c_mask, &c_dst, inpaintRange, flags );
+            area_dst.copyTo(dst(roi), area_mask);
+        }
+    }, count);
 }
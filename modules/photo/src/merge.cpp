@@ -42,6 +42,7 @@
 #include "precomp.hpp"
 #include "opencv2/photo.hpp"
 #include "opencv2/imgproc.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "hdr_common.hpp"
 
 namespace cv
@@ -169,100 +170,77 @@ public:
         CV_Assert(channels == 1 || channels == 3);
         Size size = images[0].size();
         int CV_32FCC = CV_MAKETYPE(CV_32F, channels);
+        const int count = static_cast<int>(images.size());
 
-        std::vector<Mat> weights(images.size());
-        Mat weight_sum = Mat::zeros(size, CV_32F);
-        Mutex weight_sum_mutex;
-
-        parallel_for_(Range(0, static_cast<int>(images.size())), [&](const Range& range) {
+        std::vector<Mat> grays(count), weights(count);
+        parallel_for_(Range(0, count), [&](const Range& range) {
             for(int i = range.start; i < range.end; i++) {
-                Mat img, gray, contrast, saturation, wellexp;
-                std::vector<Mat> splitted(channels);
-
+                Mat img;
                 images[i].convertTo(img, CV_32F, 1.0f/255.0f);
                 if(channels == 3) {
-                    cvtColor(img, gray, COLOR_RGB2GRAY);
+                    cvtColor(img, grays[i], COLOR_RGB2GRAY);
                 } else {
-                    img.copyTo(gray);
+                    grays[i] = img;
                 }
                 images[i] = img;
-                split(img, splitted);
-
-                Laplacian(gray, contrast, CV_32F);
-                contrast = abs(contrast);
-
-                Mat mean = Mat::zeros(size, CV_32F);
-                for(int c = 0; c < channels; c++) {
-                    mean += splitted[c];
-                }
-                mean /= channels;
-
-                saturation = Mat::zeros(size, CV_32F);
-                for(int c = 0; c < channels;  c++) {
-                    Mat deviation = splitted[c] - mean;
-                    pow(deviation, 2.0f, deviation);
-                    saturation += deviation;
-                }
-                sqrt(saturation, saturation);
-
-                wellexp = Mat::ones(size, CV_32F);
-                for(int c = 0; c < channels; c++) {
-                    Mat expo = splitted[c] - 0.5f;
-                    pow(expo, 2.0f, expo);
-                    expo = -expo / 0.08f;
-                    exp(expo, expo);
-                    wellexp = wellexp.mul(expo);
-                }
-
-                pow(contrast, wcon, contrast);
-                pow(saturation, wsat, saturation);
-                pow(wellexp, wexp, wellexp);
-
-                weights[i] = contrast;
-                if(channels == 3) {
-                    weights[i] = weights[i].mul(saturation);
-                }
-                weights[i] = weights[i].mul(wellexp) + 1e-12f;
-
-                AutoLock lock(weight_sum_mutex);
-                weight_sum += weights[i];
+                weights[i].create(size, CV_32F);
             }
         });
 
+        parallel_for_(Range(0, size.height), [&](const Range& range) {
+            computeWeights(images, grays, weights, range);
+        });
+        grays.clear();
+
+        // each exposure is replaced by its Laplacian pyramid multiplied by the Gaussian pyramid
+        // of its weights, the level 0 of the image pyramid is the converted image itself
         int maxlevel = static_cast<int>(logf(static_cast<float>(min(size.width, size.height))) / logf(2.0f));
-        std::vector<Mat> res_pyr(maxlevel + 1);
-        std::vector<Mutex> res_pyr_mutexes(maxlevel + 1);
+        std::vector<std::vector<Mat> > pyrs(count);
 
-        parallel_for_(Range(0, static_cast<int>(images.size())), [&](const Range& range) {
+        parallel_for_(Range(0, count), [&](const Range& range) {
+            std::vector<Mat> weight_pyr(maxlevel + 1);
+            Mat up_buf(size, CV_32FCC);
             for(int i = range.start; i < range.end; i++) {
-                weights[i] /= weight_sum;
-
-                std::vector<Mat> img_pyr, weight_pyr;
-                buildPyramid(images[i], img_pyr, maxlevel);
-                buildPyramid(weights[i], weight_pyr, maxlevel);
-
+                std::vector<Mat>& img_pyr = pyrs[i];
+                img_pyr.resize(maxlevel + 1);
+                img_pyr[0] = images[i];
+                weight_pyr[0] = weights[i];
                 for(int lvl = 0; lvl < maxlevel; lvl++) {
-                    Mat up;
-                    pyrUp(img_pyr[lvl + 1], up, img_pyr[lvl].size());
-                    img_pyr[lvl] -= up;
+                    pyrDown(img_pyr[lvl], img_pyr[lvl + 1]);
+                    pyrDown(weight_pyr[lvl], weight_pyr[lvl + 1]);
                 }
-                for(int lvl = 0; lvl <= maxlevel; lvl++) {
-                    std::vector<Mat> splitted(channels);
-                    split(img_pyr[lvl], splitted);
-                    for(int c = 0; c < channels; c++) {
-                        splitted[c] = splitted[c].mul(weight_pyr[lvl]);
-                    }
-                    merge(splitted, img_pyr[lvl]);
+                weights[i].release();
 
-                    AutoLock lock(res_pyr_mutexes[lvl]);
-                    if(res_pyr[lvl].empty()) {
-                        res_pyr[lvl] = img_pyr[lvl];
-                    } else {
-                        res_pyr[lvl] += img_pyr[lvl];
+                for(int lvl = 0; lvl <= maxlevel; lvl++) {
+                    Mat up;
+                    if(lvl < maxlevel) {
+                        up = Mat(img_pyr[lvl].size(), CV_32FCC, up_buf.ptr());
+                        pyrUp(img_pyr[lvl + 1], up, up.size());
                     }
+                    weightLaplacianLevel(img_pyr[lvl], up, weight_pyr[lvl]);
                 }
             }
         });
+
+        std::vector<Mat>& res_pyr = pyrs[0];
+        for(int lvl = 0; lvl <= maxlevel; lvl++) {
+            const int n = res_pyr[lvl].cols * channels;
+            parallel_for_(Range(0, res_pyr[lvl].rows), [&](const Range& range) {
+                for(int y = range.start; y < range.end; y++) {
+                    float* res = res_pyr[lvl].ptr<float>(y);
+                    for(int i = 1; i < count; i++) {
+                        const float* level = pyrs[i][lvl].ptr<float>(y);
+                        for(int x = 0; x < n; x++) {
+                            res[x] += level[x];
+                        }
+                    }
+                }
+            });
+        }
+        for(int i = 1; i < count; i++) {
+            pyrs[i].clear();
+        }
+
         for(int lvl = maxlevel; lvl > 0; lvl--) {
             Mat up;
             pyrUp(res_pyr[lvl], up, res_pyr[lvl - 1].size());
@@ -302,6 +280,152 @@ public:
 protected:
     String name;
     float wcon, wsat, wexp;
+
+    // Contrast, saturation and well-exposedness weights of the rows of all the exposures,
+    // normalized so that they sum to one at every pixel
+    void computeWeights(const std::vector<Mat>& images, const std::vector<Mat>& grays,
+                        std::vector<Mat>& weights, const Range& range) const
+    {
+        const int channels = images[0].channels();
+        const int rows = images[0].rows, cols = images[0].cols;
+
+        AutoBuffer<float> _buf(cols * 4);
+        float* contrast = _buf.data();
+        float* saturation = contrast + cols;
+        float* wellexp = saturation + cols;
+        float* weight_sum = wellexp + cols;
+        Mat contrast_row(1, cols, CV_32F, contrast);
+        Mat saturation_row(1, cols, CV_32F, saturation);
+        Mat wellexp_row(1, cols, CV_32F, wellexp);
+
+        for(int y = range.start; y < range.end; y++) {
+            for(size_t i = 0; i < images.size(); i++) {
+                // absolute value of Laplacian() with ksize 1 and BORDER_REFLECT_101
+                const float* gray = grays[i].ptr<float>(y);
+                const float* gray_up = grays[i].ptr<float>(borderInterpolate(y - 1, rows, BORDER_REFLECT_101));
+                const float* gray_down = grays[i].ptr<float>(borderInterpolate(y + 1, rows, BORDER_REFLECT_101));
+                for(int x = 1; x < cols - 1; x++) {
+                    contrast[x] = std::abs(gray_up[x] + gray[x - 1] - 4 * gray[x] + gray[x + 1] + gray_down[x]);
+                }
+                for(int x = 0; x < cols; x += std::max(cols - 1, 1)) {
+                    int left = borderInterpolate(x - 1, cols, BORDER_REFLECT_101);
+                    int right = borderInterpolate(x + 1, cols, BORDER_REFLECT_101);
+                    contrast[x] = std::abs(gray_up[x] + gray[left] - 4 * gray[x] + gray[right] + gray_down[x]);
+                }
+
+                // the well-exposedness is the product of exp(-(v - 0.5)^2 / 0.08) over the channels,
+                // raised to the power wexp
+                const float* img = images[i].ptr<float>(y);
+                const float wellexp_scale = -wexp / 0.08f;
+                int x = 0;
+                if(channels == 3) {
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+                    const int vlanes = VTraits<v_float32>::vlanes();
+                    const v_float32 v_third = vx_setall_f32(1.f / 3), v_half = vx_setall_f32(0.5f);
+                    const v_float32 v_scale = vx_setall_f32(wellexp_scale);
+                    for(; x <= cols - vlanes; x += vlanes) {
+                        v_float32 b, g, r;
+                        v_load_deinterleave(img + x * 3, b, g, r);
+                        v_float32 mean = v_mul(v_add(v_add(b, g), r), v_third);
+                        v_float32 db = v_sub(b, mean), dg = v_sub(g, mean), dr = v_sub(r, mean);
+                        v_store(saturation + x, v_sqrt(v_add(v_add(v_mul(db, db), v_mul(dg, dg)), v_mul(dr, dr))));
+                        db = v_sub(b, v_half); dg = v_sub(g, v_half); dr = v_sub(r, v_half);
+                        v_store(wellexp + x, v_mul(v_scale, v_add(v_add(v_mul(db, db), v_mul(dg, dg)), v_mul(dr, dr))));
+                    }
+#endif
+                    for(; x < cols; x++) {
+                        float b = img[x * 3], g = img[x * 3 + 1], r = img[x * 3 + 2];
+                        float mean = (b + g + r) * (1.f / 3);
+                        saturation[x] = std::sqrt((b - mean) * (b - mean) + (g - mean) * (g - mean) + (r - mean) * (r - mean));
+                        wellexp[x] = wellexp_scale * ((b - 0.5f) * (b - 0.5f) + (g - 0.5f) * (g - 0.5f) + (r - 0.5f) * (r - 0.5f));
+                    }
+                    if(wsat != 1) {
+                        pow(saturation_row, wsat, saturation_row);
+                    }
+                } else if(wexp != 0) {
+                    for(; x < cols; x++) {
+                        wellexp[x] = wellexp_scale * (img[x] - 0.5f) * (img[x] - 0.5f);
+                    }
+                }
+                if(wexp != 0) {
+                    exp(wellexp_row, wellexp_row);
+                }
+                if(wcon != 1) {
+                    pow(contrast_row, wcon, contrast_row);
+                }
+
+                float* weight = weights[i].ptr<float>(y);
+                for(x = 0; x < cols; x++) {
+                    float w = contrast[x];
+                    if(channels == 3) {
+                        w *= saturation[x];
+                    }
+                    if(wexp != 0) {
+                        w *= wellexp[x];
+                    }
+                    weight[x] = w + 1e-12f;
+                }
+                for(x = 0; x < cols; x++) {
+                    weight_sum[x] = i == 0 ? weight[x] : weight_sum[x] + weight[x];
+                }
+            }
+
+            for(size_t i = 0; i < images.size(); i++) {
+                float* weight = weights[i].ptr<float>(y);
+                for(int x = 0; x < cols; x++) {
+                    weight[x] /= weight_sum[x];
+                }
+            }
+        }
+    }
+
+    // img = (img - up) * weight for every channel, up is empty at the top level of the pyramid
+    static void weightLaplacianLevel(Mat& img, const Mat& up, const Mat& weight)
+    {
+        const int channels = img.channels();
+        const int cols = img.cols;
+        for(int y = 0; y < img.rows; y++) {
+            float* img_row = img.ptr<float>(y);
+            const float* up_row = up.empty() ? NULL : up.ptr<float>(y);
+            const float* weight_row = weight.ptr<float>(y);
+            int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+            const int vlanes = VTraits<v_float32>::vlanes();
+            if(channels == 3) {
+                for(; x <= cols - vlanes; x += vlanes) {
+                    v_float32 w = vx_load(weight_row + x);
+                    v_float32 b, g, r;
+                    v_load_deinterleave(img_row + x * 3, b, g, r);
+                    if(up_row) {
+                        v_float32 up_b, up_g, up_r;
+                        v_load_deinterleave(up_row + x * 3, up_b, up_g, up_r);
+                        b = v_sub(b, up_b);
+                        g = v_sub(g, up_g);
+                        r = v_sub(r, up_r);
+                    }
+                    v_store_interleave(img_row + x * 3, v_mul(b, w), v_mul(g, w), v_mul(r, w));
+                }
+            } else {
+                for(; x <= cols - vlanes; x += vlanes) {
+                    v_float32 v = vx_load(img_row + x);
+                    if(up_row) {
+                        v = v_sub(v, vx_load(up_row + x));
+                    }
+                    v_store(img_row + x, v_mul(v, vx_load(weight_row + x)));
+                }
+            }
+#endif
+            for(; x < cols; x++) {
+                for(int c = 0; c < channels; c++) {
+                    float v = img_row[x * channels + c];
+                    if(up_row) {
+                        v -= up_row[x * channels + c];
+                    }
+                    img_row[x * channels + c] = v * weight_row[x];
+                }
+            }
+        }
+    }
 };
 
 Ptr<MergeMertens> createMergeMertens(float wcon, float wsat, float wexp)
@@ -49,6 +49,7 @@
 
 namespace cv
 {
+    struct PoissonPlan;
 
     class Cloning
     {
@@ -65,10 +66,9 @@ namespace cv
             void scalarProduct(cv::Mat mat, float r, float g, float b);
             void poisson(const cv::Mat &destination);
             void evaluate(const cv::Mat &I, cv::Mat &wmask, const cv::Mat &cloned);
-            void dst(const Mat& src, Mat& dest, bool invert = false);
-            void solve(const Mat &img, Mat& mod_diff, Mat &result);
+            void solve(const Mat &img, const PoissonPlan& plan, Mat& mod_diff, Mat &result);
 
-            void poissonSolver(const cv::Mat &img, cv::Mat &gxx , cv::Mat &gyy, cv::Mat &result);
+            void poissonSolver(const cv::Mat &img, const PoissonPlan& plan, cv::Mat &gxx , cv::Mat &gyy, cv::Mat &result);
 
             void arrayProduct(const cv::Mat& lhs, const cv::Mat& rhs, cv::Mat& result) const;
 
@@ -82,8 +82,6 @@ namespace cv
             cv::Mat destinationGradientX, destinationGradientY;
             cv::Mat patchGradientX, patchGradientY;
             cv::Mat binaryMaskFloat, binaryMaskFloatInverted;
-
-            std::vector<float> filter_X, filter_Y;
     };
 }
 #endif
\ No newline at end of file
@@ -95,71 +95,212 @@ void Cloning::computeLaplacianY( const Mat &img, Mat &laplacianY)
     filter2D(img, laplacianY, CV_32F, kernel);
 }
 
-void Cloning::dst(const Mat& src, Mat& dest, bool invert)
+namespace cv
 {
-    Mat temp = Mat::zeros(src.rows, 2 * src.cols + 2, CV_32F);
 
-    int flag = invert ? DFT_ROWS + DFT_SCALE + DFT_INVERSE: DFT_ROWS;
+// DST-I of the rows of a matrix. The transform of a row of n values is, up to the factor -2, the
+// imaginary part of the DFT of its odd extension of length 2n + 2. When that length has large prime
+// factors, the transform is computed with Bluestein's algorithm, as a convolution with a chirp of a
+// length that dft() handles well.
+struct RowDSTPlan
+{
+    explicit RowDSTPlan(int n);
+
+    // dest(k, i) is the transform of the row i of src at the frequency k + 1
+    void apply(const Mat& src, Mat& dest) const;
 
-    src.copyTo(temp(Rect(1,0, src.cols, src.rows)));
+    int n, len, conv_len;
+    Mat chirp, chirp_spectrum;
+};
 
-    for(int j = 0 ; j < src.rows ; ++j)
+// rows transformed together, chirp_spectrum holds as many copies of the filter spectrum
+static const int dst_block_rows = 32;
+
+static int largestPrimeFactor(int n)
+{
+    int p = 1;
+    for (int f = 2; f * f <= n; f++)
     {
-        float * tempLinePtr = temp.ptr<float>(j);
-        const float * srcLinePtr = src.ptr<float>(j);
-        for(int i = 0 ; i < src.cols ; ++i)
+        for (; n % f == 0; n /= f)
+            p = f;
+    }
+    return std::max(p, n);
+}
+
+RowDSTPlan::RowDSTPlan(int n_) : n(n_), len(2 * n_ + 2), conv_len(0)
+{
+    // dft() handles the factors other than 2, 3 and 5 with a generic O(p) butterfly,
+    // which is slower than the two DFTs of the convolution for large p
+    if (largestPrimeFactor(len) <= 32)
+        return;
+
+    // sin(pi * j * k / (n + 1)) is the imaginary part of c(j) * c(k) * conj(c(k - j))
+    // with c(m) = exp(i * pi * m^2 / (2n + 2)), so the transform is a convolution with conj(c)
+    conv_len = getOptimalDFTSize(2 * n + 1);
+    chirp.create(1, n + 1, CV_32FC2);
+    Mat filter = Mat::zeros(1, conv_len, CV_32FC2);
+    for (int m = 0; m <= n; m++)
+    {
+        // m^2 is reduced modulo 2 * len to keep the precision
+        double phase = CV_PI * (double)(((int64)m * m) % (2 * len)) / len;
+        Vec2f c((float)std::cos(phase), (float)std::sin(phase));
+        chirp.at<Vec2f>(m) = c;
+        if (m < n)
         {
-            tempLinePtr[src.cols + 2 + i] = - srcLinePtr[src.cols - 1 - i];
+            // the -2 factor of the direct transform is applied here
+            filter.at<Vec2f>(m) = Vec2f(-2 * c[0], 2 * c[1]);
+            if (m > 0)
+                filter.at<Vec2f>(conv_len - m) = Vec2f(-2 * c[0], 2 * c[1]);
         }
     }
+    dft(filter, filter);
+    repeat(filter, dst_block_rows, 1, chirp_spectrum);
+}
 
-    Mat planes[] = {temp, Mat::zeros(temp.size(), CV_32F)};
-    Mat complex;
+void RowDSTPlan::apply(const Mat& src, Mat& dest) const
+{
+    CV_Assert(src.type() == CV_32FC1 && src.cols == n);
+    dest.create(n, src.rows, CV_32F);
+
+    const int block_rows = dst_block_rows;
+    Mat buf(std::min(block_rows, src.rows), conv_len > 0 ? conv_len : len, conv_len > 0 ? CV_32FC2 : CV_32FC1);
+    for (int i0 = 0; i0 < src.rows; i0 += block_rows)
+    {
+        const int rows = std::min(block_rows, src.rows - i0);
+        Mat block = buf.rowRange(0, rows);
+        block.setTo(Scalar::all(0));
 
-    merge(planes, 2, complex);
-    dft(complex, complex, flag);
-    split(complex, planes);
-    temp = Mat::zeros(src.cols, 2 * src.rows + 2, CV_32F);
+        if (conv_len == 0)
+        {
+            for (int i = 0; i < rows; i++)
+            {
+                const float* src_row = src.ptr<float>(i0 + i);
+                float* ext = block.ptr<float>(i);
+                for (int j = 0; j < n; j++)
+                {
+                    ext[j + 1] = src_row[j];
+                    ext[len - 1 - j] = -src_row[j];
+                }
+            }
+            dft(block, block, DFT_ROWS);
+            for (int i = 0; i < rows; i++)
+            {
+                // CCS packed spectrum, the imaginary part of the frequency k is at 2 * k
+                const float* spectrum = block.ptr<float>(i);
+                for (int k = 1; k <= n; k++)
+                    dest.at<float>(k - 1, i0 + i) = spectrum[2 * k];
+            }
+            continue;
+        }
+
+        const Vec2f* c = chirp.ptr<Vec2f>();
+        for (int i = 0; i < rows; i++)
+        {
+            const float* src_row = src.ptr<float>(i0 + i);
+            Vec2f* row = block.ptr<Vec2f>(i);
+            for (int j = 1; j <= n; j++)
+                row[j] = c[j] * src_row[j - 1];
+        }
+        dft(block, block, DFT_ROWS);
+        mulSpectrums(block, chirp_spectrum.rowRange(0, rows), block, DFT_ROWS);
+        dft(block, block, DFT_ROWS | DFT_INVERSE | DFT_SCALE);
+        for (int i = 0; i < rows; i++)
+        {
+            const Vec2f* row = block.ptr<Vec2f>(i);
+            for (int k = 1; k <= n; k++)
+                dest.at<float>(k - 1, i0 + i) = c[k][0] * row[k][1] + c[k][1] * row[k][0];
+        }
+    }
+}
 
-    for(int j = 0 ; j < src.cols ; ++j)
+// Solver of the Poisson equation with Dirichlet boundary conditions on the interior of a w x h
+// rectangle: the transforms and the inverse eigenvalues of the Laplacian depend only on the size
+// and are shared by the channels and by the calls on images of the same size.
+struct PoissonPlan
+{
+    explicit PoissonPlan(Size size_) : size(size_), dst_x(size_.width - 2), dst_y(size_.height - 2)
     {
-        float * tempLinePtr = temp.ptr<float>(j);
-        for(int i = 0 ; i < src.rows ; ++i)
+        // the transform is its own inverse up to a factor (n + 1) / 2 in each direction,
+        // and each pass of RowDSTPlan::apply() scales it by -2
+        const float scale = 1.0f / (4.0f * (dst_x.n + 1) * (dst_y.n + 1));
+        std::vector<float> filter_X(dst_x.n);
+        for (int i = 0; i < dst_x.n; i++)
+            filter_X[i] = 2.0f * (float)std::cos(CV_PI * (i + 1) / (dst_x.n + 1));
+
+        eigenvalues_inv.create(dst_y.n, dst_x.n, CV_32F);
+        for (int j = 0; j < dst_y.n; j++)
         {
-            float val = planes[1].ptr<float>(i)[j + 1];
-            tempLinePtr[i + 1] = val;
-            tempLinePtr[temp.cols - 1 - i] = - val;
+            const float filter_Y = 2.0f * (float)std::cos(CV_PI * (j + 1) / (dst_y.n + 1));
+            float* row = eigenvalues_inv.ptr<float>(j);
+            for (int i = 0; i < dst_x.n; i++)
+                row[i] = scale / (filter_X[i] + filter_Y - 4);
         }
     }
 
-    Mat planes2[] = {temp, Mat::zeros(temp.size(), CV_32F)};
+    size_t memoryUsed() const
+    {
+        const Mat* mats[] = { &eigenvalues_inv, &dst_x.chirp, &dst_x.chirp_spectrum, &dst_y.chirp, &dst_y.chirp_spectrum };
+        size_t bytes = 0;
+        for (size_t i = 0; i < sizeof(mats) / sizeof(mats[0]); i++)
+            bytes += mats[i]->total() * mats[i]->elemSize();
+        return bytes;
+    }
 
-    merge(planes2, 2, complex);
-    dft(complex, complex, flag);
-    split(complex, planes2);
+    Size size;
+    RowDSTPlan dst_x, dst_y;
+    Mat eigenvalues_inv;
+};
 
-    temp = planes2[1].t();
-    temp(Rect( 0, 1, src.cols, src.rows)).copyTo(dest);
+static Ptr<PoissonPlan> getPoissonPlan(Size size)
+{
+    // a few plans are kept so that batches of images of the same sizes do not recompute them;
+    // the cache is bounded in memory too, plans larger than that are not kept at all
+    static Mutex mutex;
+    static std::vector<Ptr<PoissonPlan> > plans;
+    static size_t cached_bytes = 0;
+    const size_t max_plans = 4;
+    const size_t max_cached_bytes = (size_t)64 << 20;
+
+    AutoLock lock(mutex);
+    for (size_t i = 0; i < plans.size(); i++)
+    {
+        if (plans[i]->size == size)
+        {
+            Ptr<PoissonPlan> plan = plans[i];
+            plans.erase(plans.begin() + i);
+            plans.insert(plans.begin(), plan);
+            return plan;
+        }
+    }
+    Ptr<PoissonPlan> plan = makePtr<PoissonPlan>(size);
+    const size_t bytes = plan->memoryUsed();
+    if (bytes > max_cached_bytes)
+        return plan;
+    plans.insert(plans.begin(), plan);
+    cached_bytes += bytes;
+    while (plans.size() > max_plans || cached_bytes > max_cached_bytes)
+    {
+        cached_bytes -= plans.back()->memoryUsed();
+        plans.pop_back();
+    }
+    return plan;
 }
 
-void Cloning::solve(const Mat &img, Mat& mod_diff, Mat &result)
+}
+
+void Cloning::solve(const Mat &img, const PoissonPlan& plan, Mat& mod_diff, Mat &result)
 {
     const int w = img.cols;
     const int h = img.rows;
 
     Mat res;
-    dst(mod_diff, res);
+    plan.dst_x.apply(mod_diff, res);
+    plan.dst_y.apply(res, mod_diff);
 
-    for(int j = 0 ; j < h-2; j++)
-    {
-        float * resLinePtr = res.ptr<float>(j);
-        for(int i = 0 ; i < w-2; i++)
-        {
-            resLinePtr[i] /= (filter_X[i] + filter_Y[j] - 4);
-        }
-    }
+    multiply(mod_diff, plan.eigenvalues_inv, mod_diff);
 
-    dst(res, mod_diff, true);
+    plan.dst_x.apply(mod_diff, res);
+    plan.dst_y.apply(res, mod_diff);
 
     unsigned char *  resLinePtr = result.ptr<unsigned char>(0);
     const unsigned char * imgLinePtr = img.ptr<unsigned char>(0);
@@ -202,7 +343,7 @@ void Cloning::solve(const Mat &img, Mat& mod_diff, Mat &result)
         resLinePtr[i] = imgLinePtr[i];
 }
 
-void Cloning::poissonSolver(const Mat &img, Mat &laplacianX , Mat &laplacianY, Mat &result)
+void Cloning::poissonSolver(const Mat &img, const PoissonPlan& plan, Mat &laplacianX , Mat &laplacianY, Mat &result)
 {
     const int w = img.cols;
     const int h = img.rows;
@@ -219,7 +360,7 @@ void Cloning::poissonSolver(const Mat &img, Mat &laplacianX , Mat &laplacianY, M
 
     Mat mod_diff = boundary_points(Rect(1, 1, w-2, h-2));
 
-    solve(img,mod_diff,result);
+    solve(img,plan,mod_diff,result);
 }
 
 void Cloning::initVariables(const Mat &destination, const Mat &binaryMask)
@@ -231,19 +372,6 @@ void Cloning::initVariables(const Mat &destination, const Mat &binaryMask)
 
     binaryMaskFloat = Mat(binaryMask.size(),CV_32FC1);
     binaryMaskFloatInverted = Mat(binaryMask.size(),CV_32FC1);
-
-    //init of the filters used in the dst
-    const int w = destination.cols;
-    filter_X.resize(w - 2);
-    double scale = CV_PI / (w - 1);
-    for(int i = 0 ; i < w-2 ; ++i)
-        filter_X[i] = 2.0f * (float)std::cos(scale * (i + 1));
-
-    const int h  = destination.rows;
-    filter_Y.resize(h - 2);
-    scale = CV_PI / (h - 1);
-    for(int j = 0 ; j < h - 2 ; ++j)
-        filter_Y[j] = 2.0f * (float)std::cos(scale * (j + 1));
 }
 
 void Cloning::computeDerivatives(const Mat& destination, const Mat &patch, Mat &binaryMask)
@@ -300,10 +428,14 @@ void Cloning::poisson(const Mat &destination)
 
     split(destination,output);
 
-    for(int chan = 0 ; chan < 3 ; ++chan)
+    Ptr<PoissonPlan> plan = getPoissonPlan(destination.size());
+    parallel_for_(Range(0, 3), [&](const Range& range)
     {
-        poissonSolver(output[chan], rgbx_channel[chan], rgby_channel[chan], output[chan]);
-    }
+        for(int chan = range.start ; chan < range.end ; ++chan)
+        {
+            poissonSolver(output[chan], *plan, rgbx_channel[chan], rgby_channel[chan], output[chan]);
+        }
+    });
 }
 
 void Cloning::evaluate(const Mat &I, Mat &wmask, const Mat &cloned)
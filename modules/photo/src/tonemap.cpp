@@ -39,18 +39,298 @@
 //
 //M*/
 
+
 #include "precomp.hpp"
 #include "opencv2/photo.hpp"
 #include "opencv2/imgproc.hpp"
+#include "opencv2/core/hal/hal.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "hdr_common.hpp"
 
 namespace cv
 {
 
-inline void log_(const Mat& src, Mat& dst)
+// The operators work on stripes of rows in parallel. Statistics are reduced per stripe and then
+// over the stripes in a fixed order, so the results do not depend on the number of threads.
+static const int tonemap_stripe_rows = 32;
+
+static inline int stripeCount(int rows)
+{
+    return (rows + tonemap_stripe_rows - 1) / tonemap_stripe_rows;
+}
+
+static inline Range stripeRows(int stripe, int rows)
+{
+    return Range(stripe * tonemap_stripe_rows, std::min((stripe + 1) * tonemap_stripe_rows, rows));
+}
+
+// y = x^power, computed the way pow() does it for non-integer powers; x and y must not overlap
+static void powRow(const float* x, float* y, int len, float power)
+{
+    if (power == 1.f)
+    {
+        memcpy(y, x, len * sizeof(float));
+        return;
+    }
+    hal::log32f(x, y, len);
+    int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int vlanes = VTraits<v_float32>::vlanes();
+    v_float32 v_power = vx_setall_f32(power);
+    for (; i <= len - vlanes; i += vlanes)
+        v_store(y + i, v_mul(vx_load(y + i), v_power));
+#endif
+    for (; i < len; i++)
+        y[i] *= power;
+    hal::exp32f(y, y, len);
+    for (i = 0; i < len; i++)
+    {
+        if (x[i] <= 0)
+            y[i] = x[i] < 0 ? std::numeric_limits<float>::quiet_NaN() :
+                   power < 0 ? std::numeric_limits<float>::infinity() : 0.f;
+    }
+}
+
+// y = log(max(x, 1e-4))
+static void logRow(const float* x, float* y, int len)
+{
+    int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int vlanes = VTraits<v_float32>::vlanes();
+    v_float32 v_eps = vx_setall_f32(1e-4f);
+    for (; i <= len - vlanes; i += vlanes)
+        v_store(y + i, v_max(vx_load(x + i), v_eps));
+#endif
+    for (; i < len; i++)
+        y[i] = std::max(x[i], 1e-4f);
+    hal::log32f(y, y, len);
+}
+
+// y = x * scale + shift
+static void scaleRow(const float* x, float* y, int len, float scale, float shift)
+{
+    int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int vlanes = VTraits<v_float32>::vlanes();
+    v_float32 v_scale = vx_setall_f32(scale), v_shift = vx_setall_f32(shift);
+    for (; i <= len - vlanes; i += vlanes)
+        v_store(y + i, v_muladd(vx_load(x + i), v_scale, v_shift));
+#endif
+    for (; i < len; i++)
+        y[i] = x[i] * scale + shift;
+}
+
+// luminance of 3-channel pixels, with the weights of COLOR_RGB2GRAY
+static void grayRow(const float* src, float* gray, int width)
+{
+    const float cr = 0.299f, cg = 0.587f, cb = 0.114f;
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int vlanes = VTraits<v_float32>::vlanes();
+    v_float32 v_cr = vx_setall_f32(cr), v_cg = vx_setall_f32(cg), v_cb = vx_setall_f32(cb);
+    for (; x <= width - vlanes; x += vlanes)
+    {
+        v_float32 r, g, b;
+        v_load_deinterleave(src + x * 3, r, g, b);
+        v_store(gray + x, v_muladd(r, v_cr, v_muladd(g, v_cg, v_mul(b, v_cb))));
+    }
+#endif
+    for (; x < width; x++)
+        gray[x] = src[x * 3] * cr + src[x * 3 + 1] * cg + src[x * 3 + 2] * cb;
+}
+
+// dst = (src / lum)^saturation * new_lum for every channel of 3-channel pixels; buf holds 3 * width
+// values, src and dst may be the same
+static void mapLuminanceRow(const float* src, const float* lum, const float* new_lum, float* dst,
+                            float* buf, int width, float saturation)
+{
+    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int vlanes = VTraits<v_float32>::vlanes();
+    for (; x <= width - vlanes; x += vlanes)
+    {
+        v_float32 a, b, c, l = vx_load(lum + x);
+        v_load_deinterleave(src + x * 3, a, b, c);
+        v_store_interleave(buf + x * 3, v_div(a, l), v_div(b, l), v_div(c, l));
+    }
+#endif
+    for (; x < width; x++)
+        for (int c = 0; c < 3; c++)
+            buf[x * 3 + c] = src[x * 3 + c] / lum[x];
+
+    powRow(buf, dst, width * 3, saturation);
+
+    x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    for (; x <= width - vlanes; x += vlanes)
+    {
+        v_float32 a, b, c, l = vx_load(new_lum + x);
+        v_load_deinterleave(dst + x * 3, a, b, c);
+        v_store_interleave(dst + x * 3, v_mul(a, l), v_mul(b, l), v_mul(c, l));
+    }
+#endif
+    for (; x < width; x++)
+        for (int c = 0; c < 3; c++)
+            dst[x * 3 + c] *= new_lum[x];
+}
+
+static void minMaxRow(const float* src, int len, float& min_val, float& max_val)
+{
+    int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int vlanes = VTraits<v_float32>::vlanes();
+    if (len >= vlanes)
+    {
+        v_float32 vmin = vx_setall_f32(min_val), vmax = vx_setall_f32(max_val);
+        for (; i <= len - vlanes; i += vlanes)
+        {
+            v_float32 v = vx_load(src + i);
+            vmin = v_min(vmin, v);
+            vmax = v_max(vmax, v);
+        }
+        min_val = v_reduce_min(vmin);
+        max_val = v_reduce_max(vmax);
+    }
+#endif
+    for (; i < len; i++)
+    {
+        min_val = std::min(min_val, src[i]);
+        max_val = std::max(max_val, src[i]);
+    }
+}
+
+// coefficients of the linear mapping of [min, max] onto [0, 1]
+static void linearCoefficients(double min, double max, float& scale, float& shift)
 {
-    max(src, Scalar::all(1e-4), dst);
-    log(dst, dst);
+    if (max - min > DBL_EPSILON)
+    {
+        scale = static_cast<float>(1.0 / (max - min));
+        shift = static_cast<float>(-min / (max - min));
+    }
+    else
+    {
+        scale = 1.0f;
+        shift = 0.0f;
+    }
+}
+
+static void linearCoefficients(const Mat& img, float& scale, float& shift)
+{
+    double min, max;
+    minMaxLoc(img, &min, &max);
+    linearCoefficients(min, max, scale, shift);
+}
+
+// dst = (src * scale + shift)^(1 / gamma); src and dst may be the same
+static void linearMap(const Mat& src, Mat& dst, float scale, float shift, float gamma)
+{
+    const int len = src.cols * src.channels();
+    parallel_for_(Range(0, stripeCount(src.rows)), [&](const Range& range)
+    {
+        AutoBuffer<float> buf(len);
+        for (int s = range.start; s < range.end; s++)
+        {
+            Range rows = stripeRows(s, src.rows);
+            for (int y = rows.start; y < rows.end; y++)
+            {
+                if (gamma == 1.0f)
+                {
+                    scaleRow(src.ptr<float>(y), dst.ptr<float>(y), len, scale, shift);
+                }
+                else
+                {
+                    scaleRow(src.ptr<float>(y), buf.data(), len, scale, shift);
+                    powRow(buf.data(), dst.ptr<float>(y), len, 1.0f / gamma);
+                }
+            }
+        }
+    });
+}
+
+// normalizes the tonemapped image, whose range is reduced over the stripes, and applies gamma
+static void applyGamma(Mat& img, const std::vector<Vec2f>& stripe_range, float gamma)
+{
+    float min_val = FLT_MAX, max_val = -FLT_MAX;
+    for (size_t s = 0; s < stripe_range.size(); s++)
+    {
+        min_val = std::min(min_val, stripe_range[s][0]);
+        max_val = std::max(max_val, stripe_range[s][1]);
+    }
+    float scale, shift;
+    linearCoefficients(min_val, max_val, scale, shift);
+    linearMap(img, img, scale, shift, gamma);
+}
+
+struct LuminanceStats
+{
+    double log_sum, gray_sum, chan_sum[3];
+    float log_min, log_max, gray_max;
+};
+
+// normalizes src into dst like Tonemap with gamma = 1, computes the luminance of the result
+// and collects the statistics of the luminance and of its logarithm
+static LuminanceStats normalizeAndGetLuminance(const Mat& src, Mat& dst, Mat& gray, Mat* log_gray)
+{
+    float scale, shift;
+    linearCoefficients(src, scale, shift);
+
+    const int width = src.cols, stripes = stripeCount(src.rows);
+    gray.create(src.size(), CV_32F);
+    if (log_gray)
+        log_gray->create(src.size(), CV_32F);
+
+    std::vector<LuminanceStats> stripe_stats(stripes);
+    parallel_for_(Range(0, stripes), [&](const Range& range)
+    {
+        AutoBuffer<float> buf(width);
+        for (int s = range.start; s < range.end; s++)
+        {
+            LuminanceStats& st = stripe_stats[s];
+            st.log_sum = st.gray_sum = st.chan_sum[0] = st.chan_sum[1] = st.chan_sum[2] = 0;
+            st.log_min = FLT_MAX;
+            st.log_max = st.gray_max = -FLT_MAX;
+            Range rows = stripeRows(s, src.rows);
+            for (int y = rows.start; y < rows.end; y++)
+            {
+                float* img_row = dst.ptr<float>(y);
+                float* gray_row = gray.ptr<float>(y);
+                float* log_row = log_gray ? log_gray->ptr<float>(y) : buf.data();
+                scaleRow(src.ptr<float>(y), img_row, width * 3, scale, shift);
+                grayRow(img_row, gray_row, width);
+                logRow(gray_row, log_row, width);
+
+                float gray_min = FLT_MAX;
+                minMaxRow(gray_row, width, gray_min, st.gray_max);
+                minMaxRow(log_row, width, st.log_min, st.log_max);
+                double log_sum = 0, gray_sum = 0, chan_sum[3] = { 0, 0, 0 };
+                for (int x = 0; x < width; x++)
+                {
+                    log_sum += log_row[x];
+                    gray_sum += gray_row[x];
+                    for (int c = 0; c < 3; c++)
+                        chan_sum[c] += img_row[x * 3 + c];
+                }
+                st.log_sum += log_sum;
+                st.gray_sum += gray_sum;
+                for (int c = 0; c < 3; c++)
+                    st.chan_sum[c] += chan_sum[c];
+            }
+        }
+    });
+
+    LuminanceStats stats = stripe_stats[0];
+    for (int s = 1; s < stripes; s++)
+    {
+        const LuminanceStats& st = stripe_stats[s];
+        stats.log_sum += st.log_sum;
+        stats.gray_sum += st.gray_sum;
+        for (int c = 0; c < 3; c++)
+            stats.chan_sum[c] += st.chan_sum[c];
+        stats.log_min = std::min(stats.log_min, st.log_min);
+        stats.log_max = std::max(stats.log_max, st.log_max);
+        stats.gray_max = std::max(stats.gray_max, st.gray_max);
+    }
+    return stats;
 }
 
 class TonemapImpl CV_FINAL : public Tonemap
@@ -70,15 +350,9 @@ public:
         _dst.create(src.size(), CV_32FC3);
         Mat dst = _dst.getMat();
 
-        double min, max;
-        minMaxLoc(src, &min, &max);
-        if(max - min > DBL_EPSILON) {
-            dst = (src - min) / (max - min);
-        } else {
-            src.copyTo(dst);
-        }
-
-        pow(dst, 1.0f / gamma, dst);
+        float scale, shift;
+        linearCoefficients(src, scale, shift);
+        linearMap(src, dst, scale, shift, gamma);
     }
 
     float getGamma() const CV_OVERRIDE { return gamma; }
@@ -125,36 +399,53 @@ public:
 
         Mat src = _src.getMat();
         CV_Assert(!src.empty());
+        CV_Assert(_src.dims() == 2 && _src.type() == CV_32FC3);
         _dst.create(src.size(), CV_32FC3);
         Mat img = _dst.getMat();
 
-        Ptr<Tonemap> linear = createTonemap(1.0f);
-        linear->process(src, img);
-
         Mat gray_img;
-        cvtColor(img, gray_img, COLOR_RGB2GRAY);
-        Mat log_img;
-        log_(gray_img, log_img);
-        float mean = expf(static_cast<float>(sum(log_img)[0]) / log_img.total());
-        gray_img /= mean;
-        log_img.release();
-
-        double max;
-        minMaxLoc(gray_img, NULL, &max);
+        LuminanceStats stats = normalizeAndGetLuminance(src, img, gray_img, NULL);
+        float mean = expf(static_cast<float>(stats.log_sum / src.total()));
+        float max = stats.gray_max / mean;
         CV_Assert(max > 0);
 
-        Mat map;
-        log(gray_img + 1.0f, map);
-        Mat div;
-        pow(gray_img / static_cast<float>(max), logf(bias) / logf(0.5f), div);
-        log(2.0f + 8.0f * div, div);
-        map = map.mul(1.0f / div);
-        div.release();
-
-        mapLuminance(img, img, gray_img, map, saturation);
+        const int width = src.cols, stripes = stripeCount(src.rows);
+        const float power = logf(bias) / logf(0.5f);
+        std::vector<Vec2f> stripe_range(stripes);
+        parallel_for_(Range(0, stripes), [&](const Range& range)
+        {
+            AutoBuffer<float> _buf(width * 6);
+            float *lum = _buf.data(), *map = lum + width, *div = map + width, *buf = div + width;
+            for (int s = range.start; s < range.end; s++)
+            {
+                float min_val = FLT_MAX, max_val = -FLT_MAX;
+                Range rows = stripeRows(s, src.rows);
+                for (int y = rows.start; y < rows.end; y++)
+                {
+                    const float* gray_row = gray_img.ptr<float>(y);
+                    for (int x = 0; x < width; x++)
+                    {
+                        lum[x] = gray_row[x] / mean;
+                        map[x] = lum[x] + 1.0f;
+                        buf[x] = lum[x] / max;
+                    }
+                    hal::log32f(map, map, width);
+                    powRow(buf, div, width, power);
+                    for (int x = 0; x < width; x++)
+                        div[x] = 2.0f + 8.0f * div[x];
+                    hal::log32f(div, div, width);
+                    for (int x = 0; x < width; x++)
+                        map[x] /= div[x];
+
+                    float* img_row = img.ptr<float>(y);
+                    mapLuminanceRow(img_row, lum, map, img_row, buf, width, saturation);
+                    minMaxRow(img_row, width * 3, min_val, max_val);
+                }
+                stripe_range[s] = Vec2f(min_val, max_val);
+            }
+        });
 
-        linear->setGamma(gamma);
-        linear->process(img, img);
+        applyGamma(img, stripe_range, gamma);
     }
 
     float getGamma() const CV_OVERRIDE { return gamma; }
@@ -212,42 +503,88 @@ public:
 
         Mat src = _src.getMat();
         CV_Assert(!src.empty());
+        CV_Assert(_src.dims() == 2 && _src.type() == CV_32FC3);
         _dst.create(src.size(), CV_32FC3);
         Mat img = _dst.getMat();
-        Ptr<Tonemap> linear = createTonemap(1.0f);
-        linear->process(src, img);
 
         Mat gray_img;
-        cvtColor(img, gray_img, COLOR_RGB2GRAY);
-        Mat log_img;
-        log_(gray_img, log_img);
-
-        float log_mean = static_cast<float>(sum(log_img)[0] / log_img.total());
-        double log_min, log_max;
-        minMaxLoc(log_img, &log_min, &log_max);
-        log_img.release();
-
-        double key = static_cast<float>((log_max - log_mean) / (log_max - log_min));
+        LuminanceStats stats = normalizeAndGetLuminance(src, img, gray_img, NULL);
+        const double total = static_cast<double>(src.total());
+        float log_mean = static_cast<float>(stats.log_sum / total);
+        double key = static_cast<float>((stats.log_max - log_mean) / (stats.log_max - stats.log_min));
         float map_key = 0.3f + 0.7f * pow(static_cast<float>(key), 1.4f);
-        intensity = exp(-intensity);
-        Scalar chan_mean = mean(img);
-        float gray_mean = static_cast<float>(mean(gray_img)[0]);
-
-        std::vector<Mat> channels(3);
-        split(img, channels);
-
-        for(int i = 0; i < 3; i++) {
-            float global = color_adapt * static_cast<float>(chan_mean[i]) + (1.0f - color_adapt) * gray_mean;
-            Mat adapt = color_adapt * channels[i] + (1.0f - color_adapt) * gray_img;
-            adapt = light_adapt * adapt + (1.0f - light_adapt) * global;
-            pow(intensity * adapt, map_key, adapt);
-            channels[i] = channels[i].mul(1.0f / (adapt + channels[i]));
+        float intensity_scale = exp(-intensity);
+        float gray_mean = static_cast<float>(stats.gray_sum / total);
+        float global[3];
+        for (int c = 0; c < 3; c++)
+        {
+            float chan_mean = static_cast<float>(stats.chan_sum[c] / total);
+            global[c] = color_adapt * chan_mean + (1.0f - color_adapt) * gray_mean;
         }
-        gray_img.release();
-        merge(channels, img);
 
-        linear->setGamma(gamma);
-        linear->process(img, img);
+        // adapt = (intensity * (la * (ca * channel + (1 - ca) * gray) + (1 - la) * global))^key,
+        // channel = channel / (adapt + channel)
+        const int width = src.cols, stripes = stripeCount(src.rows);
+        const float a_chan = intensity_scale * light_adapt * color_adapt;
+        const float a_gray = intensity_scale * light_adapt * (1.0f - color_adapt);
+        const float a_global[3] = { intensity_scale * (1.0f - light_adapt) * global[0],
+                                    intensity_scale * (1.0f - light_adapt) * global[1],
+                                    intensity_scale * (1.0f - light_adapt) * global[2] };
+        std::vector<Vec2f> stripe_range(stripes);
+        parallel_for_(Range(0, stripes), [&](const Range& range)
+        {
+            AutoBuffer<float> _buf(width * 6);
+            float *adapt = _buf.data(), *buf = adapt + width * 3;
+            for (int s = range.start; s < range.end; s++)
+            {
+                float min_val = FLT_MAX, max_val = -FLT_MAX;
+                Range rows = stripeRows(s, src.rows);
+                for (int y = rows.start; y < rows.end; y++)
+                {
+                    const float* gray_row = gray_img.ptr<float>(y);
+                    float* img_row = img.ptr<float>(y);
+                    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+                    const int vlanes = VTraits<v_float32>::vlanes();
+                    v_float32 v_chan = vx_setall_f32(a_chan);
+                    v_float32 v_global0 = vx_setall_f32(a_global[0]);
+                    v_float32 v_global1 = vx_setall_f32(a_global[1]);
+                    v_float32 v_global2 = vx_setall_f32(a_global[2]);
+                    v_float32 v_gray = vx_setall_f32(a_gray);
+                    for (; x <= width - vlanes; x += vlanes)
+                    {
+                        v_float32 a, b, c, g = v_mul(vx_load(gray_row + x), v_gray);
+                        v_load_deinterleave(img_row + x * 3, a, b, c);
+                        v_store_interleave(buf + x * 3, v_muladd(a, v_chan, v_add(g, v_global0)),
+                                                        v_muladd(b, v_chan, v_add(g, v_global1)),
+                                                        v_muladd(c, v_chan, v_add(g, v_global2)));
+                    }
+#endif
+                    for (; x < width; x++)
+                    {
+                        float g = gray_row[x] * a_gray;
+                        for (int c = 0; c < 3; c++)
+                            buf[x * 3 + c] = img_row[x * 3 + c] * a_chan + (g + a_global[c]);
+                    }
+                    powRow(buf, adapt, width * 3, map_key);
+
+                    x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+                    for (; x <= width * 3 - vlanes; x += vlanes)
+                    {
+                        v_float32 v = vx_load(img_row + x);
+                        v_store(img_row + x, v_div(v, v_add(vx_load(adapt + x), v)));
+                    }
+#endif
+                    for (; x < width * 3; x++)
+                        img_row[x] = img_row[x] / (adapt[x] + img_row[x]);
+                    minMaxRow(img_row, width * 3, min_val, max_val);
+                }
+                stripe_range[s] = Vec2f(min_val, max_val);
+            }
+        });
+
+        applyGamma(img, stripe_range, gamma);
     }
 
     float getGamma() const CV_OVERRIDE { return gamma; }
@@ -309,30 +646,26 @@ public:
 
         Mat src = _src.getMat();
         CV_Assert(!src.empty());
+        CV_Assert(_src.dims() == 2 && _src.type() == CV_32FC3);
         _dst.create(src.size(), CV_32FC3);
         Mat img = _dst.getMat();
-        Ptr<Tonemap> linear = createTonemap(1.0f);
-        linear->process(src, img);
-
-        Mat gray_img;
-        cvtColor(img, gray_img, COLOR_RGB2GRAY);
-        Mat log_img;
-        log_(gray_img, log_img);
 
-        std::vector<Mat> x_contrast, y_contrast;
-        getContrast(log_img, x_contrast, y_contrast);
+        Mat gray_img, log_img;
+        normalizeAndGetLuminance(src, img, gray_img, &log_img);
 
-        for(size_t i = 0; i < x_contrast.size(); i++) {
-            mapContrast(x_contrast[i]);
-            mapContrast(y_contrast[i]);
-        }
+        Mat right;
+        calculateSum(log_img, right, true);
 
-        Mat right(src.size(), CV_32F);
-        calculateSum(x_contrast, y_contrast, right);
+        // The contrast mapping is a power function of the gradients and therefore linear in them,
+        // so the scaled log luminance already solves the equation. It is the initial guess and
+        // the conjugate gradients only have to correct the rounding errors.
+        float gain = 1.0f;
+        mapContrast(&gain, 1);
+        Mat x = log_img * gain;
 
-        Mat p, r, product, x = log_img;
-        calculateProduct(x, r);
-        r = right - r;
+        Mat r, p, product;
+        calculateSum(x, r, false);
+        subtract(right, r, r);
         r.copyTo(p);
 
         const float target_error = 1e-3f;
@@ -340,30 +673,44 @@ public:
         int max_iterations = 100;
         float rr = static_cast<float>(r.dot(r));
 
-        for(int i = 0; i < max_iterations; i++)
+        for(int i = 0; i < max_iterations && rr > target_norm; i++)
         {
-            calculateProduct(p, product);
+            calculateSum(p, product, false);
             double dprod = p.dot(product);
             CV_Assert(fabs(dprod) > 0);
             float alpha = rr / static_cast<float>(dprod);
 
-            r -= alpha * product;
-            x += alpha * p;
+            scaleAdd(product, -alpha, r, r);
+            scaleAdd(p, alpha, x, x);
 
             float new_rr = static_cast<float>(r.dot(r));
             CV_Assert(fabs(rr) > 0);
-            p = r + (new_rr / rr) * p;
+            scaleAdd(p, new_rr / rr, r, p);
             rr = new_rr;
+        }
 
-            if(rr < target_norm) {
-                break;
+        const int width = src.cols, stripes = stripeCount(src.rows);
+        std::vector<Vec2f> stripe_range(stripes);
+        parallel_for_(Range(0, stripes), [&](const Range& range)
+        {
+            AutoBuffer<float> _buf(width * 4);
+            float *lum = _buf.data(), *buf = lum + width;
+            for (int s = range.start; s < range.end; s++)
+            {
+                float min_val = FLT_MAX, max_val = -FLT_MAX;
+                Range rows = stripeRows(s, src.rows);
+                for (int y = rows.start; y < rows.end; y++)
+                {
+                    float* img_row = img.ptr<float>(y);
+                    hal::exp32f(x.ptr<float>(y), lum, width);
+                    mapLuminanceRow(img_row, gray_img.ptr<float>(y), lum, img_row, buf, width, saturation);
+                    minMaxRow(img_row, width * 3, min_val, max_val);
+                }
+                stripe_range[s] = Vec2f(min_val, max_val);
             }
-        }
-        exp(x, x);
-        mapLuminance(img, img, gray_img, x, saturation);
+        });
 
-        linear = createTonemap(gamma);
-        linear->process(img, img);
+        applyGamma(img, stripe_range, gamma);
     }
 
     float getGamma() const CV_OVERRIDE { return gamma; }
@@ -397,71 +744,95 @@ protected:
     String name;
     float gamma, scale, saturation;
 
-    void signedPow(Mat src, float power, Mat& dst)
-    {
-        Mat sign = (src > 0);
-        sign.convertTo(sign, CV_32F, 1.0f/255.0f);
-        sign = sign * 2.0f - 1.0f;
-        pow(abs(src), power, dst);
-        dst = dst.mul(sign);
-    }
-
-    void mapContrast(Mat& contrast)
+    // contrast = sign * (scale * |contrast|^p)^(1 / p) in place
+    void mapContrast(float* contrast, int len) const
     {
         const float response_power = 0.4185f;
-        signedPow(contrast, response_power, contrast);
-        contrast *= scale;
-        signedPow(contrast, 1.0f / response_power, contrast);
+        AutoBuffer<float> buf(len * 2);
+        float *mag = buf.data(), *mapped = mag + len;
+        for (int i = 0; i < len; i++)
+            mag[i] = std::abs(contrast[i]);
+        powRow(mag, mapped, len, response_power);
+        for (int i = 0; i < len; i++)
+            mag[i] = mapped[i] * std::abs(scale);
+        powRow(mag, mapped, len, 1.0f / response_power);
+        for (int i = 0; i < len; i++)
+            contrast[i] = (contrast[i] > 0) == (scale > 0) ? mapped[i] : -mapped[i];
     }
 
-    void getGradient(Mat src, Mat& dst, int pos)
+    // divergence of the forward differences of src (with the contrast mapping applied to them),
+    // i.e. the Laplacian of src with Neumann boundary conditions
+    void getDivergence(const Mat& src, Mat& dst, bool map_contrast) const
     {
-        dst = Mat::zeros(src.size(), CV_32F);
-        Mat a, b;
-        Mat grad = src.colRange(1, src.cols) - src.colRange(0, src.cols - 1);
-        grad.copyTo(dst.colRange(pos, src.cols + pos - 1));
-        if(pos == 1) {
-            src.col(0).copyTo(dst.col(0));
-        }
+        const int rows = src.rows, cols = src.cols;
+        dst.create(src.size(), CV_32F);
+        parallel_for_(Range(0, stripeCount(rows)), [&](const Range& range)
+        {
+            AutoBuffer<float> _buf(cols * 3);
+            float *dx = _buf.data(), *dy = dx + cols, *dy_prev = dy + cols;
+            for (int s = range.start; s < range.end; s++)
+            {
+                Range stripe = stripeRows(s, rows);
+                for (int y = stripe.start; y < stripe.end; y++)
+                {
+                    const float* cur = src.ptr<float>(y);
+                    const float* next = y + 1 < rows ? src.ptr<float>(y + 1) : NULL;
+                    const float* prev = y > 0 ? src.ptr<float>(y - 1) : NULL;
+                    for (int x = 0; x + 1 < cols; x++)
+                        dx[x] = cur[x + 1] - cur[x];
+                    dx[cols - 1] = 0.0f;
+                    for (int x = 0; x < cols; x++)
+                    {
+                        dy[x] = next ? next[x] - cur[x] : 0.0f;
+                        dy_prev[x] = prev ? cur[x] - prev[x] : 0.0f;
+                    }
+                    if (map_contrast)
+                        mapContrast(dx, cols * 3);
+
+                    float* d = dst.ptr<float>(y);
+                    d[0] = dx[0] + dy[0] - dy_prev[0];
+                    int x = 1;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+                    const int vlanes = VTraits<v_float32>::vlanes();
+                    for (; x <= cols - vlanes; x += vlanes)
+                        v_store(d + x, v_add(v_sub(vx_load(dx + x), vx_load(dx + x - 1)),
+                                             v_sub(vx_load(dy + x), vx_load(dy_prev + x))));
+#endif
+                    for (; x < cols; x++)
+                        d[x] = (dx[x] - dx[x - 1]) + (dy[x] - dy_prev[x]);
+                }
+            }
+        });
     }
 
-    void getContrast(Mat src, std::vector<Mat>& x_contrast, std::vector<Mat>& y_contrast)
+    // sum over a pyramid of src of the divergences of its levels, upsampled to the size of src
+    void calculateSum(const Mat& src, Mat& sum, bool map_contrast) const
     {
         int levels = static_cast<int>(logf(static_cast<float>(min(src.rows, src.cols))) / logf(2.0f));
-        x_contrast.resize(levels);
-        y_contrast.resize(levels);
-
-        Mat layer;
-        src.copyTo(layer);
-        for(int i = 0; i < levels; i++) {
-            getGradient(layer, x_contrast[i], 0);
-            getGradient(layer.t(), y_contrast[i], 0);
-            resize(layer, layer, Size(layer.cols / 2, layer.rows / 2), 0, 0, INTER_LINEAR);
+        if (levels <= 0)
+        {
+            sum = Mat::zeros(src.size(), CV_32F);
+            return;
         }
-    }
 
-    void calculateSum(std::vector<Mat>& x_contrast, std::vector<Mat>& y_contrast, Mat& sum)
-    {
-        if (x_contrast.empty())
-            return;
-        const int last = (int)x_contrast.size() - 1;
-        sum = Mat::zeros(x_contrast[last].size(), CV_32F);
-        for(int i = last; i >= 0; i--)
+        std::vector<Mat> pyr(levels);
+        pyr[0] = src;
+        for (int i = 1; i < levels; i++)
+            resize(pyr[i - 1], pyr[i], Size(pyr[i - 1].cols / 2, pyr[i - 1].rows / 2), 0, 0, INTER_LINEAR);
+
+        Mat up;
+        for (int i = levels - 1; i >= 0; i--)
         {
-            Mat grad_x, grad_y;
-            getGradient(x_contrast[i], grad_x, 1);
-            getGradient(y_contrast[i], grad_y, 1);
-            resize(sum, sum, x_contrast[i].size(), 0, 0, INTER_LINEAR);
-            sum += grad_x + grad_y.t();
+            Mat div;
+            getDivergence(pyr[i], div, map_contrast);
+            if (i < levels - 1)
+            {
+                resize(sum, up, div.size(), 0, 0, INTER_LINEAR);
+                div += up;
+            }
+            sum = div;
         }
     }
-
-    void calculateProduct(Mat src, Mat& dst)
-    {
-        std::vector<Mat> x_contrast, y_contrast;
-        getContrast(src, x_contrast, y_contrast);
-        calculateSum(x_contrast, y_contrast, dst);
-    }
 };
 
 Ptr<TonemapMantiuk> createTonemapMantiuk(float gamma, float scale, float saturation)
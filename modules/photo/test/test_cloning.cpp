@@ -244,4 +244,23 @@ TEST(Photo_SeamlessClone_textureFlattening, regression)
     EXPECT_LE(errorL1, reference.total() * numerical_precision) << "size=" << reference.size();
 }
 
+TEST(Photo_SeamlessClone_colorChange, identity_sizes)
+{
+    // the Poisson solver uses different transforms depending on the factors of the image sizes
+    const Size sizes[] = { Size(161, 121), Size(302, 200), Size(97, 243) };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        Mat source(sizes[i], CV_8UC3);
+        theRNG().fill(source, RNG::UNIFORM, 0, 256);
+        GaussianBlur(source, source, Size(7, 7), 2);
+        Mat mask = Mat::zeros(sizes[i], CV_8UC1);
+        circle(mask, Point(sizes[i].width / 2, sizes[i].height / 2), sizes[i].height / 3, Scalar(255), -1);
+
+        Mat result;
+        colorChange(source, mask, result, 1.0f, 1.0f, 1.0f);
+
+        EXPECT_LE(cvtest::norm(source, result, NORM_INF), 1) << "size=" << sizes[i];
+    }
+}
+
 }} // namespace
@@ -165,4 +165,211 @@ TEST(Photo_Denoising, speed)
     printf("execution time: %gms\n", t*1000./getTickFrequency());
 }
 
+// Straightforward fastNlMeansDenoising: every patch distance is summed over the whole template
+// window, with the same fixed point weights and rounding as the optimized implementation
+template <typename ET, typename IT, typename UIT>
+static Mat referenceNlMeans(const Mat& src, const std::vector<float>& h, int templateWindowSize,
+                            int searchWindowSize, int normType)
+{
+    const int cn = src.channels(), wn = (int)h.size();
+    const double sampleMax = std::numeric_limits<ET>::max();
+    const int twh = templateWindowSize / 2, swh = searchWindowSize / 2;
+    const int tws = twh * 2 + 1, sws = swh * 2 + 1, border = twh + swh;
+    Mat ext;
+    cv::copyMakeBorder(src, ext, border, border, border, border, BORDER_DEFAULT);
+
+    const IT fixedPointMult = (IT)std::min<IT>(std::numeric_limits<IT>::max() / ((IT)sws * sws * (IT)sampleMax),
+                                               std::numeric_limits<int>::max());
+    int shift = 0;
+    while ((1 << shift) < tws * tws)
+        shift++;
+    const double almostToActual = (double)(1 << shift) / (tws * tws);
+    const double maxDist = normType == NORM_L1 ? sampleMax * cn : sampleMax * sampleMax * cn;
+    const int almostMaxDist = (int)(maxDist / almostToActual + 1);
+    std::vector<std::vector<IT> > dist2weight(wn, std::vector<IT>(almostMaxDist));
+    for (int c = 0; c < wn; c++)
+        for (int d = 0; d < almostMaxDist; d++)
+        {
+            double dist = d * almostToActual;
+            double w = std::exp(-(normType == NORM_L1 ? dist * dist : dist) / (h[c] * h[c] * cn));
+            if (cvIsNaN(w))
+                w = 1.0;
+            IT weight = (IT)cvRound(fixedPointMult * w);
+            dist2weight[c][d] = weight < 0.001 * fixedPointMult ? 0 : weight;
+        }
+
+    Mat dst(src.size(), src.type());
+    std::vector<IT> estimation(cn), weightsSum(wn);
+    for (int i = 0; i < src.rows; i++)
+        for (int j = 0; j < src.cols; j++)
+        {
+            std::fill(estimation.begin(), estimation.end(), 0);
+            std::fill(weightsSum.begin(), weightsSum.end(), 0);
+            for (int y = -swh; y <= swh; y++)
+                for (int x = -swh; x <= swh; x++)
+                {
+                    int dist = 0;
+                    for (int ty = -twh; ty <= twh; ty++)
+                    {
+                        const ET* a = ext.ptr<ET>(border + i + ty) + (border + j - twh) * cn;
+                        const ET* b = ext.ptr<ET>(border + i + y + ty) + (border + j + x - twh) * cn;
+                        for (int k = 0; k < tws * cn; k++)
+                        {
+                            int diff = (int)a[k] - (int)b[k];
+                            dist += normType == NORM_L1 ? std::abs(diff) : diff * diff;
+                        }
+                    }
+                    const ET* p = ext.ptr<ET>(border + i + y) + (border + j + x) * cn;
+                    for (int c = 0; c < cn; c++)
+                    {
+                        IT weight = dist2weight[wn == 1 ? 0 : c][dist >> shift];
+                        estimation[c] += weight * p[c];
+                        if (c < wn)
+                            weightsSum[c] += weight;
+                    }
+                }
+            ET* out = dst.ptr<ET>(i) + j * cn;
+            for (int c = 0; c < cn; c++)
+            {
+                IT sum = weightsSum[wn == 1 ? 0 : c];
+                out[c] = saturate_cast<ET>((IT)(((UIT)estimation[c] + sum / 2) / sum));
+            }
+        }
+    return dst;
+}
+
+TEST(Photo_Denoising, reference_implementation)
+{
+    struct { int depth; int normType; float h; } configs[] = {
+        { CV_8U, NORM_L2, 15.f }, { CV_8U, NORM_L1, 15.f }, { CV_16U, NORM_L1, 4000.f }
+    };
+    // the last sizes are smaller than the search windows
+    const Size sizes[] = { Size(29, 17), Size(4, 6) };
+    const int windows[][2] = { {3, 7}, {5, 11}, {7, 21} };
+    RNG& rng = theRNG();
+    for (const auto& config : configs)
+        for (int cn = 1; cn <= 4; cn++)
+            for (const Size& size : sizes)
+                for (const auto& window : windows)
+                    for (int hn = 1; hn <= std::min(cn, 2); hn++)
+                    {
+                        Mat src(size, CV_MAKETYPE(config.depth, cn));
+                        const double base = config.depth == CV_8U ? 100 : 20000;
+                        const double range = config.depth == CV_8U ? 40 : 10000;
+                        rng.fill(src, RNG::UNIFORM, base, base + range);
+                        std::vector<float> h(hn == 1 ? 1 : cn);
+                        for (size_t c = 0; c < h.size(); c++)
+                            h[c] = config.h * (1.f + 0.25f * c);
+
+                        Mat dst, ref;
+                        fastNlMeansDenoising(src, dst, h, window[0], window[1], config.normType);
+                        if (config.depth == CV_8U)
+                            ref = referenceNlMeans<uchar, int, unsigned>(src, h, window[0], window[1], config.normType);
+                        else
+                            ref = referenceNlMeans<ushort, int64, uint64>(src, h, window[0], window[1], config.normType);
+                        EXPECT_EQ(0, cvtest::norm(dst, ref, NORM_INF))
+                            << "depth " << config.depth << " norm " << config.normType << " cn " << cn
+                            << " size " << size << " windows " << window[0] << "/" << window[1] << " h " << h.size();
+                        // the weights are not negligible, the pixels are averaged
+                        EXPECT_GT(cvtest::norm(dst, src, NORM_INF), 0);
+                    }
+}
+
+static void makeNoisySequence(int frames, Point2i motion, vector<Mat>& clean, vector<Mat>& noisy)
+{
+    RNG& rng = theRNG();
+    Mat scene(240 + frames * std::abs(motion.y), 320 + frames * std::abs(motion.x), CV_8UC3);
+    rng.fill(scene, RNG::UNIFORM, 0, 255);
+    GaussianBlur(scene, scene, Size(0, 0), 3);
+    normalize(scene, scene, 0, 255, NORM_MINMAX);
+
+    clean.resize(frames);
+    noisy.resize(frames);
+    for (int i = 0; i < frames; i++)
+    {
+        Point2i offset(motion.x >= 0 ? motion.x * i : -motion.x * (frames - 1 - i),
+                       motion.y >= 0 ? motion.y * i : -motion.y * (frames - 1 - i));
+        clean[i] = scene(Rect(offset, Size(320, 240))).clone();
+        Mat noise(clean[i].size(), CV_16SC3);
+        rng.fill(noise, RNG::NORMAL, 0, 15);
+        cv::add(clean[i], noise, noisy[i], noArray(), CV_8U);
+    }
+}
+
+TEST(Photo_FastNlMeansVideoDenoiser, single_frame_window)
+{
+    vector<Mat> clean, noisy;
+    makeNoisySequence(3, Point2i(0, 0), clean, noisy);
+
+    Ptr<FastNlMeansVideoDenoiser> denoiser = createFastNlMeansVideoDenoiser(10, 1);
+    for (size_t i = 0; i < noisy.size(); i++)
+    {
+        Mat result, expected;
+        denoiser->apply(noisy[i], result);
+        fastNlMeansDenoisingMulti(noisy, expected, (int)i, 1, 10);
+        ASSERT_EQ(0, cvtest::norm(result, expected, NORM_INF)) << "frame " << i;
+    }
+}
+
+TEST(Photo_FastNlMeansVideoDenoiser, static_scene)
+{
+    vector<Mat> clean, noisy;
+    makeNoisySequence(6, Point2i(0, 0), clean, noisy);
+
+    Ptr<FastNlMeansVideoDenoiser> denoiser = createFastNlMeansVideoDenoiser(15, 5, 7, 11);
+    Mat result;
+    double psnr_first = 0;
+    for (size_t i = 0; i < noisy.size(); i++)
+    {
+        denoiser->apply(noisy[i], result);
+        ASSERT_EQ(noisy[i].size(), result.size());
+        ASSERT_EQ(noisy[i].type(), result.type());
+        if (i == 0)
+            psnr_first = cvtest::PSNR(result, clean[i]);
+    }
+    // later frames are denoised with the buffered ones as well
+    EXPECT_GT(cvtest::PSNR(result, clean.back()), psnr_first + 1);
+
+    // a frame of another size restarts the sequence
+    Mat small;
+    resize(noisy.back(), small, Size(), 0.5, 0.5);
+    denoiser->apply(small, result);
+    EXPECT_EQ(small.size(), result.size());
+}
+
+TEST(Photo_FastNlMeansVideoDenoiser, motion_compensation)
+{
+    // the camera pans further than the search window reaches over the temporal window,
+    // every frame is shifted by the motion from the previous one
+    const Point2i motion(3, -2);
+    vector<Mat> clean, noisy;
+    makeNoisySequence(8, motion, clean, noisy);
+    Mat flow(noisy[0].size(), CV_32FC2, Scalar((double)motion.x, (double)motion.y));
+
+    Ptr<FastNlMeansVideoDenoiser> denoiser = createFastNlMeansVideoDenoiser(15, 5, 7, 7);
+    double psnr[2] = { 0, 0 };
+    for (int mc = 0; mc < 2; mc++)
+    {
+        denoiser->reset();
+        Mat result;
+        for (size_t i = 0; i < noisy.size(); i++)
+        {
+            denoiser->apply(noisy[i], mc ? flow : Mat(), result);
+            if (i == noisy.size() - 1)
+                psnr[mc] = cvtest::PSNR(result(Rect(20, 20, 280, 200)), clean[i](Rect(20, 20, 280, 200)));
+        }
+    }
+    EXPECT_GT(psnr[1], psnr[0] + 1);
+
+    // a zero flow gives the same result as no flow
+    Mat with_flow, without_flow;
+    denoiser->reset();
+    for (size_t i = 0; i < 3; i++)
+        denoiser->apply(noisy[i], Mat::zeros(flow.size(), CV_32FC2), with_flow);
+    denoiser->reset();
+    for (size_t i = 0; i < 3; i++)
+        denoiser->apply(noisy[i], without_flow);
+    EXPECT_EQ(0, cvtest::norm(with_flow, without_flow, NORM_INF));
+}
+
 }} // namespace
@@ -118,6 +118,48 @@ TEST(Photo_Tonemap, regression)
     checkEqual(result, expected, 3, "Mantiuk");
 }
 
+TEST(Photo_Tonemap, repeated_and_inplace)
+{
+    Mat img(75, 103, CV_32FC3);
+    theRNG().fill(img, RNG::UNIFORM, -4, 4);
+    exp(img, img);
+
+    vector<Ptr<Tonemap> > tonemaps;
+    tonemaps.push_back(createTonemap(2.2f));
+    tonemaps.push_back(createTonemapDrago(2.2f));
+    tonemaps.push_back(createTonemapReinhard(2.2f));
+    tonemaps.push_back(createTonemapMantiuk(2.2f));
+    for (size_t i = 0; i < tonemaps.size(); i++)
+    {
+        Mat first, second;
+        tonemaps[i]->process(img, first);
+        tonemaps[i]->process(img, second);
+        checkEqual(first, second, 0, "Tonemap");
+
+        Mat inplace = img.clone();
+        tonemaps[i]->process(inplace, inplace);
+        checkEqual(first, inplace, 0, "Tonemap");
+
+        double min_val, max_val;
+        minMaxLoc(first, &min_val, &max_val);
+        EXPECT_GE(min_val, 0);
+        EXPECT_LE(max_val, 1);
+    }
+}
+
+TEST(Photo_TonemapMantiuk, identity_mapping)
+{
+    // with unit contrast scale and saturation the luminance is kept, which is the linear operator
+    Mat img(64, 96, CV_32FC3);
+    theRNG().fill(img, RNG::UNIFORM, 1, 3);
+    exp(img, img);
+
+    Mat expected, result;
+    createTonemap(2.2f)->process(img, expected);
+    createTonemapMantiuk(2.2f, 1.0f, 1.0f)->process(img, result);
+    checkEqual(expected, result, 1e-3f, "Mantiuk");
+}
+
 TEST(Photo_AlignMTB, regression)
 {
     const int TESTS_COUNT = 100;
@@ -172,6 +214,27 @@ TEST(Photo_MergeMertens, regression)
     checkEqual(uniform, result, 1e-2f, "Mertens");
 }
 
+TEST(Photo_MergeMertens, identical_exposures)
+{
+    // the weights of identical exposures are equal, so the fusion gives back the image
+    Mat img(97, 131, CV_8UC3);
+    theRNG().fill(img, RNG::UNIFORM, 0, 256);
+    Mat gray;
+    cvtColor(img, gray, COLOR_BGR2GRAY);
+
+    Ptr<MergeMertens> merge = createMergeMertens(1.0f, 1.0f, 1.0f);
+    for (int cn = 1; cn <= 3; cn += 2)
+    {
+        Mat src = cn == 1 ? gray : img;
+        vector<Mat> images(4, src);
+
+        Mat result, expected;
+        merge->process(images, result);
+        src.convertTo(expected, CV_32F, 1.0 / 255);
+        checkEqual(expected, result, 1e-4, "Mertens");
+    }
+}
+
 TEST(Photo_MergeDebevec, regression)
 {
     string test_path = string(cvtest::TS::ptr()->get_data_path()) + "hdr/";
@@ -157,4 +157,77 @@ TEST(Photo_InpaintBorders, regression)
     ASSERT_TRUE(countNonZero(diff) == 0);
 }
 
+TEST(Photo_Inpaint, separate_holes)
+{
+    RNG& rng = theRNG();
+    Mat src(240, 320, CV_8UC3);
+    rng.fill(src, RNG::UNIFORM, 0, 255);
+    GaussianBlur(src, src, Size(0, 0), 2);
+
+    Mat mask = Mat::zeros(src.size(), CV_8U);
+    circle(mask, Point(60, 60), 12, Scalar(255), -1);
+    rectangle(mask, Rect(200, 40, 30, 8), Scalar(255), -1);
+    circle(mask, Point(100, 180), 20, Scalar(255), -1);
+    line(mask, Point(180, 150), Point(300, 220), Scalar(255), 5);
+
+    for (int flags = INPAINT_NS; flags <= INPAINT_TELEA; flags++)
+    {
+        Mat dst;
+        inpaint(src, mask, dst, 3, flags);
+
+        // the holes are far apart, so each one can be inpainted on its own
+        Mat expected = src.clone();
+        Mat labels;
+        int count = connectedComponents(mask, labels);
+        for (int i = 1; i < count; i++)
+            inpaint(expected, labels == i, expected, 3, flags);
+
+        EXPECT_EQ(0, cvtest::norm(dst, expected, NORM_INF)) << "flags=" << flags;
+    }
+}
+
+TEST(Photo_Inpaint, patchmatch_texture)
+{
+    // horizontal stripes with a period of 8 pixels
+    Mat src(128, 128, CV_8UC3);
+    for (int y = 0; y < src.rows; y++)
+        src.row(y).setTo(y % 8 < 4 ? Scalar(40, 120, 200) : Scalar(220, 60, 30));
+
+    Mat mask = Mat::zeros(src.size(), CV_8U);
+    circle(mask, Point(64, 64), 20, Scalar(255), -1);
+    Mat damaged = src.clone();
+    damaged.setTo(Scalar::all(0), mask);
+
+    Mat dst;
+    inpaint(damaged, mask, dst, 3, INPAINT_PATCHMATCH);
+    ASSERT_EQ(src.size(), dst.size());
+    ASSERT_EQ(src.type(), dst.type());
+
+    // pixels outside of the hole are kept and the stripes continue through it
+    EXPECT_EQ(0, cvtest::norm(dst, src, NORM_INF, ~mask));
+    EXPECT_LE(cvtest::norm(dst, src, NORM_L1, mask) / (countNonZero(mask) * 3), 10.);
+}
+
+TEST(Photo_Inpaint, patchmatch_fallback_multichannel)
+{
+    // the image is smaller than a patch, the hole is filled by Telea channel by channel
+    const int types[] = { CV_8UC2, CV_8UC4, CV_16UC3, CV_32FC3, CV_32FC4 };
+    for (int type : types)
+    {
+        Mat src(6, 6, type, Scalar(10, 20, 30, 40));
+        Mat mask = Mat::zeros(src.size(), CV_8U);
+        mask(Rect(2, 2, 2, 2)).setTo(255);
+        Mat damaged = src.clone();
+        damaged.setTo(Scalar::all(0), mask);
+
+        Mat dst;
+        inpaint(damaged, mask, dst, 5, INPAINT_PATCHMATCH);
+        ASSERT_EQ(src.type(), dst.type()) << "type=" << typeToString(type);
+        EXPECT_LE(cvtest::norm(dst, src, NORM_INF), 4.) << "type=" << typeToString(type);
+    }
+
+    Mat src5(6, 6, CV_8UC(5), Scalar::all(0)), dst;
+    EXPECT_THROW(inpaint(src5, Mat::zeros(src5.size(), CV_8U), dst, 5, INPAINT_PATCHMATCH), cv::Exception);
+}
+
 }} // namespace
@@ -471,6 +471,11 @@ public:
 
 
 /** @brief Class computing a dense optical flow using the Gunnar Farneback's algorithm.
+
+The object keeps the polynomial expansion of the last second frame it was given. When the frames of
+a video are processed in turn, i.e. the second frame of a call is passed as the first frame of the
+next one, the expansion of that frame is reused instead of being computed again. Call
+collectGarbage() to release it. calcOpticalFlowFarneback() does not keep anything between calls.
  */
 class CV_EXPORTS_W FarnebackOpticalFlow : public DenseOpticalFlow
 {
@@ -717,6 +722,44 @@ public:
             double minEigThreshold = 1e-4);
 };
 
+/** @brief Sparse point tracker for frame sequences based on the iterative Lucas-Kanade method with pyramids.
+
+The tracker computes the same optical flow as SparsePyrLKOpticalFlow, but is meant for tracking many
+points through the frames of a video: calc(prevImg, nextImg, ...) is called with the frames in turn,
+so that nextImg of one call is prevImg of the next one.
+
+- The pyramid of nextImg is kept together with its derivatives and reused for prevImg in the next
+  call, so each frame is decimated and differentiated once. Whether prevImg is the kept frame is
+  checked by its content; any other frame is processed from scratch. Call clear() to release the
+  kept pyramid.
+- All the pyramid levels of a point are processed in a single parallel pass over the points.
+- When the forward-backward threshold is positive, every point is also tracked back from nextImg to
+  prevImg in the same pass, and its status is cleared if it does not return within the threshold
+  (in pixels) of its original position @cite Kalal2010 .
+
+Only 8-bit images are accepted, pyramids built by buildOpticalFlowPyramid are not. The supported flags
+are OPTFLOW_USE_INITIAL_FLOW and OPTFLOW_LK_GET_MIN_EIGENVALS, err has the same meaning as in
+calcOpticalFlowPyrLK.
+
+@sa calcOpticalFlowPyrLK, SparsePyrLKOpticalFlow
+*/
+class CV_EXPORTS_W SparsePyrLKPointTracker : public SparsePyrLKOpticalFlow
+{
+public:
+    /** @brief Maximal forward-backward error in pixels; the check is disabled when it is not positive */
+    CV_WRAP virtual double getFBThreshold() const = 0;
+    /** @copybrief getFBThreshold @see getFBThreshold */
+    CV_WRAP virtual void setFBThreshold(double fbThreshold) = 0;
+
+    CV_WRAP static Ptr<SparsePyrLKPointTracker> create(
+            Size winSize = Size(21, 21),
+            int maxLevel = 3, TermCriteria crit =
+            TermCriteria(TermCriteria::COUNT+TermCriteria::EPS, 30, 0.01),
+            int flags = 0,
+            double minEigThreshold = 1e-4,
+            double fbThreshold = 1.0);
+};
+
 
 
 
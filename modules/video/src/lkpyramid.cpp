@@ -180,549 +180,627 @@ typedef float acctype;
 typedef float itemtype;
 #endif
 
-void cv::detail::LKTrackerInvoker::operator()(const Range& range) const
+namespace
 {
-    CV_INSTRUMENT_REGION();
-
-    Point2f halfWin((winSize.width-1)*0.5f, (winSize.height-1)*0.5f);
-    const Mat& I = *prevImg;
-    const Mat& J = *nextImg;
-    const Mat& derivI = *prevDeriv;
-
-    int j, cn = I.channels(), cn2 = cn*2;
-    cv::AutoBuffer<deriv_type> _buf(winSize.area()*(cn + cn2));
-    int derivDepth = DataType<deriv_type>::depth;
+using cv::detail::deriv_type;
 
-    Mat IWinBuf(winSize, CV_MAKETYPE(derivDepth, cn), _buf.data());
-    Mat derivIWinBuf(winSize, CV_MAKETYPE(derivDepth, cn2), _buf.data() + winSize.area()*cn);
+enum
+{
+    LK_TRACKED = 0,       // the iterations converged or reached the iteration limit
+    LK_OUTSIDE_PREV = 1,  // the window around the point is outside of the first image
+    LK_SMALL_EIG = 2,     // the spatial gradient matrix is (nearly) singular
+    LK_OUTSIDE_NEXT = 3   // the point has left the second image during the iterations
+};
 
-    for( int ptidx = range.start; ptidx < range.end; ptidx++ )
-    {
-        Point2f prevPt = prevPts[ptidx]*(float)(1./(1 << level));
-        Point2f nextPt;
-        if( level == maxLevel )
-        {
-            if( flags & OPTFLOW_USE_INITIAL_FLOW )
-                nextPt = nextPts[ptidx]*(float)(1./(1 << level));
-            else
-                nextPt = prevPt;
-        }
-        else
-            nextPt = nextPts[ptidx]*2.f;
-        nextPts[ptidx] = nextPt;
+// Allocates the buffers for the window of the first image and its derivatives. Their rows are padded to
+// a multiple of 8 elements, so that lkTrackPoint() can process whole rows of the window with SIMD.
+static void lkAllocWinBufs( cv::AutoBuffer<deriv_type>& buf, cv::Size winSize, int cn,
+                            cv::Mat& IWinBuf, cv::Mat& derivIWinBuf )
+{
+    using namespace cv;
 
-        Point2i iprevPt, inextPt;
-        prevPt -= halfWin;
-        iprevPt.x = cvFloor(prevPt.x);
-        iprevPt.y = cvFloor(prevPt.y);
+    int wstep = alignSize(winSize.width*cn, 8);
+    int derivDepth = DataType<deriv_type>::depth;
+    buf.allocate(winSize.height*wstep*3);
+    IWinBuf = Mat(winSize, CV_MAKETYPE(derivDepth, cn), buf.data(), wstep*sizeof(deriv_type));
+    derivIWinBuf = Mat(winSize, CV_MAKETYPE(derivDepth, cn*2), buf.data() + winSize.height*wstep,
+                       wstep*2*sizeof(deriv_type));
+}
 
-        if( iprevPt.x < -winSize.width || iprevPt.x >= derivI.cols ||
-            iprevPt.y < -winSize.height || iprevPt.y >= derivI.rows )
-        {
-            if( level == 0 )
-            {
-                if( status )
-                    status[ptidx] = false;
-                if( err )
-                    err[ptidx] = 0;
-            }
-            continue;
-        }
+// Runs the Lucas-Kanade iterations for one point on one pyramid level. prevPt and nextPoint
+// are the coordinates on that level; nextPoint holds the initial estimate and is refined in place.
+// The interpolated window of I and its derivatives are left in IWinBuf and derivIWinBuf.
+static int lkTrackPoint( const cv::Mat& I, const cv::Mat& derivI, const cv::Mat& J,
+                         cv::Point2f prevPt, cv::Point2f& nextPoint, cv::Size winSize,
+                         const cv::TermCriteria& criteria, float minEigThreshold,
+                         cv::Mat& IWinBuf, cv::Mat& derivIWinBuf, float& minEig )
+{
+    using namespace cv;
 
-        float a = prevPt.x - iprevPt.x;
-        float b = prevPt.y - iprevPt.y;
-        const int W_BITS = 14, W_BITS1 = 14;
-        const float FLT_SCALE = 1.f/(1 << 20);
-        int iw00 = cvRound((1.f - a)*(1.f - b)*(1 << W_BITS));
-        int iw01 = cvRound(a*(1.f - b)*(1 << W_BITS));
-        int iw10 = cvRound((1.f - a)*b*(1 << W_BITS));
-        int iw11 = (1 << W_BITS) - iw00 - iw01 - iw10;
-
-        int dstep = (int)(derivI.step/derivI.elemSize1());
-        int stepI = (int)(I.step/I.elemSize1());
-        int stepJ = (int)(J.step/J.elemSize1());
-        acctype iA11 = 0, iA12 = 0, iA22 = 0;
-        float A11, A12, A22;
+    Point2f halfWin((winSize.width-1)*0.5f, (winSize.height-1)*0.5f);
+    int j, cn = I.channels(), cn2 = cn*2;
+    int wstep = (int)(IWinBuf.step/IWinBuf.elemSize1());
+
+    Point2i iprevPt, inextPt;
+    prevPt -= halfWin;
+    iprevPt.x = cvFloor(prevPt.x);
+    iprevPt.y = cvFloor(prevPt.y);
+
+    if( iprevPt.x < -winSize.width || iprevPt.x >= derivI.cols ||
+        iprevPt.y < -winSize.height || iprevPt.y >= derivI.rows )
+        return LK_OUTSIDE_PREV;
+
+    float a = prevPt.x - iprevPt.x;
+    float b = prevPt.y - iprevPt.y;
+    const int W_BITS = 14, W_BITS1 = 14;
+    const float FLT_SCALE = 1.f/(1 << 20);
+    int iw00 = cvRound((1.f - a)*(1.f - b)*(1 << W_BITS));
+    int iw01 = cvRound(a*(1.f - b)*(1 << W_BITS));
+    int iw10 = cvRound((1.f - a)*b*(1 << W_BITS));
+    int iw11 = (1 << W_BITS) - iw00 - iw01 - iw10;
+
+    int dstep = (int)(derivI.step/derivI.elemSize1());
+    int stepI = (int)(I.step/I.elemSize1());
+    int stepJ = (int)(J.step/J.elemSize1());
+    acctype iA11 = 0, iA12 = 0, iA22 = 0;
+    float A11, A12, A22;
 
 #if CV_SIMD128 && !CV_NEON
-        v_int16x8 qw0((short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01));
-        v_int16x8 qw1((short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11));
-        v_int32x4 qdelta_d = v_setall_s32(1 << (W_BITS1-1));
-        v_int32x4 qdelta = v_setall_s32(1 << (W_BITS1-5-1));
-        v_float32x4 qA11 = v_setzero_f32(), qA12 = v_setzero_f32(), qA22 = v_setzero_f32();
+    v_int16x8 qw0((short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01));
+    v_int16x8 qw1((short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11));
+    v_int32x4 qdelta_d = v_setall_s32(1 << (W_BITS1-1));
+    v_int32x4 qdelta = v_setall_s32(1 << (W_BITS1-5-1));
+    v_float32x4 qA11 = v_setzero_f32(), qA12 = v_setzero_f32(), qA22 = v_setzero_f32();
 #endif
 
 #if CV_NEON
 
-        float CV_DECL_ALIGNED(16) nA11[] = { 0, 0, 0, 0 }, nA12[] = { 0, 0, 0, 0 }, nA22[] = { 0, 0, 0, 0 };
-        const int shifter1 = -(W_BITS - 5); //negative so it shifts right
-        const int shifter2 = -(W_BITS);
+    float CV_DECL_ALIGNED(16) nA11[] = { 0, 0, 0, 0 }, nA12[] = { 0, 0, 0, 0 }, nA22[] = { 0, 0, 0, 0 };
+    const int shifter1 = -(W_BITS - 5); //negative so it shifts right
+    const int shifter2 = -(W_BITS);
 
-        const int16x4_t d26 = vdup_n_s16((int16_t)iw00);
-        const int16x4_t d27 = vdup_n_s16((int16_t)iw01);
-        const int16x4_t d28 = vdup_n_s16((int16_t)iw10);
-        const int16x4_t d29 = vdup_n_s16((int16_t)iw11);
-        const int32x4_t q11 = vdupq_n_s32((int32_t)shifter1);
-        const int32x4_t q12 = vdupq_n_s32((int32_t)shifter2);
+    const int16x4_t d26 = vdup_n_s16((int16_t)iw00);
+    const int16x4_t d27 = vdup_n_s16((int16_t)iw01);
+    const int16x4_t d28 = vdup_n_s16((int16_t)iw10);
+    const int16x4_t d29 = vdup_n_s16((int16_t)iw11);
+    const int32x4_t q11 = vdupq_n_s32((int32_t)shifter1);
+    const int32x4_t q12 = vdupq_n_s32((int32_t)shifter2);
 
 #endif
 
-        // extract the patch from the first image, compute covariation matrix of derivatives
-        int x, y;
-        for( y = 0; y < winSize.height; y++ )
-        {
-            const uchar* src = I.ptr() + (y + iprevPt.y)*stepI + iprevPt.x*cn;
-            const deriv_type* dsrc = derivI.ptr<deriv_type>() + (y + iprevPt.y)*dstep + iprevPt.x*cn2;
+    // extract the patch from the first image, compute covariation matrix of derivatives
+    int x, y;
+    for( y = 0; y < winSize.height; y++ )
+    {
+        const uchar* src = I.ptr() + (y + iprevPt.y)*stepI + iprevPt.x*cn;
+        const deriv_type* dsrc = derivI.ptr<deriv_type>() + (y + iprevPt.y)*dstep + iprevPt.x*cn2;
 
-            deriv_type* Iptr = IWinBuf.ptr<deriv_type>(y);
-            deriv_type* dIptr = derivIWinBuf.ptr<deriv_type>(y);
+        deriv_type* Iptr = IWinBuf.ptr<deriv_type>(y);
+        deriv_type* dIptr = derivIWinBuf.ptr<deriv_type>(y);
 
-            x = 0;
+        x = 0;
 
 #if CV_SIMD128 && !CV_NEON
-            for( ; x <= winSize.width*cn - 8; x += 8, dsrc += 8*2, dIptr += 8*2 )
-            {
-                v_int32x4 t0, t1;
-                v_int16x8 v00, v01, v10, v11, t00, t01, t10, t11;
-
-                v00 = v_reinterpret_as_s16(v_load_expand(src + x));
-                v01 = v_reinterpret_as_s16(v_load_expand(src + x + cn));
-                v10 = v_reinterpret_as_s16(v_load_expand(src + x + stepI));
-                v11 = v_reinterpret_as_s16(v_load_expand(src + x + stepI + cn));
-
-                v_zip(v00, v01, t00, t01);
-                v_zip(v10, v11, t10, t11);
-
-                t0 = v_add(v_dotprod(t00, qw0, qdelta), v_dotprod(t10, qw1));
-                t1 = v_add(v_dotprod(t01, qw0, qdelta), v_dotprod(t11, qw1));
-                t0 = v_shr<W_BITS1 - 5>(t0);
-                t1 = v_shr<W_BITS1 - 5>(t1);
-                v_store(Iptr + x, v_pack(t0, t1));
-
-                v00 = v_reinterpret_as_s16(v_load(dsrc));
-                v01 = v_reinterpret_as_s16(v_load(dsrc + cn2));
-                v10 = v_reinterpret_as_s16(v_load(dsrc + dstep));
-                v11 = v_reinterpret_as_s16(v_load(dsrc + dstep + cn2));
-
-                v_zip(v00, v01, t00, t01);
-                v_zip(v10, v11, t10, t11);
-
-                t0 = v_add(v_dotprod(t00, qw0, qdelta_d), v_dotprod(t10, qw1));
-                t1 = v_add(v_dotprod(t01, qw0, qdelta_d), v_dotprod(t11, qw1));
-                t0 = v_shr<W_BITS1>(t0);
-                t1 = v_shr<W_BITS1>(t1);
-                v00 = v_pack(t0, t1); // Ix0 Iy0 Ix1 Iy1 ...
-                v_store(dIptr, v00);
-
-                v00 = v_reinterpret_as_s16(v_interleave_pairs(v_reinterpret_as_s32(v_interleave_pairs(v00))));
-                v_expand(v00, t1, t0);
-
-                v_float32x4 fy = v_cvt_f32(t0);
-                v_float32x4 fx = v_cvt_f32(t1);
-
-                qA22 = v_muladd(fy, fy, qA22);
-                qA12 = v_muladd(fx, fy, qA12);
-                qA11 = v_muladd(fx, fx, qA11);
-
-                v00 = v_reinterpret_as_s16(v_load(dsrc + 4*2));
-                v01 = v_reinterpret_as_s16(v_load(dsrc + 4*2 + cn2));
-                v10 = v_reinterpret_as_s16(v_load(dsrc + 4*2 + dstep));
-                v11 = v_reinterpret_as_s16(v_load(dsrc + 4*2 + dstep + cn2));
-
-                v_zip(v00, v01, t00, t01);
-                v_zip(v10, v11, t10, t11);
-
-                t0 = v_add(v_dotprod(t00, qw0, qdelta_d), v_dotprod(t10, qw1));
-                t1 = v_add(v_dotprod(t01, qw0, qdelta_d), v_dotprod(t11, qw1));
-                t0 = v_shr<W_BITS1>(t0);
-                t1 = v_shr<W_BITS1>(t1);
-                v00 = v_pack(t0, t1); // Ix0 Iy0 Ix1 Iy1 ...
-                v_store(dIptr + 4*2, v00);
-
-                v00 = v_reinterpret_as_s16(v_interleave_pairs(v_reinterpret_as_s32(v_interleave_pairs(v00))));
-                v_expand(v00, t1, t0);
-
-                fy = v_cvt_f32(t0);
-                fx = v_cvt_f32(t1);
-
-                qA22 = v_muladd(fy, fy, qA22);
-                qA12 = v_muladd(fx, fy, qA12);
-                qA11 = v_muladd(fx, fx, qA11);
-            }
+        for( ; x <= winSize.width*cn - 8; x += 8, dsrc += 8*2, dIptr += 8*2 )
+        {
+            v_int32x4 t0, t1;
+            v_int16x8 v00, v01, v10, v11, t00, t01, t10, t11;
+
+            v00 = v_reinterpret_as_s16(v_load_expand(src + x));
+            v01 = v_reinterpret_as_s16(v_load_expand(src + x + cn));
+            v10 = v_reinterpret_as_s16(v_load_expand(src + x + stepI));
+            v11 = v_reinterpret_as_s16(v_load_expand(src + x + stepI + cn));
+
+            v_zip(v00, v01, t00, t01);
+            v_zip(v10, v11, t10, t11);
+
+            t0 = v_add(v_dotprod(t00, qw0, qdelta), v_dotprod(t10, qw1));
+            t1 = v_add(v_dotprod(t01, qw0, qdelta), v_dotprod(t11, qw1));
+            t0 = v_shr<W_BITS1 - 5>(t0);
+            t1 = v_shr<W_BITS1 - 5>(t1);
+            v_store(Iptr + x, v_pack(t0, t1));
+
+            v00 = v_reinterpret_as_s16(v_load(dsrc));
+            v01 = v_reinterpret_as_s16(v_load(dsrc + cn2));
+            v10 = v_reinterpret_as_s16(v_load(dsrc + dstep));
+            v11 = v_reinterpret_as_s16(v_load(dsrc + dstep + cn2));
+
+            v_zip(v00, v01, t00, t01);
+            v_zip(v10, v11, t10, t11);
+
+            t0 = v_add(v_dotprod(t00, qw0, qdelta_d), v_dotprod(t10, qw1));
+            t1 = v_add(v_dotprod(t01, qw0, qdelta_d), v_dotprod(t11, qw1));
+            t0 = v_shr<W_BITS1>(t0);
+            t1 = v_shr<W_BITS1>(t1);
+            v00 = v_pack(t0, t1); // Ix0 Iy0 Ix1 Iy1 ...
+            v_store(dIptr, v00);
+
+            v00 = v_reinterpret_as_s16(v_interleave_pairs(v_reinterpret_as_s32(v_interleave_pairs(v00))));
+            v_expand(v00, t1, t0);
+
+            v_float32x4 fy = v_cvt_f32(t0);
+            v_float32x4 fx = v_cvt_f32(t1);
+
+            qA22 = v_muladd(fy, fy, qA22);
+            qA12 = v_muladd(fx, fy, qA12);
+            qA11 = v_muladd(fx, fx, qA11);
+
+            v00 = v_reinterpret_as_s16(v_load(dsrc + 4*2));
+            v01 = v_reinterpret_as_s16(v_load(dsrc + 4*2 + cn2));
+            v10 = v_reinterpret_as_s16(v_load(dsrc + 4*2 + dstep));
+            v11 = v_reinterpret_as_s16(v_load(dsrc + 4*2 + dstep + cn2));
+
+            v_zip(v00, v01, t00, t01);
+            v_zip(v10, v11, t10, t11);
+
+            t0 = v_add(v_dotprod(t00, qw0, qdelta_d), v_dotprod(t10, qw1));
+            t1 = v_add(v_dotprod(t01, qw0, qdelta_d), v_dotprod(t11, qw1));
+            t0 = v_shr<W_BITS1>(t0);
+            t1 = v_shr<W_BITS1>(t1);
+            v00 = v_pack(t0, t1); // Ix0 Iy0 Ix1 Iy1 ...
+            v_store(dIptr + 4*2, v00);
+
+            v00 = v_reinterpret_as_s16(v_interleave_pairs(v_reinterpret_as_s32(v_interleave_pairs(v00))));
+            v_expand(v00, t1, t0);
+
+            fy = v_cvt_f32(t0);
+            fx = v_cvt_f32(t1);
+
+            qA22 = v_muladd(fy, fy, qA22);
+            qA12 = v_muladd(fx, fy, qA12);
+            qA11 = v_muladd(fx, fx, qA11);
+        }
 #endif
 
 #if CV_NEON
-            for( ; x <= winSize.width*cn - 4; x += 4, dsrc += 4*2, dIptr += 4*2 )
-            {
+        for( ; x <= winSize.width*cn - 4; x += 4, dsrc += 4*2, dIptr += 4*2 )
+        {
 
-                uint8x8_t d0 = vld1_u8(&src[x]);
-                uint8x8_t d2 = vld1_u8(&src[x+cn]);
-                uint16x8_t q0 = vmovl_u8(d0);
-                uint16x8_t q1 = vmovl_u8(d2);
+            uint8x8_t d0 = vld1_u8(&src[x]);
+            uint8x8_t d2 = vld1_u8(&src[x+cn]);
+            uint16x8_t q0 = vmovl_u8(d0);
+            uint16x8_t q1 = vmovl_u8(d2);
 
-                int32x4_t q5 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q0)), d26);
-                int32x4_t q6 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q1)), d27);
+            int32x4_t q5 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q0)), d26);
+            int32x4_t q6 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q1)), d27);
 
-                uint8x8_t d4 = vld1_u8(&src[x + stepI]);
-                uint8x8_t d6 = vld1_u8(&src[x + stepI + cn]);
-                uint16x8_t q2 = vmovl_u8(d4);
-                uint16x8_t q3 = vmovl_u8(d6);
+            uint8x8_t d4 = vld1_u8(&src[x + stepI]);
+            uint8x8_t d6 = vld1_u8(&src[x + stepI + cn]);
+            uint16x8_t q2 = vmovl_u8(d4);
+            uint16x8_t q3 = vmovl_u8(d6);
 
-                int32x4_t q7 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q2)), d28);
-                int32x4_t q8 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q3)), d29);
+            int32x4_t q7 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q2)), d28);
+            int32x4_t q8 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q3)), d29);
 
-                q5 = vaddq_s32(q5, q6);
-                q7 = vaddq_s32(q7, q8);
-                q5 = vaddq_s32(q5, q7);
+            q5 = vaddq_s32(q5, q6);
+            q7 = vaddq_s32(q7, q8);
+            q5 = vaddq_s32(q5, q7);
 
-                int16x4x2_t d0d1 = vld2_s16(dsrc);
-                int16x4x2_t d2d3 = vld2_s16(&dsrc[cn2]);
+            int16x4x2_t d0d1 = vld2_s16(dsrc);
+            int16x4x2_t d2d3 = vld2_s16(&dsrc[cn2]);
 
-                q5 = vqrshlq_s32(q5, q11);
+            q5 = vqrshlq_s32(q5, q11);
 
-                int32x4_t q4 = vmull_s16(d0d1.val[0], d26);
-                q6 = vmull_s16(d0d1.val[1], d26);
+            int32x4_t q4 = vmull_s16(d0d1.val[0], d26);
+            q6 = vmull_s16(d0d1.val[1], d26);
 
-                int16x4_t nd0 = vmovn_s32(q5);
+            int16x4_t nd0 = vmovn_s32(q5);
 
-                q7 = vmull_s16(d2d3.val[0], d27);
-                q8 = vmull_s16(d2d3.val[1], d27);
+            q7 = vmull_s16(d2d3.val[0], d27);
+            q8 = vmull_s16(d2d3.val[1], d27);
 
-                vst1_s16(&Iptr[x], nd0);
+            vst1_s16(&Iptr[x], nd0);
 
-                int16x4x2_t d4d5 = vld2_s16(&dsrc[dstep]);
-                int16x4x2_t d6d7 = vld2_s16(&dsrc[dstep+cn2]);
+            int16x4x2_t d4d5 = vld2_s16(&dsrc[dstep]);
+            int16x4x2_t d6d7 = vld2_s16(&dsrc[dstep+cn2]);
 
-                q4 = vaddq_s32(q4, q7);
-                q6 = vaddq_s32(q6, q8);
+            q4 = vaddq_s32(q4, q7);
+            q6 = vaddq_s32(q6, q8);
 
-                q7 = vmull_s16(d4d5.val[0], d28);
-                int32x4_t q14 = vmull_s16(d4d5.val[1], d28);
-                q8 = vmull_s16(d6d7.val[0], d29);
-                int32x4_t q15 = vmull_s16(d6d7.val[1], d29);
+            q7 = vmull_s16(d4d5.val[0], d28);
+            int32x4_t q14 = vmull_s16(d4d5.val[1], d28);
+            q8 = vmull_s16(d6d7.val[0], d29);
+            int32x4_t q15 = vmull_s16(d6d7.val[1], d29);
 
-                q7 = vaddq_s32(q7, q8);
-                q14 = vaddq_s32(q14, q15);
+            q7 = vaddq_s32(q7, q8);
+            q14 = vaddq_s32(q14, q15);
 
-                q4 = vaddq_s32(q4, q7);
-                q6 = vaddq_s32(q6, q14);
+            q4 = vaddq_s32(q4, q7);
+            q6 = vaddq_s32(q6, q14);
 
-                float32x4_t nq0 = vld1q_f32(nA11);
-                float32x4_t nq1 = vld1q_f32(nA12);
-                float32x4_t nq2 = vld1q_f32(nA22);
+            float32x4_t nq0 = vld1q_f32(nA11);
+            float32x4_t nq1 = vld1q_f32(nA12);
+            float32x4_t nq2 = vld1q_f32(nA22);
 
-                q4 = vqrshlq_s32(q4, q12);
-                q6 = vqrshlq_s32(q6, q12);
+            q4 = vqrshlq_s32(q4, q12);
+            q6 = vqrshlq_s32(q6, q12);
 
-                q7 = vmulq_s32(q4, q4);
-                q8 = vmulq_s32(q4, q6);
-                q15 = vmulq_s32(q6, q6);
+            q7 = vmulq_s32(q4, q4);
+            q8 = vmulq_s32(q4, q6);
+            q15 = vmulq_s32(q6, q6);
 
-                nq0 = vaddq_f32(nq0, vcvtq_f32_s32(q7));
-                nq1 = vaddq_f32(nq1, vcvtq_f32_s32(q8));
-                nq2 = vaddq_f32(nq2, vcvtq_f32_s32(q15));
+            nq0 = vaddq_f32(nq0, vcvtq_f32_s32(q7));
+            nq1 = vaddq_f32(nq1, vcvtq_f32_s32(q8));
+            nq2 = vaddq_f32(nq2, vcvtq_f32_s32(q15));
 
-                vst1q_f32(nA11, nq0);
-                vst1q_f32(nA12, nq1);
-                vst1q_f32(nA22, nq2);
+            vst1q_f32(nA11, nq0);
+            vst1q_f32(nA12, nq1);
+            vst1q_f32(nA22, nq2);
 
-                int16x4_t d8 = vmovn_s32(q4);
-                int16x4_t d12 = vmovn_s32(q6);
+            int16x4_t d8 = vmovn_s32(q4);
+            int16x4_t d12 = vmovn_s32(q6);
 
-                int16x4x2_t d8d12;
-                d8d12.val[0] = d8; d8d12.val[1] = d12;
-                vst2_s16(dIptr, d8d12);
-            }
+            int16x4x2_t d8d12;
+            d8d12.val[0] = d8; d8d12.val[1] = d12;
+            vst2_s16(dIptr, d8d12);
+        }
 #endif
 
-            for( ; x < winSize.width*cn; x++, dsrc += 2, dIptr += 2 )
-            {
-                int ival = CV_DESCALE(src[x]*iw00 + src[x+cn]*iw01 +
-                                      src[x+stepI]*iw10 + src[x+stepI+cn]*iw11, W_BITS1-5);
-                int ixval = CV_DESCALE(dsrc[0]*iw00 + dsrc[cn2]*iw01 +
-                                       dsrc[dstep]*iw10 + dsrc[dstep+cn2]*iw11, W_BITS1);
-                int iyval = CV_DESCALE(dsrc[1]*iw00 + dsrc[cn2+1]*iw01 + dsrc[dstep+1]*iw10 +
-                                       dsrc[dstep+cn2+1]*iw11, W_BITS1);
-
-                Iptr[x] = (short)ival;
-                dIptr[0] = (short)ixval;
-                dIptr[1] = (short)iyval;
-
-                iA11 += (itemtype)(ixval*ixval);
-                iA12 += (itemtype)(ixval*iyval);
-                iA22 += (itemtype)(iyval*iyval);
-            }
+        for( ; x < winSize.width*cn; x++, dsrc += 2, dIptr += 2 )
+        {
+            int ival = CV_DESCALE(src[x]*iw00 + src[x+cn]*iw01 +
+                                  src[x+stepI]*iw10 + src[x+stepI+cn]*iw11, W_BITS1-5);
+            int ixval = CV_DESCALE(dsrc[0]*iw00 + dsrc[cn2]*iw01 +
+                                   dsrc[dstep]*iw10 + dsrc[dstep+cn2]*iw11, W_BITS1);
+            int iyval = CV_DESCALE(dsrc[1]*iw00 + dsrc[cn2+1]*iw01 + dsrc[dstep+1]*iw10 +
+                                   dsrc[dstep+cn2+1]*iw11, W_BITS1);
+
+            Iptr[x] = (short)ival;
+            dIptr[0] = (short)ixval;
+            dIptr[1] = (short)iyval;
+
+            iA11 += (itemtype)(ixval*ixval);
+            iA12 += (itemtype)(ixval*iyval);
+            iA22 += (itemtype)(iyval*iyval);
+        }
+
+        // zero the padding of the row, see lkAllocWinBufs()
+        for( ; x < wstep; x++, dIptr += 2 )
+        {
+            Iptr[x] = 0;
+            dIptr[0] = dIptr[1] = 0;
         }
+    }
 
 #if CV_SIMD128 && !CV_NEON
-        iA11 += v_reduce_sum(qA11);
-        iA12 += v_reduce_sum(qA12);
-        iA22 += v_reduce_sum(qA22);
+    iA11 += v_reduce_sum(qA11);
+    iA12 += v_reduce_sum(qA12);
+    iA22 += v_reduce_sum(qA22);
 #endif
 
 #if CV_NEON
-        iA11 += nA11[0] + nA11[1] + nA11[2] + nA11[3];
-        iA12 += nA12[0] + nA12[1] + nA12[2] + nA12[3];
-        iA22 += nA22[0] + nA22[1] + nA22[2] + nA22[3];
+    iA11 += nA11[0] + nA11[1] + nA11[2] + nA11[3];
+    iA12 += nA12[0] + nA12[1] + nA12[2] + nA12[3];
+    iA22 += nA22[0] + nA22[1] + nA22[2] + nA22[3];
 #endif
 
-        A11 = iA11*FLT_SCALE;
-        A12 = iA12*FLT_SCALE;
-        A22 = iA22*FLT_SCALE;
-
-        float D = A11*A22 - A12*A12;
-        float minEig = (A22 + A11 - std::sqrt((A11-A22)*(A11-A22) +
-                        4.f*A12*A12))/(2*winSize.width*winSize.height);
+    A11 = iA11*FLT_SCALE;
+    A12 = iA12*FLT_SCALE;
+    A22 = iA22*FLT_SCALE;
 
-        if( err && (flags & OPTFLOW_LK_GET_MIN_EIGENVALS) != 0 )
-            err[ptidx] = (float)minEig;
+    float D = A11*A22 - A12*A12;
+    minEig = (A22 + A11 - std::sqrt((A11-A22)*(A11-A22) +
+              4.f*A12*A12))/(2*winSize.width*winSize.height);
 
-        if( minEig < minEigThreshold || D < FLT_EPSILON )
-        {
-            if( level == 0 && status )
-                status[ptidx] = false;
-            continue;
-        }
+    if( minEig < minEigThreshold || D < FLT_EPSILON )
+        return LK_SMALL_EIG;
 
-        D = 1.f/D;
+    D = 1.f/D;
 
-        nextPt -= halfWin;
-        Point2f prevDelta;
-
-        for( j = 0; j < criteria.maxCount; j++ )
-        {
-            inextPt.x = cvFloor(nextPt.x);
-            inextPt.y = cvFloor(nextPt.y);
+    Point2f nextPt = nextPoint - halfWin;
+    Point2f prevDelta;
 
-            if( inextPt.x < -winSize.width || inextPt.x >= J.cols ||
-               inextPt.y < -winSize.height || inextPt.y >= J.rows )
-            {
-                if( level == 0 && status )
-                    status[ptidx] = false;
-                break;
-            }
-
-            a = nextPt.x - inextPt.x;
-            b = nextPt.y - inextPt.y;
-            iw00 = cvRound((1.f - a)*(1.f - b)*(1 << W_BITS));
-            iw01 = cvRound(a*(1.f - b)*(1 << W_BITS));
-            iw10 = cvRound((1.f - a)*b*(1 << W_BITS));
-            iw11 = (1 << W_BITS) - iw00 - iw01 - iw10;
-            acctype ib1 = 0, ib2 = 0;
-            float b1, b2;
+    for( j = 0; j < criteria.maxCount; j++ )
+    {
+        inextPt.x = cvFloor(nextPt.x);
+        inextPt.y = cvFloor(nextPt.y);
+
+        if( inextPt.x < -winSize.width || inextPt.x >= J.cols ||
+           inextPt.y < -winSize.height || inextPt.y >= J.rows )
+            return LK_OUTSIDE_NEXT;
+
+        a = nextPt.x - inextPt.x;
+        b = nextPt.y - inextPt.y;
+        iw00 = cvRound((1.f - a)*(1.f - b)*(1 << W_BITS));
+        iw01 = cvRound(a*(1.f - b)*(1 << W_BITS));
+        iw10 = cvRound((1.f - a)*b*(1 << W_BITS));
+        iw11 = (1 << W_BITS) - iw00 - iw01 - iw10;
+        acctype ib1 = 0, ib2 = 0;
+        float b1, b2;
 #if CV_SIMD128 && !CV_NEON
-            qw0 = v_int16x8((short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01));
-            qw1 = v_int16x8((short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11));
-            v_float32x4 qb0 = v_setzero_f32(), qb1 = v_setzero_f32();
+        qw0 = v_int16x8((short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01), (short)(iw00), (short)(iw01));
+        qw1 = v_int16x8((short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11), (short)(iw10), (short)(iw11));
+        v_float32x4 qb0 = v_setzero_f32(), qb1 = v_setzero_f32();
+
+        // the last pixels of the rows go through SIMD as well: the zero derivatives in the padding
+        // cancel the pixels read after the window, which stay inside of J unless its last row is read
+        int simdEnd = inextPt.y < J.rows - 1 ? winSize.width*cn : winSize.width*cn - 7;
 #endif
 
 #if CV_NEON
-            float CV_DECL_ALIGNED(16) nB1[] = { 0,0,0,0 }, nB2[] = { 0,0,0,0 };
+        float CV_DECL_ALIGNED(16) nB1[] = { 0,0,0,0 }, nB2[] = { 0,0,0,0 };
 
-            const int16x4_t d26_2 = vdup_n_s16((int16_t)iw00);
-            const int16x4_t d27_2 = vdup_n_s16((int16_t)iw01);
-            const int16x4_t d28_2 = vdup_n_s16((int16_t)iw10);
-            const int16x4_t d29_2 = vdup_n_s16((int16_t)iw11);
+        const int16x4_t d26_2 = vdup_n_s16((int16_t)iw00);
+        const int16x4_t d27_2 = vdup_n_s16((int16_t)iw01);
+        const int16x4_t d28_2 = vdup_n_s16((int16_t)iw10);
+        const int16x4_t d29_2 = vdup_n_s16((int16_t)iw11);
 
 #endif
 
-            for( y = 0; y < winSize.height; y++ )
-            {
-                const uchar* Jptr = J.ptr() + (y + inextPt.y)*stepJ + inextPt.x*cn;
-                const deriv_type* Iptr = IWinBuf.ptr<deriv_type>(y);
-                const deriv_type* dIptr = derivIWinBuf.ptr<deriv_type>(y);
+        for( y = 0; y < winSize.height; y++ )
+        {
+            const uchar* Jptr = J.ptr() + (y + inextPt.y)*stepJ + inextPt.x*cn;
+            const deriv_type* Iptr = IWinBuf.ptr<deriv_type>(y);
+            const deriv_type* dIptr = derivIWinBuf.ptr<deriv_type>(y);
 
-                x = 0;
+            x = 0;
 
 #if CV_SIMD128 && !CV_NEON
-                for( ; x <= winSize.width*cn - 8; x += 8, dIptr += 8*2 )
-                {
-                    v_int16x8 diff0 = v_reinterpret_as_s16(v_load(Iptr + x)), diff1, diff2;
-                    v_int16x8 v00 = v_reinterpret_as_s16(v_load_expand(Jptr + x));
-                    v_int16x8 v01 = v_reinterpret_as_s16(v_load_expand(Jptr + x + cn));
-                    v_int16x8 v10 = v_reinterpret_as_s16(v_load_expand(Jptr + x + stepJ));
-                    v_int16x8 v11 = v_reinterpret_as_s16(v_load_expand(Jptr + x + stepJ + cn));
-
-                    v_int32x4 t0, t1;
-                    v_int16x8 t00, t01, t10, t11;
-                    v_zip(v00, v01, t00, t01);
-                    v_zip(v10, v11, t10, t11);
-
-                    t0 = v_add(v_dotprod(t00, qw0, qdelta), v_dotprod(t10, qw1));
-                    t1 = v_add(v_dotprod(t01, qw0, qdelta), v_dotprod(t11, qw1));
-                    t0 = v_shr<W_BITS1 - 5>(t0);
-                    t1 = v_shr<W_BITS1 - 5>(t1);
-                    diff0 = v_sub(v_pack(t0, t1), diff0);
-                    v_zip(diff0, diff0, diff2, diff1); // It0 It0 It1 It1 ...
-                    v00 = v_reinterpret_as_s16(v_load(dIptr)); // Ix0 Iy0 Ix1 Iy1 ...
-                    v01 = v_reinterpret_as_s16(v_load(dIptr + 8));
-                    v_zip(v00, v01, v10, v11);
-                    v_zip(diff2, diff1, v00, v01);
-                    qb0 = v_add(qb0, v_cvt_f32(v_dotprod(v00, v10)));
-                    qb1 = v_add(qb1, v_cvt_f32(v_dotprod(v01, v11)));
-                }
+            for( ; x < simdEnd; x += 8, dIptr += 8*2 )
+            {
+                v_int16x8 diff0 = v_reinterpret_as_s16(v_load(Iptr + x)), diff1, diff2;
+                v_int16x8 v00 = v_reinterpret_as_s16(v_load_expand(Jptr + x));
+                v_int16x8 v01 = v_reinterpret_as_s16(v_load_expand(Jptr + x + cn));
+                v_int16x8 v10 = v_reinterpret_as_s16(v_load_expand(Jptr + x + stepJ));
+                v_int16x8 v11 = v_reinterpret_as_s16(v_load_expand(Jptr + x + stepJ + cn));
+
+                v_int32x4 t0, t1;
+                v_int16x8 t00, t01, t10, t11;
+                v_zip(v00, v01, t00, t01);
+                v_zip(v10, v11, t10, t11);
+
+                t0 = v_add(v_dotprod(t00, qw0, qdelta), v_dotprod(t10, qw1));
+                t1 = v_add(v_dotprod(t01, qw0, qdelta), v_dotprod(t11, qw1));
+                t0 = v_shr<W_BITS1 - 5>(t0);
+                t1 = v_shr<W_BITS1 - 5>(t1);
+                diff0 = v_sub(v_pack(t0, t1), diff0);
+                v_zip(diff0, diff0, diff2, diff1); // It0 It0 It1 It1 ...
+                v00 = v_reinterpret_as_s16(v_load(dIptr)); // Ix0 Iy0 Ix1 Iy1 ...
+                v01 = v_reinterpret_as_s16(v_load(dIptr + 8));
+                v_zip(v00, v01, v10, v11);
+                v_zip(diff2, diff1, v00, v01);
+                qb0 = v_add(qb0, v_cvt_f32(v_dotprod(v00, v10)));
+                qb1 = v_add(qb1, v_cvt_f32(v_dotprod(v01, v11)));
+            }
 #endif
 
 #if CV_NEON
-                for( ; x <= winSize.width*cn - 8; x += 8, dIptr += 8*2 )
-                {
+            for( ; x <= winSize.width*cn - 8; x += 8, dIptr += 8*2 )
+            {
 
-                    uint8x8_t d0 = vld1_u8(&Jptr[x]);
-                    uint8x8_t d2 = vld1_u8(&Jptr[x+cn]);
-                    uint8x8_t d4 = vld1_u8(&Jptr[x+stepJ]);
-                    uint8x8_t d6 = vld1_u8(&Jptr[x+stepJ+cn]);
+                uint8x8_t d0 = vld1_u8(&Jptr[x]);
+                uint8x8_t d2 = vld1_u8(&Jptr[x+cn]);
+                uint8x8_t d4 = vld1_u8(&Jptr[x+stepJ]);
+                uint8x8_t d6 = vld1_u8(&Jptr[x+stepJ+cn]);
 
-                    uint16x8_t q0 = vmovl_u8(d0);
-                    uint16x8_t q1 = vmovl_u8(d2);
-                    uint16x8_t q2 = vmovl_u8(d4);
-                    uint16x8_t q3 = vmovl_u8(d6);
+                uint16x8_t q0 = vmovl_u8(d0);
+                uint16x8_t q1 = vmovl_u8(d2);
+                uint16x8_t q2 = vmovl_u8(d4);
+                uint16x8_t q3 = vmovl_u8(d6);
 
-                    int32x4_t nq4 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q0)), d26_2);
-                    int32x4_t nq5 = vmull_s16(vget_high_s16(vreinterpretq_s16_u16(q0)), d26_2);
+                int32x4_t nq4 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q0)), d26_2);
+                int32x4_t nq5 = vmull_s16(vget_high_s16(vreinterpretq_s16_u16(q0)), d26_2);
 
-                    int32x4_t nq6 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q1)), d27_2);
-                    int32x4_t nq7 = vmull_s16(vget_high_s16(vreinterpretq_s16_u16(q1)), d27_2);
+                int32x4_t nq6 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q1)), d27_2);
+                int32x4_t nq7 = vmull_s16(vget_high_s16(vreinterpretq_s16_u16(q1)), d27_2);
 
-                    int32x4_t nq8 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q2)), d28_2);
-                    int32x4_t nq9 = vmull_s16(vget_high_s16(vreinterpretq_s16_u16(q2)), d28_2);
+                int32x4_t nq8 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q2)), d28_2);
+                int32x4_t nq9 = vmull_s16(vget_high_s16(vreinterpretq_s16_u16(q2)), d28_2);
 
-                    int32x4_t nq10 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q3)), d29_2);
-                    int32x4_t nq11 = vmull_s16(vget_high_s16(vreinterpretq_s16_u16(q3)), d29_2);
+                int32x4_t nq10 = vmull_s16(vget_low_s16(vreinterpretq_s16_u16(q3)), d29_2);
+                int32x4_t nq11 = vmull_s16(vget_high_s16(vreinterpretq_s16_u16(q3)), d29_2);
 
-                    nq4 = vaddq_s32(nq4, nq6);
-                    nq5 = vaddq_s32(nq5, nq7);
-                    nq8 = vaddq_s32(nq8, nq10);
-                    nq9 = vaddq_s32(nq9, nq11);
+                nq4 = vaddq_s32(nq4, nq6);
+                nq5 = vaddq_s32(nq5, nq7);
+                nq8 = vaddq_s32(nq8, nq10);
+                nq9 = vaddq_s32(nq9, nq11);
 
-                    int16x8_t q6 = vld1q_s16(&Iptr[x]);
+                int16x8_t q6 = vld1q_s16(&Iptr[x]);
 
-                    nq4 = vaddq_s32(nq4, nq8);
-                    nq5 = vaddq_s32(nq5, nq9);
+                nq4 = vaddq_s32(nq4, nq8);
+                nq5 = vaddq_s32(nq5, nq9);
 
-                    nq8 = vmovl_s16(vget_high_s16(q6));
-                    nq6 = vmovl_s16(vget_low_s16(q6));
+                nq8 = vmovl_s16(vget_high_s16(q6));
+                nq6 = vmovl_s16(vget_low_s16(q6));
 
-                    nq4 = vqrshlq_s32(nq4, q11);
-                    nq5 = vqrshlq_s32(nq5, q11);
+                nq4 = vqrshlq_s32(nq4, q11);
+                nq5 = vqrshlq_s32(nq5, q11);
 
-                    int16x8x2_t q0q1 = vld2q_s16(dIptr);
-                    float32x4_t nB1v = vld1q_f32(nB1);
-                    float32x4_t nB2v = vld1q_f32(nB2);
+                int16x8x2_t q0q1 = vld2q_s16(dIptr);
+                float32x4_t nB1v = vld1q_f32(nB1);
+                float32x4_t nB2v = vld1q_f32(nB2);
 
-                    nq4 = vsubq_s32(nq4, nq6);
-                    nq5 = vsubq_s32(nq5, nq8);
+                nq4 = vsubq_s32(nq4, nq6);
+                nq5 = vsubq_s32(nq5, nq8);
 
-                    int32x4_t nq2 = vmovl_s16(vget_low_s16(q0q1.val[0]));
-                    int32x4_t nq3 = vmovl_s16(vget_high_s16(q0q1.val[0]));
+                int32x4_t nq2 = vmovl_s16(vget_low_s16(q0q1.val[0]));
+                int32x4_t nq3 = vmovl_s16(vget_high_s16(q0q1.val[0]));
 
-                    nq7 = vmovl_s16(vget_low_s16(q0q1.val[1]));
-                    nq8 = vmovl_s16(vget_high_s16(q0q1.val[1]));
+                nq7 = vmovl_s16(vget_low_s16(q0q1.val[1]));
+                nq8 = vmovl_s16(vget_high_s16(q0q1.val[1]));
 
-                    nq9 = vmulq_s32(nq4, nq2);
-                    nq10 = vmulq_s32(nq5, nq3);
+                nq9 = vmulq_s32(nq4, nq2);
+                nq10 = vmulq_s32(nq5, nq3);
 
-                    nq4 = vmulq_s32(nq4, nq7);
-                    nq5 = vmulq_s32(nq5, nq8);
+                nq4 = vmulq_s32(nq4, nq7);
+                nq5 = vmulq_s32(nq5, nq8);
 
-                    nq9 = vaddq_s32(nq9, nq10);
-                    nq4 = vaddq_s32(nq4, nq5);
+                nq9 = vaddq_s32(nq9, nq10);
+                nq4 = vaddq_s32(nq4, nq5);
 
-                    nB1v = vaddq_f32(nB1v, vcvtq_f32_s32(nq9));
-                    nB2v = vaddq_f32(nB2v, vcvtq_f32_s32(nq4));
+                nB1v = vaddq_f32(nB1v, vcvtq_f32_s32(nq9));
+                nB2v = vaddq_f32(nB2v, vcvtq_f32_s32(nq4));
 
-                    vst1q_f32(nB1, nB1v);
-                    vst1q_f32(nB2, nB2v);
-                }
+                vst1q_f32(nB1, nB1v);
+                vst1q_f32(nB2, nB2v);
+            }
 #endif
 
-                for( ; x < winSize.width*cn; x++, dIptr += 2 )
-                {
-                    int diff = CV_DESCALE(Jptr[x]*iw00 + Jptr[x+cn]*iw01 +
-                                          Jptr[x+stepJ]*iw10 + Jptr[x+stepJ+cn]*iw11,
-                                          W_BITS1-5) - Iptr[x];
-                    ib1 += (itemtype)(diff*dIptr[0]);
-                    ib2 += (itemtype)(diff*dIptr[1]);
-                }
+            for( ; x < winSize.width*cn; x++, dIptr += 2 )
+            {
+                int diff = CV_DESCALE(Jptr[x]*iw00 + Jptr[x+cn]*iw01 +
+                                      Jptr[x+stepJ]*iw10 + Jptr[x+stepJ+cn]*iw11,
+                                      W_BITS1-5) - Iptr[x];
+                ib1 += (itemtype)(diff*dIptr[0]);
+                ib2 += (itemtype)(diff*dIptr[1]);
             }
+        }
 
 #if CV_SIMD128 && !CV_NEON
-            v_float32x4 qf0, qf1;
-            v_recombine(v_interleave_pairs(v_add(qb0, qb1)), v_setzero_f32(), qf0, qf1);
-            ib1 += v_reduce_sum(qf0);
-            ib2 += v_reduce_sum(qf1);
+        v_float32x4 qf0, qf1;
+        v_recombine(v_interleave_pairs(v_add(qb0, qb1)), v_setzero_f32(), qf0, qf1);
+        ib1 += v_reduce_sum(qf0);
+        ib2 += v_reduce_sum(qf1);
 #endif
 
 #if CV_NEON
 
-            ib1 += (float)(nB1[0] + nB1[1] + nB1[2] + nB1[3]);
-            ib2 += (float)(nB2[0] + nB2[1] + nB2[2] + nB2[3]);
+        ib1 += (float)(nB1[0] + nB1[1] + nB1[2] + nB1[3]);
+        ib2 += (float)(nB2[0] + nB2[1] + nB2[2] + nB2[3]);
 #endif
 
-            b1 = ib1*FLT_SCALE;
-            b2 = ib2*FLT_SCALE;
+        b1 = ib1*FLT_SCALE;
+        b2 = ib2*FLT_SCALE;
 
-            Point2f delta( (float)((A12*b2 - A22*b1) * D),
-                          (float)((A12*b1 - A11*b2) * D));
-            //delta = -delta;
+        Point2f delta( (float)((A12*b2 - A22*b1) * D),
+                      (float)((A12*b1 - A11*b2) * D));
+        //delta = -delta;
 
-            nextPt += delta;
-            nextPts[ptidx] = nextPt + halfWin;
+        nextPt += delta;
+        nextPoint = nextPt + halfWin;
 
-            if( delta.ddot(delta) <= criteria.epsilon )
-                break;
+        if( delta.ddot(delta) <= criteria.epsilon )
+            break;
 
-            if( j > 0 && std::abs(delta.x + prevDelta.x) < 0.01 &&
-               std::abs(delta.y + prevDelta.y) < 0.01 )
-            {
-                nextPts[ptidx] -= delta*0.5f;
-                break;
-            }
-            prevDelta = delta;
+        if( j > 0 && std::abs(delta.x + prevDelta.x) < 0.01 &&
+           std::abs(delta.y + prevDelta.y) < 0.01 )
+        {
+            nextPoint -= delta*0.5f;
+            break;
         }
+        prevDelta = delta;
+    }
 
-        CV_Assert(status != NULL);
-        if( status[ptidx] && err && level == 0 && (flags & OPTFLOW_LK_GET_MIN_EIGENVALS) == 0 )
-        {
-            Point2f nextPoint = nextPts[ptidx] - halfWin;
-            Point inextPoint;
+    return LK_TRACKED;
+}
 
-            inextPoint.x = cvFloor(nextPoint.x);
-            inextPoint.y = cvFloor(nextPoint.y);
+// Computes the mean absolute difference between the window of the first image left in IWinBuf
+// by lkTrackPoint() and the window around nextPoint in J. Returns false if that window is outside of J.
+static bool lkPatchError( const cv::Mat& J, const cv::Mat& IWinBuf, cv::Point2f nextPoint,
+                          cv::Size winSize, float& err )
+{
+    using namespace cv;
 
-            if( inextPoint.x < -winSize.width || inextPoint.x >= J.cols ||
-                inextPoint.y < -winSize.height || inextPoint.y >= J.rows )
-            {
-                if( status )
-                    status[ptidx] = false;
-                continue;
-            }
+    Point2f halfWin((winSize.width-1)*0.5f, (winSize.height-1)*0.5f);
+    Point2f nextPt = nextPoint - halfWin;
+    Point inextPt;
+    int x, y, cn = J.channels();
+    int stepJ = (int)(J.step/J.elemSize1());
+    const int W_BITS = 14, W_BITS1 = 14;
+
+    inextPt.x = cvFloor(nextPt.x);
+    inextPt.y = cvFloor(nextPt.y);
+
+    if( inextPt.x < -winSize.width || inextPt.x >= J.cols ||
+        inextPt.y < -winSize.height || inextPt.y >= J.rows )
+        return false;
+
+    float aa = nextPt.x - inextPt.x;
+    float bb = nextPt.y - inextPt.y;
+    int iw00 = cvRound((1.f - aa)*(1.f - bb)*(1 << W_BITS));
+    int iw01 = cvRound(aa*(1.f - bb)*(1 << W_BITS));
+    int iw10 = cvRound((1.f - aa)*bb*(1 << W_BITS));
+    int iw11 = (1 << W_BITS) - iw00 - iw01 - iw10;
+    float errval = 0.f;
+
+    for( y = 0; y < winSize.height; y++ )
+    {
+        const uchar* Jptr = J.ptr() + (y + inextPt.y)*stepJ + inextPt.x*cn;
+        const deriv_type* Iptr = IWinBuf.ptr<deriv_type>(y);
 
-            float aa = nextPoint.x - inextPoint.x;
-            float bb = nextPoint.y - inextPoint.y;
-            iw00 = cvRound((1.f - aa)*(1.f - bb)*(1 << W_BITS));
-            iw01 = cvRound(aa*(1.f - bb)*(1 << W_BITS));
-            iw10 = cvRound((1.f - aa)*bb*(1 << W_BITS));
-            iw11 = (1 << W_BITS) - iw00 - iw01 - iw10;
-            float errval = 0.f;
+        for( x = 0; x < winSize.width*cn; x++ )
+        {
+            int diff = CV_DESCALE(Jptr[x]*iw00 + Jptr[x+cn]*iw01 +
+                                  Jptr[x+stepJ]*iw10 + Jptr[x+stepJ+cn]*iw11,
+                                  W_BITS1-5) - Iptr[x];
+            errval += std::abs((float)diff);
+        }
+    }
+    err = errval * 1.f/(32*winSize.width*cn*winSize.height);
+    return true;
+}
 
-            for( y = 0; y < winSize.height; y++ )
-            {
-                const uchar* Jptr = J.ptr() + (y + inextPoint.y)*stepJ + inextPoint.x*cn;
-                const deriv_type* Iptr = IWinBuf.ptr<deriv_type>(y);
+// Processes one pyramid level of calcOpticalFlowPyrLK for one point. prevPt is the point in the first
+// image at level 0. On the top level nextPt holds the initial estimate at level 0 if OPTFLOW_USE_INITIAL_FLOW
+// is set; on the other levels it holds the estimate from the level above. It receives the estimate on this level.
+// status and err are only set on level 0, except the minimal eigenvalue requested by OPTFLOW_LK_GET_MIN_EIGENVALS.
+static void lkTrackPointOnLevel( const cv::Mat& I, const cv::Mat& derivI, const cv::Mat& J, int level, int maxLevel,
+                                 int flags, cv::Point2f prevPt, cv::Point2f& nextPt, uchar* status, float* err,
+                                 cv::Size winSize, const cv::TermCriteria& criteria, float minEigThreshold,
+                                 cv::Mat& IWinBuf, cv::Mat& derivIWinBuf )
+{
+    using namespace cv;
 
-                for( x = 0; x < winSize.width*cn; x++ )
-                {
-                    int diff = CV_DESCALE(Jptr[x]*iw00 + Jptr[x+cn]*iw01 +
-                                          Jptr[x+stepJ]*iw10 + Jptr[x+stepJ+cn]*iw11,
-                                          W_BITS1-5) - Iptr[x];
-                    errval += std::abs((float)diff);
-                }
-            }
-            err[ptidx] = errval * 1.f/(32*winSize.width*cn*winSize.height);
+    prevPt *= (float)(1./(1 << level));
+    if( level == maxLevel )
+    {
+        if( flags & OPTFLOW_USE_INITIAL_FLOW )
+            nextPt *= (float)(1./(1 << level));
+        else
+            nextPt = prevPt;
+    }
+    else
+        nextPt *= 2.f;
+
+    float minEig = 0.f;
+    int result = lkTrackPoint(I, derivI, J, prevPt, nextPt, winSize, criteria,
+                              minEigThreshold, IWinBuf, derivIWinBuf, minEig);
+    if( result == LK_OUTSIDE_PREV )
+    {
+        if( level == 0 )
+        {
+            if( status )
+                *status = false;
+            if( err )
+                *err = 0;
         }
+        return;
+    }
+
+    if( err && (flags & OPTFLOW_LK_GET_MIN_EIGENVALS) != 0 )
+        *err = minEig;
+
+    if( result != LK_TRACKED )
+    {
+        if( level == 0 && status )
+            *status = false;
+        return;
+    }
+
+    CV_Assert(status != NULL);
+    if( *status && err && level == 0 && (flags & OPTFLOW_LK_GET_MIN_EIGENVALS) == 0 )
+    {
+        if( !lkPatchError(J, IWinBuf, nextPt, winSize, *err) )
+            *status = false;
     }
 }
 
+}//namespace
+
+void cv::detail::LKTrackerInvoker::operator()(const Range& range) const
+{
+    CV_INSTRUMENT_REGION();
+
+    cv::AutoBuffer<deriv_type> _buf;
+    Mat IWinBuf, derivIWinBuf;
+    lkAllocWinBufs(_buf, winSize, prevImg->channels(), IWinBuf, derivIWinBuf);
+
+    for( int ptidx = range.start; ptidx < range.end; ptidx++ )
+        lkTrackPointOnLevel(*prevImg, *prevDeriv, *nextImg, level, maxLevel, flags,
+                            prevPts[ptidx], nextPts[ptidx], status ? status + ptidx : 0, err ? err + ptidx : 0,
+                            winSize, criteria, minEigThreshold, IWinBuf, derivIWinBuf);
+}
+
 int cv::buildOpticalFlowPyramid(InputArray _img, OutputArrayOfArrays pyramid, Size winSize, int maxLevel, bool withDerivatives,
                                 int pyrBorder, int derivBorder, bool tryReuseInputImage)
 {
@@ -1403,11 +1481,210 @@ void SparsePyrLKOpticalFlowImpl::calc( InputArray _prevImg, InputArray _nextImg,
     }
 }
 
+static bool isSameImage( const Mat& a, const Mat& b )
+{
+    if( a.size() != b.size() || a.type() != b.type() )
+        return false;
+    size_t rowSize = a.cols*a.elemSize();
+    for( int y = 0; y < a.rows; y++ )
+        if( memcmp(a.ptr(y), b.ptr(y), rowSize) != 0 )
+            return false;
+    return true;
+}
+
+class SparsePyrLKPointTrackerImpl CV_FINAL : public SparsePyrLKPointTracker
+{
+public:
+    SparsePyrLKPointTrackerImpl(Size winSize_, int maxLevel_, TermCriteria criteria_, int flags_,
+                                double minEigThreshold_, double fbThreshold_) :
+        winSize(winSize_), maxLevel(maxLevel_), criteria(criteria_), flags(flags_),
+        minEigThreshold(minEigThreshold_), fbThreshold(fbThreshold_), pyrMaxLevel(-1), pyrLevels(0)
+    {
+    }
+
+    virtual Size getWinSize() const CV_OVERRIDE { return winSize;}
+    virtual void setWinSize(Size winSize_) CV_OVERRIDE { winSize = winSize_;}
+
+    virtual int getMaxLevel() const CV_OVERRIDE { return maxLevel;}
+    virtual void setMaxLevel(int maxLevel_) CV_OVERRIDE { maxLevel = maxLevel_;}
+
+    virtual TermCriteria getTermCriteria() const CV_OVERRIDE { return criteria;}
+    virtual void setTermCriteria(TermCriteria& crit_) CV_OVERRIDE { criteria=crit_;}
+
+    virtual int getFlags() const CV_OVERRIDE { return flags; }
+    virtual void setFlags(int flags_) CV_OVERRIDE { flags=flags_;}
+
+    virtual double getMinEigThreshold() const CV_OVERRIDE { return minEigThreshold;}
+    virtual void setMinEigThreshold(double minEigThreshold_) CV_OVERRIDE { minEigThreshold=minEigThreshold_;}
+
+    virtual double getFBThreshold() const CV_OVERRIDE { return fbThreshold;}
+    virtual void setFBThreshold(double fbThreshold_) CV_OVERRIDE { fbThreshold=fbThreshold_;}
+
+    virtual void calc(InputArray prevImg, InputArray nextImg,
+                      InputArray prevPts, InputOutputArray nextPts,
+                      OutputArray status,
+                      OutputArray err = cv::noArray()) CV_OVERRIDE;
+
+    virtual void clear() CV_OVERRIDE
+    {
+        prevPyr.clear();
+        nextPyr.clear();
+    }
+
+    virtual String getDefaultName() const CV_OVERRIDE { return "SparseOpticalFlow.SparsePyrLKPointTracker"; }
+
+private:
+    Size winSize;
+    int maxLevel;
+    TermCriteria criteria;
+    int flags;
+    double minEigThreshold;
+    double fbThreshold;
+
+    // the pyramids with derivatives; after calc() prevPyr holds the pyramid of the last nextImg,
+    // and nextPyr keeps the buffers of the previous one to build the next pyramid into
+    std::vector<Mat> prevPyr, nextPyr;
+    Size pyrWinSize;
+    int pyrMaxLevel;
+    int pyrLevels;
+};
+
+void SparsePyrLKPointTrackerImpl::calc( InputArray _prevImg, InputArray _nextImg,
+                                        InputArray _prevPts, InputOutputArray _nextPts,
+                                        OutputArray _status, OutputArray _err )
+{
+    CV_INSTRUMENT_REGION();
+
+    Mat prevImg = _prevImg.getMat(), nextImg = _nextImg.getMat();
+    Mat prevPtsMat = _prevPts.getMat();
+
+    CV_Assert( maxLevel >= 0 && winSize.width > 2 && winSize.height > 2 );
+    CV_Assert( prevImg.depth() == CV_8U && prevImg.type() == nextImg.type() &&
+               prevImg.size() == nextImg.size() );
+
+    int npoints;
+    CV_Assert( (npoints = prevPtsMat.checkVector(2, CV_32F, true)) >= 0 );
+
+    // the pyramid of nextImg is kept even if there is nothing to track in this frame
+    int levels = pyrLevels;
+    if( prevPyr.empty() || pyrWinSize != winSize || pyrMaxLevel != maxLevel ||
+        !isSameImage(prevPyr[0], prevImg) )
+        levels = buildOpticalFlowPyramid(prevImg, prevPyr, winSize, maxLevel, true,
+                                         BORDER_REFLECT_101, BORDER_CONSTANT, false);
+    buildOpticalFlowPyramid(nextImg, nextPyr, winSize, maxLevel, true,
+                            BORDER_REFLECT_101, BORDER_CONSTANT, false);
+
+    if( npoints > 0 )
+    {
+        if( !(flags & OPTFLOW_USE_INITIAL_FLOW) )
+            _nextPts.create(prevPtsMat.size(), prevPtsMat.type(), -1, true);
+
+        Mat nextPtsMat = _nextPts.getMat();
+        CV_Assert( nextPtsMat.checkVector(2, CV_32F, true) == npoints );
+
+        const Point2f* prevPts = prevPtsMat.ptr<Point2f>();
+        Point2f* nextPts = nextPtsMat.ptr<Point2f>();
+
+        _status.create((int)npoints, 1, CV_8U, -1, true);
+        Mat statusMat = _status.getMat(), errMat;
+        CV_Assert( statusMat.isContinuous() );
+        uchar* status = statusMat.ptr();
+        float* err = 0;
+
+        if( _err.needed() )
+        {
+            _err.create((int)npoints, 1, CV_32F, -1, true);
+            errMat = _err.getMat();
+            CV_Assert( errMat.isContinuous() );
+            err = errMat.ptr<float>();
+        }
+
+        TermCriteria crit = criteria;
+        if( (crit.type & TermCriteria::COUNT) == 0 )
+            crit.maxCount = 30;
+        else
+            crit.maxCount = std::min(std::max(crit.maxCount, 0), 100);
+        if( (crit.type & TermCriteria::EPS) == 0 )
+            crit.epsilon = 0.01;
+        else
+            crit.epsilon = std::min(std::max(crit.epsilon, 0.), 10.);
+        crit.epsilon *= crit.epsilon;
+
+        bool fbCheck = fbThreshold > 0;
+        float fbThreshold2 = (float)(fbThreshold*fbThreshold);
+        int cn = prevImg.channels();
+
+        // the points are processed in small blocks that go through all the levels, and back through
+        // all the levels of the swapped pyramids when the forward-backward check is on. This needs no
+        // synchronization between the levels and keeps the parts of the pyramids used by a block in cache.
+        const int BLOCK_SIZE = 64;
+        parallel_for_(Range(0, (npoints + BLOCK_SIZE - 1)/BLOCK_SIZE), [&](const Range& range)
+        {
+            AutoBuffer<cv::detail::deriv_type> _buf;
+            Mat IWinBuf, derivIWinBuf;
+            lkAllocWinBufs(_buf, winSize, cn, IWinBuf, derivIWinBuf);
+            Point2f backPts[BLOCK_SIZE];
+            uchar backStatus[BLOCK_SIZE];
+
+            for( int block = range.start; block < range.end; block++ )
+            {
+                int start = block*BLOCK_SIZE, end = std::min(start + BLOCK_SIZE, npoints);
+                int level, ptidx;
+
+                for( ptidx = start; ptidx < end; ptidx++ )
+                    status[ptidx] = true;
+
+                for( level = levels; level >= 0; level-- )
+                    for( ptidx = start; ptidx < end; ptidx++ )
+                        lkTrackPointOnLevel(prevPyr[level*2], prevPyr[level*2+1], nextPyr[level*2], level, levels,
+                                            flags, prevPts[ptidx], nextPts[ptidx], status + ptidx,
+                                            err ? err + ptidx : 0, winSize, crit, (float)minEigThreshold,
+                                            IWinBuf, derivIWinBuf);
+
+                if( !fbCheck )
+                    continue;
+
+                for( ptidx = start; ptidx < end; ptidx++ )
+                    backStatus[ptidx - start] = true;
+
+                for( level = levels; level >= 0; level-- )
+                    for( ptidx = start; ptidx < end; ptidx++ )
+                        if( status[ptidx] )
+                            lkTrackPointOnLevel(nextPyr[level*2], nextPyr[level*2+1], prevPyr[level*2], level, levels,
+                                                0, nextPts[ptidx], backPts[ptidx - start], backStatus + ptidx - start,
+                                                0, winSize, crit, (float)minEigThreshold, IWinBuf, derivIWinBuf);
+
+                for( ptidx = start; ptidx < end; ptidx++ )
+                {
+                    Point2f d = backPts[ptidx - start] - prevPts[ptidx];
+                    if( status[ptidx] && (!backStatus[ptidx - start] || d.dot(d) > fbThreshold2) )
+                        status[ptidx] = false;
+                }
+            }
+        });
+    }
+    else
+    {
+        _nextPts.release();
+        _status.release();
+        _err.release();
+    }
+
+    std::swap(prevPyr, nextPyr);
+    pyrWinSize = winSize;
+    pyrMaxLevel = maxLevel;
+    pyrLevels = levels;
+}
+
 } // namespace
 } // namespace cv
 cv::Ptr<cv::SparsePyrLKOpticalFlow> cv::SparsePyrLKOpticalFlow::create(Size winSize, int maxLevel, TermCriteria crit, int flags, double minEigThreshold){
     return makePtr<SparsePyrLKOpticalFlowImpl>(winSize,maxLevel,crit,flags,minEigThreshold);
 }
+cv::Ptr<cv::SparsePyrLKPointTracker> cv::SparsePyrLKPointTracker::create(Size winSize, int maxLevel, TermCriteria crit, int flags,
+                                                                       double minEigThreshold, double fbThreshold){
+    return makePtr<SparsePyrLKPointTrackerImpl>(winSize,maxLevel,crit,flags,minEigThreshold,fbThreshold);
+}
 void cv::calcOpticalFlowPyrLK( InputArray _prevImg, InputArray _nextImg,
                                InputArray _prevPts, InputOutputArray _nextPts,
                                OutputArray _status, OutputArray _err,
@@ -116,90 +116,159 @@ FarnebackPrepareGaussian(int n, double sigma, float *g, float *xg, float *xxg,
 static void
 FarnebackPolyExp( const Mat& src, Mat& dst, int n, double sigma )
 {
-    int k, x, y;
-
     CV_Assert( src.type() == CV_32FC1 );
     int width = src.cols;
     int height = src.rows;
-    AutoBuffer<float> kbuf(n*6 + 3), _row((width + n*2)*3);
+    AutoBuffer<float> kbuf(n*6 + 3);
     float* g = kbuf.data() + n;
     float* xg = g + n*2 + 1;
     float* xxg = xg + n*2 + 1;
-    float *row = _row.data() + n*3;
     double ig11, ig03, ig33, ig55;
 
     FarnebackPrepareGaussian(n, sigma, g, xg, xxg, ig11, ig03, ig33, ig55);
 
     dst.create( height, width, CV_32FC(5));
 
-    for( y = 0; y < height; y++ )
+    const float fig11 = (float)ig11, fig03 = (float)ig03, fig33 = (float)ig33, fig55 = (float)ig55;
+    parallel_for_(Range(0, height), [&](const Range& range)
     {
-        float g0 = g[0], g1, g2;
-        const float *srow0 = src.ptr<float>(y), *srow1 = 0;
-        float *drow = dst.ptr<float>(y);
-
-        // vertical part of convolution
-        for( x = 0; x < width; x++ )
+        // the vertical convolutions with g, xg and xxg, extended by n pixels on both sides
+        const int rstep = width + n*2;
+        AutoBuffer<float> _row(rstep*3);
+        float* row0 = _row.data() + n;
+        float* row1 = row0 + rstep;
+        float* row2 = row1 + rstep;
+        int x, k;
+
+        for( int y = range.start; y < range.end; y++ )
         {
-            row[x*3] = srow0[x]*g0;
-            row[x*3+1] = row[x*3+2] = 0.f;
-        }
+            const float *srow0 = src.ptr<float>(y), *srow1;
+            float *drow = dst.ptr<float>(y);
 
-        for( k = 1; k <= n; k++ )
-        {
-            g0 = g[k]; g1 = xg[k]; g2 = xxg[k];
-            srow0 = src.ptr<float>(std::max(y-k,0));
-            srow1 = src.ptr<float>(std::min(y+k,height-1));
-
-            for( x = 0; x < width; x++ )
+            // vertical part of convolution
+            x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+            const int vlanes = VTraits<v_float32>::vlanes();
+            {
+                v_float32 vg0 = vx_setall_f32(g[0]), vz = vx_setzero_f32();
+                for( ; x <= width - vlanes; x += vlanes )
+                {
+                    v_store(row0 + x, v_mul(vx_load(srow0 + x), vg0));
+                    v_store(row1 + x, vz);
+                    v_store(row2 + x, vz);
+                }
+            }
+#endif
+            for( ; x < width; x++ )
             {
-                float p = srow0[x] + srow1[x];
-                float t0 = row[x*3] + g0*p;
-                float t1 = row[x*3+1] + g1*(srow1[x] - srow0[x]);
-                float t2 = row[x*3+2] + g2*p;
-
-                row[x*3] = t0;
-                row[x*3+1] = t1;
-                row[x*3+2] = t2;
+                row0[x] = srow0[x]*g[0];
+                row1[x] = row2[x] = 0.f;
             }
-        }
 
-        // horizontal part of convolution
-        for( x = 0; x < n*3; x++ )
-        {
-            row[-1-x] = row[2-x];
-            row[width*3+x] = row[width*3+x-3];
-        }
+            for( k = 1; k <= n; k++ )
+            {
+                float g0 = g[k], g1 = xg[k], g2 = xxg[k];
+                srow0 = src.ptr<float>(std::max(y-k,0));
+                srow1 = src.ptr<float>(std::min(y+k,height-1));
+
+                x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+                v_float32 vg0 = vx_setall_f32(g0), vg1 = vx_setall_f32(g1), vg2 = vx_setall_f32(g2);
+                for( ; x <= width - vlanes; x += vlanes )
+                {
+                    v_float32 s0 = vx_load(srow0 + x), s1 = vx_load(srow1 + x);
+                    v_float32 p = v_add(s0, s1);
+                    v_store(row0 + x, v_muladd(p, vg0, vx_load(row0 + x)));
+                    v_store(row1 + x, v_muladd(v_sub(s1, s0), vg1, vx_load(row1 + x)));
+                    v_store(row2 + x, v_muladd(p, vg2, vx_load(row2 + x)));
+                }
+#endif
+                for( ; x < width; x++ )
+                {
+                    float p = srow0[x] + srow1[x];
+                    row0[x] += g0*p;
+                    row1[x] += g1*(srow1[x] - srow0[x]);
+                    row2[x] += g2*p;
+                }
+            }
 
-        for( x = 0; x < width; x++ )
-        {
-            g0 = g[0];
-            // r1 ~ 1, r2 ~ x, r3 ~ y, r4 ~ x^2, r5 ~ y^2, r6 ~ xy
-            double b1 = row[x*3]*g0, b2 = 0, b3 = row[x*3+1]*g0,
-                b4 = 0, b5 = row[x*3+2]*g0, b6 = 0;
+            // horizontal part of convolution
+            for( x = 1; x <= n; x++ )
+            {
+                row0[-x] = row0[0]; row0[width-1+x] = row0[width-1];
+                row1[-x] = row1[0]; row1[width-1+x] = row1[width-1];
+                row2[-x] = row2[0]; row2[width-1+x] = row2[width-1];
+            }
 
-            for( k = 1; k <= n; k++ )
+            x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
             {
-                double tg = row[(x+k)*3] + row[(x-k)*3];
-                g0 = g[k];
-                b1 += tg*g0;
-                b4 += tg*xxg[k];
-                b2 += (row[(x+k)*3] - row[(x-k)*3])*xg[k];
-                b3 += (row[(x+k)*3+1] + row[(x-k)*3+1])*g0;
-                b6 += (row[(x+k)*3+1] - row[(x-k)*3+1])*xg[k];
-                b5 += (row[(x+k)*3+2] + row[(x-k)*3+2])*g0;
+                float buf[5][VTraits<v_float32>::max_nlanes];
+                v_float32 vig11 = vx_setall_f32(fig11), vig03 = vx_setall_f32(fig03);
+                v_float32 vig33 = vx_setall_f32(fig33), vig55 = vx_setall_f32(fig55);
+                for( ; x <= width - vlanes; x += vlanes )
+                {
+                    // r1 ~ 1, r2 ~ x, r3 ~ y, r4 ~ x^2, r5 ~ y^2, r6 ~ xy
+                    v_float32 vg0 = vx_setall_f32(g[0]);
+                    v_float32 b1 = v_mul(vx_load(row0 + x), vg0), b2 = vx_setzero_f32();
+                    v_float32 b3 = v_mul(vx_load(row1 + x), vg0), b4 = vx_setzero_f32();
+                    v_float32 b5 = v_mul(vx_load(row2 + x), vg0), b6 = vx_setzero_f32();
+
+                    for( k = 1; k <= n; k++ )
+                    {
+                        v_float32 vg = vx_setall_f32(g[k]), vxg = vx_setall_f32(xg[k]), vxxg = vx_setall_f32(xxg[k]);
+                        v_float32 r0p = vx_load(row0 + x + k), r0m = vx_load(row0 + x - k);
+                        v_float32 r1p = vx_load(row1 + x + k), r1m = vx_load(row1 + x - k);
+                        v_float32 tg = v_add(r0p, r0m);
+                        b1 = v_muladd(tg, vg, b1);
+                        b4 = v_muladd(tg, vxxg, b4);
+                        b2 = v_muladd(v_sub(r0p, r0m), vxg, b2);
+                        b3 = v_muladd(v_add(r1p, r1m), vg, b3);
+                        b6 = v_muladd(v_sub(r1p, r1m), vxg, b6);
+                        b5 = v_muladd(v_add(vx_load(row2 + x + k), vx_load(row2 + x - k)), vg, b5);
+                    }
+
+                    v_store(buf[0], v_mul(b3, vig11));
+                    v_store(buf[1], v_mul(b2, vig11));
+                    v_store(buf[2], v_muladd(b1, vig03, v_mul(b5, vig33)));
+                    v_store(buf[3], v_muladd(b1, vig03, v_mul(b4, vig33)));
+                    v_store(buf[4], v_mul(b6, vig55));
+                    for( int i = 0; i < vlanes; i++ )
+                    {
+                        float* d = drow + (x + i)*5;
+                        d[0] = buf[0][i]; d[1] = buf[1][i]; d[2] = buf[2][i];
+                        d[3] = buf[3][i]; d[4] = buf[4][i];
+                    }
+                }
             }
+#endif
+            for( ; x < width; x++ )
+            {
+                float g0 = g[0];
+                float b1 = row0[x]*g0, b2 = 0, b3 = row1[x]*g0,
+                    b4 = 0, b5 = row2[x]*g0, b6 = 0;
 
-            // do not store r1
-            drow[x*5+1] = (float)(b2*ig11);
-            drow[x*5] = (float)(b3*ig11);
-            drow[x*5+3] = (float)(b1*ig03 + b4*ig33);
-            drow[x*5+2] = (float)(b1*ig03 + b5*ig33);
-            drow[x*5+4] = (float)(b6*ig55);
-        }
-    }
+                for( k = 1; k <= n; k++ )
+                {
+                    float tg = row0[x+k] + row0[x-k];
+                    g0 = g[k];
+                    b1 += tg*g0;
+                    b4 += tg*xxg[k];
+                    b2 += (row0[x+k] - row0[x-k])*xg[k];
+                    b3 += (row1[x+k] + row1[x-k])*g0;
+                    b6 += (row1[x+k] - row1[x-k])*xg[k];
+                    b5 += (row2[x+k] + row2[x-k])*g0;
+                }
 
-    row -= n*3;
+                // do not store r1
+                drow[x*5+1] = b2*fig11;
+                drow[x*5] = b3*fig11;
+                drow[x*5+3] = b1*fig03 + b4*fig33;
+                drow[x*5+2] = b1*fig03 + b5*fig33;
+                drow[x*5+4] = b6*fig55;
+            }
+        }
+    });
 }
 
 
@@ -220,125 +289,119 @@ FarnebackUpdateMatrices( const Mat& _R0, const Mat& _R1, const Mat& _flow, Mat&
     const int BORDER = 5;
     static const float border[BORDER] = {0.14f, 0.14f, 0.4472f, 0.4472f, 0.4472f};
 
-    int x, y, width = _flow.cols, height = _flow.rows;
+    int width = _flow.cols, height = _flow.rows;
     const float* R1 = _R1.ptr<float>();
     size_t step1 = _R1.step/sizeof(R1[0]);
 
     matM.create(height, width, CV_32FC(5));
 
-    for( y = _y0; y < _y1; y++ )
+    parallel_for_(Range(_y0, _y1), [&](const Range& range)
     {
-        const float* flow = _flow.ptr<float>(y);
-        const float* R0 = _R0.ptr<float>(y);
-        float* M = matM.ptr<float>(y);
-
-        for( x = 0; x < width; x++ )
+        for( int y = range.start; y < range.end; y++ )
         {
-            float dx = flow[x*2], dy = flow[x*2+1];
-            float fx = x + dx, fy = y + dy;
+            const float* flow = _flow.ptr<float>(y);
+            const float* R0 = _R0.ptr<float>(y);
+            float* M = matM.ptr<float>(y);
 
-#if 1
-            int x1 = cvFloor(fx), y1 = cvFloor(fy);
-            const float* ptr = R1 + y1*step1 + x1*5;
-            float r2, r3, r4, r5, r6;
+            for( int x = 0; x < width; x++ )
+            {
+                float dx = flow[x*2], dy = flow[x*2+1];
+                float fx = x + dx, fy = y + dy;
 
-            fx -= x1; fy -= y1;
+                int x1 = cvFloor(fx), y1 = cvFloor(fy);
+                const float* ptr = R1 + y1*step1 + x1*5;
+                float r2, r3, r4, r5, r6;
 
-            if( (unsigned)x1 < (unsigned)(width-1) &&
-                (unsigned)y1 < (unsigned)(height-1) )
-            {
-                float a00 = (1.f-fx)*(1.f-fy), a01 = fx*(1.f-fy),
-                      a10 = (1.f-fx)*fy, a11 = fx*fy;
-
-                r2 = a00*ptr[0] + a01*ptr[5] + a10*ptr[step1] + a11*ptr[step1+5];
-                r3 = a00*ptr[1] + a01*ptr[6] + a10*ptr[step1+1] + a11*ptr[step1+6];
-                r4 = a00*ptr[2] + a01*ptr[7] + a10*ptr[step1+2] + a11*ptr[step1+7];
-                r5 = a00*ptr[3] + a01*ptr[8] + a10*ptr[step1+3] + a11*ptr[step1+8];
-                r6 = a00*ptr[4] + a01*ptr[9] + a10*ptr[step1+4] + a11*ptr[step1+9];
-
-                r4 = (R0[x*5+2] + r4)*0.5f;
-                r5 = (R0[x*5+3] + r5)*0.5f;
-                r6 = (R0[x*5+4] + r6)*0.25f;
-            }
-#else
-            int x1 = cvRound(fx), y1 = cvRound(fy);
-            const float* ptr = R1 + y1*step1 + x1*5;
-            float r2, r3, r4, r5, r6;
+                fx -= x1; fy -= y1;
 
-            if( (unsigned)x1 < (unsigned)width &&
-                (unsigned)y1 < (unsigned)height )
-            {
-                r2 = ptr[0];
-                r3 = ptr[1];
-                r4 = (R0[x*5+2] + ptr[2])*0.5f;
-                r5 = (R0[x*5+3] + ptr[3])*0.5f;
-                r6 = (R0[x*5+4] + ptr[4])*0.25f;
-            }
+                if( (unsigned)x1 < (unsigned)(width-1) &&
+                    (unsigned)y1 < (unsigned)(height-1) )
+                {
+                    float a00 = (1.f-fx)*(1.f-fy), a01 = fx*(1.f-fy),
+                          a10 = (1.f-fx)*fy, a11 = fx*fy;
+
+#if CV_SIMD128
+                    // r2..r5 of the 4 neighbours are interpolated at once
+                    v_float32x4 r = v_muladd(v_load(ptr), v_setall_f32(a00),
+                                    v_muladd(v_load(ptr + 5), v_setall_f32(a01),
+                                    v_muladd(v_load(ptr + step1), v_setall_f32(a10),
+                                             v_mul(v_load(ptr + step1 + 5), v_setall_f32(a11)))));
+                    float CV_DECL_ALIGNED(16) rbuf[4];
+                    v_store_aligned(rbuf, r);
+                    r2 = rbuf[0]; r3 = rbuf[1]; r4 = rbuf[2]; r5 = rbuf[3];
+#else
+                    r2 = a00*ptr[0] + a01*ptr[5] + a10*ptr[step1] + a11*ptr[step1+5];
+                    r3 = a00*ptr[1] + a01*ptr[6] + a10*ptr[step1+1] + a11*ptr[step1+6];
+                    r4 = a00*ptr[2] + a01*ptr[7] + a10*ptr[step1+2] + a11*ptr[step1+7];
+                    r5 = a00*ptr[3] + a01*ptr[8] + a10*ptr[step1+3] + a11*ptr[step1+8];
 #endif
-            else
-            {
-                r2 = r3 = 0.f;
-                r4 = R0[x*5+2];
-                r5 = R0[x*5+3];
-                r6 = R0[x*5+4]*0.5f;
-            }
+                    r6 = a00*ptr[4] + a01*ptr[9] + a10*ptr[step1+4] + a11*ptr[step1+9];
 
-            r2 = (R0[x*5] - r2)*0.5f;
-            r3 = (R0[x*5+1] - r3)*0.5f;
+                    r4 = (R0[x*5+2] + r4)*0.5f;
+                    r5 = (R0[x*5+3] + r5)*0.5f;
+                    r6 = (R0[x*5+4] + r6)*0.25f;
+                }
+                else
+                {
+                    r2 = r3 = 0.f;
+                    r4 = R0[x*5+2];
+                    r5 = R0[x*5+3];
+                    r6 = R0[x*5+4]*0.5f;
+                }
 
-            r2 += r4*dy + r6*dx;
-            r3 += r6*dy + r5*dx;
+                r2 = (R0[x*5] - r2)*0.5f;
+                r3 = (R0[x*5+1] - r3)*0.5f;
 
-            if( (unsigned)(x - BORDER) >= (unsigned)(width - BORDER*2) ||
-                (unsigned)(y - BORDER) >= (unsigned)(height - BORDER*2))
-            {
-                float scale = (x < BORDER ? border[x] : 1.f)*
-                    (x >= width - BORDER ? border[width - x - 1] : 1.f)*
-                    (y < BORDER ? border[y] : 1.f)*
-                    (y >= height - BORDER ? border[height - y - 1] : 1.f);
+                r2 += r4*dy + r6*dx;
+                r3 += r6*dy + r5*dx;
 
-                r2 *= scale; r3 *= scale; r4 *= scale;
-                r5 *= scale; r6 *= scale;
-            }
+                if( (unsigned)(x - BORDER) >= (unsigned)(width - BORDER*2) ||
+                    (unsigned)(y - BORDER) >= (unsigned)(height - BORDER*2))
+                {
+                    float scale = (x < BORDER ? border[x] : 1.f)*
+                        (x >= width - BORDER ? border[width - x - 1] : 1.f)*
+                        (y < BORDER ? border[y] : 1.f)*
+                        (y >= height - BORDER ? border[height - y - 1] : 1.f);
+
+                    r2 *= scale; r3 *= scale; r4 *= scale;
+                    r5 *= scale; r6 *= scale;
+                }
 
-            M[x*5]   = r4*r4 + r6*r6; // G(1,1)
-            M[x*5+1] = (r4 + r5)*r6;  // G(1,2)=G(2,1)
-            M[x*5+2] = r5*r5 + r6*r6; // G(2,2)
-            M[x*5+3] = r4*r2 + r6*r3; // h(1)
-            M[x*5+4] = r6*r2 + r5*r3; // h(2)
+                M[x*5]   = r4*r4 + r6*r6; // G(1,1)
+                M[x*5+1] = (r4 + r5)*r6;  // G(1,2)=G(2,1)
+                M[x*5+2] = r5*r5 + r6*r6; // G(2,2)
+                M[x*5+3] = r4*r2 + r6*r3; // h(1)
+                M[x*5+4] = r6*r2 + r5*r3; // h(2)
+            }
         }
-    }
+    });
 }
 
 
+// solves blur(G)*flow=blur(h) for the rows of range with a box filter
 static void
-FarnebackUpdateFlow_Blur( const Mat& _R0, const Mat& _R1,
-                          Mat& _flow, Mat& matM, int block_size,
-                          bool update_matrices )
+FarnebackSolveFlow_Blur( const Mat& matM, Mat& _flow, int block_size, const Range& range )
 {
     int x, y, width = _flow.cols, height = _flow.rows;
     int m = block_size/2;
-    int y0 = 0, y1;
-    int min_update_stripe = std::max((1 << 10)/width, block_size);
     double scale = 1./(block_size*block_size);
 
     AutoBuffer<double> _vsum((width+m*2+2)*5);
     double* vsum = _vsum.data() + (m+1)*5;
 
-    // init vsum
-    const float* srow0 = matM.ptr<float>();
+    // init vsum with the rows range.start-m-1 ... range.start+m-1
+    const float* srow0 = matM.ptr<float>(std::max(range.start-m-1,0));
     for( x = 0; x < width*5; x++ )
-        vsum[x] = srow0[x]*(m+2);
+        vsum[x] = srow0[x];
 
-    for( y = 1; y < m; y++ )
+    for( y = range.start-m; y < range.start+m; y++ )
     {
-        srow0 = matM.ptr<float>(std::min(y,height-1));
+        srow0 = matM.ptr<float>(std::min(std::max(y,0),height-1));
         for( x = 0; x < width*5; x++ )
             vsum[x] += srow0[x];
     }
 
-    // compute blur(G)*flow=blur(h)
-    for( y = 0; y < height; y++ )
+    for( y = range.start; y < range.end; y++ )
     {
         double g11, g12, g22, h1, h2;
         float* flow = _flow.ptr<float>(y);
@@ -393,37 +456,49 @@ FarnebackUpdateFlow_Blur( const Mat& _R0, const Mat& _R1,
             flow[x*2] = (float)((g11_*h2_-g12_*h1_)*idet);
             flow[x*2+1] = (float)((g22_*h1_-g12_*h2_)*idet);
         }
-
-        y1 = y == height - 1 ? height : y - block_size;
-        if( update_matrices && (y1 == height || y1 >= y0 + min_update_stripe) )
-        {
-            FarnebackUpdateMatrices( _R0, _R1, _flow, matM, y0, y1 );
-            y0 = y1;
-        }
     }
 }
 
 
+// The flow of a row only depends on the matrices of the rows around it, and the matrices of
+// a row only depend on the flow of that row. So the flow of all the rows is computed from the old
+// matrices first and the matrices are updated afterwards, both in parallel.
+// Every stripe starts its running vertical sum from scratch, so the stripes have a fixed height
+// and the flow does not depend on how parallel_for_ splits the rows between the threads.
+static void
+FarnebackUpdateFlow_Blur( const Mat& _R0, const Mat& _R1,
+                          Mat& _flow, Mat& matM, int block_size,
+                          bool update_matrices )
+{
+    int height = _flow.rows;
+    int stripe_height = std::max(block_size*4, 32);
+    int nstripes = (height + stripe_height - 1)/stripe_height;
+    parallel_for_(Range(0, nstripes), [&](const Range& range)
+    {
+        for( int s = range.start; s < range.end; s++ )
+            FarnebackSolveFlow_Blur(matM, _flow, block_size,
+                                    Range(s*stripe_height, std::min((s+1)*stripe_height, height)));
+    });
+
+    if( update_matrices )
+        FarnebackUpdateMatrices( _R0, _R1, _flow, matM, 0, height );
+}
+
+
 static void
 FarnebackUpdateFlow_GaussianBlur( const Mat& _R0, const Mat& _R1,
                                   Mat& _flow, Mat& matM, int block_size,
                                   bool update_matrices )
 {
-    int x, y, i, width = _flow.cols, height = _flow.rows;
+    int width = _flow.cols, height = _flow.rows;
     int m = block_size/2;
-    int y0 = 0, y1;
-    int min_update_stripe = std::max((1 << 10)/width, block_size);
     double sigma = m*0.3, s = 1;
 
-    AutoBuffer<float> _vsum((width+m*2+2)*5 + 16), _hsum(width*5 + 16);
     AutoBuffer<float> _kernel((m+1)*5 + 16);
-    AutoBuffer<const float*> _srow(m*2+1);
-    float *vsum = alignPtr(_vsum.data() + (m+1)*5, 16), *hsum = alignPtr(_hsum.data(), 16);
     float* kernel = _kernel.data();
-    const float** srow = _srow.data();
     kernel[0] = (float)s;
 
-    for( i = 1; i <= m; i++ )
+    for( int i = 1; i <= m; i++ )
     {
         float t = (float)std::exp(-i*i/(2*sigma*sigma) );
         kernel[i] = t;
@@ -431,149 +506,155 @@ FarnebackUpdateFlow_GaussianBlur( const Mat& _R0, const Mat& _R1,
     }
 
     s = 1./s;
-    for( i = 0; i <= m; i++ )
+    for( int i = 0; i <= m; i++ )
         kernel[i] = (float)(kernel[i]*s);
 
 #if CV_SIMD128
     float* simd_kernel = alignPtr(kernel + m+1, 16);
     {
-        for( i = 0; i <= m; i++ )
+        for( int i = 0; i <= m; i++ )
             v_store(simd_kernel + i*4, v_setall_f32(kernel[i]));
     }
 #endif
 
-    // compute blur(G)*flow=blur(h)
-    for( y = 0; y < height; y++ )
+    // compute blur(G)*flow=blur(h); the rows are independent, so each stripe only needs its own
+    // buffers, and the matrices are updated once the flow of all the rows is known
+    parallel_for_(Range(0, height), [&](const Range& range)
     {
-        double g11, g12, g22, h1, h2;
-        float* flow = _flow.ptr<float>(y);
+        int x, i;
+        AutoBuffer<float> _vsum((width+m*2+2)*5 + 16), _hsum(width*5 + 16);
+        AutoBuffer<const float*> _srow(m*2+1);
+        float *vsum = alignPtr(_vsum.data() + (m+1)*5, 16), *hsum = alignPtr(_hsum.data(), 16);
+        const float** srow = _srow.data();
 
-        // vertical blur
-        for( i = 0; i <= m; i++ )
+        for( int y = range.start; y < range.end; y++ )
         {
-            srow[m-i] = matM.ptr<float>(std::max(y-i,0));
-            srow[m+i] = matM.ptr<float>(std::min(y+i,height-1));
-        }
+            double g11, g12, g22, h1, h2;
+            float* flow = _flow.ptr<float>(y);
 
-        x = 0;
-#if CV_SIMD128
-        {
-            for( ; x <= width*5 - 16; x += 16 )
+            // vertical blur
+            for( i = 0; i <= m; i++ )
             {
-                const float *sptr0 = srow[m], *sptr1;
-                v_float32x4 g4 = v_load(simd_kernel);
-                v_float32x4 s0, s1, s2, s3;
-                s0 = v_mul(v_load(sptr0 + x), g4);
-                s1 = v_mul(v_load(sptr0 + x + 4), g4);
-                s2 = v_mul(v_load(sptr0 + x + 8), g4);
-                s3 = v_mul(v_load(sptr0 + x + 12), g4);
-
-                for( i = 1; i <= m; i++ )
-                {
-                    v_float32x4 x0, x1;
-                    sptr0 = srow[m+i], sptr1 = srow[m-i];
-                    g4 = v_load(simd_kernel + i*4);
-                    x0 = v_add(v_load(sptr0 + x), v_load(sptr1 + x));
-                    x1 = v_add(v_load(sptr0 + x + 4), v_load(sptr1 + x + 4));
-                    s0 = v_muladd(x0, g4, s0);
-                    s1 = v_muladd(x1, g4, s1);
-                    x0 = v_add(v_load(sptr0 + x + 8), v_load(sptr1 + x + 8));
-                    x1 = v_add(v_load(sptr0 + x + 12), v_load(sptr1 + x + 12));
-                    s2 = v_muladd(x0, g4, s2);
-                    s3 = v_muladd(x1, g4, s3);
-                }
-
-                v_store(vsum + x, s0);
-                v_store(vsum + x + 4, s1);
-                v_store(vsum + x + 8, s2);
-                v_store(vsum + x + 12, s3);
+                srow[m-i] = matM.ptr<float>(std::max(y-i,0));
+                srow[m+i] = matM.ptr<float>(std::min(y+i,height-1));
             }
 
-            for( ; x <= width*5 - 4; x += 4 )
+            x = 0;
+#if CV_SIMD128
             {
-                const float *sptr0 = srow[m], *sptr1;
-                v_float32x4 g4 = v_load(simd_kernel);
-                v_float32x4 s0 = v_mul(v_load(sptr0 + x), g4);
+                for( ; x <= width*5 - 16; x += 16 )
+                {
+                    const float *sptr0 = srow[m], *sptr1;
+                    v_float32x4 g4 = v_load(simd_kernel);
+                    v_float32x4 s0, s1, s2, s3;
+                    s0 = v_mul(v_load(sptr0 + x), g4);
+                    s1 = v_mul(v_load(sptr0 + x + 4), g4);
+                    s2 = v_mul(v_load(sptr0 + x + 8), g4);
+                    s3 = v_mul(v_load(sptr0 + x + 12), g4);
+
+                    for( i = 1; i <= m; i++ )
+                    {
+                        v_float32x4 x0, x1;
+                        sptr0 = srow[m+i], sptr1 = srow[m-i];
+                        g4 = v_load(simd_kernel + i*4);
+                        x0 = v_add(v_load(sptr0 + x), v_load(sptr1 + x));
+                        x1 = v_add(v_load(sptr0 + x + 4), v_load(sptr1 + x + 4));
+                        s0 = v_muladd(x0, g4, s0);
+                        s1 = v_muladd(x1, g4, s1);
+                        x0 = v_add(v_load(sptr0 + x + 8), v_load(sptr1 + x + 8));
+                        x1 = v_add(v_load(sptr0 + x + 12), v_load(sptr1 + x + 12));
+                        s2 = v_muladd(x0, g4, s2);
+                        s3 = v_muladd(x1, g4, s3);
+                    }
+
+                    v_store(vsum + x, s0);
+                    v_store(vsum + x + 4, s1);
+                    v_store(vsum + x + 8, s2);
+                    v_store(vsum + x + 12, s3);
+                }
 
-                for( i = 1; i <= m; i++ )
+                for( ; x <= width*5 - 4; x += 4 )
                 {
-                    sptr0 = srow[m+i], sptr1 = srow[m-i];
-                    g4 = v_load(simd_kernel + i*4);
-                    v_float32x4 x0 = v_add(v_load(sptr0 + x), v_load(sptr1 + x));
-                    s0 = v_muladd(x0, g4, s0);
+                    const float *sptr0 = srow[m], *sptr1;
+                    v_float32x4 g4 = v_load(simd_kernel);
+                    v_float32x4 s0 = v_mul(v_load(sptr0 + x), g4);
+
+                    for( i = 1; i <= m; i++ )
+                    {
+                        sptr0 = srow[m+i], sptr1 = srow[m-i];
+                        g4 = v_load(simd_kernel + i*4);
+                        v_float32x4 x0 = v_add(v_load(sptr0 + x), v_load(sptr1 + x));
+                        s0 = v_muladd(x0, g4, s0);
+                    }
+                    v_store(vsum + x, s0);
                 }
-                v_store(vsum + x, s0);
             }
-        }
 #endif
-        for( ; x < width*5; x++ )
-        {
-            float s0 = srow[m][x]*kernel[0];
-            for( i = 1; i <= m; i++ )
-                s0 += (srow[m+i][x] + srow[m-i][x])*kernel[i];
-            vsum[x] = s0;
-        }
+            for( ; x < width*5; x++ )
+            {
+                float s0 = srow[m][x]*kernel[0];
+                for( i = 1; i <= m; i++ )
+                    s0 += (srow[m+i][x] + srow[m-i][x])*kernel[i];
+                vsum[x] = s0;
+            }
 
-        // update borders
-        for( x = 0; x < m*5; x++ )
-        {
-            vsum[-1-x] = vsum[4-x];
-            vsum[width*5+x] = vsum[width*5+x-5];
-        }
+            // update borders
+            for( x = 0; x < m*5; x++ )
+            {
+                vsum[-1-x] = vsum[4-x];
+                vsum[width*5+x] = vsum[width*5+x-5];
+            }
 
-        // horizontal blur
-        x = 0;
+            // horizontal blur
+            x = 0;
 #if CV_SIMD128
-        {
-            for( ; x <= width*5 - 8; x += 8 )
             {
-                v_float32x4 g4 = v_load(simd_kernel);
-                v_float32x4 s0 = v_mul(v_load(vsum + x), g4);
-                v_float32x4 s1 = v_mul(v_load(vsum + x + 4), g4);
-
-                for( i = 1; i <= m; i++ )
+                for( ; x <= width*5 - 8; x += 8 )
                 {
-                    g4 = v_load(simd_kernel + i*4);
-                    v_float32x4 x0 = v_add(v_load(vsum + x - i * 5), v_load(vsum + x + i * 5));
-                    v_float32x4 x1 = v_add(v_load(vsum + x - i * 5 + 4), v_load(vsum + x + i * 5 + 4));
-                    s0 = v_muladd(x0, g4, s0);
-                    s1 = v_muladd(x1, g4, s1);
+                    v_float32x4 g4 = v_load(simd_kernel);
+                    v_float32x4 s0 = v_mul(v_load(vsum + x), g4);
+                    v_float32x4 s1 = v_mul(v_load(vsum + x + 4), g4);
+
+                    for( i = 1; i <= m; i++ )
+                    {
+                        g4 = v_load(simd_kernel + i*4);
+                        v_float32x4 x0 = v_add(v_load(vsum + x - i * 5), v_load(vsum + x + i * 5));
+                        v_float32x4 x1 = v_add(v_load(vsum + x - i * 5 + 4), v_load(vsum + x + i * 5 + 4));
+                        s0 = v_muladd(x0, g4, s0);
+                        s1 = v_muladd(x1, g4, s1);
+                    }
+
+                    v_store(hsum + x, s0);
+                    v_store(hsum + x + 4, s1);
                 }
-
-                v_store(hsum + x, s0);
-                v_store(hsum + x + 4, s1);
             }
-        }
 #endif
-        for( ; x < width*5; x++ )
-        {
-            float sum = vsum[x]*kernel[0];
-            for( i = 1; i <= m; i++ )
-                sum += kernel[i]*(vsum[x - i*5] + vsum[x + i*5]);
-            hsum[x] = sum;
-        }
+            for( ; x < width*5; x++ )
+            {
+                float sum = vsum[x]*kernel[0];
+                for( i = 1; i <= m; i++ )
+                    sum += kernel[i]*(vsum[x - i*5] + vsum[x + i*5]);
+                hsum[x] = sum;
+            }
 
-        for( x = 0; x < width; x++ )
-        {
-            g11 = hsum[x*5];
-            g12 = hsum[x*5+1];
-            g22 = hsum[x*5+2];
-            h1 = hsum[x*5+3];
-            h2 = hsum[x*5+4];
+            for( x = 0; x < width; x++ )
+            {
+                g11 = hsum[x*5];
+                g12 = hsum[x*5+1];
+                g22 = hsum[x*5+2];
+                h1 = hsum[x*5+3];
+                h2 = hsum[x*5+4];
 
-            double idet = 1./(g11*g22 - g12*g12 + 1e-3);
+                double idet = 1./(g11*g22 - g12*g12 + 1e-3);
 
-            flow[x*2] = (float)((g11*h2-g12*h1)*idet);
-            flow[x*2+1] = (float)((g22*h1-g12*h2)*idet);
+                flow[x*2] = (float)((g11*h2-g12*h1)*idet);
+                flow[x*2+1] = (float)((g22*h1-g12*h2)*idet);
+            }
         }
+    });
 
-        y1 = y == height - 1 ? height : y - block_size;
-        if( update_matrices && (y1 == height || y1 >= y0 + min_update_stripe) )
-        {
-            FarnebackUpdateMatrices( _R0, _R1, _flow, matM, y0, y1 );
-            y0 = y1;
-        }
-    }
+    if( update_matrices )
+        FarnebackUpdateMatrices( _R0, _R1, _flow, matM, 0, height );
 }
 
 }
@@ -586,9 +667,11 @@ class FarnebackOpticalFlowImpl : public FarnebackOpticalFlow
 {
 public:
     FarnebackOpticalFlowImpl(int numLevels=5, double pyrScale=0.5, bool fastPyramids=false, int winSize=13,
-                             int numIters=10, int polyN=5, double polySigma=1.1, int flags=0) :
+                             int numIters=10, int polyN=5, double polySigma=1.1, int flags=0,
+                             bool keepPolyExp=true) :
         numLevels_(numLevels), pyrScale_(pyrScale), fastPyramids_(fastPyramids), winSize_(winSize),
-        numIters_(numIters), polyN_(polyN), polySigma_(polySigma), flags_(flags)
+        numIters_(numIters), polyN_(polyN), polySigma_(polySigma), flags_(flags),
+        keepPolyExp_(keepPolyExp), polyExpPyrScale_(0), polyExpPolyN_(0), polyExpPolySigma_(0)
     {
     }
 
@@ -630,6 +713,22 @@ private:
     double polySigma_;
     int flags_;
 
+    // polynomial expansion of the pyramid of the last "next" frame, reused by calc() when
+    // the same frame comes back as the "prev" frame of the following pair; not kept by the
+    // one-shot objects of calcOpticalFlowFarneback()
+    bool keepPolyExp_;
+    Mat polyExpFrame_;
+    std::vector<Mat> polyExp_;
+    double polyExpPyrScale_;
+    int polyExpPolyN_;
+    double polyExpPolySigma_;
+
+    void releasePolyExp()
+    {
+        polyExpFrame_.release();
+        polyExp_.clear();
+    }
+
 #ifdef HAVE_OPENCL
     bool operator ()(const UMat &frame0, const UMat &frame1, UMat &flowx, UMat &flowy)
     {
@@ -800,6 +899,7 @@ private:
     }
     void releaseMemory()
     {
+        releasePolyExp();
         frames_[0].release();
         frames_[1].release();
         pyrLevel_[0].release();
@@ -1091,10 +1191,25 @@ private:
         return true;
     }
 #else // HAVE_OPENCL
-    virtual void collectGarbage() CV_OVERRIDE {}
+    virtual void collectGarbage() CV_OVERRIDE {
+        releasePolyExp();
+    }
 #endif
 };
 
+static bool isSameFrame( const Mat& a, const Mat& b )
+{
+    if( a.size() != b.size() || a.type() != b.type() )
+        return false;
+    if( a.data == b.data && a.step == b.step )
+        return true;
+    size_t rowSize = a.cols*a.elemSize();
+    for( int y = 0; y < a.rows; y++ )
+        if( memcmp(a.ptr(y), b.ptr(y), rowSize) != 0 )
+            return false;
+    return true;
+}
+
 void FarnebackOpticalFlowImpl::calc(InputArray _prev0, InputArray _next0,
                                     InputOutputArray _flow0)
 {
@@ -1133,6 +1248,13 @@ void FarnebackOpticalFlowImpl::calc(InputArray _prev0, InputArray _next0,
 
     levels = k;
 
+    // the expansion of prev0 does not have to be recomputed if prev0 is the "next" frame of
+    // the previous call, which is the usual case when the frames of a video are processed in turn
+    bool reusePolyExp = keepPolyExp_ && !polyExpFrame_.empty() && polyExpPyrScale_ == pyrScale_ &&
+                        polyExpPolyN_ == polyN_ && polyExpPolySigma_ == polySigma_ &&
+                        isSameFrame( prev0, polyExpFrame_ );
+    std::vector<Mat> nextPolyExp(levels+1);
+
     for( k = levels; k >= 0; k-- )
     {
         for( i = 0, scale = 1; i < k; i++ )
@@ -1169,11 +1291,18 @@ void FarnebackOpticalFlowImpl::calc(InputArray _prev0, InputArray _next0,
         Mat R[2], I, M;
         for( i = 0; i < 2; i++ )
         {
+            if( i == 0 && reusePolyExp && k < (int)polyExp_.size() && !polyExp_[k].empty() )
+            {
+                R[0] = polyExp_[k];
+                continue;
+            }
             img[i]->convertTo(fimg, CV_32F);
             GaussianBlur(fimg, fimg, Size(smooth_sz, smooth_sz), sigma, sigma);
             resize( fimg, I, Size(width, height), INTER_LINEAR );
             FarnebackPolyExp( I, R[i], polyN_, polySigma_ );
         }
+        if( keepPolyExp_ )
+            nextPolyExp[k] = R[1];
 
         FarnebackUpdateMatrices( R[0], R[1], flow, M, 0, flow.rows );
 
@@ -1187,6 +1316,14 @@ void FarnebackOpticalFlowImpl::calc(InputArray _prev0, InputArray _next0,
 
         prevFlow = flow;
     }
+
+    if( !keepPolyExp_ )
+        return;
+    polyExp_.swap(nextPolyExp);
+    next0.copyTo(polyExpFrame_);
+    polyExpPyrScale_ = pyrScale_;
+    polyExpPolyN_ = polyN_;
+    polyExpPolySigma_ = polySigma_;
 }
 } // namespace
 } // namespace cv
@@ -1198,7 +1335,7 @@ void cv::calcOpticalFlowFarneback( InputArray _prev0, InputArray _next0,
     CV_INSTRUMENT_REGION();
 
     Ptr<cv::FarnebackOpticalFlow> optflow;
-    optflow = makePtr<FarnebackOpticalFlowImpl>(levels,pyr_scale,false,winsize,iterations,poly_n,poly_sigma,flags);
+    optflow = makePtr<FarnebackOpticalFlowImpl>(levels,pyr_scale,false,winsize,iterations,poly_n,poly_sigma,flags,false);
     optflow->calc(_prev0,_next0,_flow0);
 }
 
@@ -172,4 +172,91 @@ TEST(DenseOpticalFlow_VariationalRefinement, ReferenceAccuracy)
     EXPECT_LE(calcRMSE(GT, flow), target_RMSE);
 }
 
+static Mat makeFarnebackFrame(const Mat& scene, Point2f shift)
+{
+    Mat frame, A = (Mat_<double>(2, 3) << 1, 0, -shift.x, 0, 1, -shift.y);
+    warpAffine(scene, frame, A, Size(scene.cols - 32, scene.rows - 32), INTER_LINEAR, BORDER_REFLECT);
+    return frame;
+}
+
+TEST(DenseOpticalFlow_Farneback, SyntheticShift)
+{
+    RNG& rng = theRNG();
+    Mat scene(272, 352, CV_8U);
+    rng.fill(scene, RNG::UNIFORM, 0, 255);
+    GaussianBlur(scene, scene, Size(0, 0), 2.0);
+    normalize(scene, scene, 0, 255, NORM_MINMAX);
+
+    for (int flags = 0; flags <= OPTFLOW_FARNEBACK_GAUSSIAN; flags += OPTFLOW_FARNEBACK_GAUSSIAN)
+    {
+        Mat frame1 = makeFarnebackFrame(scene, Point2f(8, 8));
+        Mat frame2 = makeFarnebackFrame(scene, Point2f(10.5f, 6.75f));
+        Mat flow;
+        calcOpticalFlowFarneback(frame1, frame2, flow, 0.5, 3, 15, 3, 5, 1.1, flags);
+
+        Scalar meanFlow = mean(flow(Rect(16, 16, flow.cols - 32, flow.rows - 32)));
+        EXPECT_NEAR(-2.5, meanFlow[0], 0.05) << "flags=" << flags;
+        EXPECT_NEAR(1.25, meanFlow[1], 0.05) << "flags=" << flags;
+    }
+}
+
+TEST(DenseOpticalFlow_Farneback, SequenceMatchesSeparateCalls)
+{
+    RNG& rng = theRNG();
+    Mat scene(272, 352, CV_8U);
+    rng.fill(scene, RNG::UNIFORM, 0, 255);
+    GaussianBlur(scene, scene, Size(0, 0), 2.0);
+
+    Mat frame0 = makeFarnebackFrame(scene, Point2f(8, 8));
+    Mat frame1 = makeFarnebackFrame(scene, Point2f(9, 7.5f));
+    Mat frame2 = makeFarnebackFrame(scene, Point2f(10.5f, 7));
+
+    // the flow of a pair must not depend on what the object was given before
+    Ptr<FarnebackOpticalFlow> sequence = FarnebackOpticalFlow::create();
+    Mat flow01, flow12, flow12_ref;
+    sequence->calc(frame0, frame1, flow01);
+    sequence->calc(frame1.clone(), frame2, flow12);
+
+    Ptr<FarnebackOpticalFlow> single = FarnebackOpticalFlow::create();
+    single->calc(frame1, frame2, flow12_ref);
+    EXPECT_EQ(0, cvtest::norm(flow12, flow12_ref, NORM_INF));
+
+    Mat flow02, flow02_ref;
+    sequence->calc(frame0, frame2, flow02);
+    single->collectGarbage();
+    single->calc(frame0, frame2, flow02_ref);
+    EXPECT_EQ(0, cvtest::norm(flow02, flow02_ref, NORM_INF));
+
+    // the last frame is changed in place, so it keeps its address but not its content
+    Mat frame = frame2.clone(), flow, flow_ref;
+    sequence->calc(frame1, frame, flow);
+    frame1.copyTo(frame);
+    sequence->calc(frame, frame0, flow);
+    single->calc(frame1, frame0, flow_ref);
+    EXPECT_EQ(0, cvtest::norm(flow, flow_ref, NORM_INF));
+}
+
+TEST(DenseOpticalFlow_Farneback, IndependentOfThreadCount)
+{
+    RNG& rng = theRNG();
+    Mat scene(272, 352, CV_8U);
+    rng.fill(scene, RNG::UNIFORM, 0, 255);
+    GaussianBlur(scene, scene, Size(0, 0), 2.0);
+
+    Mat frame1 = makeFarnebackFrame(scene, Point2f(8, 8));
+    Mat frame2 = makeFarnebackFrame(scene, Point2f(10.5f, 6.75f));
+
+    int nthreads = getNumThreads();
+    for (int flags = 0; flags <= OPTFLOW_FARNEBACK_GAUSSIAN; flags += OPTFLOW_FARNEBACK_GAUSSIAN)
+    {
+        Mat flow, flow_ref;
+        setNumThreads(1);
+        calcOpticalFlowFarneback(frame1, frame2, flow_ref, 0.5, 3, 15, 3, 5, 1.1, flags);
+        setNumThreads(std::max(nthreads, 4));
+        calcOpticalFlowFarneback(frame1, frame2, flow, 0.5, 3, 15, 3, 5, 1.1, flags);
+        setNumThreads(nthreads);
+        EXPECT_EQ(0, cvtest::norm(flow, flow_ref, NORM_INF)) << "flags=" << flags;
+    }
+}
+
 }} // namespace
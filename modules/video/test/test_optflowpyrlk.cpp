@@ -249,4 +249,117 @@ TEST(Video_OpticalFlowPyrLK, submat)
     ASSERT_NO_THROW(cv::calcOpticalFlowPyrLK(img1, img2, prev, next, status, error));
 }
 
+
+static Mat makeShiftedFrame(const Mat& scene, Point2f shift, Size size)
+{
+    Mat frame, A = (Mat_<double>(2, 3) << 1, 0, -shift.x, 0, 1, -shift.y);
+    warpAffine(scene, frame, A, size, INTER_LINEAR, BORDER_REFLECT);
+    return frame;
+}
+
+TEST(Video_SparsePyrLKPointTracker, sequence)
+{
+    RNG& rng = theRNG();
+    Mat scene(300, 400, CV_8U);
+    rng.fill(scene, RNG::UNIFORM, 0, 255);
+    GaussianBlur(scene, scene, Size(0, 0), 1.5);
+
+    Size size(320, 240);
+    Point2f shifts[] = { Point2f(20, 20), Point2f(21.5f, 19.25f), Point2f(23, 18.75f) };
+    std::vector<Mat> frames;
+    for (int i = 0; i < 3; i++)
+        frames.push_back(makeShiftedFrame(scene, shifts[i], size));
+
+    // the points close to the borders go through the scalar code of the last window rows
+    std::vector<Point2f> pts;
+    for (int y = 2; y < size.height; y += 9)
+        for (int x = 3; x < size.width; x += 11)
+            pts.push_back(Point2f(x + 0.25f, y + 0.5f));
+    pts.push_back(Point2f(size.width - 1.f, size.height - 1.f));
+
+    Ptr<SparsePyrLKPointTracker> tracker = SparsePyrLKPointTracker::create();
+    tracker->setFBThreshold(0);
+    for (int i = 0; i < 2; i++)
+    {
+        std::vector<Point2f> next, nextRef;
+        std::vector<uchar> status, statusRef;
+        std::vector<float> err, errRef;
+        // the second call gets a copy of the frame kept from the first one
+        tracker->calc(frames[i].clone(), frames[i + 1], pts, next, status, err);
+        calcOpticalFlowPyrLK(frames[i], frames[i + 1], pts, nextRef, statusRef, errRef);
+
+        ASSERT_EQ(pts.size(), next.size());
+        EXPECT_EQ(0, cvtest::norm(Mat(next), Mat(nextRef), NORM_INF)) << "frame " << i;
+        EXPECT_EQ(0, cvtest::norm(Mat(status), Mat(statusRef), NORM_INF)) << "frame " << i;
+        EXPECT_EQ(0, cvtest::norm(Mat(err), Mat(errRef), NORM_INF)) << "frame " << i;
+
+        Point2f motion = shifts[i] - shifts[i + 1];
+        int tracked = 0;
+        for (size_t j = 0; j < pts.size(); j++)
+        {
+            if (!status[j] || pts[j].x < 15 || pts[j].y < 15 ||
+                pts[j].x > size.width - 15 || pts[j].y > size.height - 15)
+                continue;
+            tracked++;
+            EXPECT_LE(cv::norm(next[j] - pts[j] - motion), 0.1) << "frame " << i << " point " << pts[j];
+        }
+        EXPECT_GT(tracked, (int)pts.size()/2);
+    }
+}
+
+TEST(Video_SparsePyrLKPointTracker, forward_backward_check)
+{
+    RNG& rng = theRNG();
+    Mat scene(300, 400, CV_8U);
+    rng.fill(scene, RNG::UNIFORM, 0, 255);
+    GaussianBlur(scene, scene, Size(0, 0), 1.5);
+
+    Size size(320, 240);
+    Mat frame0 = makeShiftedFrame(scene, Point2f(20, 20), size);
+    Mat frame1 = makeShiftedFrame(scene, Point2f(22, 21), size);
+
+    // a part of the second frame is replaced by an unrelated texture
+    Rect occluded(200, 60, 80, 80);
+    Mat patch(occluded.size(), CV_8U);
+    rng.fill(patch, RNG::UNIFORM, 0, 255);
+    GaussianBlur(patch, patch, Size(0, 0), 1.5);
+    patch.copyTo(frame1(occluded));
+
+    std::vector<Point2f> pts;
+    for (int y = 30; y < size.height - 30; y += 6)
+        for (int x = 30; x < size.width - 30; x += 6)
+            pts.push_back(Point2f((float)x, (float)y));
+
+    Ptr<SparsePyrLKPointTracker> tracker = SparsePyrLKPointTracker::create(Size(15, 15), 3);
+    tracker->setFBThreshold(0.5);
+    std::vector<Point2f> next;
+    std::vector<uchar> status;
+    tracker->calc(frame0, frame1, pts, next, status);
+
+    // any point whose window is occluded can be lost, the points well inside must be lost
+    int lostInside = 0, inside = 0, lostOutside = 0, outside = 0;
+    Rect inner(occluded.x + 10, occluded.y + 10, occluded.width - 20, occluded.height - 20);
+    Rect outer(occluded.x - 20, occluded.y - 20, occluded.width + 40, occluded.height + 40);
+    for (size_t i = 0; i < pts.size(); i++)
+    {
+        Point pt(cvRound(pts[i].x), cvRound(pts[i].y));
+        if (inner.contains(pt))
+        {
+            inside++;
+            lostInside += !status[i];
+        }
+        else if (!outer.contains(pt))
+        {
+            outside++;
+            lostOutside += !status[i];
+            if (status[i])
+            {
+                EXPECT_LE(cv::norm(next[i] - pts[i] - Point2f(-2, -1)), 0.1) << pts[i];
+            }
+        }
+    }
+    EXPECT_GE(lostInside, inside*9/10);
+    EXPECT_LE(lostOutside, outside/50);
+}
+
 }} // namespace